@@ -0,0 +1,305 @@
+#include "AllocationBenchmark.h"
+#include "BenchmarkFixtures.h"
+#include "AllocationTracker.h"
+#include "Profiler.h"
+#include "Robot.h"
+#include "RenderQueue.h"
+#include "RecordingRenderDevice.h"
+#include "CountingRenderDevice.h"
+#include "ShaderStructures.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <thread>
+
+using namespace std;
+
+// Allocations made when timing operator new, and their size
+constexpr int ALLOCATION_BENCHMARK_ALLOCATIONS = 1000000;
+constexpr size_t ALLOCATION_BENCHMARK_SIZE = 64;
+
+// Robots in the crowd, which are split into tiles of robots that are each updated as one task when
+// there is a thread pool, the frames each run is given to warm up (while the buffers of the render queue
+// and the device grow to the size they need), and the frames that are then checked
+constexpr size_t ALLOCATION_BENCHMARK_ROBOTS = 256;
+constexpr size_t ALLOCATION_BENCHMARK_TILE_ROBOTS = 16;
+constexpr size_t ALLOCATION_BENCHMARK_ROBOT_NODES = 10;
+constexpr uint64_t ALLOCATION_BENCHMARK_WARM_UP_FRAMES = 10;
+constexpr uint64_t ALLOCATION_BENCHMARK_FRAMES = 200;
+
+// Over-aligned blocks allocated in the nested zone, which use the std::align_val_t forms of operator new
+// where the compiler supports them
+#if defined( __cpp_aligned_new )
+constexpr int ALLOCATION_BENCHMARK_ALIGNED_BLOCKS = 2;
+#else
+constexpr int ALLOCATION_BENCHMARK_ALIGNED_BLOCKS = 0;
+#endif
+constexpr size_t ALLOCATION_BENCHMARK_ALIGNMENT = 64;
+
+struct alignas(ALLOCATION_BENCHMARK_ALIGNMENT) AlignedBenchmarkBlock
+{
+	char	Bytes[ALLOCATION_BENCHMARK_ALIGNMENT];
+};
+
+constexpr float ALLOCATION_BENCHMARK_SPACING = 20.0f;
+constexpr uint32_t ALLOCATION_BENCHMARK_INSTANCE_SIZE = offsetof(CBuffer, DirectionalLightColour);
+
+// The time taken to allocate and free a block, in nanoseconds.  The pointers are kept in blocks so
+// that the allocations cannot be optimised away.
+
+double TimeAllocations(vector<char *>& blocks)
+{
+	auto start = chrono::steady_clock::now();
+	for (int i = 0; i < ALLOCATION_BENCHMARK_ALLOCATIONS; i++)
+	{
+		char *& block = blocks[i % blocks.size()];
+		delete[] block;
+		block = new char[ALLOCATION_BENCHMARK_SIZE];
+	}
+	return static_cast<double>(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count()) / ALLOCATION_BENCHMARK_ALLOCATIONS;
+}
+
+// The counts for the zone given in the last frame, or nothing if it did not allocate
+
+AllocationCounts FindZoneAllocations(const vector<ZoneAllocations>& zones, const char * zone)
+{
+	for (const ZoneAllocations& zoneAllocations : zones)
+	{
+		if (zoneAllocations.Zone == zone)
+		{
+			return zoneAllocations.Counts;
+		}
+	}
+	return AllocationCounts();
+}
+
+int RunAllocationBenchmarks(const std::string& resultsFileName, const std::string& reportFileName)
+{
+	ofstream results(resultsFileName);
+	if (!results)
+	{
+		return -1;
+	}
+
+	// The tracker and the profiler are shared by the whole process, so they are put back as they were
+	bool profilerWasEnabled = Profiler::IsEnabled();
+	bool allPassed = true;
+
+	// The cost of an allocation with the tracker disabled, enabled outside any zone and enabled inside a zone
+	results << "benchmark,allocations,disabled_ns,enabled_ns,enabled_in_zone_ns,overhead_ns" << endl;
+	{
+		vector<char *> blocks(256, nullptr);
+		double disabledTime = TimeAllocations(blocks);
+		AllocationTracker::SetEnabled(true);
+		Profiler::SetEnabled(false);
+		double enabledTime = TimeAllocations(blocks);
+		Profiler::SetEnabled(true);
+		double zoneTime;
+		{
+			PROFILE_ZONE("AllocationBenchmark::TimeAllocations");
+			zoneTime = TimeAllocations(blocks);
+		}
+		AllocationTracker::SetEnabled(false);
+		for (char * block : blocks)
+		{
+			delete[] block;
+		}
+		results << "overhead," << ALLOCATION_BENCHMARK_ALLOCATIONS << "," << disabledTime << "," << enabledTime << "," << zoneTime << ","
+				<< zoneTime - disabledTime << endl;
+	}
+
+	// Allocations and resources made in and out of zones, which must each be put down to the right zone
+	results << "benchmark,zone_allocations,zone_bytes,zone_frees,nested_allocations,unzoned_allocations,resources,resource_bytes,"
+			<< "next_frame_allocations,attributed_correctly" << endl;
+	{
+		const char * outerZone = "AllocationBenchmark::Outer";
+		const char * innerZone = "AllocationBenchmark::Inner";
+		const char * deviceZone = "AllocationBenchmark::CreateResources";
+		Profiler::SetEnabled(true);
+		RecordingRenderDevice device;
+		vector<unique_ptr<char[]>> blocks;
+		blocks.reserve(64);
+		vector<unique_ptr<AlignedBenchmarkBlock>> alignedBlocks;
+		alignedBlocks.reserve(ALLOCATION_BENCHMARK_ALIGNED_BLOCKS + 1);
+		vector<ZoneAllocations> zones;
+		zones.reserve(AllocationTracker::MAXIMUM_ZONES);
+
+		// The zones are run once first, so that this thread's profile buffer has been created
+		{
+			ProfileZone outer(outerZone);
+			ProfileZone inner(innerZone);
+		}
+		AllocationTracker::SetEnabled(true);
+		AllocationTracker::BeginFrame();
+		{
+			ProfileZone outer(outerZone);
+			for (int i = 0; i < 10; i++)
+			{
+				blocks.emplace_back(new char[100]);
+			}
+			blocks[0].reset();
+			{
+				ProfileZone inner(innerZone);
+				for (int i = 0; i < 3; i++)
+				{
+					blocks.emplace_back(new char[1000]);
+				}
+#if defined( __cpp_aligned_new )
+				for (int i = 0; i < ALLOCATION_BENCHMARK_ALIGNED_BLOCKS; i++)
+				{
+					alignedBlocks.emplace_back(new AlignedBenchmarkBlock);
+				}
+#endif
+			}
+		}
+		for (int i = 0; i < 5; i++)
+		{
+			blocks.emplace_back(new char[50]);
+		}
+		{
+			ProfileZone create(deviceZone);
+			device.CreateVertexBuffer(nullptr, 4096);
+			device.CreateIndexBuffer(nullptr, 1024);
+			device.CreateConstantBuffer(256);
+		}
+		AllocationTracker::BeginFrame();
+		AllocationTracker::GetLastFrameZones(zones);
+		AllocationCounts outer = FindZoneAllocations(zones, outerZone);
+		AllocationCounts inner = FindZoneAllocations(zones, innerZone);
+		AllocationCounts unzoned = FindZoneAllocations(zones, nullptr);
+		AllocationCounts resources = FindZoneAllocations(zones, deviceZone);
+		AllocationCounts lastFrame = AllocationTracker::GetLastFrame();
+
+		// Nothing happens in the next frame
+		AllocationTracker::BeginFrame();
+		AllocationCounts emptyFrame = AllocationTracker::GetLastFrame();
+		AllocationTracker::SetEnabled(false);
+
+		// The device records its commands, so it allocates too, but those allocations are in the zone
+		bool aligned = true;
+		for (const unique_ptr<AlignedBenchmarkBlock>& block : alignedBlocks)
+		{
+			aligned = aligned && reinterpret_cast<uintptr_t>(block.get()) % ALLOCATION_BENCHMARK_ALIGNMENT == 0;
+		}
+		const size_t innerAllocations = 3 + ALLOCATION_BENCHMARK_ALIGNED_BLOCKS;
+		const size_t innerBytes = 3000 + ALLOCATION_BENCHMARK_ALIGNED_BLOCKS * sizeof(AlignedBenchmarkBlock);
+		bool attributed = outer.Allocations == 10 && outer.Bytes == 1000 && outer.Frees == 1 && inner.Allocations == innerAllocations && inner.Bytes == innerBytes && aligned
+						  && unzoned.Allocations == 5 && unzoned.Bytes == 250 && resources.Resources == 3 && resources.ResourceBytes == 4096 + 1024 + 256
+						  && lastFrame.Allocations == outer.Allocations + inner.Allocations + unzoned.Allocations + resources.Allocations
+						  && lastFrame.Resources == 3 && emptyFrame.Allocations == 0 && emptyFrame.Resources == 0;
+		allPassed = allPassed && attributed;
+		results << "attribution," << outer.Allocations << "," << outer.Bytes << "," << outer.Frees << "," << inner.Allocations << "," << unzoned.Allocations << ","
+				<< resources.Resources << "," << resources.ResourceBytes << "," << emptyFrame.Allocations << "," << (attributed ? "yes" : "no") << endl;
+	}
+
+	// Whole frames for a crowd of robots, which must not allocate once they have warmed up.  The last
+	// run allocates in one frame on purpose, which must be caught and put down to the right zone.
+	results << "benchmark,robots,threads,frames,checked_frames,failed_frames,allocations,bytes,first_failure_zone,steady_state" << endl;
+	{
+		AnimationClipPointer clip = CreateRobotClip();
+		NodePool nodePool;
+		RenderQueue queue;
+		uint32_t programIndex = queue.AddShaderProgram(BenchmarkCubeProgram(sizeof(CBuffer), ALLOCATION_BENCHMARK_INSTANCE_SIZE, 1024));
+		uint32_t meshIndex = queue.AddMesh(BenchmarkCubeMesh());
+
+		SceneGraphPointer root = nodePool.Create<SceneGraph>();
+		AnimationSystem animation(*root);
+		size_t side = 16;
+		SceneGraphPointer tile;
+		for (size_t i = 0; i < ALLOCATION_BENCHMARK_ROBOTS; i++)
+		{
+			if (i % ALLOCATION_BENCHMARK_TILE_ROBOTS == 0)
+			{
+				tile = nodePool.Create<SceneGraph>(L"Tile");
+				root->Add(tile);
+			}
+			SceneGraphPointer placement = nodePool.Create<SceneGraph>(L"Robot");
+			placement->SetWorldTransform(Matrix::CreateTranslation(Vector3((i % side) * ALLOCATION_BENCHMARK_SPACING, 0.0f, (i / side) * ALLOCATION_BENCHMARK_SPACING)));
+			tile->Add(placement);
+			SceneGraphPointer robot = nodePool.Create<SceneGraph>(L"Body");
+			placement->Add(robot);
+			animation.AddRig(BuildRobot(*robot, nodePool,
+								[&](const wstring& name, const Vector4& colour)
+								{
+									return nodePool.Create<BenchmarkCubeNode>(name, colour, Matrix::Identity, programIndex, meshIndex);
+								}));
+		}
+		for (uint32_t rig = 0; rig < animation.GetRigCount(); rig++)
+		{
+			animation.Play(rig, clip, static_cast<float>(rig % 97) * 0.1f);
+		}
+		root->Initialise();
+		root->SetRenderQueue(&queue);
+		Matrix viewTransformation = XMMatrixLookAtLH(Vector3(150.0f, 60.0f, -100.0f), Vector3(150.0f, 20.0f, 150.0f), Vector3(0.0f, 1.0f, 0.0f));
+		root->SetViewFrustum(Frustum(viewTransformation * XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, 1.0f, 10000.0f)));
+
+		RecordingRenderDevice device;
+		RenderStatistics renderStatistics;
+		CountingRenderDevice countingDevice(device, renderStatistics);
+		const float background[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		const char * allocatingZone = "AllocationBenchmark::AllocatingFrame";
+		Matrix identity;
+		unsigned int maximumThreads = max(thread::hardware_concurrency(), 2u);
+		Profiler::SetEnabled(true);
+
+		for (int run = 0; run < 3; run++)
+		{
+			unsigned int threads = run == 0 ? 1 : maximumThreads;
+			bool allocateOnPurpose = run == 2;
+			unique_ptr<ThreadPool> threadPool = threads > 1 ? make_unique<ThreadPool>(threads) : nullptr;
+			root->SetThreadPool(threadPool.get(), ALLOCATION_BENCHMARK_TILE_ROBOTS * ALLOCATION_BENCHMARK_ROBOT_NODES);
+
+			AllocationTracker::CheckSteadyState(true, ALLOCATION_BENCHMARK_WARM_UP_FRAMES);
+			AllocationTracker::SetEnabled(true);
+			uint64_t frameCount = ALLOCATION_BENCHMARK_WARM_UP_FRAMES + ALLOCATION_BENCHMARK_FRAMES;
+			unique_ptr<char[]> allocatedOnPurpose;
+			for (uint64_t frame = 0; frame < frameCount; frame++)
+			{
+				AllocationTracker::BeginFrame();
+				PROFILE_ZONE("AllocationBenchmark::Frame");
+				device.Clear();
+				animation.Update(ANIMATION_FRAME_TIME);
+				root->Update(identity);
+				queue.BeginFrame(viewTransformation, 1.0f, 10000.0f);
+				root->Render();
+				queue.Sort();
+				countingDevice.Clear(background, 1.0f);
+				queue.Submit(countingDevice);
+				renderStatistics.EndFrame(frame);
+				if (allocateOnPurpose && frame == frameCount / 2)
+				{
+					PROFILE_ZONE(allocatingZone);
+					allocatedOnPurpose.reset(new char[ALLOCATION_BENCHMARK_SIZE]);
+				}
+			}
+			AllocationTracker::BeginFrame();
+			AllocationTracker::SetEnabled(false);
+			AllocationTracker::CheckSteadyState(false);
+			root->SetThreadPool(nullptr);
+
+			vector<ZoneAllocations> failureZones;
+			AllocationTracker::GetFirstFailureZones(failureZones);
+			auto allocated = find_if(failureZones.begin(), failureZones.end(), [](const ZoneAllocations& zone) { return zone.Counts.Allocations > 0; });
+			const char * firstFailureZone = allocated == failureZones.end() ? "" : (allocated->Zone != nullptr ? allocated->Zone : "(no zone)");
+			uint64_t failedFrames = AllocationTracker::GetFailedFrameCount();
+			bool passes = allocateOnPurpose ? failedFrames == 1 && allocated != failureZones.end() && allocated->Zone == allocatingZone && allocated->Counts.Allocations == 1
+										: failedFrames == 0;
+			allPassed = allPassed && passes;
+			AllocationCounts total = AllocationTracker::GetTotal();
+			results << (allocateOnPurpose ? "allocating_frame," : "steady_state,") << ALLOCATION_BENCHMARK_ROBOTS << "," << threads << "," << frameCount << ","
+					<< ALLOCATION_BENCHMARK_FRAMES << "," << failedFrames << "," << total.Allocations << "," << total.Bytes << "," << firstFailureZone << ","
+					<< (passes ? "yes" : "no") << endl;
+			if (run == 1)
+			{
+				allPassed = AllocationTracker::WriteReport(reportFileName) && allPassed;
+			}
+		}
+	}
+	Profiler::SetEnabled(profilerWasEnabled);
+	return allPassed ? 0 : 1;
+}
@@ -0,0 +1,13 @@
+#pragma once
+#include <string>
+
+// Benchmarks and checks for the allocation tracker.  The cost of an allocation is measured with the
+// tracker disabled and enabled, and the allocations and resources made in a frame are checked to be
+// put down to the right profiler zones.  Then a crowd of robots is animated, updated, culled and
+// submitted to a RecordingRenderDevice for a run of frames, with and without a thread pool, and every
+// frame after the first few must not allocate.  A frame that does allocate must be caught.
+//
+// The results are written as comma-separated values to the file given, and the tracker's report of
+// the robot frames to reportFileName.
+
+int RunAllocationBenchmarks(const std::string& resultsFileName, const std::string& reportFileName);
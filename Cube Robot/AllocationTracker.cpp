@@ -0,0 +1,513 @@
+#include "AllocationTracker.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+
+#if defined( _WIN32 )
+#include <malloc.h>
+#endif
+
+std::atomic<bool> AllocationTracker::_enabled{ false };
+
+namespace
+{
+	// The counts of one zone for the frame being counted.  The first counter is for allocations made
+	// outside any zone, and the others are claimed by zones the first time they allocate.  These are
+	// written by every thread, so they must not need constructing before the first allocation.
+
+	struct ZoneCounter
+	{
+		std::atomic<const char *>	Zone;
+		std::atomic<size_t>			Allocations;
+		std::atomic<size_t>			Bytes;
+		std::atomic<size_t>			Frees;
+		std::atomic<size_t>			Resources;
+		std::atomic<size_t>			ResourceBytes;
+	};
+
+	ZoneCounter zoneCounters[AllocationTracker::MAXIMUM_ZONES];
+
+	// The finished frames.  These are only used by the thread running the main loop.
+
+	struct AllocationFrame
+	{
+		uint64_t			Frame{ 0 };
+		AllocationCounts	Counts;
+	};
+
+	struct AllocationFrames
+	{
+		uint64_t			Frame{ 0 };				// The frame being counted
+		AllocationCounts	LastFrame;
+		ZoneAllocations		LastFrameZones[AllocationTracker::MAXIMUM_ZONES];
+		size_t				LastFrameZoneCount{ 0 };
+		AllocationCounts	Total;					// Of the finished frames
+		AllocationCounts	ZoneTotals[AllocationTracker::MAXIMUM_ZONES];
+		AllocationFrame		History[AllocationTracker::ALLOCATION_HISTORY_FRAMES];
+
+		bool				CheckSteadyState{ false };
+		uint64_t			WarmUpFrames{ 0 };
+		uint64_t			SteadyStateFrame{ 0 };	// The first frame that must not allocate
+		uint64_t			FailedFrames{ 0 };
+		uint64_t			FirstFailedFrame{ 0 };
+		ZoneAllocations		FirstFailureZones[AllocationTracker::MAXIMUM_ZONES];
+		size_t				FirstFailureZoneCount{ 0 };
+	};
+
+	AllocationFrames allocationFrames;
+
+	ZoneCounter& FindZoneCounter(const char * zone)
+	{
+		if (zone == nullptr)
+		{
+			return zoneCounters[0];
+		}
+
+		// Zone names are string literals, so each zone is known by its pointer.  Once a zone has claimed
+		// a counter, it keeps it.
+		const size_t zoneCounterCount = AllocationTracker::MAXIMUM_ZONES - 1;
+		size_t first = static_cast<size_t>((reinterpret_cast<uintptr_t>(zone) >> 3) % zoneCounterCount);
+		for (size_t probe = 0; probe < zoneCounterCount; probe++)
+		{
+			ZoneCounter& counter = zoneCounters[1 + (first + probe) % zoneCounterCount];
+			const char * current = counter.Zone.load(std::memory_order_acquire);
+			if (current == nullptr)
+			{
+				if (counter.Zone.compare_exchange_strong(current, zone, std::memory_order_acq_rel))
+				{
+					return counter;
+				}
+			}
+			if (current == zone)
+			{
+				return counter;
+			}
+		}
+		return zoneCounters[0];
+	}
+
+	// Take the counts from a counter, leaving it clear for the next frame
+
+	AllocationCounts TakeZoneCounts(ZoneCounter& counter)
+	{
+		AllocationCounts counts;
+		counts.Allocations = counter.Allocations.exchange(0, std::memory_order_relaxed);
+		counts.Bytes = counter.Bytes.exchange(0, std::memory_order_relaxed);
+		counts.Frees = counter.Frees.exchange(0, std::memory_order_relaxed);
+		counts.Resources = counter.Resources.exchange(0, std::memory_order_relaxed);
+		counts.ResourceBytes = counter.ResourceBytes.exchange(0, std::memory_order_relaxed);
+		return counts;
+	}
+
+	void AddAllocationCounts(AllocationCounts& total, const AllocationCounts& counts)
+	{
+		total.Allocations += counts.Allocations;
+		total.Bytes += counts.Bytes;
+		total.Frees += counts.Frees;
+		total.Resources += counts.Resources;
+		total.ResourceBytes += counts.ResourceBytes;
+	}
+
+	void WriteAllocationCounts(std::ostream& report, const AllocationCounts& counts)
+	{
+		report << counts.Allocations << "," << counts.Bytes << "," << counts.Frees << "," << counts.Resources << "," << counts.ResourceBytes << std::endl;
+	}
+}
+
+void AllocationTracker::SetEnabled(bool enabled)
+{
+	// Counting starts again from nothing
+	if (enabled && !IsEnabled())
+	{
+		for (ZoneCounter& counter : zoneCounters)
+		{
+			TakeZoneCounts(counter);
+		}
+		bool checkSteadyState = allocationFrames.CheckSteadyState;
+		uint64_t warmUpFrames = allocationFrames.WarmUpFrames;
+		allocationFrames = AllocationFrames();
+		CheckSteadyState(checkSteadyState, warmUpFrames);
+	}
+	_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void AllocationTracker::CheckSteadyState(bool check, uint64_t warmUpFrames)
+{
+	// The frame being counted has already started, so it is not checked
+	allocationFrames.CheckSteadyState = check;
+	allocationFrames.WarmUpFrames = warmUpFrames;
+	allocationFrames.SteadyStateFrame = allocationFrames.Frame + 1 + warmUpFrames;
+}
+
+void AllocationTracker::BeginFrame()
+{
+	if (!IsEnabled())
+	{
+		return;
+	}
+	AllocationFrames& frames = allocationFrames;
+	AllocationCounts frame;
+	frames.LastFrameZoneCount = 0;
+	for (size_t i = 0; i < MAXIMUM_ZONES; i++)
+	{
+		ZoneCounter& counter = zoneCounters[i];
+		const char * zone = counter.Zone.load(std::memory_order_acquire);
+		if (i > 0 && zone == nullptr)
+		{
+			continue;
+		}
+		AllocationCounts counts = TakeZoneCounts(counter);
+		if (counts.Allocations == 0 && counts.Frees == 0 && counts.Resources == 0)
+		{
+			continue;
+		}
+		AddAllocationCounts(frame, counts);
+		AddAllocationCounts(frames.ZoneTotals[i], counts);
+		frames.LastFrameZones[frames.LastFrameZoneCount++] = ZoneAllocations{ zone, counts };
+	}
+	frames.LastFrame = frame;
+	AddAllocationCounts(frames.Total, frame);
+	frames.History[frames.Frame % ALLOCATION_HISTORY_FRAMES] = AllocationFrame{ frames.Frame, frame };
+
+	if (frames.CheckSteadyState && frames.Frame >= frames.SteadyStateFrame && (frame.Allocations > 0 || frame.Resources > 0))
+	{
+		if (frames.FailedFrames == 0)
+		{
+			frames.FirstFailedFrame = frames.Frame;
+			frames.FirstFailureZoneCount = frames.LastFrameZoneCount;
+			std::copy(frames.LastFrameZones, frames.LastFrameZones + frames.LastFrameZoneCount, frames.FirstFailureZones);
+		}
+		frames.FailedFrames++;
+	}
+	frames.Frame++;
+}
+
+uint64_t AllocationTracker::GetFrameCount()
+{
+	return allocationFrames.Frame;
+}
+
+AllocationCounts AllocationTracker::GetLastFrame()
+{
+	return allocationFrames.LastFrame;
+}
+
+void AllocationTracker::GetLastFrameZones(std::vector<ZoneAllocations>& zones)
+{
+	zones.insert(zones.end(), allocationFrames.LastFrameZones, allocationFrames.LastFrameZones + allocationFrames.LastFrameZoneCount);
+}
+
+AllocationCounts AllocationTracker::GetTotal()
+{
+	AllocationCounts total = allocationFrames.Total;
+	for (ZoneCounter& counter : zoneCounters)
+	{
+		total.Allocations += counter.Allocations.load(std::memory_order_relaxed);
+		total.Bytes += counter.Bytes.load(std::memory_order_relaxed);
+		total.Frees += counter.Frees.load(std::memory_order_relaxed);
+		total.Resources += counter.Resources.load(std::memory_order_relaxed);
+		total.ResourceBytes += counter.ResourceBytes.load(std::memory_order_relaxed);
+	}
+	return total;
+}
+
+uint64_t AllocationTracker::GetFailedFrameCount()
+{
+	return allocationFrames.FailedFrames;
+}
+
+void AllocationTracker::GetFirstFailureZones(std::vector<ZoneAllocations>& zones)
+{
+	zones.insert(zones.end(), allocationFrames.FirstFailureZones, allocationFrames.FirstFailureZones + allocationFrames.FirstFailureZoneCount);
+}
+
+bool AllocationTracker::WriteReport(const std::string& fileName)
+{
+	std::ofstream report(fileName);
+	if (!report)
+	{
+		return false;
+	}
+	const AllocationFrames& frames = allocationFrames;
+	report << "frames,failed_frames,first_failed_frame,allocations,bytes,frees,resources,resource_bytes" << std::endl;
+	report << frames.Frame << "," << frames.FailedFrames << "," << frames.FirstFailedFrame << ",";
+	WriteAllocationCounts(report, frames.Total);
+
+	report << "zone,allocations,bytes,frees,resources,resource_bytes" << std::endl;
+	for (size_t i = 0; i < MAXIMUM_ZONES; i++)
+	{
+		const AllocationCounts& counts = frames.ZoneTotals[i];
+		if (counts.Allocations == 0 && counts.Frees == 0 && counts.Resources == 0)
+		{
+			continue;
+		}
+		const char * zone = zoneCounters[i].Zone.load(std::memory_order_acquire);
+		report << (zone != nullptr ? zone : "(no zone)") << ",";
+		WriteAllocationCounts(report, counts);
+	}
+
+	if (frames.FailedFrames > 0)
+	{
+		report << "first_failure_zone,allocations,bytes,frees,resources,resource_bytes" << std::endl;
+		for (size_t i = 0; i < frames.FirstFailureZoneCount; i++)
+		{
+			const ZoneAllocations& zone = frames.FirstFailureZones[i];
+			report << (zone.Zone != nullptr ? zone.Zone : "(no zone)") << ",";
+			WriteAllocationCounts(report, zone.Counts);
+		}
+	}
+
+	report << "frame,allocations,bytes,frees,resources,resource_bytes" << std::endl;
+	uint64_t firstFrame = frames.Frame > ALLOCATION_HISTORY_FRAMES ? frames.Frame - ALLOCATION_HISTORY_FRAMES : 0;
+	for (uint64_t frame = firstFrame; frame < frames.Frame; frame++)
+	{
+		const AllocationFrame& history = frames.History[frame % ALLOCATION_HISTORY_FRAMES];
+		report << history.Frame << ",";
+		WriteAllocationCounts(report, history.Counts);
+	}
+	return static_cast<bool>(report);
+}
+
+void AllocationTracker::RecordAllocation(size_t bytes)
+{
+	ZoneCounter& counter = FindZoneCounter(Profiler::GetCurrentZone());
+	counter.Allocations.fetch_add(1, std::memory_order_relaxed);
+	counter.Bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void AllocationTracker::RecordFree()
+{
+	FindZoneCounter(Profiler::GetCurrentZone()).Frees.fetch_add(1, std::memory_order_relaxed);
+}
+
+void AllocationTracker::RecordResource(size_t bytes)
+{
+	if (IsEnabled())
+	{
+		ZoneCounter& counter = FindZoneCounter(Profiler::GetCurrentZone());
+		counter.Resources.fetch_add(1, std::memory_order_relaxed);
+		counter.ResourceBytes.fetch_add(bytes, std::memory_order_relaxed);
+	}
+}
+
+#if !defined( ALLOCATION_TRACKER_DISABLED )
+
+namespace
+{
+	void * AllocateCounted(std::size_t size)
+	{
+		size = size == 0 ? 1 : size;
+		void * memory;
+		while ((memory = std::malloc(size)) == nullptr)
+		{
+			std::new_handler handler = std::get_new_handler();
+			if (handler == nullptr)
+			{
+				throw std::bad_alloc();
+			}
+			handler();
+		}
+		if (AllocationTracker::IsEnabled())
+		{
+			AllocationTracker::RecordAllocation(size);
+		}
+		return memory;
+	}
+
+	void FreeCounted(void * memory) noexcept
+	{
+		if (memory != nullptr)
+		{
+			if (AllocationTracker::IsEnabled())
+			{
+				AllocationTracker::RecordFree();
+			}
+			std::free(memory);
+		}
+	}
+
+#if defined( __cpp_aligned_new )
+	// Over-aligned allocations cannot be freed with std::free on Windows, so they have their own pair
+
+	void * AllocateAlignedCounted(std::size_t size, std::size_t alignment)
+	{
+		size = size == 0 ? 1 : size;
+		void * memory;
+#if defined( _WIN32 )
+		while ((memory = _aligned_malloc(size, alignment)) == nullptr)
+#else
+		while (posix_memalign(&memory, alignment, size) != 0)
+#endif
+		{
+			std::new_handler handler = std::get_new_handler();
+			if (handler == nullptr)
+			{
+				throw std::bad_alloc();
+			}
+			handler();
+		}
+		if (AllocationTracker::IsEnabled())
+		{
+			AllocationTracker::RecordAllocation(size);
+		}
+		return memory;
+	}
+
+	void FreeAlignedCounted(void * memory) noexcept
+	{
+		if (memory != nullptr)
+		{
+			if (AllocationTracker::IsEnabled())
+			{
+				AllocationTracker::RecordFree();
+			}
+#if defined( _WIN32 )
+			_aligned_free(memory);
+#else
+			std::free(memory);
+#endif
+		}
+	}
+#endif
+}
+
+// The replacements for the global operator new and operator delete.  Every form that the standard
+// library lets a program replace is replaced, so that nothing allocated through them is missed: the
+// plain, array, nothrow and sized forms here, and, where the compiler supports over-aligned
+// allocation, the std::align_val_t forms below.
+
+void * operator new(std::size_t size)
+{
+	return AllocateCounted(size);
+}
+
+void * operator new[](std::size_t size)
+{
+	return AllocateCounted(size);
+}
+
+void * operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+	try
+	{
+		return AllocateCounted(size);
+	}
+	catch (...)
+	{
+		return nullptr;
+	}
+}
+
+void * operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+	try
+	{
+		return AllocateCounted(size);
+	}
+	catch (...)
+	{
+		return nullptr;
+	}
+}
+
+void operator delete(void * memory) noexcept
+{
+	FreeCounted(memory);
+}
+
+void operator delete[](void * memory) noexcept
+{
+	FreeCounted(memory);
+}
+
+void operator delete(void * memory, std::size_t) noexcept
+{
+	FreeCounted(memory);
+}
+
+void operator delete[](void * memory, std::size_t) noexcept
+{
+	FreeCounted(memory);
+}
+
+void operator delete(void * memory, const std::nothrow_t&) noexcept
+{
+	FreeCounted(memory);
+}
+
+void operator delete[](void * memory, const std::nothrow_t&) noexcept
+{
+	FreeCounted(memory);
+}
+
+#if defined( __cpp_aligned_new )
+
+void * operator new(std::size_t size, std::align_val_t alignment)
+{
+	return AllocateAlignedCounted(size, static_cast<std::size_t>(alignment));
+}
+
+void * operator new[](std::size_t size, std::align_val_t alignment)
+{
+	return AllocateAlignedCounted(size, static_cast<std::size_t>(alignment));
+}
+
+void * operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	try
+	{
+		return AllocateAlignedCounted(size, static_cast<std::size_t>(alignment));
+	}
+	catch (...)
+	{
+		return nullptr;
+	}
+}
+
+void * operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	try
+	{
+		return AllocateAlignedCounted(size, static_cast<std::size_t>(alignment));
+	}
+	catch (...)
+	{
+		return nullptr;
+	}
+}
+
+void operator delete(void * memory, std::align_val_t) noexcept
+{
+	FreeAlignedCounted(memory);
+}
+
+void operator delete[](void * memory, std::align_val_t) noexcept
+{
+	FreeAlignedCounted(memory);
+}
+
+void operator delete(void * memory, std::size_t, std::align_val_t) noexcept
+{
+	FreeAlignedCounted(memory);
+}
+
+void operator delete[](void * memory, std::size_t, std::align_val_t) noexcept
+{
+	FreeAlignedCounted(memory);
+}
+
+void operator delete(void * memory, std::align_val_t, const std::nothrow_t&) noexcept
+{
+	FreeAlignedCounted(memory);
+}
+
+void operator delete[](void * memory, std::align_val_t, const std::nothrow_t&) noexcept
+{
+	FreeAlignedCounted(memory);
+}
+
+#endif
+
+#endif
@@ -0,0 +1,93 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Counts the heap allocations and render device resources made in each frame, so that allocations
+// that creep into the frame loop are noticed.
+//
+// AllocationTracker.cpp replaces the global operator new and operator delete.  While the tracker is
+// enabled, every allocation and every resource created by a render device is counted against the
+// current frame and against the profiler zone that the allocating thread is in (see
+// Profiler::GetCurrentZone).  Zones are only known while the profiler is enabled, so anything
+// allocated outside a zone, or while the profiler is disabled, is counted as being in no zone.  While
+// the tracker is disabled, an allocation costs a single check of a flag.
+//
+// The main loop calls BeginFrame at the start of each frame, which finishes counting the frame before.
+// The counts of the last frame can then be read, along with those of each zone that allocated in it.
+// The counts for the last ALLOCATION_HISTORY_FRAMES frames are kept for WriteReport.
+//
+// Once the first few frames have gone (while the scene is loaded and buffers grow to the size they
+// need to be), a frame should not allocate at all.  CheckSteadyState sets how many frames are allowed
+// to allocate.  Any later frame that allocates is counted as a failure, and the zones that allocated
+// in the first of them are kept for the report.  The benchmarks use this to fail if the frame loop
+// allocates.
+//
+// The tracker only counts.  It holds nothing per allocation, so it cannot say how many bytes are
+// freed or which allocation leaked.  BeginFrame and the functions that read the counts must only be
+// called from the thread running the main loop.
+//
+// Defining ALLOCATION_TRACKER_DISABLED leaves operator new and operator delete alone, so nothing is
+// counted.
+
+struct AllocationCounts
+{
+	size_t		Allocations{ 0 };
+	size_t		Bytes{ 0 };				// Requested from operator new
+	size_t		Frees{ 0 };
+	size_t		Resources{ 0 };			// Render device resources created
+	size_t		ResourceBytes{ 0 };		// Buffer sizes and shader bytecode
+};
+
+struct ZoneAllocations
+{
+	const char *		Zone{ nullptr };	// nullptr for allocations made outside any zone
+	AllocationCounts	Counts;
+};
+
+class AllocationTracker
+{
+public:
+	static void SetEnabled(bool enabled);
+	static inline bool IsEnabled() { return _enabled.load(std::memory_order_relaxed); }
+
+	// Count any frame that allocates, after the first warmUpFrames frames since this was called, as a failure
+	static void CheckSteadyState(bool check, uint64_t warmUpFrames = DEFAULT_WARM_UP_FRAMES);
+
+	// Finish counting the last frame and start counting the next one
+	static void BeginFrame();
+
+	static uint64_t GetFrameCount();
+	static AllocationCounts GetLastFrame();
+
+	// Append the counts of each zone that allocated in the last frame to zones
+	static void GetLastFrameZones(std::vector<ZoneAllocations>& zones);
+
+	// Everything counted since the tracker was enabled, including the frame still being counted
+	static AllocationCounts GetTotal();
+
+	// The frames that allocated after the warm-up, while the steady state was being checked, and the
+	// zones that allocated in the first of them
+	static uint64_t GetFailedFrameCount();
+	static void GetFirstFailureZones(std::vector<ZoneAllocations>& zones);
+
+	// Write the totals of each zone, the first failure and the counts of the most recent frames.
+	// Returns false if the file cannot be written.
+	static bool WriteReport(const std::string& fileName);
+
+	// Called by operator new and operator delete, and by the render devices
+	static void RecordAllocation(size_t bytes);
+	static void RecordFree();
+	static void RecordResource(size_t bytes);
+
+	static constexpr uint64_t DEFAULT_WARM_UP_FRAMES = 120;
+	static constexpr size_t ALLOCATION_HISTORY_FRAMES = 300;
+
+	// Zones beyond this many are counted with the allocations made outside any zone
+	static constexpr size_t MAXIMUM_ZONES = 256;
+
+private:
+	static std::atomic<bool>	_enabled;
+};
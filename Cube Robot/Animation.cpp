@@ -0,0 +1,567 @@
+#include "Animation.h"
+#include "SceneGraph.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define ANIMATION_X86 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	// Arrays are given this many elements more than are used, so that the last joints can be
+	// processed as part of a full group of four wherever in the arrays they start
+	constexpr size_t ARRAY_PADDING = 3;
+
+	// Adjusts the factor used to nlerp between two rotations, whose dot product is dot (which
+	// must not be negative), so that the result is close to that of a slerp.  This is the
+	// approximation from Arseny Kapoulkine's "Approximating slerp".
+	inline float SlerpFactor(float dot, float t)
+	{
+		float a = 1.0904f + dot * (-3.2452f + dot * (3.55645f - dot * 1.43519f));
+		float b = 0.848013f + dot * (-1.06021f + dot * 0.215638f);
+		float k = a * (t - 0.5f) * (t - 0.5f) + b;
+		return t + t * (t - 0.5f) * (t - 1.0f) * k;
+	}
+
+	// Find the keys either side of time, returning how far between them it is.  cursor holds the
+	// key found the last time.  Animations usually either stay between the same two keys or move
+	// on to the next ones, so the keys are only searched for when the time has jumped.
+	float FindKeys(const std::vector<float>& times, float time, uint32_t& cursor, size_t& previous, size_t& next)
+	{
+		size_t last = times.size() - 1;
+		auto isBetween = [&](size_t key) { return key <= last && times[key] <= time && (key == last || time < times[key + 1]); };
+		size_t key = cursor;
+		if (!isBetween(key))
+		{
+			if (isBetween(key + 1))
+			{
+				key++;
+			}
+			else
+			{
+				key = std::upper_bound(times.begin(), times.end(), time) - times.begin();
+				key = key > 0 ? key - 1 : 0;
+			}
+		}
+		cursor = static_cast<uint32_t>(key);
+		previous = key;
+		next = std::min(key + 1, last);
+		float interval = times[next] - times[previous];
+		return interval > 0.0f ? std::min(std::max((time - times[previous]) / interval, 0.0f), 1.0f) : 0.0f;
+	}
+
+#if defined(ANIMATION_X86)
+	inline __m128 SlerpFactor(__m128 dot, __m128 t)
+	{
+		const __m128 half = _mm_set1_ps(0.5f);
+		const __m128 one = _mm_set1_ps(1.0f);
+		__m128 a = _mm_add_ps(_mm_set1_ps(1.0904f), _mm_mul_ps(dot, _mm_add_ps(_mm_set1_ps(-3.2452f),
+								_mm_mul_ps(dot, _mm_sub_ps(_mm_set1_ps(3.55645f), _mm_mul_ps(dot, _mm_set1_ps(1.43519f)))))));
+		__m128 b = _mm_add_ps(_mm_set1_ps(0.848013f), _mm_mul_ps(dot, _mm_add_ps(_mm_set1_ps(-1.06021f), _mm_mul_ps(dot, _mm_set1_ps(0.215638f)))));
+		__m128 centred = _mm_sub_ps(t, half);
+		__m128 k = _mm_add_ps(_mm_mul_ps(a, _mm_mul_ps(centred, centred)), b);
+		return _mm_add_ps(t, _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(t, centred), _mm_sub_ps(t, one)), k));
+	}
+
+	inline __m128 Lerp(__m128 from, __m128 to, __m128 t)
+	{
+		return _mm_add_ps(from, _mm_mul_ps(_mm_sub_ps(to, from), t));
+	}
+#endif
+}
+
+void AnimationTrack::AddKey(float time, const Vector3& translation, const Quaternion& rotation, const Vector3& scale)
+{
+	Times.push_back(time);
+	Translations.push_back(translation);
+	Rotations.push_back(rotation);
+	Scales.push_back(scale);
+}
+
+AnimationTrack& AnimationClip::GetTrack(uint32_t joint)
+{
+	if (joint >= _trackIndices.size())
+	{
+		_trackIndices.resize(joint + 1, -1);
+	}
+	if (_trackIndices[joint] < 0)
+	{
+		_trackIndices[joint] = static_cast<int>(_tracks.size());
+		_tracks.emplace_back();
+		_tracks.back().Joint = joint;
+	}
+	return _tracks[_trackIndices[joint]];
+}
+
+void AnimationSystem::PoseArrays::Resize(size_t count)
+{
+	for (std::vector<float>& channel : Channels)
+	{
+		channel.resize(count + ARRAY_PADDING);
+	}
+}
+
+void AnimationSystem::PoseArrays::Set(size_t index, const Vector3& translation, const Quaternion& rotation, const Vector3& scale)
+{
+	Channels[TranslationX][index] = translation.x;
+	Channels[TranslationY][index] = translation.y;
+	Channels[TranslationZ][index] = translation.z;
+	Channels[RotationX][index] = rotation.x;
+	Channels[RotationY][index] = rotation.y;
+	Channels[RotationZ][index] = rotation.z;
+	Channels[RotationW][index] = rotation.w;
+	Channels[ScaleX][index] = scale.x;
+	Channels[ScaleY][index] = scale.y;
+	Channels[ScaleZ][index] = scale.z;
+}
+
+void AnimationSystem::PoseArrays::Copy(size_t index, const PoseArrays& source, size_t sourceIndex)
+{
+	for (int channel = 0; channel < CHANNEL_COUNT; channel++)
+	{
+		Channels[channel][index] = source.Channels[channel][sourceIndex];
+	}
+}
+
+uint32_t AnimationSystem::AddRig(const std::vector<NodeHandle>& joints)
+{
+	Rig rig;
+	rig.FirstJoint = static_cast<uint32_t>(_joints.size());
+	rig.JointCount = static_cast<uint32_t>(joints.size());
+	for (NodeHandle joint : joints)
+	{
+		Pose pose;
+		pose.Scale = Vector3(1.0f, 1.0f, 1.0f);
+		SceneNode * node = _sceneGraph.Resolve(joint);
+		if (node != nullptr)
+		{
+			Matrix transformation = node->GetWorldTransform();
+			transformation.Decompose(pose.Scale, pose.Rotation, pose.Translation);
+		}
+		_joints.push_back(joint);
+		_bindPoses.push_back(pose);
+		_keyCursors.push_back(0);
+		_keyCursors.push_back(0);
+	}
+	_rigs.push_back(rig);
+	return static_cast<uint32_t>(_rigs.size() - 1);
+}
+
+void AnimationSystem::Clear()
+{
+	_rigs.clear();
+	_joints.clear();
+	_bindPoses.clear();
+	_keyCursors.clear();
+}
+
+void AnimationSystem::Play(uint32_t rig, AnimationClipPointer clip, float time, float speed)
+{
+	Rig& playing = _rigs[rig];
+	playing.Layers[0].Clip = clip;
+	playing.Layers[0].Time = time;
+	playing.Layers[0].Speed = speed;
+	playing.Layers[1] = Layer();
+	playing.BlendWeight = 0.0f;
+	playing.FadeRate = 0.0f;
+}
+
+void AnimationSystem::CrossFade(uint32_t rig, AnimationClipPointer clip, float fadeTime, float time, float speed)
+{
+	if (!_rigs[rig].Layers[0].Clip || fadeTime <= 0.0f)
+	{
+		Play(rig, clip, time, speed);
+		return;
+	}
+	Blend(rig, clip, 0.0f, time, speed);
+	_rigs[rig].FadeRate = 1.0f / fadeTime;
+}
+
+void AnimationSystem::Blend(uint32_t rig, AnimationClipPointer clip, float weight, float time, float speed)
+{
+	Rig& blending = _rigs[rig];
+	blending.Layers[1].Clip = clip;
+	blending.Layers[1].Time = time;
+	blending.Layers[1].Speed = speed;
+	blending.BlendWeight = weight;
+	blending.FadeRate = 0.0f;
+}
+
+void AnimationSystem::Update(float deltaTime)
+{
+	PROFILE_ZONE("AnimationSystem::Update");
+	for (Rig& rig : _rigs)
+	{
+		AdvanceLayer(rig.Layers[0], deltaTime);
+		AdvanceLayer(rig.Layers[1], deltaTime);
+		if (rig.FadeRate > 0.0f)
+		{
+			rig.BlendWeight += rig.FadeRate * deltaTime;
+			if (rig.BlendWeight >= 1.0f)
+			{
+				// The cross-fade has finished, so only the new clip is left playing
+				rig.Layers[0] = rig.Layers[1];
+				rig.Layers[1] = Layer();
+				rig.BlendWeight = 0.0f;
+				rig.FadeRate = 0.0f;
+			}
+		}
+	}
+	_statistics = AnimationStatistics();
+	if (_batched)
+	{
+		UpdateBatched();
+	}
+	else
+	{
+		UpdateUnbatched();
+	}
+}
+
+void AnimationSystem::AdvanceLayer(Layer& layer, float deltaTime)
+{
+	if (!layer.Clip)
+	{
+		return;
+	}
+	float duration = layer.Clip->GetDuration();
+	layer.Time += deltaTime * layer.Speed;
+	if (layer.Clip->IsLooping() && duration > 0.0f)
+	{
+		layer.Time = fmodf(layer.Time, duration);
+		if (layer.Time < 0.0f)
+		{
+			layer.Time += duration;
+		}
+	}
+	else
+	{
+		layer.Time = std::min(std::max(layer.Time, 0.0f), duration);
+	}
+}
+
+// Store the keys either side of the layer's time, for the given joint of the rig, in element
+// index of the key arrays, along with how far the time is between them
+
+void AnimationSystem::SampleKeys(const Layer& layer, uint32_t rigJoint, uint32_t joint, uint32_t& cursor, size_t index)
+{
+	const AnimationTrack * track = layer.Clip ? layer.Clip->FindTrack(rigJoint) : nullptr;
+	if (track == nullptr || track->Times.empty())
+	{
+		const Pose& pose = _bindPoses[joint];
+		_fromKeys.Set(index, pose.Translation, pose.Rotation, pose.Scale);
+		_toKeys.Set(index, pose.Translation, pose.Rotation, pose.Scale);
+		_factors[index] = 0.0f;
+		return;
+	}
+	size_t previous;
+	size_t next;
+	_factors[index] = FindKeys(track->Times, layer.Time, cursor, previous, next);
+	_fromKeys.Set(index, track->Translations[previous], track->Rotations[previous], track->Scales[previous]);
+	_toKeys.Set(index, track->Translations[next], track->Rotations[next], track->Scales[next]);
+}
+
+void AnimationSystem::UpdateBatched()
+{
+	// Keys for the first clip of every joint come first, followed by the second clip of the
+	// joints of rigs that are blending
+	size_t jointCount = _joints.size();
+	size_t blendCount = 0;
+	for (const Rig& rig : _rigs)
+	{
+		blendCount += rig.Layers[1].Clip ? rig.JointCount : 0;
+	}
+	size_t keyCount = jointCount + blendCount;
+	_fromKeys.Resize(keyCount);
+	_toKeys.Resize(keyCount);
+	_poses.Resize(keyCount);
+	_factors.assign(keyCount + ARRAY_PADDING, 0.0f);
+	_blendPoses.Resize(blendCount);
+	_blendWeights.assign(blendCount + ARRAY_PADDING, 0.0f);
+	_blendJoints.clear();
+
+	size_t blendIndex = jointCount;
+	for (const Rig& rig : _rigs)
+	{
+		for (uint32_t i = 0; i < rig.JointCount; i++)
+		{
+			uint32_t joint = rig.FirstJoint + i;
+			SampleKeys(rig.Layers[0], i, joint, _keyCursors[joint * 2], joint);
+			if (rig.Layers[1].Clip)
+			{
+				SampleKeys(rig.Layers[1], i, joint, _keyCursors[joint * 2 + 1], blendIndex++);
+				_blendWeights[_blendJoints.size()] = rig.BlendWeight;
+				_blendJoints.push_back(joint);
+			}
+		}
+	}
+	InterpolatePoses(_fromKeys, 0, _toKeys, 0, _factors.data(), _poses, keyCount, _interpolation);
+
+	if (blendCount > 0)
+	{
+		// Gather the first clip's poses for the joints that are blending, blend them with the
+		// second clip's and put the results back
+		for (size_t i = 0; i < blendCount; i++)
+		{
+			_blendPoses.Copy(i, _poses, _blendJoints[i]);
+		}
+		InterpolatePoses(_blendPoses, 0, _poses, jointCount, _blendWeights.data(), _blendPoses, blendCount, _interpolation);
+		for (size_t i = 0; i < blendCount; i++)
+		{
+			_poses.Copy(_blendJoints[i], _blendPoses, i);
+		}
+	}
+
+	_transformations.resize(jointCount + ARRAY_PADDING);
+	ComposeTransformations(_poses, jointCount, _transformations.data());
+	for (const Rig& rig : _rigs)
+	{
+		if (rig.Layers[0].Clip)
+		{
+			for (uint32_t joint = rig.FirstJoint; joint < rig.FirstJoint + rig.JointCount; joint++)
+			{
+				SetTransformation(joint, _transformations[joint]);
+			}
+			_statistics.JointsSampled += rig.JointCount;
+		}
+	}
+	_statistics.JointsBlended = blendCount;
+}
+
+AnimationSystem::Pose AnimationSystem::SamplePose(const Layer& layer, uint32_t rigJoint, uint32_t joint, uint32_t& cursor) const
+{
+	const AnimationTrack * track = layer.Clip->FindTrack(rigJoint);
+	if (track == nullptr || track->Times.empty())
+	{
+		return _bindPoses[joint];
+	}
+	size_t previous;
+	size_t next;
+	float t = FindKeys(track->Times, layer.Time, cursor, previous, next);
+	Pose pose;
+	pose.Translation = Vector3::Lerp(track->Translations[previous], track->Translations[next], t);
+	pose.Scale = Vector3::Lerp(track->Scales[previous], track->Scales[next], t);
+	pose.Rotation = _interpolation == RotationInterpolation::Slerp ? Quaternion::Slerp(track->Rotations[previous], track->Rotations[next], t)
+																   : Quaternion::Lerp(track->Rotations[previous], track->Rotations[next], t);
+	return pose;
+}
+
+void AnimationSystem::UpdateUnbatched()
+{
+	for (const Rig& rig : _rigs)
+	{
+		if (!rig.Layers[0].Clip)
+		{
+			continue;
+		}
+		for (uint32_t i = 0; i < rig.JointCount; i++)
+		{
+			uint32_t joint = rig.FirstJoint + i;
+			Pose pose = SamplePose(rig.Layers[0], i, joint, _keyCursors[joint * 2]);
+			if (rig.Layers[1].Clip)
+			{
+				Pose blendPose = SamplePose(rig.Layers[1], i, joint, _keyCursors[joint * 2 + 1]);
+				float weight = rig.BlendWeight;
+				pose.Translation = Vector3::Lerp(pose.Translation, blendPose.Translation, weight);
+				pose.Scale = Vector3::Lerp(pose.Scale, blendPose.Scale, weight);
+				pose.Rotation = _interpolation == RotationInterpolation::Slerp ? Quaternion::Slerp(pose.Rotation, blendPose.Rotation, weight)
+																			   : Quaternion::Lerp(pose.Rotation, blendPose.Rotation, weight);
+				_statistics.JointsBlended++;
+			}
+			SetTransformation(joint, Matrix::CreateScale(pose.Scale) * Matrix::CreateFromQuaternion(pose.Rotation) * Matrix::CreateTranslation(pose.Translation));
+		}
+		_statistics.JointsSampled += rig.JointCount;
+	}
+}
+
+void AnimationSystem::SetTransformation(uint32_t joint, const Matrix& transformation)
+{
+	SceneNode * node = _sceneGraph.Resolve(_joints[joint]);
+	if (node != nullptr)
+	{
+		node->SetWorldTransform(transformation);
+	}
+}
+
+// Interpolate between count pairs of poses, starting at element fromFirst of from and toFirst of to.
+// The results are stored in result, starting at element fromFirst.  Rotations are interpolated
+// along the shorter arc between them.
+
+void AnimationSystem::InterpolatePoses(const PoseArrays& from, size_t fromFirst, const PoseArrays& to, size_t toFirst, const float * factors,
+									   PoseArrays& result, size_t count, RotationInterpolation interpolation)
+{
+	const float * fromChannels[CHANNEL_COUNT];
+	const float * toChannels[CHANNEL_COUNT];
+	float * resultChannels[CHANNEL_COUNT];
+	for (int channel = 0; channel < CHANNEL_COUNT; channel++)
+	{
+		fromChannels[channel] = from.Channels[channel].data() + fromFirst;
+		toChannels[channel] = to.Channels[channel].data() + toFirst;
+		resultChannels[channel] = result.Channels[channel].data() + fromFirst;
+	}
+	const int linearChannels[] = { TranslationX, TranslationY, TranslationZ, ScaleX, ScaleY, ScaleZ };
+	bool slerp = interpolation == RotationInterpolation::Slerp;
+	size_t i = 0;
+
+#if defined(ANIMATION_X86)
+	const __m128 signBit = _mm_set1_ps(-0.0f);
+	for (; i < count; i += 4)
+	{
+		__m128 t = _mm_loadu_ps(factors + i);
+		for (int channel : linearChannels)
+		{
+			_mm_storeu_ps(resultChannels[channel] + i, Lerp(_mm_loadu_ps(fromChannels[channel] + i), _mm_loadu_ps(toChannels[channel] + i), t));
+		}
+
+		__m128 fromRotation[4];
+		__m128 toRotation[4];
+		__m128 dot = _mm_setzero_ps();
+		for (int component = 0; component < 4; component++)
+		{
+			fromRotation[component] = _mm_loadu_ps(fromChannels[RotationX + component] + i);
+			toRotation[component] = _mm_loadu_ps(toChannels[RotationX + component] + i);
+			dot = _mm_add_ps(dot, _mm_mul_ps(fromRotation[component], toRotation[component]));
+		}
+		// Flip the second rotation where the dot product is negative, so the shorter arc is taken
+		__m128 flip = _mm_and_ps(dot, signBit);
+		dot = _mm_xor_ps(dot, flip);
+		if (slerp)
+		{
+			t = SlerpFactor(dot, t);
+		}
+		__m128 rotation[4];
+		__m128 lengthSquared = _mm_setzero_ps();
+		for (int component = 0; component < 4; component++)
+		{
+			rotation[component] = Lerp(fromRotation[component], _mm_xor_ps(toRotation[component], flip), t);
+			lengthSquared = _mm_add_ps(lengthSquared, _mm_mul_ps(rotation[component], rotation[component]));
+		}
+		__m128 inverseLength = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(lengthSquared));
+		for (int component = 0; component < 4; component++)
+		{
+			_mm_storeu_ps(resultChannels[RotationX + component] + i, _mm_mul_ps(rotation[component], inverseLength));
+		}
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		float t = factors[i];
+		for (int channel : linearChannels)
+		{
+			resultChannels[channel][i] = fromChannels[channel][i] + (toChannels[channel][i] - fromChannels[channel][i]) * t;
+		}
+		float dot = 0.0f;
+		for (int component = RotationX; component <= RotationW; component++)
+		{
+			dot += fromChannels[component][i] * toChannels[component][i];
+		}
+		float sign = dot < 0.0f ? -1.0f : 1.0f;
+		if (slerp)
+		{
+			t = SlerpFactor(dot * sign, t);
+		}
+		float rotation[4];
+		float lengthSquared = 0.0f;
+		for (int component = 0; component < 4; component++)
+		{
+			float fromValue = fromChannels[RotationX + component][i];
+			rotation[component] = fromValue + (toChannels[RotationX + component][i] * sign - fromValue) * t;
+			lengthSquared += rotation[component] * rotation[component];
+		}
+		float inverseLength = 1.0f / sqrtf(lengthSquared);
+		for (int component = 0; component < 4; component++)
+		{
+			resultChannels[RotationX + component][i] = rotation[component] * inverseLength;
+		}
+	}
+}
+
+// Build the transformation Scale * Rotation * Translation for each of count poses.  The rotation
+// part is the same as Matrix::CreateFromQuaternion, with each row multiplied by the scale.
+
+void AnimationSystem::ComposeTransformations(const PoseArrays& poses, size_t count, Matrix * transformations)
+{
+	const float * channels[CHANNEL_COUNT];
+	for (int channel = 0; channel < CHANNEL_COUNT; channel++)
+	{
+		channels[channel] = poses.Channels[channel].data();
+	}
+	size_t i = 0;
+
+#if defined(ANIMATION_X86)
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 two = _mm_set1_ps(2.0f);
+	for (; i < count; i += 4)
+	{
+		__m128 x = _mm_loadu_ps(channels[RotationX] + i);
+		__m128 y = _mm_loadu_ps(channels[RotationY] + i);
+		__m128 z = _mm_loadu_ps(channels[RotationZ] + i);
+		__m128 w = _mm_loadu_ps(channels[RotationW] + i);
+		__m128 x2 = _mm_mul_ps(x, two);
+		__m128 y2 = _mm_mul_ps(y, two);
+		__m128 z2 = _mm_mul_ps(z, two);
+		__m128 xx = _mm_mul_ps(x, x2);
+		__m128 yy = _mm_mul_ps(y, y2);
+		__m128 zz = _mm_mul_ps(z, z2);
+		__m128 xy = _mm_mul_ps(x, y2);
+		__m128 xz = _mm_mul_ps(x, z2);
+		__m128 yz = _mm_mul_ps(y, z2);
+		__m128 wx = _mm_mul_ps(w, x2);
+		__m128 wy = _mm_mul_ps(w, y2);
+		__m128 wz = _mm_mul_ps(w, z2);
+		__m128 scaleX = _mm_loadu_ps(channels[ScaleX] + i);
+		__m128 scaleY = _mm_loadu_ps(channels[ScaleY] + i);
+		__m128 scaleZ = _mm_loadu_ps(channels[ScaleZ] + i);
+
+		// Each group of four holds one element of the matrices of four poses.  Transposing
+		// each row turns them into a row of each of the four matrices.
+		__m128 rows[4][4] =
+		{
+			{ _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(yy, zz)), scaleX), _mm_mul_ps(_mm_add_ps(xy, wz), scaleX), _mm_mul_ps(_mm_sub_ps(xz, wy), scaleX), _mm_setzero_ps() },
+			{ _mm_mul_ps(_mm_sub_ps(xy, wz), scaleY), _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, zz)), scaleY), _mm_mul_ps(_mm_add_ps(yz, wx), scaleY), _mm_setzero_ps() },
+			{ _mm_mul_ps(_mm_add_ps(xz, wy), scaleZ), _mm_mul_ps(_mm_sub_ps(yz, wx), scaleZ), _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, yy)), scaleZ), _mm_setzero_ps() },
+			{ _mm_loadu_ps(channels[TranslationX] + i), _mm_loadu_ps(channels[TranslationY] + i), _mm_loadu_ps(channels[TranslationZ] + i), one }
+		};
+		for (int row = 0; row < 4; row++)
+		{
+			_MM_TRANSPOSE4_PS(rows[row][0], rows[row][1], rows[row][2], rows[row][3]);
+			for (int pose = 0; pose < 4; pose++)
+			{
+				_mm_storeu_ps(&transformations[i + pose].m[row][0], rows[row][pose]);
+			}
+		}
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		float x = channels[RotationX][i];
+		float y = channels[RotationY][i];
+		float z = channels[RotationZ][i];
+		float w = channels[RotationW][i];
+		float scaleX = channels[ScaleX][i];
+		float scaleY = channels[ScaleY][i];
+		float scaleZ = channels[ScaleZ][i];
+		Matrix& transformation = transformations[i];
+		transformation.m[0][0] = (1.0f - 2.0f * (y * y + z * z)) * scaleX;
+		transformation.m[0][1] = 2.0f * (x * y + w * z) * scaleX;
+		transformation.m[0][2] = 2.0f * (x * z - w * y) * scaleX;
+		transformation.m[0][3] = 0.0f;
+		transformation.m[1][0] = 2.0f * (x * y - w * z) * scaleY;
+		transformation.m[1][1] = (1.0f - 2.0f * (x * x + z * z)) * scaleY;
+		transformation.m[1][2] = 2.0f * (y * z + w * x) * scaleY;
+		transformation.m[1][3] = 0.0f;
+		transformation.m[2][0] = 2.0f * (x * z + w * y) * scaleZ;
+		transformation.m[2][1] = 2.0f * (y * z - w * x) * scaleZ;
+		transformation.m[2][2] = (1.0f - 2.0f * (x * x + y * y)) * scaleZ;
+		transformation.m[2][3] = 0.0f;
+		transformation.m[3][0] = channels[TranslationX][i];
+		transformation.m[3][1] = channels[TranslationY][i];
+		transformation.m[3][2] = channels[TranslationZ][i];
+		transformation.m[3][3] = 1.0f;
+	}
+}
@@ -0,0 +1,200 @@
+#pragma once
+#include "DirectXCore.h"
+#include "NodeRegistry.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+class SceneGraph;
+
+// The keyframes for one joint of a rig.  Each key gives the translation, rotation and scale of the
+// joint at a time (in seconds from the start of the clip).  Together these make up the transformation
+// that would otherwise be set with SceneNode::SetWorldTransform, as Scale * Rotation * Translation.
+// Keys must be added in time order.
+
+struct AnimationTrack
+{
+	uint32_t					Joint{ 0 };			// Index of the joint in the rig (see AnimationSystem::AddRig)
+	std::vector<float>			Times;
+	std::vector<Vector3>		Translations;
+	std::vector<Quaternion>		Rotations;
+	std::vector<Vector3>		Scales;
+
+	void AddKey(float time, const Vector3& translation, const Quaternion& rotation, const Vector3& scale);
+};
+
+// A set of tracks that animate the joints of a rig.  Joints without a track keep the transformation
+// they had when the rig was added.  Looping clips wrap around at the duration, so their last key
+// should be at the duration and match the first.  Otherwise, the clip holds its last key.
+
+class AnimationClip
+{
+public:
+	AnimationClip(const std::wstring& name, float duration, bool looping = true) : _name(name), _duration(duration), _looping(looping) {}
+
+	// Returns the track for the joint, adding it if the clip does not have one yet
+	AnimationTrack& GetTrack(uint32_t joint);
+
+	// Returns nullptr if the clip does not animate the joint
+	inline const AnimationTrack * FindTrack(uint32_t joint) const
+	{
+		return (joint < _trackIndices.size() && _trackIndices[joint] >= 0) ? &_tracks[_trackIndices[joint]] : nullptr;
+	}
+
+	inline const std::wstring& GetName() const { return _name; }
+	inline float GetDuration() const { return _duration; }
+	inline bool IsLooping() const { return _looping; }
+
+private:
+	std::wstring				_name;
+	float						_duration;
+	bool						_looping;
+	std::vector<AnimationTrack>	_tracks;
+	std::vector<int>			_trackIndices;		// Index in _tracks of the track for each joint, or -1
+};
+
+typedef std::shared_ptr<const AnimationClip> AnimationClipPointer;
+
+// How rotations are interpolated between keys and blended between clips.  Slerp uses a polynomial
+// correction to nlerp that is within about 0.001 radians of a true slerp, so it can be
+// calculated in the same batches.
+
+enum class RotationInterpolation
+{
+	Nlerp,
+	Slerp
+};
+
+// What the animation system did in the last call to Update
+
+struct AnimationStatistics
+{
+	size_t		JointsSampled{ 0 };
+	size_t		JointsBlended{ 0 };					// Joints of rigs that were blending between two clips
+};
+
+// Plays animation clips on rigs: sets of nodes in a scene graph (the joints) that are animated
+// together, such as the parts of a robot.  Each rig plays one clip, or blends from one clip to
+// another, and the result is written to the joints with SetWorldTransform, so the scene graph
+// picks it up in its next Update.
+//
+// Rather than working through each rig in turn, Update first finds the keys either side of the
+// current time for every joint of every rig.  It then interpolates the keys for all of the joints
+// at once, four at a time with SSE, with the keys held as separate arrays of each component.  The
+// same is done to blend the results of two clips, and to turn the translations, rotations and
+// scales into matrices.
+//
+// Joints are given as handles in the scene graph passed to the constructor, so nodes that have
+// been removed from it are skipped.
+
+class AnimationSystem
+{
+public:
+	AnimationSystem(SceneGraph& sceneGraph) : _sceneGraph(sceneGraph) {}
+
+	AnimationSystem(const AnimationSystem&) = delete;
+	AnimationSystem& operator=(const AnimationSystem&) = delete;
+
+	// Add a rig with the given joints, returning its index.  The transformation each joint has now is
+	// used for any joint that a clip does not animate.
+	uint32_t AddRig(const std::vector<NodeHandle>& joints);
+	void Clear();
+
+	inline size_t GetRigCount() const { return _rigs.size(); }
+	inline size_t GetJointCount() const { return _joints.size(); }
+
+	// Start playing the clip from the given time, stopping any other clips on the rig
+	void Play(uint32_t rig, AnimationClipPointer clip, float time = 0.0f, float speed = 1.0f);
+
+	// Blend from the clip that is playing to a new clip over fadeTime seconds
+	void CrossFade(uint32_t rig, AnimationClipPointer clip, float fadeTime, float time = 0.0f, float speed = 1.0f);
+
+	// Blend the clip that is playing with another one, with a fixed weight (0 for just the clip
+	// that is playing, 1 for just the new one)
+	void Blend(uint32_t rig, AnimationClipPointer clip, float weight, float time = 0.0f, float speed = 1.0f);
+
+	// Move every rig on by deltaTime seconds and set the transformations of their joints
+	void Update(float deltaTime);
+
+	inline void SetInterpolation(RotationInterpolation interpolation) { _interpolation = interpolation; }
+	inline RotationInterpolation GetInterpolation() const { return _interpolation; }
+
+	// If batching is turned off, each joint is sampled, blended and turned into a matrix on its own
+	// using the SimpleMath functions.  This is much slower, and is kept so that the two can be compared.
+	inline void SetBatched(bool batched) { _batched = batched; }
+
+	inline const AnimationStatistics& GetStatistics() const { return _statistics; }
+
+private:
+	struct Pose
+	{
+		Vector3					Translation;
+		Quaternion				Rotation;
+		Vector3					Scale;
+	};
+
+	struct Layer
+	{
+		AnimationClipPointer	Clip;
+		float					Time{ 0.0f };
+		float					Speed{ 1.0f };
+	};
+
+	struct Rig
+	{
+		uint32_t				FirstJoint;
+		uint32_t				JointCount;
+		Layer					Layers[2];			// Layers[1] is only used while blending
+		float					BlendWeight{ 0.0f };
+		float					FadeRate{ 0.0f };	// Change in BlendWeight per second while cross-fading
+	};
+
+	// Translations, rotations and scales for a number of joints, with each component held in
+	// a separate array so that they can be processed four joints at a time
+	enum Channel
+	{
+		TranslationX, TranslationY, TranslationZ,
+		RotationX, RotationY, RotationZ, RotationW,
+		ScaleX, ScaleY, ScaleZ,
+		CHANNEL_COUNT
+	};
+
+	struct PoseArrays
+	{
+		std::vector<float>		Channels[CHANNEL_COUNT];
+
+		void Resize(size_t count);
+		void Set(size_t index, const Vector3& translation, const Quaternion& rotation, const Vector3& scale);
+		void Copy(size_t index, const PoseArrays& source, size_t sourceIndex);
+	};
+
+	SceneGraph&					_sceneGraph;
+	std::vector<Rig>			_rigs;
+	std::vector<NodeHandle>		_joints;
+	std::vector<Pose>			_bindPoses;			// The transformation of each joint when its rig was added
+	std::vector<uint32_t>		_keyCursors;		// The keys last used by each joint, for each of the two layers
+	RotationInterpolation		_interpolation{ RotationInterpolation::Nlerp };
+	bool						_batched{ true };
+	AnimationStatistics			_statistics;
+
+	// Working space for Update
+	PoseArrays					_fromKeys;
+	PoseArrays					_toKeys;
+	std::vector<float>			_factors;
+	PoseArrays					_poses;
+	PoseArrays					_blendPoses;
+	std::vector<float>			_blendWeights;
+	std::vector<uint32_t>		_blendJoints;		// The joint blended in each element of _blendPoses
+	std::vector<Matrix>			_transformations;
+
+	static void InterpolatePoses(const PoseArrays& from, size_t fromFirst, const PoseArrays& to, size_t toFirst, const float * factors,
+								 PoseArrays& result, size_t count, RotationInterpolation interpolation);
+	static void ComposeTransformations(const PoseArrays& poses, size_t count, Matrix * transformations);
+
+	void AdvanceLayer(Layer& layer, float deltaTime);
+	void SampleKeys(const Layer& layer, uint32_t rigJoint, uint32_t joint, uint32_t& cursor, size_t index);
+	Pose SamplePose(const Layer& layer, uint32_t rigJoint, uint32_t joint, uint32_t& cursor) const;
+	void UpdateBatched();
+	void UpdateUnbatched();
+	void SetTransformation(uint32_t joint, const Matrix& transformation);
+};
@@ -0,0 +1,240 @@
+#include "AnimationBenchmark.h"
+#include "Animation.h"
+#include "BenchmarkFixtures.h"
+#include "SceneGraph.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+
+using namespace std;
+
+// Number of updates timed for each method
+constexpr int ANIMATION_BENCHMARK_FRAMES = 20;
+
+// Each rig has the joints of the robot: the body, which turns, and a shoulder and arm on each side
+constexpr uint32_t ANIMATION_BENCHMARK_JOINTS = 5;
+
+// Keys are this far apart, in frames of the robot's animation
+constexpr int ANIMATION_BENCHMARK_FRAMES_PER_KEY = 10;
+constexpr int ANIMATION_BENCHMARK_FRAMES_PER_TURN = 720;
+constexpr float ANIMATION_BENCHMARK_FRAME_TIME = 1.0f / 60.0f;
+
+// The transformations of the robot's joints after the given number of frames, calculated as the
+// robot originally did each frame.  The arms swing out of step by phase.
+
+void CalculateRobotTransformations(float frame, float phase, Matrix transformations[ANIMATION_BENCHMARK_JOINTS])
+{
+	float rotationAngle = frame * 0.5f;
+	float armRotation = sinf((rotationAngle + phase) * XM_PI / 180.0f) * 180.0f;
+	transformations[0] = Matrix::CreateRotationY(rotationAngle * XM_PI / 180.0f);
+	transformations[1] = Matrix::CreateTranslation(Vector3(0.0f, -4.25f, 0.0f)) * Matrix::CreateRotationX(armRotation * XM_PI / 180.0f) * Matrix::CreateTranslation(Vector3(-6.0f, 30.0f, 0.0f));
+	transformations[2] = Matrix::CreateScale(Vector3(1.0f, 8.5f, 1.0f)) * Matrix::CreateTranslation(Vector3(0.0f, -4.25f, 0.0f)) * Matrix::CreateRotationY(armRotation * XM_PI / 180.0f);
+	transformations[3] = Matrix::CreateTranslation(Vector3(0.0f, -4.25f, 0.0f)) * Matrix::CreateRotationX(-armRotation * XM_PI / 180.0f) * Matrix::CreateTranslation(Vector3(6.0f, 30.0f, 0.0f));
+	transformations[4] = Matrix::CreateScale(Vector3(1.0f, 8.5f, 1.0f)) * Matrix::CreateTranslation(Vector3(0.0f, -4.25f, 0.0f)) * Matrix::CreateRotationY(-armRotation * XM_PI / 180.0f);
+}
+
+// A clip made by sampling CalculateRobotTransformations
+
+AnimationClipPointer BuildRobotBenchmarkClip(const wstring& name, float phase)
+{
+	shared_ptr<AnimationClip> clip = make_shared<AnimationClip>(name, ANIMATION_BENCHMARK_FRAMES_PER_TURN * ANIMATION_BENCHMARK_FRAME_TIME);
+	for (int frame = 0; frame <= ANIMATION_BENCHMARK_FRAMES_PER_TURN; frame += ANIMATION_BENCHMARK_FRAMES_PER_KEY)
+	{
+		Matrix transformations[ANIMATION_BENCHMARK_JOINTS];
+		CalculateRobotTransformations(static_cast<float>(frame), phase, transformations);
+		for (uint32_t joint = 0; joint < ANIMATION_BENCHMARK_JOINTS; joint++)
+		{
+			Vector3 scale;
+			Quaternion rotation;
+			Vector3 translation;
+			transformations[joint].Decompose(scale, rotation, translation);
+			clip->GetTrack(joint).AddKey(frame * ANIMATION_BENCHMARK_FRAME_TIME, translation, rotation, scale);
+		}
+	}
+	return clip;
+}
+
+// Build a scene graph holding rigCount robots, returning the joints of each one in turn
+
+SceneGraphPointer BuildAnimationScene(size_t rigCount, vector<NodeHandle>& joints)
+{
+	SceneGraphPointer root = make_shared<SceneGraph>();
+	for (size_t i = 0; i < rigCount; i++)
+	{
+		wstring suffix = to_wstring(i);
+		SceneGraphPointer body = make_shared<SceneGraph>(L"Body" + suffix);
+		body->SetWorldTransform(Matrix::CreateTranslation(Vector3(static_cast<float>(i % 100) * 20.0f, 0.0f, static_cast<float>(i / 100) * 20.0f)));
+		SceneGraphPointer shoulders[2] = { make_shared<SceneGraph>(L"LeftShoulder" + suffix), make_shared<SceneGraph>(L"RightShoulder" + suffix) };
+		SceneNodePointer arms[2] = { make_shared<BenchmarkNode>(L"LeftArm" + suffix), make_shared<BenchmarkNode>(L"RightArm" + suffix) };
+		for (int side = 0; side < 2; side++)
+		{
+			shoulders[side]->Add(arms[side]);
+			body->Add(shoulders[side]);
+		}
+		root->Add(body);
+	}
+	joints.clear();
+	for (size_t i = 0; i < rigCount; i++)
+	{
+		wstring suffix = to_wstring(i);
+		for (const wchar_t * name : { L"Body", L"LeftShoulder", L"LeftArm", L"RightShoulder", L"RightArm" })
+		{
+			joints.push_back(root->FindHandle(name + suffix));
+		}
+	}
+	return root;
+}
+
+// The largest difference between the transformations of the joints and those recorded in
+// transformations, relative to the size of the elements
+
+float CompareJointTransformations(SceneGraph& sceneGraph, const vector<NodeHandle>& joints, const vector<Matrix>& transformations)
+{
+	float largestError = 0.0f;
+	for (size_t i = 0; i < joints.size(); i++)
+	{
+		const Matrix& transformation = sceneGraph.Resolve(joints[i])->GetWorldTransform();
+		for (int row = 0; row < 4; row++)
+		{
+			for (int column = 0; column < 4; column++)
+			{
+				float expected = transformations[i].m[row][column];
+				largestError = max(largestError, fabsf(transformation.m[row][column] - expected) / max(1.0f, fabsf(expected)));
+			}
+		}
+	}
+	return largestError;
+}
+
+int RunAnimationBenchmarks(const std::string& resultsFileName)
+{
+	ofstream results(resultsFileName);
+	if (!results)
+	{
+		return -1;
+	}
+
+	AnimationClipPointer swingClip = BuildRobotBenchmarkClip(L"Swing", 0.0f);
+	AnimationClipPointer waveClip = BuildRobotBenchmarkClip(L"Wave", 90.0f);
+
+	// For each number of rigs, the robot's original calculation is timed first.  Then the clips
+	// are played with and without batching, with each type of interpolation, with every other
+	// rig blending between two clips in the blend benchmarks.  The batched results are checked
+	// against the unbatched ones.  Nlerp should match to within rounding errors.  The batched
+	// slerp is an approximation, so only has to be close to a true slerp.
+	bool allMatch = true;
+	results << "benchmark,rigs,joints,method,interpolation,ns_per_joint,speedup,largest_error,matches_unbatched" << endl;
+	for (size_t rigCount : { 1, 100, 10000, 100000 })
+	{
+		vector<NodeHandle> joints;
+		SceneGraphPointer sceneGraph = BuildAnimationScene(rigCount, joints);
+		size_t jointCount = joints.size();
+		auto nanosecondsPerJoint = [&](chrono::steady_clock::time_point start)
+		{
+			double nanoseconds = static_cast<double>(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count());
+			return nanoseconds / (static_cast<double>(ANIMATION_BENCHMARK_FRAMES) * jointCount);
+		};
+
+		auto start = chrono::steady_clock::now();
+		for (int frame = 0; frame < ANIMATION_BENCHMARK_FRAMES; frame++)
+		{
+			for (size_t rig = 0; rig < rigCount; rig++)
+			{
+				Matrix transformations[ANIMATION_BENCHMARK_JOINTS];
+				CalculateRobotTransformations(static_cast<float>(frame), 0.0f, transformations);
+				for (uint32_t joint = 0; joint < ANIMATION_BENCHMARK_JOINTS; joint++)
+				{
+					sceneGraph->Resolve(joints[rig * ANIMATION_BENCHMARK_JOINTS + joint])->SetWorldTransform(transformations[joint]);
+				}
+			}
+		}
+		double handCoded = nanosecondsPerJoint(start);
+		results << "animation," << rigCount << "," << jointCount << ",hand_coded,," << handCoded << ",1,," << endl;
+
+		AnimationSystem animation(*sceneGraph);
+		for (size_t rig = 0; rig < rigCount; rig++)
+		{
+			animation.AddRig(vector<NodeHandle>(joints.begin() + rig * ANIMATION_BENCHMARK_JOINTS, joints.begin() + (rig + 1) * ANIMATION_BENCHMARK_JOINTS));
+		}
+		for (bool blending : { false, true })
+		{
+			for (RotationInterpolation interpolation : { RotationInterpolation::Nlerp, RotationInterpolation::Slerp })
+			{
+				const char * interpolationName = interpolation == RotationInterpolation::Slerp ? "slerp" : "nlerp";
+				animation.SetInterpolation(interpolation);
+
+				// Start every rig at a different time, so that they are not all using the same keys
+				auto startClips = [&]()
+				{
+					for (uint32_t rig = 0; rig < rigCount; rig++)
+					{
+						float time = static_cast<float>(rig % 97) * 0.1f;
+						animation.Play(rig, swingClip, time);
+						if (blending && rig % 2 == 1)
+						{
+							animation.Blend(rig, waveClip, 0.3f + static_cast<float>(rig % 5) * 0.1f, time);
+						}
+					}
+				};
+				vector<Matrix> unbatchedTransformations;
+				for (bool batched : { false, true })
+				{
+					animation.SetBatched(batched);
+					startClips();
+					start = chrono::steady_clock::now();
+					for (int frame = 0; frame < ANIMATION_BENCHMARK_FRAMES; frame++)
+					{
+						animation.Update(ANIMATION_BENCHMARK_FRAME_TIME);
+					}
+					double time = nanosecondsPerJoint(start);
+					const char * method = blending ? (batched ? "batched_blend" : "unbatched_blend") : (batched ? "batched" : "unbatched");
+					if (!batched)
+					{
+						for (NodeHandle joint : joints)
+						{
+							unbatchedTransformations.push_back(sceneGraph->Resolve(joint)->GetWorldTransform());
+						}
+						results << "animation," << rigCount << "," << jointCount << "," << method << "," << interpolationName << "," << time << "," << handCoded / time << ",," << endl;
+					}
+					else
+					{
+						float largestError = CompareJointTransformations(*sceneGraph, joints, unbatchedTransformations);
+						bool matches = largestError < (interpolation == RotationInterpolation::Slerp ? 2e-3f : 1e-4f);
+						allMatch = allMatch && matches;
+						results << "animation," << rigCount << "," << jointCount << "," << method << "," << interpolationName << "," << time << "," << handCoded / time << ","
+								<< largestError << "," << (matches ? "yes" : "no") << endl;
+					}
+				}
+			}
+		}
+	}
+
+	// Cross-fading: once the fade has finished, only the new clip should be left playing
+	{
+		vector<NodeHandle> joints;
+		SceneGraphPointer sceneGraph = BuildAnimationScene(1, joints);
+		AnimationSystem animation(*sceneGraph);
+		animation.AddRig(joints);
+		animation.Play(0, swingClip);
+		animation.Update(1.0f);
+		animation.CrossFade(0, waveClip, 0.5f, 2.0f);
+		animation.Update(0.25f);
+		bool blendingDuringFade = animation.GetStatistics().JointsBlended == ANIMATION_BENCHMARK_JOINTS;
+		animation.Update(0.5f);
+		bool blendingAfterFade = animation.GetStatistics().JointsBlended != 0;
+		vector<Matrix> faded;
+		for (NodeHandle joint : joints)
+		{
+			faded.push_back(sceneGraph->Resolve(joint)->GetWorldTransform());
+		}
+		animation.Play(0, waveClip, 2.75f);
+		animation.Update(0.0f);
+		float largestError = CompareJointTransformations(*sceneGraph, joints, faded);
+		bool matches = blendingDuringFade && !blendingAfterFade && largestError < 1e-5f;
+		allMatch = allMatch && matches;
+		results << "benchmark,largest_error,matches" << endl;
+		results << "cross_fade," << largestError << "," << (matches ? "yes" : "no") << endl;
+	}
+	return allMatch ? 0 : 1;
+}
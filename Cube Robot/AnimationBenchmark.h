@@ -0,0 +1,11 @@
+#pragma once
+#include <string>
+
+// Benchmarks for AnimationSystem, animating many copies of the robot's joints.  The batched
+// update is compared with sampling each joint on its own, and with building each transformation
+// from rotation matrices as the robot originally did, and the batched results must match the
+// unbatched ones.
+//
+// The results are written as comma-separated values to the file given.
+
+int RunAnimationBenchmarks(const std::string& resultsFileName);
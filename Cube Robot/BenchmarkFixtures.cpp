@@ -0,0 +1,63 @@
+#include "BenchmarkFixtures.h"
+#include "ShaderStructures.h"
+#include <new>
+
+// The number of indices in the cube's mesh
+constexpr uint32_t BENCHMARK_CUBE_INDICES = 36;
+
+BoundsType BenchmarkNode::GetLocalBounds(BoundingSphere& bounds) const
+{
+	if (_radius == 0.0f)
+	{
+		return BoundsType::Infinite;
+	}
+	bounds = BoundingSphere(Vector3(0.0f, 0.0f, 0.0f), _radius);
+	return BoundsType::Finite;
+}
+
+bool BenchmarkCubeNode::Enqueue(RenderQueue& queue)
+{
+	void * constants = queue.AllocateConstants(sizeof(CBuffer));
+	if (constants == nullptr)
+	{
+		return false;
+	}
+	CBuffer * constantBuffer = new (constants) CBuffer;
+	constantBuffer->World = _cumulativeWorldTransformation;
+	constantBuffer->WorldViewProjection = _cumulativeWorldTransformation * _viewProjection;
+	constantBuffer->MaterialColour = Vector4(0.6f, 0.8f, 1.0f, 1.0f);
+	constantBuffer->AmbientLightColour = _ambientColour;
+	constantBuffer->DirectionalLightVector = Vector4(-1.0f, -1.0f, 1.0f, 0.0f);
+	constantBuffer->DirectionalLightColour = Vector4(1.0f, 0.5f, 0.31f, 1.0f);		// LightCoral
+	queue.Add(RenderPass::Opaque, _program, _mesh, 0, _cumulativeWorldTransformation.Translation(), constantBuffer);
+	return true;
+}
+
+ShaderProgram BenchmarkCubeProgram(uint32_t constantsSize, uint32_t instanceSize, uint32_t maximumInstances)
+{
+	ShaderProgram program;
+	program.VertexShader = 1;
+	program.PixelShader = 2;
+	program.InputLayout = 3;
+	program.ConstantBuffer = 4;
+	program.ConstantsSize = constantsSize;
+	if (maximumInstances > 0)
+	{
+		program.InstancedVertexShader = 5;
+		program.InstancedInputLayout = 6;
+		program.InstanceBuffer = 7;
+		program.InstanceSize = instanceSize;
+		program.MaximumInstances = maximumInstances;
+	}
+	return program;
+}
+
+MeshBuffers BenchmarkCubeMesh(uint32_t mesh)
+{
+	MeshBuffers buffers;
+	buffers.VertexBuffer = 8 + 2 * mesh;
+	buffers.VertexStride = sizeof(Vertex);
+	buffers.IndexBuffer = 9 + 2 * mesh;
+	buffers.IndexCount = BENCHMARK_CUBE_INDICES;
+	return buffers;
+}
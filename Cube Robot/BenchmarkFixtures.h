@@ -0,0 +1,51 @@
+#pragma once
+#include "SceneNode.h"
+#include "RenderQueue.h"
+#include <cstdint>
+
+// The nodes and render queue set-up shared by the benchmarks, so that scenes can be built, updated
+// and queued without a DirectX device.
+
+// A node that has a transformation but nothing to draw.  Its bounds are a sphere of the radius
+// given, or, if the radius is 0, it has no bounds and so is never culled.
+
+class BenchmarkNode : public SceneNode
+{
+public:
+	BenchmarkNode(wstring name, float radius = 0.0f) : SceneNode(name), _radius(radius) {}
+
+	bool Initialise() { return true; }
+	void Render() {}
+	BoundsType GetLocalBounds(BoundingSphere& bounds) const;
+
+private:
+	float		_radius;
+};
+
+// A cube that queues the same draw as CubeNode, using the program and mesh given instead of
+// creating its own resources.  The corners of the cube are at -1 and 1 on each axis.
+
+class BenchmarkCubeNode : public SceneNode
+{
+public:
+	BenchmarkCubeNode(const wstring& name, const Vector4& ambientColour, const Matrix& viewProjection, uint32_t program, uint32_t mesh)
+		: SceneNode(name), _ambientColour(ambientColour), _viewProjection(viewProjection), _program(program), _mesh(mesh) {}
+
+	bool Initialise() { return true; }
+	void Render() {}
+	BoundsType GetLocalBounds(BoundingSphere& bounds) const { bounds = BoundingSphere(Vector3(0.0f, 0.0f, 0.0f), 1.7320508f); return BoundsType::Finite; }
+	bool Enqueue(RenderQueue& queue);
+
+private:
+	Vector4			_ambientColour;
+	const Matrix&	_viewProjection;
+	uint32_t		_program;
+	uint32_t		_mesh;
+};
+
+// The program the cube is drawn with, with made-up resource handles.  It can only be instanced if
+// maximumInstances is not 0.
+ShaderProgram BenchmarkCubeProgram(uint32_t constantsSize, uint32_t instanceSize = 0, uint32_t maximumInstances = 0);
+
+// The cube's mesh, with made-up buffer handles.  Each value of mesh gives different buffers.
+MeshBuffers BenchmarkCubeMesh(uint32_t mesh = 0);
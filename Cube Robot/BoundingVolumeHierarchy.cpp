@@ -0,0 +1,303 @@
+#include "BoundingVolumeHierarchy.h"
+#include <algorithm>
+#include <cfloat>
+
+void BoundingVolumeHierarchy::Build(const std::vector<SceneNode *>& nodes)
+{
+	Clear();
+	for (SceneNode * node : nodes)
+	{
+		// Only the nodes that draw something themselves are included.  Scene graphs are
+		// left out, since their bounds just enclose those of the nodes below them.
+		BoundingSphere localBounds;
+		BoundsType localBoundsType = node->GetLocalBounds(localBounds);
+		if (localBoundsType == BoundsType::Infinite)
+		{
+			_unboundedNodes.push_back(node);
+		}
+		else if (localBoundsType == BoundsType::Finite)
+		{
+			Leaf leaf;
+			leaf.Node = node;
+			if (node->GetWorldBounds(leaf.Bounds) == BoundsType::Finite)
+			{
+				_leaves.push_back(leaf);
+			}
+			else
+			{
+				// The world bounds have not been calculated yet
+				_unboundedNodes.push_back(node);
+			}
+		}
+	}
+	Rebuild();
+}
+
+void BoundingVolumeHierarchy::Clear()
+{
+	_treeNodes.clear();
+	_leaves.clear();
+	_unboundedNodes.clear();
+	_builtSurfaceArea = 0.0f;
+}
+
+bool BoundingVolumeHierarchy::Refit()
+{
+	if (_treeNodes.empty())
+	{
+		return false;
+	}
+	for (Leaf& leaf : _leaves)
+	{
+		leaf.Node->GetWorldBounds(leaf.Bounds);
+	}
+
+	// Children always follow their parents, so working backwards
+	// calculates the children of each node before the node itself
+	for (size_t i = _treeNodes.size(); i > 0; i--)
+	{
+		CalculateBounds(_treeNodes[i - 1]);
+	}
+
+	if (GetTotalSurfaceArea() > _builtSurfaceArea * REBUILD_THRESHOLD)
+	{
+		Rebuild();
+		_rebuildCount++;
+		return true;
+	}
+	return false;
+}
+
+void BoundingVolumeHierarchy::Rebuild()
+{
+	_treeNodes.clear();
+	if (_leaves.empty())
+	{
+		return;
+	}
+	_treeNodes.reserve(2 * (_leaves.size() / MAXIMUM_LEAF_SIZE + 1));
+	BuildTreeNode(0, static_cast<uint32_t>(_leaves.size()));
+	_builtSurfaceArea = GetTotalSurfaceArea();
+}
+
+uint32_t BoundingVolumeHierarchy::BuildTreeNode(uint32_t firstLeaf, uint32_t leafCount)
+{
+	uint32_t index = static_cast<uint32_t>(_treeNodes.size());
+	_treeNodes.emplace_back();
+	_treeNodes[index].FirstLeaf = firstLeaf;
+	_treeNodes[index].LeafCount = leafCount;
+	_treeNodes[index].RightChild = 0;
+	if (leafCount > MAXIMUM_LEAF_SIZE)
+	{
+		// Split the leaves in half at the median of their centres along
+		// the axis on which the centres are most spread out
+		Vector3 minimum = _leaves[firstLeaf].Bounds.Center;
+		Vector3 maximum = minimum;
+		for (uint32_t i = firstLeaf + 1; i < firstLeaf + leafCount; i++)
+		{
+			minimum = Vector3::Min(minimum, _leaves[i].Bounds.Center);
+			maximum = Vector3::Max(maximum, _leaves[i].Bounds.Center);
+		}
+		Vector3 extent = maximum - minimum;
+		int axis = (extent.x >= extent.y && extent.x >= extent.z) ? 0 : (extent.y >= extent.z ? 1 : 2);
+
+		uint32_t leftCount = leafCount / 2;
+		auto first = _leaves.begin() + firstLeaf;
+		std::nth_element(first, first + leftCount, first + leafCount,
+						 [axis](const Leaf& a, const Leaf& b)
+						 {
+							 return (&a.Bounds.Center.x)[axis] < (&b.Bounds.Center.x)[axis];
+						 });
+		BuildTreeNode(firstLeaf, leftCount);
+		uint32_t rightChild = BuildTreeNode(firstLeaf + leftCount, leafCount - leftCount);
+		_treeNodes[index].RightChild = rightChild;
+	}
+	CalculateBounds(_treeNodes[index]);
+	return index;
+}
+
+void BoundingVolumeHierarchy::CalculateBounds(TreeNode& treeNode) const
+{
+	if (treeNode.RightChild == 0)
+	{
+		BoundingBox::CreateFromSphere(treeNode.Bounds, _leaves[treeNode.FirstLeaf].Bounds);
+		for (uint32_t i = treeNode.FirstLeaf + 1; i < treeNode.FirstLeaf + treeNode.LeafCount; i++)
+		{
+			BoundingBox leafBounds;
+			BoundingBox::CreateFromSphere(leafBounds, _leaves[i].Bounds);
+			BoundingBox::CreateMerged(treeNode.Bounds, treeNode.Bounds, leafBounds);
+		}
+	}
+	else
+	{
+		const TreeNode * leftChild = &treeNode + 1;
+		BoundingBox::CreateMerged(treeNode.Bounds, leftChild->Bounds, _treeNodes[treeNode.RightChild].Bounds);
+	}
+}
+
+float BoundingVolumeHierarchy::GetTotalSurfaceArea() const
+{
+	float surfaceArea = 0.0f;
+	for (const TreeNode& treeNode : _treeNodes)
+	{
+		const XMFLOAT3& extents = treeNode.Bounds.Extents;
+		surfaceArea += extents.x * extents.y + extents.y * extents.z + extents.z * extents.x;
+	}
+	return surfaceArea;
+}
+
+void BoundingVolumeHierarchy::QueryFrustum(const Frustum& frustum, std::vector<SceneNode *>& results, CullingStatistics * statistics) const
+{
+	results.insert(results.end(), _unboundedNodes.begin(), _unboundedNodes.end());
+	if (_treeNodes.empty())
+	{
+		return;
+	}
+	size_t visited = 0;
+	size_t culled = 0;
+	uint32_t stack[64];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+	while (stackSize > 0)
+	{
+		const TreeNode& treeNode = _treeNodes[stack[--stackSize]];
+		visited++;
+		FrustumTest result = frustum.Test(treeNode.Bounds);
+		if (result == FrustumTest::Outside)
+		{
+			culled++;
+			continue;
+		}
+		if (result == FrustumTest::Inside)
+		{
+			// Everything below this node is visible, so there is no need to test any further
+			for (uint32_t i = treeNode.FirstLeaf; i < treeNode.FirstLeaf + treeNode.LeafCount; i++)
+			{
+				results.push_back(_leaves[i].Node);
+			}
+		}
+		else if (treeNode.RightChild == 0)
+		{
+			for (uint32_t i = treeNode.FirstLeaf; i < treeNode.FirstLeaf + treeNode.LeafCount; i++)
+			{
+				if (frustum.Test(_leaves[i].Bounds) != FrustumTest::Outside)
+				{
+					results.push_back(_leaves[i].Node);
+				}
+			}
+		}
+		else
+		{
+			stack[stackSize++] = treeNode.RightChild;
+			stack[stackSize++] = static_cast<uint32_t>(&treeNode - _treeNodes.data()) + 1;
+		}
+	}
+	if (statistics != nullptr)
+	{
+		statistics->NodesVisited += visited;
+		statistics->NodesCulled += culled;
+	}
+}
+
+void BoundingVolumeHierarchy::QueryRay(const Ray& ray, std::vector<SceneNode *>& results) const
+{
+	if (_treeNodes.empty())
+	{
+		return;
+	}
+	uint32_t stack[64];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+	while (stackSize > 0)
+	{
+		const TreeNode& treeNode = _treeNodes[stack[--stackSize]];
+		float distance;
+		if (!ray.Intersects(treeNode.Bounds, distance))
+		{
+			continue;
+		}
+		if (treeNode.RightChild == 0)
+		{
+			for (uint32_t i = treeNode.FirstLeaf; i < treeNode.FirstLeaf + treeNode.LeafCount; i++)
+			{
+				if (ray.Intersects(_leaves[i].Bounds, distance))
+				{
+					results.push_back(_leaves[i].Node);
+				}
+			}
+		}
+		else
+		{
+			stack[stackSize++] = treeNode.RightChild;
+			stack[stackSize++] = static_cast<uint32_t>(&treeNode - _treeNodes.data()) + 1;
+		}
+	}
+}
+
+SceneNode * BoundingVolumeHierarchy::Pick(const Ray& ray, float& distance) const
+{
+	SceneNode * closestNode = nullptr;
+	float closestDistance = FLT_MAX;
+	if (_treeNodes.empty() || !ray.Intersects(_treeNodes[0].Bounds, distance))
+	{
+		return nullptr;
+	}
+
+	// Each entry holds a tree node and the distance at which the ray enters its box.  The nearer
+	// child is visited first, so that boxes further away than the closest hit so far can be skipped.
+	std::pair<uint32_t, float> stack[64];
+	int stackSize = 0;
+	stack[stackSize++] = std::make_pair(0u, distance);
+	while (stackSize > 0)
+	{
+		std::pair<uint32_t, float> entry = stack[--stackSize];
+		if (entry.second > closestDistance)
+		{
+			continue;
+		}
+		const TreeNode& treeNode = _treeNodes[entry.first];
+		if (treeNode.RightChild == 0)
+		{
+			for (uint32_t i = treeNode.FirstLeaf; i < treeNode.FirstLeaf + treeNode.LeafCount; i++)
+			{
+				float leafDistance;
+				if (ray.Intersects(_leaves[i].Bounds, leafDistance) && leafDistance < closestDistance)
+				{
+					closestDistance = leafDistance;
+					closestNode = _leaves[i].Node;
+				}
+			}
+			continue;
+		}
+
+		uint32_t leftChild = entry.first + 1;
+		uint32_t rightChild = treeNode.RightChild;
+		float leftDistance;
+		float rightDistance;
+		bool hitLeft = ray.Intersects(_treeNodes[leftChild].Bounds, leftDistance) && leftDistance <= closestDistance;
+		bool hitRight = ray.Intersects(_treeNodes[rightChild].Bounds, rightDistance) && rightDistance <= closestDistance;
+		if (hitLeft && hitRight)
+		{
+			if (leftDistance < rightDistance)
+			{
+				stack[stackSize++] = std::make_pair(rightChild, rightDistance);
+				stack[stackSize++] = std::make_pair(leftChild, leftDistance);
+			}
+			else
+			{
+				stack[stackSize++] = std::make_pair(leftChild, leftDistance);
+				stack[stackSize++] = std::make_pair(rightChild, rightDistance);
+			}
+		}
+		else if (hitLeft)
+		{
+			stack[stackSize++] = std::make_pair(leftChild, leftDistance);
+		}
+		else if (hitRight)
+		{
+			stack[stackSize++] = std::make_pair(rightChild, rightDistance);
+		}
+	}
+	distance = closestDistance;
+	return closestNode;
+}
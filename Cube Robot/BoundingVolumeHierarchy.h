@@ -0,0 +1,72 @@
+#pragma once
+#include "SceneNode.h"
+#include <vector>
+
+// A bounding volume hierarchy over the world bounds of the nodes that draw something.
+//
+// The scene graph is arranged for the convenience of whoever built the scene, so the children
+// of a node can be spread all over the world.  This tree is arranged by position instead: each
+// node of the tree holds an axis-aligned box around everything below it, and the two halves of
+// every node are split along its longest axis.  Frustum and ray queries only descend into the
+// boxes they touch, so they take roughly logarithmic time in the number of nodes.
+//
+// When nodes move, Refit recalculates the boxes without changing the shape of the tree.  This
+// is cheap, but the boxes get looser as nodes drift away from their original neighbours, so the
+// tree is rebuilt once the total surface area of the boxes has grown by REBUILD_THRESHOLD.
+//
+// Nodes whose bounds are Infinite (see SceneNode::GetLocalBounds) cannot be placed in the tree.
+// They are returned by every frustum query and never by ray queries.
+
+class BoundingVolumeHierarchy
+{
+public:
+	// Build the tree from the nodes of a scene graph.  The world bounds of the nodes must have
+	// been calculated (by SceneGraph::Update).  Build must be called again if nodes are added or removed.
+	void Build(const std::vector<SceneNode *>& nodes);
+	void Clear();
+
+	// Update the tree after nodes have moved.  Returns true if the tree had to be rebuilt.
+	bool Refit();
+
+	// Add every node that is at least partly inside the frustum to results.  If statistics
+	// is not nullptr, the tree nodes tested and rejected are added to it.
+	void QueryFrustum(const Frustum& frustum, std::vector<SceneNode *>& results, CullingStatistics * statistics = nullptr) const;
+
+	// Add every node whose bounds are hit by the ray to results.  The direction of the ray must be normalised.
+	void QueryRay(const Ray& ray, std::vector<SceneNode *>& results) const;
+
+	// Find the node whose bounds are hit closest to the start of the ray.  Returns nullptr if nothing is hit.
+	SceneNode * Pick(const Ray& ray, float& distance) const;
+
+	inline size_t GetNodeCount() const { return _leaves.size() + _unboundedNodes.size(); }
+	inline size_t GetRebuildCount() const { return _rebuildCount; }
+
+	static constexpr size_t MAXIMUM_LEAF_SIZE = 4;
+	static constexpr float REBUILD_THRESHOLD = 1.5f;
+
+private:
+	struct TreeNode
+	{
+		BoundingBox		Bounds;
+		uint32_t		FirstLeaf;			// The leaves below this node are _leaves[FirstLeaf] to _leaves[FirstLeaf + LeafCount - 1]
+		uint32_t		LeafCount;
+		uint32_t		RightChild;			// The left child always follows its parent.  0 if this node has no children
+	};
+
+	struct Leaf
+	{
+		SceneNode *		Node;
+		BoundingSphere	Bounds;				// The world bounds of the node as of the last Build or Refit
+	};
+
+	std::vector<TreeNode>		_treeNodes;			// In depth-first order, so children always follow their parents
+	std::vector<Leaf>			_leaves;
+	std::vector<SceneNode *>	_unboundedNodes;
+	float						_builtSurfaceArea{ 0.0f };
+	size_t						_rebuildCount{ 0 };
+
+	void Rebuild();
+	uint32_t BuildTreeNode(uint32_t firstLeaf, uint32_t leafCount);
+	void CalculateBounds(TreeNode& treeNode) const;
+	float GetTotalSurfaceArea() const;
+};
@@ -0,0 +1,360 @@
+#include "CachingShaderCompiler.h"
+#include <cstring>
+#include <cstdint>
+
+// Layout of the cache file.  The file header is followed by one record for each shader.  Each record
+// is a RecordHeader followed by the bytecode, padded to a multiple of eight bytes.
+
+namespace
+{
+	constexpr uint32_t CACHE_FILE_MAGIC = 0x31434253;		// "SBC1"
+	constexpr uint32_t CACHE_FILE_VERSION = 1;
+	constexpr size_t RECORD_ALIGNMENT = 8;
+
+	struct FileHeader
+	{
+		uint32_t	Magic;
+		uint32_t	Version;
+	};
+
+	struct RecordHeader
+	{
+		uint64_t	SourceHash;
+		uint64_t	ShaderHash;
+		uint32_t	Size;
+		uint32_t	Checksum;
+	};
+
+	// FNV-1a hashes.  These do not need to be secure, just quick and unlikely to collide.
+	constexpr uint64_t HASH_OFFSET = 14695981039346656037ull;
+	constexpr uint64_t HASH_PRIME = 1099511628211ull;
+
+	void HashBytes(uint64_t& hash, const void * data, size_t size)
+	{
+		const unsigned char * bytes = static_cast<const unsigned char *>(data);
+		for (size_t i = 0; i < size; i++)
+		{
+			hash = (hash ^ bytes[i]) * HASH_PRIME;
+		}
+	}
+
+	// The length is hashed as well as the contents, so that ("ab", "c") and ("a", "bc") hash differently
+	template <typename String>
+	void HashString(uint64_t& hash, const String& value)
+	{
+		uint64_t length = value.size();
+		HashBytes(hash, &length, sizeof(length));
+		HashBytes(hash, value.data(), value.size() * sizeof(value[0]));
+	}
+
+	uint32_t Checksum(const char * data, size_t size)
+	{
+		uint32_t checksum = 2166136261u;
+		for (size_t i = 0; i < size; i++)
+		{
+			checksum = (checksum ^ static_cast<unsigned char>(data[i])) * 16777619u;
+		}
+		return checksum;
+	}
+
+	size_t PaddedSize(size_t size)
+	{
+		return (size + RECORD_ALIGNMENT - 1) & ~(RECORD_ALIGNMENT - 1);
+	}
+
+	bool WriteHeader(FILE * file)
+	{
+		FileHeader header{ CACHE_FILE_MAGIC, CACHE_FILE_VERSION };
+		return fwrite(&header, sizeof(header), 1, file) == 1;
+	}
+
+	bool WriteRecord(FILE * file, uint64_t sourceHash, uint64_t shaderHash, const char * bytecode, uint32_t size)
+	{
+		RecordHeader record{ sourceHash, shaderHash, size, Checksum(bytecode, size) };
+		const char padding[RECORD_ALIGNMENT] = {};
+		size_t paddingSize = PaddedSize(size) - size;
+		return fwrite(&record, sizeof(record), 1, file) == 1 &&
+			   fwrite(bytecode, 1, size, file) == size &&
+			   fwrite(padding, 1, paddingSize, file) == paddingSize;
+	}
+
+	bool ReadFile(const std::wstring& fileName, std::vector<char>& contents)
+	{
+		FILE * file = OpenFileStream(fileName, "rb");
+		if (file == nullptr)
+		{
+			return false;
+		}
+		char buffer[4096];
+		size_t bytesRead;
+		contents.clear();
+		while ((bytesRead = fread(buffer, 1, sizeof(buffer), file)) > 0)
+		{
+			contents.insert(contents.end(), buffer, buffer + bytesRead);
+		}
+		fclose(file);
+		return true;
+	}
+
+	// Returns true and sets includeName if line is an #include directive
+	bool ParseInclude(const char * line, const char * end, std::string& includeName)
+	{
+		const char * position = line;
+		auto skipSpaces = [&]() { while (position < end && (*position == ' ' || *position == '\t')) { position++; } };
+		skipSpaces();
+		if (position == end || *position != '#')
+		{
+			return false;
+		}
+		position++;
+		skipSpaces();
+		const char directive[] = "include";
+		size_t directiveLength = sizeof(directive) - 1;
+		if (static_cast<size_t>(end - position) < directiveLength || strncmp(position, directive, directiveLength) != 0)
+		{
+			return false;
+		}
+		position += directiveLength;
+		skipSpaces();
+		if (position == end || (*position != '"' && *position != '<'))
+		{
+			return false;
+		}
+		char closing = *position == '"' ? '"' : '>';
+		const char * nameStart = ++position;
+		while (position < end && *position != closing)
+		{
+			position++;
+		}
+		if (position == end)
+		{
+			return false;
+		}
+		includeName.assign(nameStart, position);
+		return true;
+	}
+}
+
+CachingShaderCompiler::CachingShaderCompiler(ShaderCompiler& compiler, const std::wstring& cacheFileName) :
+	_compiler(compiler), _cacheFileName(cacheFileName)
+{
+	Load();
+}
+
+CachingShaderCompiler::~CachingShaderCompiler()
+{
+	if (_needsCompacting)
+	{
+		Compact();
+	}
+}
+
+bool CachingShaderCompiler::Compile(const std::wstring& fileName, const std::string& entryPoint, const std::string& profile,
+									const std::vector<ShaderDefine>& defines, std::vector<char>& bytecode, std::string& messages)
+{
+	uint64_t shaderHash = HASH_OFFSET;
+	HashString(shaderHash, fileName);
+	HashString(shaderHash, entryPoint);
+	HashString(shaderHash, profile);
+	for (const ShaderDefine& define : defines)
+	{
+		HashString(shaderHash, define.Name);
+		HashString(shaderHash, define.Value);
+	}
+	uint32_t flags = _compiler.GetFlags();
+	HashBytes(shaderHash, &flags, sizeof(flags));
+
+	uint64_t sourceHash = shaderHash;
+	std::set<std::wstring> visited;
+	HashSource(fileName, sourceHash, visited);
+
+	auto entry = _entries.find(sourceHash);
+	if (entry != _entries.end())
+	{
+		_hitCount++;
+		bytecode.assign(entry->second.Bytecode, entry->second.Bytecode + entry->second.Size);
+		messages.clear();
+		return true;
+	}
+
+	_missCount++;
+	if (_latest.find(shaderHash) != _latest.end())
+	{
+		_invalidationCount++;
+	}
+	if (!_compiler.Compile(fileName, entryPoint, profile, defines, bytecode, messages))
+	{
+		return false;
+	}
+	_compiledBytecode.push_back(bytecode);
+	const std::vector<char>& compiled = _compiledBytecode.back();
+	AddEntry(sourceHash, shaderHash, compiled.data(), static_cast<uint32_t>(compiled.size()));
+	if (!Append(sourceHash, shaderHash, compiled))
+	{
+		// Write out everything when the compiler is destroyed instead
+		_needsCompacting = true;
+	}
+	return true;
+}
+
+bool CachingShaderCompiler::Compact()
+{
+	// Write the latest version of each shader to a new file, then replace the cache file with it
+	std::wstring temporaryFileName = _cacheFileName + L".tmp";
+	FILE * file = OpenFileStream(temporaryFileName, "wb");
+	if (file == nullptr)
+	{
+		return false;
+	}
+	bool written = WriteHeader(file);
+	for (const auto& latest : _latest)
+	{
+		const Entry& entry = _entries[latest.second];
+		written = written && WriteRecord(file, latest.second, latest.first, entry.Bytecode, entry.Size);
+	}
+	written = fclose(file) == 0 && written;
+	if (!written)
+	{
+		return false;
+	}
+
+	// The file has to be unmapped before it can be replaced
+	_cacheFile.Close();
+	bool replaced = RenameFile(temporaryFileName, _cacheFileName);
+	Load();
+	return replaced;
+}
+
+void CachingShaderCompiler::Load()
+{
+	_entries.clear();
+	_latest.clear();
+	_compiledBytecode.clear();
+	_validSize = 0;
+	_fileSize = 0;
+	_needsCompacting = false;
+
+	if (!_cacheFile.Open(_cacheFileName) || _cacheFile.GetSize() == 0)
+	{
+		// There is nothing cached yet.  The header is written along with the first shader.
+		return;
+	}
+	const char * data = _cacheFile.GetData();
+	size_t size = _cacheFile.GetSize();
+	_fileSize = size;
+	FileHeader header;
+	if (size < sizeof(header))
+	{
+		_needsCompacting = true;
+		return;
+	}
+	memcpy(&header, data, sizeof(header));
+	if (header.Magic != CACHE_FILE_MAGIC || header.Version != CACHE_FILE_VERSION)
+	{
+		_needsCompacting = true;
+		return;
+	}
+
+	// Stop at the first record that is incomplete or does not match its checksum.  This can happen
+	// if the application exited while a record was being appended.
+	size_t offset = sizeof(header);
+	while (offset + sizeof(RecordHeader) <= size)
+	{
+		RecordHeader record;
+		memcpy(&record, data + offset, sizeof(record));
+		const char * bytecode = data + offset + sizeof(record);
+		size_t end = offset + sizeof(record) + PaddedSize(record.Size);
+		if (end > size || Checksum(bytecode, record.Size) != record.Checksum)
+		{
+			break;
+		}
+		AddEntry(record.SourceHash, record.ShaderHash, bytecode, record.Size);
+		offset = end;
+	}
+	_validSize = offset;
+	if (offset != size)
+	{
+		_needsCompacting = true;
+	}
+}
+
+void CachingShaderCompiler::AddEntry(uint64_t sourceHash, uint64_t shaderHash, const char * bytecode, uint32_t size)
+{
+	auto latest = _latest.find(shaderHash);
+	if (latest != _latest.end() && latest->second != sourceHash)
+	{
+		// An older version of the shader is in the file
+		_needsCompacting = true;
+	}
+	_latest[shaderHash] = sourceHash;
+	_entries[sourceHash] = { shaderHash, bytecode, size };
+}
+
+bool CachingShaderCompiler::Append(uint64_t sourceHash, uint64_t shaderHash, const std::vector<char>& bytecode)
+{
+	// Anything after the valid entries would be read back as part of the new record, so in
+	// that case the whole file is rewritten by Compact instead
+	if (_validSize != _fileSize)
+	{
+		return false;
+	}
+	FILE * file = OpenFileStream(_cacheFileName, "ab");
+	if (file == nullptr)
+	{
+		return false;
+	}
+	bool written = true;
+	if (fseek(file, 0, SEEK_END) != 0 || ftell(file) == 0)
+	{
+		written = WriteHeader(file);
+	}
+	written = written && WriteRecord(file, sourceHash, shaderHash, bytecode.data(), static_cast<uint32_t>(bytecode.size()));
+	long end = ftell(file);
+	written = fclose(file) == 0 && written && end >= 0;
+
+	// The mapped view does not include the new record, so compare against the size on disk from now
+	// on.  If only part of the record was written, the sizes no longer match and nothing more is appended.
+	_fileSize = end >= 0 ? static_cast<size_t>(end) : SIZE_MAX;
+	if (written)
+	{
+		_validSize = _fileSize;
+	}
+	return written;
+}
+
+void CachingShaderCompiler::HashSource(const std::wstring& fileName, uint64_t& hash, std::set<std::wstring>& visited) const
+{
+	if (!visited.insert(fileName).second)
+	{
+		return;
+	}
+	HashString(hash, fileName);
+	std::vector<char> source;
+	if (!ReadFile(fileName, source))
+	{
+		// A missing file hashes differently to an empty one.  The compiler will report the error.
+		HashString(hash, std::string("<missing>"));
+		return;
+	}
+	HashBytes(hash, source.data(), source.size());
+
+	// Includes are resolved relative to the directory of the file that includes them
+	size_t separator = fileName.find_last_of(L"\\/");
+	std::wstring directory = separator == std::wstring::npos ? std::wstring() : fileName.substr(0, separator + 1);
+	const char * line = source.data();
+	const char * end = source.data() + source.size();
+	while (line < end)
+	{
+		const char * lineEnd = static_cast<const char *>(memchr(line, '\n', end - line));
+		if (lineEnd == nullptr)
+		{
+			lineEnd = end;
+		}
+		std::string includeName;
+		if (ParseInclude(line, lineEnd, includeName))
+		{
+			HashSource(directory + std::wstring(includeName.begin(), includeName.end()), hash, visited);
+		}
+		line = lineEnd < end ? lineEnd + 1 : end;
+	}
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include "ShaderCompiler.h"
+#include "MappedFile.h"
+#include <deque>
+#include <set>
+#include <unordered_map>
+
+// A ShaderCompiler that keeps the bytecode produced by another compiler in a file, so that
+// shaders only need to be compiled the first time the application is run.
+//
+// Each shader is identified by a hash of its source file and every file it includes, the
+// defines, the entry point, the profile and the compiler flags.  If any of these change, the
+// shader is compiled again.  The cache file is memory-mapped when the compiler is created,
+// and shaders found in it are returned without calling the other compiler.  Newly compiled
+// shaders are appended to the file.
+//
+// Includes are found by looking for #include directives in the source and resolving them
+// relative to the file that includes them, as D3D_COMPILE_STANDARD_FILE_INCLUDE does.
+//
+// Bytecode replaced by a newer version of the same shader is removed from the file when the
+// compiler is destroyed.  If the file is missing, from a different version or damaged, the
+// valid part is kept and the rest of the shaders are compiled again.
+//
+// The compiler is not thread-safe.
+
+class CachingShaderCompiler : public ShaderCompiler
+{
+public:
+	CachingShaderCompiler(ShaderCompiler& compiler, const std::wstring& cacheFileName);
+	~CachingShaderCompiler();
+
+	CachingShaderCompiler(const CachingShaderCompiler&) = delete;
+	CachingShaderCompiler& operator=(const CachingShaderCompiler&) = delete;
+
+	bool Compile(const std::wstring& fileName, const std::string& entryPoint, const std::string& profile,
+				 const std::vector<ShaderDefine>& defines, std::vector<char>& bytecode, std::string& messages);
+	inline uint32_t GetFlags() const { return _compiler.GetFlags(); }
+
+	// Rewrite the cache file, leaving out any bytecode that has been replaced.  Returns false if
+	// the file could not be written, in which case the existing file is left as it was.
+	bool Compact();
+
+	inline size_t GetHitCount() const { return _hitCount; }
+	inline size_t GetMissCount() const { return _missCount; }
+
+	// The number of misses for shaders that were in the cache, but whose source has changed
+	inline size_t GetInvalidationCount() const { return _invalidationCount; }
+
+	// The number of shaders that can be returned from the cache
+	inline size_t GetEntryCount() const { return _entries.size(); }
+
+private:
+	struct Entry
+	{
+		uint64_t			ShaderHash;
+		const char *		Bytecode;
+		uint32_t			Size;
+	};
+
+	ShaderCompiler&		_compiler;
+	std::wstring		_cacheFileName;
+	MappedFile			_cacheFile;
+
+	// Entries are found by the hash of the source and settings.  _latest maps the hash of just
+	// the settings to the most recent version of each shader.
+	std::unordered_map<uint64_t, Entry>		_entries;
+	std::unordered_map<uint64_t, uint64_t>	_latest;
+
+	// Bytecode compiled since the cache file was mapped
+	std::deque<std::vector<char>>			_compiledBytecode;
+
+	// The number of bytes of the file that hold valid entries, the number of bytes in the file on disk
+	// (which grows past the mapped view as records are appended), and whether anything in it needs removing
+	size_t				_validSize{ 0 };
+	size_t				_fileSize{ 0 };
+	bool				_needsCompacting{ false };
+
+	size_t				_hitCount{ 0 };
+	size_t				_missCount{ 0 };
+	size_t				_invalidationCount{ 0 };
+
+	void Load();
+	void AddEntry(uint64_t sourceHash, uint64_t shaderHash, const char * bytecode, uint32_t size);
+	bool Append(uint64_t sourceHash, uint64_t shaderHash, const std::vector<char>& bytecode);
+	void HashSource(const std::wstring& fileName, uint64_t& hash, std::set<std::wstring>& visited) const;
+};
@@ -0,0 +1,174 @@
+#include "CountingRenderDevice.h"
+
+ResourceId CountingRenderDevice::CreateVertexBuffer(const void * data, size_t size)
+{
+	return _device.CreateVertexBuffer(data, size);
+}
+
+ResourceId CountingRenderDevice::CreateIndexBuffer(const void * data, size_t size)
+{
+	return _device.CreateIndexBuffer(data, size);
+}
+
+ResourceId CountingRenderDevice::CreateConstantBuffer(size_t size)
+{
+	return _device.CreateConstantBuffer(size);
+}
+
+ResourceId CountingRenderDevice::CreateDynamicVertexBuffer(size_t size)
+{
+	return _device.CreateDynamicVertexBuffer(size);
+}
+
+ResourceId CountingRenderDevice::CreateVertexShader(const void * bytecode, size_t size)
+{
+	return _device.CreateVertexShader(bytecode, size);
+}
+
+ResourceId CountingRenderDevice::CreatePixelShader(const void * bytecode, size_t size)
+{
+	return _device.CreatePixelShader(bytecode, size);
+}
+
+ResourceId CountingRenderDevice::CreateInputLayout(const VertexElement * elements, size_t elementCount, const void * vertexShaderBytecode, size_t size)
+{
+	return _device.CreateInputLayout(elements, elementCount, vertexShaderBytecode, size);
+}
+
+void CountingRenderDevice::ReleaseResource(ResourceId resource)
+{
+	_device.ReleaseResource(resource);
+}
+
+void CountingRenderDevice::Clear(const float colour[4], float depth)
+{
+	_device.Clear(colour, depth);
+}
+
+void CountingRenderDevice::SetViewport(float x, float y, float width, float height)
+{
+	_device.SetViewport(x, y, width, height);
+}
+
+void CountingRenderDevice::SetPrimitiveTopology(PrimitiveTopology topology)
+{
+	CountStateChange(_topologySet && topology == _topology);
+	_topology = topology;
+	_topologySet = true;
+	_device.SetPrimitiveTopology(topology);
+}
+
+void CountingRenderDevice::SetInputLayout(ResourceId inputLayout)
+{
+	CountStateChange(inputLayout == _inputLayout);
+	_inputLayout = inputLayout;
+	_device.SetInputLayout(inputLayout);
+}
+
+void CountingRenderDevice::SetVertexShader(ResourceId vertexShader)
+{
+	CountStateChange(vertexShader == _vertexShader);
+	_vertexShader = vertexShader;
+	_device.SetVertexShader(vertexShader);
+}
+
+void CountingRenderDevice::SetPixelShader(ResourceId pixelShader)
+{
+	CountStateChange(pixelShader == _pixelShader);
+	_pixelShader = pixelShader;
+	_device.SetPixelShader(pixelShader);
+}
+
+void CountingRenderDevice::SetVertexBuffer(ResourceId vertexBuffer, uint32_t stride)
+{
+	CountStateChange(vertexBuffer == _vertexBuffer && stride == _vertexStride);
+	_vertexBuffer = vertexBuffer;
+	_vertexStride = stride;
+	_device.SetVertexBuffer(vertexBuffer, stride);
+}
+
+void CountingRenderDevice::SetInstanceBuffer(ResourceId instanceBuffer, uint32_t stride)
+{
+	CountStateChange(instanceBuffer == _instanceBuffer && stride == _instanceStride);
+	_instanceBuffer = instanceBuffer;
+	_instanceStride = stride;
+	_device.SetInstanceBuffer(instanceBuffer, stride);
+}
+
+void CountingRenderDevice::SetIndexBuffer(ResourceId indexBuffer)
+{
+	CountStateChange(indexBuffer == _indexBuffer);
+	_indexBuffer = indexBuffer;
+	_device.SetIndexBuffer(indexBuffer);
+}
+
+void CountingRenderDevice::SetConstantBuffer(uint32_t slot, ResourceId constantBuffer)
+{
+	if (slot >= _constantBuffers.size())
+	{
+		_constantBuffers.resize(slot + 1, 0);
+	}
+	CountStateChange(constantBuffer == _constantBuffers[slot]);
+	_constantBuffers[slot] = constantBuffer;
+	_device.SetConstantBuffer(slot, constantBuffer);
+}
+
+void CountingRenderDevice::UpdateConstantBuffer(ResourceId constantBuffer, const void * data, size_t size)
+{
+	RenderCounters& counters = _statistics.GetCounters();
+	counters.ConstantBufferUpdates++;
+	counters.ConstantBufferBytes += size;
+	_device.UpdateConstantBuffer(constantBuffer, data, size);
+}
+
+void CountingRenderDevice::UpdateVertexBuffer(ResourceId dynamicVertexBuffer, const void * data, size_t size)
+{
+	_statistics.GetCounters().VertexBufferBytes += size;
+	_device.UpdateVertexBuffer(dynamicVertexBuffer, data, size);
+}
+
+void CountingRenderDevice::DrawIndexed(uint32_t indexCount, uint32_t startIndex, int32_t baseVertex)
+{
+	CountDraw(indexCount, 1);
+	_device.DrawIndexed(indexCount, startIndex, baseVertex);
+}
+
+void CountingRenderDevice::DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex)
+{
+	_statistics.GetCounters().InstancedDrawCalls++;
+	CountDraw(indexCount, instanceCount);
+	_device.DrawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex);
+}
+
+void CountingRenderDevice::CountStateChange(bool redundant)
+{
+	RenderCounters& counters = _statistics.GetCounters();
+	counters.StateChanges++;
+	if (redundant)
+	{
+		counters.RedundantStateChanges++;
+	}
+}
+
+void CountingRenderDevice::CountDraw(uint32_t indexCount, uint32_t instanceCount)
+{
+	RenderCounters& counters = _statistics.GetCounters();
+	size_t triangles = 0;
+	switch (_topology)
+	{
+		case PrimitiveTopology::TriangleList:
+			triangles = indexCount / 3;
+			break;
+
+		case PrimitiveTopology::TriangleStrip:
+			triangles = indexCount >= 3 ? indexCount - 2 : 0;
+			break;
+
+		case PrimitiveTopology::LineList:
+			break;
+	}
+	counters.DrawCalls++;
+	counters.Instances += instanceCount;
+	counters.Triangles += triangles * instanceCount;
+	counters.Vertices += static_cast<size_t>(indexCount) * instanceCount;
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include "RenderDevice.h"
+#include "RenderStatistics.h"
+#include <vector>
+
+// A RenderDevice that passes every call on to another device, counting the draws, triangles, buffer
+// updates and state changes in the current frame of a RenderStatistics.
+//
+// To tell which state changes are redundant, the device remembers what it last bound, so every draw
+// made with the other device must be made through this one.  Only the thread drawing the frame may
+// use it.  Resources can still be created with the other device from elsewhere, and are not counted.
+
+class CountingRenderDevice : public RenderDevice
+{
+public:
+	CountingRenderDevice(RenderDevice& device, RenderStatistics& statistics) : _device(device), _statistics(statistics) {}
+
+	ResourceId CreateVertexBuffer(const void * data, size_t size);
+	ResourceId CreateIndexBuffer(const void * data, size_t size);
+	ResourceId CreateConstantBuffer(size_t size);
+	ResourceId CreateDynamicVertexBuffer(size_t size);
+	ResourceId CreateVertexShader(const void * bytecode, size_t size);
+	ResourceId CreatePixelShader(const void * bytecode, size_t size);
+	ResourceId CreateInputLayout(const VertexElement * elements, size_t elementCount, const void * vertexShaderBytecode, size_t size);
+	void ReleaseResource(ResourceId resource);
+
+	void Clear(const float colour[4], float depth);
+	void SetViewport(float x, float y, float width, float height);
+
+	void SetPrimitiveTopology(PrimitiveTopology topology);
+	void SetInputLayout(ResourceId inputLayout);
+	void SetVertexShader(ResourceId vertexShader);
+	void SetPixelShader(ResourceId pixelShader);
+	void SetVertexBuffer(ResourceId vertexBuffer, uint32_t stride);
+	void SetInstanceBuffer(ResourceId instanceBuffer, uint32_t stride);
+	void SetIndexBuffer(ResourceId indexBuffer);
+	void SetConstantBuffer(uint32_t slot, ResourceId constantBuffer);
+	void UpdateConstantBuffer(ResourceId constantBuffer, const void * data, size_t size);
+	void UpdateVertexBuffer(ResourceId dynamicVertexBuffer, const void * data, size_t size);
+	void DrawIndexed(uint32_t indexCount, uint32_t startIndex, int32_t baseVertex);
+	void DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex);
+
+	inline RenderDevice& GetDevice() { return _device; }
+
+private:
+	RenderDevice&			_device;
+	RenderStatistics&		_statistics;
+
+	// What is bound at the moment.  Nothing is bound to begin with.
+	PrimitiveTopology		_topology{ PrimitiveTopology::TriangleList };
+	bool					_topologySet{ false };
+	ResourceId				_inputLayout{ 0 };
+	ResourceId				_vertexShader{ 0 };
+	ResourceId				_pixelShader{ 0 };
+	ResourceId				_vertexBuffer{ 0 };
+	uint32_t				_vertexStride{ 0 };
+	ResourceId				_instanceBuffer{ 0 };
+	uint32_t				_instanceStride{ 0 };
+	ResourceId				_indexBuffer{ 0 };
+	std::vector<ResourceId>	_constantBuffers;
+
+	void CountStateChange(bool redundant);
+	void CountDraw(uint32_t indexCount, uint32_t instanceCount);
+};
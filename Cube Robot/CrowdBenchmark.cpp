@@ -0,0 +1,340 @@
+#include "CrowdBenchmark.h"
+#include "BenchmarkFixtures.h"
+#include "Robot.h"
+#include "RenderQueue.h"
+#include "RecordingRenderDevice.h"
+#include "ShaderStructures.h"
+#include "ThreadPool.h"
+#include "FramePipeline.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#if defined( _WIN32 )
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+using namespace std;
+
+// Nodes in each robot: the node that places it in the crowd, the robot's own scene graph, its two
+// shoulders and its six cubes
+constexpr size_t CROWD_ROBOT_NODES = 10;
+
+// The robots stand on a square grid, this far apart, and are grouped into tiles of
+// CROWD_TILE_SIZE x CROWD_TILE_SIZE robots.  Each tile is a scene graph node, so a tile that is out of
+// view is culled in one test, and each tile is updated as a separate task when there is a thread pool.
+constexpr float CROWD_SPACING = 20.0f;
+constexpr size_t CROWD_TILE_SIZE = 16;
+
+// Each crowd is timed for about this many node updates in total, but for no fewer than
+// CROWD_MINIMUM_FRAMES frames and no more than CROWD_MAXIMUM_FRAMES, so that small crowds
+// give enough frames for the percentiles while large crowds do not take too long
+constexpr size_t CROWD_NODE_UPDATES = 20000000;
+constexpr size_t CROWD_MINIMUM_FRAMES = 10;
+constexpr size_t CROWD_MAXIMUM_FRAMES = 300;
+
+constexpr float CROWD_NEAR_PLANE = 1.0f;
+constexpr float CROWD_FAR_PLANE = 10000.0f;
+
+// Size of the per-instance part of the constants, as used by CubeNode, and the number of cubes in
+// each instanced draw
+constexpr uint32_t CROWD_INSTANCE_SIZE = offsetof(CBuffer, DirectionalLightColour);
+constexpr uint32_t CROWD_MAXIMUM_INSTANCES = 1024;
+
+// The frames submitted by a pipeline whose submit function waits for the thread that fills the
+// packets, as Present can wait for the window thread, and how long each frame waits before giving up
+constexpr size_t CROWD_WAITING_FRAMES = 20;
+constexpr chrono::milliseconds CROWD_WAIT_TIMEOUT(1000);
+
+// The most memory the process has used so far, in bytes
+
+size_t PeakMemoryBytes()
+{
+#if defined( _WIN32 )
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+	{
+		return counters.PeakWorkingSetSize;
+	}
+	return 0;
+#else
+	rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) == 0)
+	{
+		// Given in kilobytes on Linux
+		return static_cast<size_t>(usage.ru_maxrss) * 1024;
+	}
+	return 0;
+#endif
+}
+
+// The frame time that the given fraction of frames took no longer than.  frameTimes must be sorted.
+
+double FramePercentile(const vector<double>& frameTimes, double fraction)
+{
+	size_t rank = static_cast<size_t>(ceil(fraction * frameTimes.size()));
+	return frameTimes[min(max<size_t>(rank, 1), frameTimes.size()) - 1];
+}
+
+// Add robotCount robots to the scene graph, standing on a square grid centred on the origin, with a
+// rig for each one.  Returns the number of nodes added.
+
+size_t BuildCrowd(size_t robotCount, SceneGraph& root, NodePool& nodePool, AnimationSystem& animation, const RobotCubeFactory& createCube)
+{
+	size_t side = static_cast<size_t>(ceil(sqrt(static_cast<double>(robotCount))));
+	size_t tilesPerSide = (side + CROWD_TILE_SIZE - 1) / CROWD_TILE_SIZE;
+	vector<SceneGraphPointer> tiles(tilesPerSide * tilesPerSide);
+	float offset = (side - 1) * CROWD_SPACING * 0.5f;
+	size_t nodeCount = robotCount * CROWD_ROBOT_NODES;
+	for (size_t i = 0; i < robotCount; i++)
+	{
+		size_t x = i % side;
+		size_t z = i / side;
+		SceneGraphPointer& tile = tiles[(z / CROWD_TILE_SIZE) * tilesPerSide + x / CROWD_TILE_SIZE];
+		if (tile == nullptr)
+		{
+			tile = nodePool.Create<SceneGraph>(L"Tile");
+			root.Add(tile);
+			nodeCount++;
+		}
+		SceneGraphPointer placement = nodePool.Create<SceneGraph>(L"Robot");
+		placement->SetWorldTransform(Matrix::CreateTranslation(Vector3(x * CROWD_SPACING - offset, 0.0f, z * CROWD_SPACING - offset)));
+		tile->Add(placement);
+
+		// The robot's own scene graph is animated, so the robot is placed by its parent
+		SceneGraphPointer robot = nodePool.Create<SceneGraph>(L"Body");
+		placement->Add(robot);
+		animation.AddRig(BuildRobot(*robot, nodePool, createCube));
+	}
+	return nodeCount;
+}
+
+// Start every robot playing the clip from the beginning of the benchmark.  Each robot starts at a
+// different time, so that they are not all using the same keys.
+
+void StartCrowd(AnimationSystem& animation, AnimationClipPointer clip)
+{
+	for (uint32_t rig = 0; rig < animation.GetRigCount(); rig++)
+	{
+		animation.Play(rig, clip, static_cast<float>(rig % 97) * 0.1f);
+	}
+}
+
+// Submit frames through a pipeline whose submit function cannot finish until the pipeline's wait
+// function has run on the thread that fills the packets.  Without the wait function, BeginFrame and
+// Flush would wait for the render thread while it waited for them, so each frame would time out.
+// Returns the number of frames that did not time out.
+
+size_t SubmitWaitingFrames()
+{
+	atomic<bool> handled{ false };
+	size_t framesHandled = 0;
+	FramePipeline pipeline(2,
+						   [&](FramePacket&)
+						   {
+							   auto start = chrono::steady_clock::now();
+							   while (!handled.exchange(false))
+							   {
+								   if (chrono::steady_clock::now() - start > CROWD_WAIT_TIMEOUT)
+								   {
+									   return;
+								   }
+								   this_thread::yield();
+							   }
+							   framesHandled++;
+						   });
+	pipeline.SetWaitFunction([&]() { handled = true; });
+	for (size_t frame = 0; frame < CROWD_WAITING_FRAMES; frame++)
+	{
+		pipeline.BeginFrame();
+		pipeline.EndFrame();
+	}
+	pipeline.Flush();
+	return framesHandled;
+}
+
+int RunCrowdBenchmarks(const std::string& resultsFileName, size_t maximumRobots)
+{
+	ofstream results(resultsFileName);
+	if (!results)
+	{
+		return -1;
+	}
+
+	AnimationClipPointer clip = CreateRobotClip();
+	RecordingRenderDevice device;
+	const float background[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	unsigned int maximumThreads = max(thread::hardware_concurrency(), 1u);
+	Matrix identity;
+
+	bool allSubmitted = true;
+	bool allMatch = true;
+	ostringstream pipelineResults;
+	results << "benchmark,robots,nodes,threads,frames,build_ms,ns_per_node,frame_p50_ms,frame_p95_ms,frame_p99_ms,frame_max_ms,"
+			<< "animate_ms,update_ms,cull_ms,submit_ms,nodes_drawn,draws,device_calls,node_pool_mb,peak_memory_mb,all_drawn_submitted" << endl;
+	for (size_t robotCount : { 1, 10, 100, 1000, 10000, 100000, 1000000 })
+	{
+		if (robotCount > maximumRobots)
+		{
+			break;
+		}
+		try
+		{
+			// The pool is declared first so that it outlives the nodes created from it
+			NodePool nodePool;
+			RenderQueue queue;
+			uint32_t programIndex = queue.AddShaderProgram(BenchmarkCubeProgram(sizeof(CBuffer), CROWD_INSTANCE_SIZE, CROWD_MAXIMUM_INSTANCES));
+			uint32_t meshIndex = queue.AddMesh(BenchmarkCubeMesh());
+
+			// The camera looks along the crowd from behind its front row, so the nearer robots are drawn, the
+			// robots to either side are culled and, in the largest crowds, so are the robots beyond the far plane
+			size_t side = static_cast<size_t>(ceil(sqrt(static_cast<double>(robotCount))));
+			float depth = side * CROWD_SPACING * 0.5f;
+			Matrix viewTransformation = XMMatrixLookAtLH(Vector3(0.0f, 60.0f, -depth - 100.0f), Vector3(0.0f, 20.0f, -depth), Vector3(0.0f, 1.0f, 0.0f));
+			Matrix viewProjection = viewTransformation * XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, CROWD_NEAR_PLANE, CROWD_FAR_PLANE);
+
+			auto buildStart = chrono::steady_clock::now();
+			SceneGraphPointer root = nodePool.Create<SceneGraph>();
+			AnimationSystem animation(*root);
+			size_t nodeCount = BuildCrowd(robotCount, *root, nodePool, animation,
+					   [&](const wstring& name, const Vector4& colour)
+					   {
+						   return nodePool.Create<BenchmarkCubeNode>(name, colour, viewProjection, programIndex, meshIndex);
+					   });
+			StartCrowd(animation, clip);
+			root->Initialise();
+			root->SetRenderQueue(&queue);
+			root->SetViewFrustum(Frustum(viewProjection));
+			double buildTime = static_cast<double>(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - buildStart).count());
+
+			nodeCount++;
+			size_t frameCount = min(max(CROWD_NODE_UPDATES / nodeCount, CROWD_MINIMUM_FRAMES), CROWD_MAXIMUM_FRAMES);
+
+			for (unsigned int threads = 1; threads <= maximumThreads; threads *= 2)
+			{
+				ThreadPool threadPool(threads);
+				root->SetThreadPool(&threadPool, CROWD_TILE_SIZE * CROWD_TILE_SIZE * CROWD_ROBOT_NODES);
+
+				// The first frame after the hierarchy has changed is slower, as the scene graph flattens it
+				animation.Update(ANIMATION_FRAME_TIME);
+				root->Update(identity);
+
+				vector<double> frameTimes;
+				double stageTimes[4] = { 0.0, 0.0, 0.0, 0.0 };
+				RenderQueueStatistics statistics;
+				for (size_t frame = 0; frame < frameCount; frame++)
+				{
+					device.Clear();
+					auto frameStart = chrono::steady_clock::now();
+					animation.Update(ANIMATION_FRAME_TIME);
+					auto animated = chrono::steady_clock::now();
+					root->Update(identity);
+					auto updated = chrono::steady_clock::now();
+					queue.BeginFrame(viewTransformation, CROWD_NEAR_PLANE, CROWD_FAR_PLANE);
+					root->Render();
+					auto culled = chrono::steady_clock::now();
+					queue.Sort();
+					device.Clear(background, 1.0f);
+					statistics = queue.Submit(device);
+					auto submitted = chrono::steady_clock::now();
+
+					stageTimes[0] += static_cast<double>(chrono::duration_cast<chrono::nanoseconds>(animated - frameStart).count());
+					stageTimes[1] += static_cast<double>(chrono::duration_cast<chrono::nanoseconds>(updated - animated).count());
+					stageTimes[2] += static_cast<double>(chrono::duration_cast<chrono::nanoseconds>(culled - updated).count());
+					stageTimes[3] += static_cast<double>(chrono::duration_cast<chrono::nanoseconds>(submitted - culled).count());
+					frameTimes.push_back(static_cast<double>(chrono::duration_cast<chrono::nanoseconds>(submitted - frameStart).count()));
+
+					// Every cube that was found to be visible should have been drawn, either on its own or as an instance
+					size_t cubesSubmitted = statistics.Instances + statistics.Draws - statistics.InstancedDraws;
+					allSubmitted = allSubmitted && cubesSubmitted == root->GetCullingStatistics().NodesDrawn;
+				}
+				root->SetThreadPool(nullptr);
+
+				double totalTime = stageTimes[0] + stageTimes[1] + stageTimes[2] + stageTimes[3];
+				double frames = static_cast<double>(frameCount);
+				sort(frameTimes.begin(), frameTimes.end());
+				results << "crowd," << robotCount << "," << nodeCount << "," << threads << "," << frameCount << "," << buildTime / 1e6 << ","
+						<< totalTime / (frames * nodeCount) << "," << FramePercentile(frameTimes, 0.5) / 1e6 << "," << FramePercentile(frameTimes, 0.95) / 1e6 << ","
+						<< FramePercentile(frameTimes, 0.99) / 1e6 << "," << frameTimes.back() / 1e6 << ","
+						<< stageTimes[0] / (frames * 1e6) << "," << stageTimes[1] / (frames * 1e6) << "," << stageTimes[2] / (frames * 1e6) << "," << stageTimes[3] / (frames * 1e6) << ","
+						<< root->GetCullingStatistics().NodesDrawn << "," << statistics.Draws << "," << device.GetCommands().size() << ","
+						<< nodePool.GetReservedBytes() / 1048576.0 << "," << PeakMemoryBytes() / 1048576.0 << "," << (allSubmitted ? "yes" : "no") << endl;
+
+				// Make sure that the largest thread count is always measured
+				if (threads < maximumThreads && threads * 2 > maximumThreads)
+				{
+					threads = maximumThreads / 2;
+				}
+			}
+
+			// The same frames again, with the draws submitted by a frame pipeline.  With one packet, each
+			// frame is submitted before the next one is updated.  With more, the render thread submits each
+			// frame while the next is being updated.  Every way should make exactly the same calls with
+			// the same data, so the hashes of each frame's commands are combined in order and compared.
+			double serialTime = 0.0;
+			uint64_t serialHash = 0;
+			device.SetHashing(true);
+			for (size_t packetCount : { 1, 2, 3 })
+			{
+				StartCrowd(animation, clip);
+				uint64_t commandHash = 0;
+				FramePipeline pipeline(packetCount,
+									   [&](FramePacket& packet)
+									   {
+										   device.Clear();
+										   device.Clear(background, 1.0f);
+										   packet.Queue.Sort();
+										   packet.Queue.Submit(device);
+										   commandHash = commandHash * 31 + device.GetCommandHash();
+									   });
+				auto start = chrono::steady_clock::now();
+				for (size_t frame = 0; frame < frameCount; frame++)
+				{
+					animation.Update(ANIMATION_FRAME_TIME);
+					root->Update(identity);
+					FramePacket& packet = pipeline.BeginFrame();
+					packet.Queue.CopyResources(queue);
+					packet.Queue.BeginFrame(viewTransformation, CROWD_NEAR_PLANE, CROWD_FAR_PLANE);
+					root->SetRenderQueue(&packet.Queue);
+					root->Render();
+					pipeline.EndFrame();
+				}
+				pipeline.Flush();
+				double time = static_cast<double>(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count());
+				if (packetCount == 1)
+				{
+					serialTime = time;
+					serialHash = commandHash;
+				}
+				bool matches = commandHash == serialHash;
+				allMatch = allMatch && matches;
+				pipelineResults << "pipeline," << robotCount << "," << nodeCount << "," << packetCount << "," << frameCount << ","
+								<< time / (frameCount * 1e6) << "," << serialTime / time << "," << (matches ? "yes" : "no") << endl;
+			}
+			device.SetHashing(false);
+			root->SetRenderQueue(&queue);
+		}
+		catch (const bad_alloc&)
+		{
+			results << "crowd," << robotCount << string(18, ',') << PeakMemoryBytes() / 1048576.0 << ",out_of_memory" << endl;
+			break;
+		}
+	}
+	results << "benchmark,robots,nodes,packets,frames,frame_ms,speedup,matches_serial" << endl;
+	results << pipelineResults.str();
+
+	size_t framesHandled = SubmitWaitingFrames();
+	bool waitsHandled = framesHandled == CROWD_WAITING_FRAMES;
+	results << "benchmark,frames,frames_handled,handled" << endl;
+	results << "pipeline_wait," << CROWD_WAITING_FRAMES << "," << framesHandled << "," << (waitsHandled ? "yes" : "no") << endl;
+	return allSubmitted && allMatch && waitsHandled ? 0 : 1;
+}
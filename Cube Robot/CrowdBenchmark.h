@@ -0,0 +1,22 @@
+#pragma once
+#include <string>
+
+// A benchmark of whole frames for crowds of robots, from 1 robot up to maximumRobots.  Each robot is
+// built by BuildRobot, exactly as DirectXApp builds the robot it draws, and plays the robot's clip.
+// Every frame animates the robots, updates the scene graph, culls it against a view frustum, queues
+// the draws of the robots that can be seen and submits them to a RecordingRenderDevice.  Each crowd
+// is run with from 1 thread up to the number of hardware threads available, and every robot that was
+// found to be visible must be submitted to the device.
+//
+// Each crowd is also run through a FramePipeline with one, two and three frame packets, to measure
+// how much is gained by submitting each frame on a render thread while the next one is updated.  The
+// pipelined frames must submit the same data as the frames submitted one at a time.
+//
+// For each number of robots and threads, the results give the time per node, the percentiles of the
+// frame times and the peak memory used by the process.  Crowds are run in increasing size, so the
+// peak is that of the largest crowd so far.  If a crowd does not fit in memory, that is recorded and
+// the larger crowds are skipped.
+//
+// The results are written as comma-separated values to the file given.
+
+int RunCrowdBenchmarks(const std::string& resultsFileName, size_t maximumRobots = 1000000);
@@ -1,237 +1,187 @@
 #include "CubeNode.h"
 #include "Geometry.h"
+#include "Profiler.h"
+#include "VertexNormals.h"
+#include <new>
 
 
 
 bool CubeNode::Initialise()
 {
-	_device = DirectXFramework::GetDXFramework()->GetDevice();
-	_deviceContext = DirectXFramework::GetDXFramework()->GetDeviceContext();
-	if (_device.Get() == nullptr || _deviceContext.Get() == nullptr)
+	if (DirectXFramework::GetDXFramework()->GetResourceCache() == nullptr)
 	{
 		return false;
 	}
 
-	BuildVertexNormals();
 	BuildGeometryBuffers();
 	BuildShaders();
-	BuildVertexLayout();
 	BuildConstantBuffer();
+	BuildInstanceBuffer();
+	AddToRenderQueue();
 	return true;
 
 }
 
+void CubeNode::Shutdown()
+{
+	// Release our references so that the resources are freed once no other cube is using them
+	_meshResource.reset();
+	_vertexShader.reset();
+	_instancedVertexShader.reset();
+	_pixelShader.reset();
+	_constantBuffer.reset();
+	_instanceBuffer.reset();
+	_program = RenderQueue::INVALID_INDEX;
+	_mesh = RenderQueue::INVALID_INDEX;
+}
+
 
 void CubeNode::Render()
 {
-	// Calculate the world x view x projection transformation 
-	Matrix projectionTransformation = DirectXFramework::GetDXFramework()->GetProjectionTransformation(); 
-	Matrix viewTransformation = DirectXFramework::GetDXFramework()->GetViewTransformation();
+	PROFILE_ZONE("CubeNode::Render");
+	RenderDevice * renderDevice = DirectXFramework::GetDXFramework()->GetRenderDevice();
 
 	CBuffer constantBuffer;
-	constantBuffer.World = _cumulativeWorldTransformation;
-	constantBuffer.WorldViewProjection = _cumulativeWorldTransformation * viewTransformation * projectionTransformation;
-	constantBuffer.MaterialColour = Vector4(0.6f, 0.8f, 1.0f, 1.0f);
-	constantBuffer.AmbientLightColour = _ambientColour;
-
-	constantBuffer.DirectionalLightVector = Vector4(-1.0f, -1.0f, 1.0f, 0.0f);
-	constantBuffer.DirectionalLightColour = Vector4(Colors::LightCoral);
-
-
+	FillConstantBuffer(constantBuffer);
 
 	// Update the constant buffer. Note the layout of the constant buffer must match that in the shader
-	_deviceContext->VSSetConstantBuffers(0, 1, _constantBuffer.GetAddressOf());
-	_deviceContext->UpdateSubresource(_constantBuffer.Get(), 0, 0, &constantBuffer, 0, 0);
+	renderDevice->SetConstantBuffer(0, _constantBuffer->Buffer);
+	renderDevice->UpdateConstantBuffer(_constantBuffer->Buffer, &constantBuffer, sizeof(CBuffer));
 
 	// Now render the cube
-	// Specify the distance between vertices and the starting point in the vertex buffer
-	UINT stride = sizeof(Vertex);
-	UINT offset = 0;
-
 	// Set the vertex buffer and index buffer we are going to use
-	_deviceContext->IASetVertexBuffers(0, 1, _vertexBuffer.GetAddressOf(), &stride, &offset);
-	_deviceContext->IASetIndexBuffer(_indexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
-
+	renderDevice->SetVertexBuffer(_meshResource->VertexBuffer, _meshResource->VertexStride);
+	renderDevice->SetIndexBuffer(_meshResource->IndexBuffer);
 
 	// Specify the layout of the polygons (it will rarely be different to this)
-	_deviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	renderDevice->SetPrimitiveTopology(PrimitiveTopology::TriangleList);
 
 	// Specify the layout of the input vertices.  This must match the layout of the input vertices in the shader
-	_deviceContext->IASetInputLayout(_layout.Get());
+	renderDevice->SetInputLayout(_vertexShader->InputLayout);
 
 	// Specify the vertex and pixel shaders we are going to use
-	_deviceContext->VSSetShader(_vertexShader.Get(), 0, 0);
-	_deviceContext->PSSetShader(_pixelShader.Get(), 0, 0);
+	renderDevice->SetVertexShader(_vertexShader->Shader);
+	renderDevice->SetPixelShader(_pixelShader->Shader);
 
 	// Now draw the first cube
-	_deviceContext->DrawIndexed(ARRAYSIZE(indices), 0, 0);
+	renderDevice->DrawIndexed(_meshResource->IndexCount, 0, 0);
 	
 }
 
 void CubeNode::BuildGeometryBuffers()
 {
-	// This method uses the arrays defined in Geometry.h
-	// 
-	// Setup the structure that specifies how big the vertex 
-	// buffer should be
-	D3D11_BUFFER_DESC vertexBufferDescriptor = { 0 };
-	vertexBufferDescriptor.Usage = D3D11_USAGE_IMMUTABLE;
-	vertexBufferDescriptor.ByteWidth = sizeof(Vertex) * ARRAYSIZE(vertices);
-	vertexBufferDescriptor.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-	vertexBufferDescriptor.CPUAccessFlags = 0;
-	vertexBufferDescriptor.MiscFlags = 0;
-	vertexBufferDescriptor.StructureByteStride = 0;
-
-	// Now set up a structure that tells DirectX where to get the
-	// data for the vertices from
-	D3D11_SUBRESOURCE_DATA vertexInitialisationData = { 0 };
-	vertexInitialisationData.pSysMem = &vertices;
-
-	// and create the vertex buffer
-	ThrowIfFailed(_device->CreateBuffer(&vertexBufferDescriptor, &vertexInitialisationData, _vertexBuffer.GetAddressOf()));
-
-	// Setup the structure that specifies how big the index 
-	// buffer should be
-	D3D11_BUFFER_DESC indexBufferDescriptor = { 0 };
-	indexBufferDescriptor.Usage = D3D11_USAGE_IMMUTABLE;
-	indexBufferDescriptor.ByteWidth = sizeof(UINT) * ARRAYSIZE(indices);
-	indexBufferDescriptor.BindFlags = D3D11_BIND_INDEX_BUFFER;
-	indexBufferDescriptor.CPUAccessFlags = 0;
-	indexBufferDescriptor.MiscFlags = 0;
-	indexBufferDescriptor.StructureByteStride = 0;
-
-	// Now set up a structure that tells DirectX where to get the
-	// data for the indices from
-	D3D11_SUBRESOURCE_DATA indexInitialisationData;
-	indexInitialisationData.pSysMem = &indices;
-
-	// and create the index buffer
-	ThrowIfFailed(_device->CreateBuffer(&indexBufferDescriptor, &indexInitialisationData, _indexBuffer.GetAddressOf()));
-
+	// This method uses the arrays defined in Geometry.h.  The buffers are only
+	// created (and the vertex normals calculated) by the first cube to ask for them.
+	ResourceCache * resourceCache = DirectXFramework::GetDXFramework()->GetResourceCache();
+	_meshResource = resourceCache->AcquireMesh(L"Cube",
+											   [this](MeshData& mesh)
+											   {
+												   BuildVertexNormals();
+												   mesh.Vertices = vertices;
+												   mesh.VertexStride = sizeof(Vertex);
+												   mesh.VertexCount = ARRAYSIZE(vertices);
+												   mesh.Indices = indices;
+												   mesh.IndexCount = ARRAYSIZE(indices);
+											   });
 }
 
 
 void CubeNode::BuildShaders()
 {
-	DWORD shaderCompileFlags = 0;
-#if defined( _DEBUG )
-	shaderCompileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
-#endif
-
-	ComPtr<ID3DBlob> compilationMessages = nullptr;
-
-	//Compile vertex shader
-	HRESULT hr = D3DCompileFromFile(ShaderFileName,
-		nullptr, D3D_COMPILE_STANDARD_FILE_INCLUDE,
-		VertexShaderName, "vs_5_0",
-		shaderCompileFlags, 0,
-		_vertexShaderByteCode.GetAddressOf(),
-		compilationMessages.GetAddressOf());
-
-	if (compilationMessages.Get() != nullptr)
-	{
-		// If there were any compilation messages, display them
-		MessageBoxA(0, (char*)compilationMessages->GetBufferPointer(), 0, 0);
-	}
-	// Even if there are no compiler messages, check to make sure there were no other errors.
-	ThrowIfFailed(hr);
-	ThrowIfFailed(_device->CreateVertexShader(_vertexShaderByteCode->GetBufferPointer(), _vertexShaderByteCode->GetBufferSize(), NULL, _vertexShader.GetAddressOf()));
-
-	// Compile pixel shader
-	hr = D3DCompileFromFile(ShaderFileName,
-		nullptr, D3D_COMPILE_STANDARD_FILE_INCLUDE,
-		PixelShaderName, "ps_5_0",
-		shaderCompileFlags, 0,
-		_pixelShaderByteCode.GetAddressOf(),
-		compilationMessages.GetAddressOf());
-
-	if (compilationMessages.Get() != nullptr)
-	{
-		// If there were any compilation messages, display them
-		MessageBoxA(0, (char*)compilationMessages->GetBufferPointer(), 0, 0);
-	}
-	ThrowIfFailed(hr);
-	ThrowIfFailed(_device->CreatePixelShader(_pixelShaderByteCode->GetBufferPointer(), _pixelShaderByteCode->GetBufferSize(), NULL, _pixelShader.GetAddressOf()));
+	// The vertexDesc array is defined in Geometry.h.  It describes the format of each
+	// of the vertices we are sending to the vertex shader, and is used to create the
+	// input layout along with the vertex shader.
+	ResourceCache * resourceCache = DirectXFramework::GetDXFramework()->GetResourceCache();
+	_vertexShader = resourceCache->AcquireVertexShader(ShaderFileName, VertexShaderName, "vs_5_0", vertexDesc, ARRAYSIZE(vertexDesc));
+	_instancedVertexShader = resourceCache->AcquireVertexShader(ShaderFileName, InstancedVertexShaderName, "vs_5_0", instancedVertexDesc, ARRAYSIZE(instancedVertexDesc));
+	_pixelShader = resourceCache->AcquirePixelShader(ShaderFileName, PixelShaderName, "ps_5_0");
 }
 
-void CubeNode::BuildVertexLayout()
+void CubeNode::BuildConstantBuffer()
 {
-	// Create the vertex input layout. This tells DirectX the format
-	// of each of the vertices we are sending to it. The vertexDesc array is
-	// defined in Geometry.h
-
-	ThrowIfFailed(_device->CreateInputLayout(vertexDesc, ARRAYSIZE(vertexDesc), _vertexShaderByteCode->GetBufferPointer(), _vertexShaderByteCode->GetBufferSize(), _layout.GetAddressOf()));
+	ResourceCache * resourceCache = DirectXFramework::GetDXFramework()->GetResourceCache();
+	_constantBuffer = resourceCache->AcquireConstantBuffer(L"CBuffer", sizeof(CBuffer));
 }
 
-void CubeNode::BuildConstantBuffer()
+void CubeNode::BuildInstanceBuffer()
 {
-	D3D11_BUFFER_DESC bufferDesc;
-	ZeroMemory(&bufferDesc, sizeof(bufferDesc));
-	bufferDesc.Usage = D3D11_USAGE_DEFAULT;
-	bufferDesc.ByteWidth = sizeof(CBuffer);
-	bufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-
-	ThrowIfFailed(_device->CreateBuffer(&bufferDesc, NULL, _constantBuffer.GetAddressOf()));
+	// When cubes are drawn with a single instanced draw, the start of each cube's constants is copied to this buffer
+	ResourceCache * resourceCache = DirectXFramework::GetDXFramework()->GetResourceCache();
+	_instanceBuffer = resourceCache->AcquireInstanceBuffer(L"CubeInstances", InstanceSize, MaximumInstances);
 }
 
-void CubeNode::BuildVertexNormals()
+bool CubeNode::Enqueue(RenderQueue& queue)
 {
-	// Create an array for contributing counts
-	std::vector<int>contributingCounts(ARRAYSIZE(vertices), 0);
-	//int contributingCounts[ARRAYSIZE(vertices)] = { 0 };
-
-	// Loop through polygons
-	for (size_t i = 0; i < (ARRAYSIZE(indices)); i += 3)
+	PROFILE_ZONE("CubeNode::Enqueue");
+	if (_program == RenderQueue::INVALID_INDEX || _mesh == RenderQueue::INVALID_INDEX)
 	{
-		//calc the normal for polygon
-		// Get the 3 indices of the vertices that make up the polygon
-		UINT index0 = indices[i];
-		UINT index1 = indices[i + 1];
-		UINT index2 = indices[i + 2];
-
-
-		// Get the vertices for those indices
-
-		Vector3 vertex0 = vertices[index0].Position;
-		Vector3 vertex1 = vertices[index1].Position;
-		Vector3 vertex2 = vertices[index2].Position;
-		//XMVECTOR point1 = XMVectorSet(vertex1.Position.x, vertex1.Pos.y, vertex1.Pos.z, 0.0f);
-
-		// Calculate the polygon normal
-
-		Vector3 vectorA = vertex1 - vertex0;
-		Vector3 vectorB = vertex2 - vertex0;
-
-		//Vector3 vectorB = vertex2 - vertex0;
-
-		// Calculate the cross product of vectorA and vectorB to get the normal
-		Vector3 polygonNormal = vectorA.Cross(vectorB);
-
+		return false;
+	}
+	void * constants = queue.AllocateConstants(sizeof(CBuffer));
+	if (constants == nullptr)
+	{
+		return false;
+	}
+	CBuffer * constantBuffer = new (constants) CBuffer;
+	FillConstantBuffer(*constantBuffer);
+	queue.Add(RenderPass::Opaque, _program, _mesh, 0, _cumulativeWorldTransformation.Translation(), constantBuffer);
+	return true;
+}
 
+void CubeNode::FillConstantBuffer(CBuffer& constantBuffer) const
+{
+	// Calculate the world x view x projection transformation 
+	Matrix projectionTransformation = DirectXFramework::GetDXFramework()->GetProjectionTransformation(); 
+	Matrix viewTransformation = DirectXFramework::GetDXFramework()->GetViewTransformation();
 
+	constantBuffer.World = _cumulativeWorldTransformation;
+	constantBuffer.WorldViewProjection = _cumulativeWorldTransformation * viewTransformation * projectionTransformation;
+	constantBuffer.MaterialColour = Vector4(0.6f, 0.8f, 1.0f, 1.0f);
+	constantBuffer.AmbientLightColour = _ambientColour;
 
-		// Add the polygon normal to the vertex normal for each of the 3 vertices
-		vertices[index0].Normal += polygonNormal;
-		vertices[index1].Normal += polygonNormal;
-		vertices[index2].Normal += polygonNormal;
+	constantBuffer.DirectionalLightVector = Vector4(-1.0f, -1.0f, 1.0f, 0.0f);
+	constantBuffer.DirectionalLightColour = Vector4(Colors::LightCoral);
+}
 
-		// Add 1 to the contributing count for each of the vertices
-		contributingCounts[index0] += 1;
-		contributingCounts[index1] += 1;
-		contributingCounts[index2] += 1;
-	}
+void CubeNode::AddToRenderQueue()
+{
+	// Tell the render queue which resources are used to draw the cube, so that the
+	// draws can be queued and submitted later rather than drawn immediately.  Every
+	// cube shares the same resources, so they all get the same program and mesh, and
+	// the render queue draws them together with one instanced draw.
+	RenderQueue& renderQueue = DirectXFramework::GetDXFramework()->GetRenderQueue();
+
+	ShaderProgram program;
+	program.VertexShader = _vertexShader->Shader;
+	program.PixelShader = _pixelShader->Shader;
+	program.InputLayout = _vertexShader->InputLayout;
+	program.ConstantBuffer = _constantBuffer->Buffer;
+	program.ConstantsSize = _constantBuffer->Size;
+	program.InstancedVertexShader = _instancedVertexShader->Shader;
+	program.InstancedInputLayout = _instancedVertexShader->InputLayout;
+	program.InstanceBuffer = _instanceBuffer->Buffer;
+	program.InstanceSize = _instanceBuffer->InstanceSize;
+	program.MaximumInstances = _instanceBuffer->MaximumInstances;
+	_program = renderQueue.AddShaderProgram(program);
+	_mesh = renderQueue.AddMesh(*_meshResource);
+}
 
-	// Loop through vertices
-	for (size_t i = 0; i < ARRAYSIZE(vertices); i += 1)
+BoundsType CubeNode::GetLocalBounds(BoundingSphere& bounds) const
+{
+	// Every cube uses the same vertices, so the sphere enclosing them is only calculated once
+	static BoundingSphere cubeBounds = []()
 	{
-		if (contributingCounts[i] > 0)
-		{
-			vertices[i].Normal /= (contributingCounts[i]);
-			vertices[i].Normal.Normalize();
-		}
-		// Divide the summed vertex normals by the number of times they were contributed to
-		// Normalize the resulting normal vector
+		BoundingSphere sphere;
+		BoundingSphere::CreateFromPoints(sphere, ARRAYSIZE(vertices), &vertices[0].Position, sizeof(Vertex));
+		return sphere;
+	}();
+	bounds = cubeBounds;
+	return BoundsType::Finite;
+}
 
-	}
+void CubeNode::BuildVertexNormals()
+{
+	// Each vertex normal is the sum of the normals of the triangles that use it, weighted by their area
+	VertexNormalGenerator().Generate(vertices, ARRAYSIZE(vertices), indices, ARRAYSIZE(indices), NormalWeighting::Area);
 }
 
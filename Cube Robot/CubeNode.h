@@ -2,6 +2,8 @@
 #include "SceneNode.h"
 #include "DirectXFramework.h"
 
+struct CBuffer;
+
 class CubeNode : public SceneNode 
 {
 public:
@@ -10,31 +12,35 @@ public:
 
 	bool Initialise(); 
 	void Render(); 
+	void Shutdown();
+	BoundsType GetLocalBounds(BoundingSphere& bounds) const;
+	bool Enqueue(RenderQueue& queue);
 	
 
 private: 
 	
-	ComPtr<ID3D11Device>			_device; 
-	ComPtr<ID3D11DeviceContext>		_deviceContext;
-
-	ComPtr<ID3D11Buffer>			_vertexBuffer;
-	ComPtr<ID3D11Buffer>			_indexBuffer;
-
-	ComPtr<ID3DBlob>				_vertexShaderByteCode = nullptr; 
-	ComPtr<ID3DBlob>				_pixelShaderByteCode =  nullptr; 
-	ComPtr<ID3D11VertexShader>		_vertexShader; 
-	ComPtr<ID3D11PixelShader>		_pixelShader; 
-	ComPtr<ID3D11InputLayout>		_layout; 
-	ComPtr<ID3D11Buffer>			_constantBuffer;
+	// The buffers and shaders are shared with every other cube through the resource cache
+	MeshResourcePointer				_meshResource;
+	ShaderResourcePointer			_vertexShader; 
+	ShaderResourcePointer			_instancedVertexShader;
+	ShaderResourcePointer			_pixelShader; 
+	ConstantBufferResourcePointer	_constantBuffer;
+	InstanceBufferResourcePointer	_instanceBuffer;
 
 	Vector4							_ambientColour; 
+
+	// Indices of the shader program and mesh in the render queue
+	uint32_t						_program{ RenderQueue::INVALID_INDEX };
+	uint32_t						_mesh{ RenderQueue::INVALID_INDEX };
 	
 
 
 	void BuildVertexNormals();
 	void BuildGeometryBuffers(); 
 	void BuildShaders(); 
-	void BuildVertexLayout();
 	void BuildConstantBuffer(); 
+	void BuildInstanceBuffer();
+	void AddToRenderQueue();
+	void FillConstantBuffer(CBuffer& constantBuffer) const;
 
 };
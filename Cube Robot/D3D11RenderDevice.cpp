@@ -0,0 +1,229 @@
+#include "D3D11RenderDevice.h"
+#include "AllocationTracker.h"
+
+ResourceId D3D11RenderDevice::CreateVertexBuffer(const void * data, size_t size)
+{
+	return CreateBuffer(D3D11_BIND_VERTEX_BUFFER, D3D11_USAGE_IMMUTABLE, data, size);
+}
+
+ResourceId D3D11RenderDevice::CreateIndexBuffer(const void * data, size_t size)
+{
+	return CreateBuffer(D3D11_BIND_INDEX_BUFFER, D3D11_USAGE_IMMUTABLE, data, size);
+}
+
+ResourceId D3D11RenderDevice::CreateConstantBuffer(size_t size)
+{
+	return CreateBuffer(D3D11_BIND_CONSTANT_BUFFER, D3D11_USAGE_DEFAULT, nullptr, size);
+}
+
+ResourceId D3D11RenderDevice::CreateDynamicVertexBuffer(size_t size)
+{
+	return CreateBuffer(D3D11_BIND_VERTEX_BUFFER, D3D11_USAGE_DYNAMIC, nullptr, size);
+}
+
+ResourceId D3D11RenderDevice::CreateBuffer(UINT bindFlags, D3D11_USAGE usage, const void * data, size_t size)
+{
+	D3D11_BUFFER_DESC bufferDescriptor = { 0 };
+	bufferDescriptor.Usage = usage;
+	bufferDescriptor.ByteWidth = static_cast<UINT>(size);
+	bufferDescriptor.BindFlags = bindFlags;
+	bufferDescriptor.CPUAccessFlags = (usage == D3D11_USAGE_DYNAMIC) ? D3D11_CPU_ACCESS_WRITE : 0;
+	bufferDescriptor.MiscFlags = 0;
+	bufferDescriptor.StructureByteStride = 0;
+
+	D3D11_SUBRESOURCE_DATA initialisationData = { 0 };
+	initialisationData.pSysMem = data;
+
+	Resource resource;
+	ThrowIfFailed(_device->CreateBuffer(&bufferDescriptor, data == nullptr ? nullptr : &initialisationData, resource.Buffer.GetAddressOf()));
+	AllocationTracker::RecordResource(size);
+	return AddResource(move(resource));
+}
+
+ResourceId D3D11RenderDevice::CreateVertexShader(const void * bytecode, size_t size)
+{
+	Resource resource;
+	ThrowIfFailed(_device->CreateVertexShader(bytecode, size, NULL, resource.VertexShader.GetAddressOf()));
+	AllocationTracker::RecordResource(size);
+	return AddResource(move(resource));
+}
+
+ResourceId D3D11RenderDevice::CreatePixelShader(const void * bytecode, size_t size)
+{
+	Resource resource;
+	ThrowIfFailed(_device->CreatePixelShader(bytecode, size, NULL, resource.PixelShader.GetAddressOf()));
+	AllocationTracker::RecordResource(size);
+	return AddResource(move(resource));
+}
+
+ResourceId D3D11RenderDevice::CreateInputLayout(const VertexElement * elements, size_t elementCount, const void * vertexShaderBytecode, size_t size)
+{
+	vector<D3D11_INPUT_ELEMENT_DESC> elementDescriptors(elementCount);
+	for (size_t i = 0; i < elementCount; i++)
+	{
+		D3D11_INPUT_ELEMENT_DESC& descriptor = elementDescriptors[i];
+		descriptor.SemanticName = elements[i].SemanticName;
+		descriptor.SemanticIndex = elements[i].SemanticIndex;
+		switch (elements[i].Format)
+		{
+			case VertexFormat::Float2:
+				descriptor.Format = DXGI_FORMAT_R32G32_FLOAT;
+				break;
+
+			case VertexFormat::Float3:
+				descriptor.Format = DXGI_FORMAT_R32G32B32_FLOAT;
+				break;
+
+			default:
+				descriptor.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+				break;
+		}
+		// Per-instance elements are read from the second input slot (see SetInstanceBuffer)
+		bool firstInSlot = true;
+		for (size_t j = 0; j < i; j++)
+		{
+			firstInSlot = firstInSlot && elements[j].PerInstance != elements[i].PerInstance;
+		}
+		descriptor.InputSlot = elements[i].PerInstance ? 1 : 0;
+		descriptor.AlignedByteOffset = firstInSlot ? 0 : D3D11_APPEND_ALIGNED_ELEMENT;
+		descriptor.InputSlotClass = elements[i].PerInstance ? D3D11_INPUT_PER_INSTANCE_DATA : D3D11_INPUT_PER_VERTEX_DATA;
+		descriptor.InstanceDataStepRate = elements[i].PerInstance ? 1 : 0;
+	}
+
+	Resource resource;
+	ThrowIfFailed(_device->CreateInputLayout(elementDescriptors.data(), static_cast<UINT>(elementCount), vertexShaderBytecode, size, resource.InputLayout.GetAddressOf()));
+	AllocationTracker::RecordResource(0);
+	return AddResource(move(resource));
+}
+
+void D3D11RenderDevice::ReleaseResource(ResourceId resource)
+{
+	if (resource != 0)
+	{
+		_resources[resource - 1] = Resource();
+	}
+}
+
+ResourceId D3D11RenderDevice::AddResource(Resource&& resource)
+{
+	_resources.push_back(move(resource));
+	return static_cast<ResourceId>(_resources.size());
+}
+
+void D3D11RenderDevice::Clear(const float colour[4], float depth)
+{
+	if (_renderTargetView.Get() != nullptr)
+	{
+		_deviceContext->ClearRenderTargetView(_renderTargetView.Get(), colour);
+	}
+	if (_depthStencilView.Get() != nullptr)
+	{
+		_deviceContext->ClearDepthStencilView(_depthStencilView.Get(), D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, depth, 0);
+	}
+}
+
+void D3D11RenderDevice::SetViewport(float x, float y, float width, float height)
+{
+	D3D11_VIEWPORT viewPort = { 0 };
+	viewPort.Width = width;
+	viewPort.Height = height;
+	viewPort.MinDepth = 0.0f;
+	viewPort.MaxDepth = 1.0f;
+	viewPort.TopLeftX = x;
+	viewPort.TopLeftY = y;
+	_deviceContext->RSSetViewports(1, &viewPort);
+}
+
+void D3D11RenderDevice::SetRenderTargets(ComPtr<ID3D11RenderTargetView> renderTargetView, ComPtr<ID3D11DepthStencilView> depthStencilView)
+{
+	_renderTargetView = renderTargetView;
+	_depthStencilView = depthStencilView;
+	_deviceContext->OMSetRenderTargets(1, _renderTargetView.GetAddressOf(), _depthStencilView.Get());
+}
+
+void D3D11RenderDevice::SetPrimitiveTopology(PrimitiveTopology topology)
+{
+	D3D11_PRIMITIVE_TOPOLOGY d3dTopology;
+	switch (topology)
+	{
+		case PrimitiveTopology::TriangleStrip:
+			d3dTopology = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP;
+			break;
+
+		case PrimitiveTopology::LineList:
+			d3dTopology = D3D11_PRIMITIVE_TOPOLOGY_LINELIST;
+			break;
+
+		default:
+			d3dTopology = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+			break;
+	}
+	_deviceContext->IASetPrimitiveTopology(d3dTopology);
+}
+
+void D3D11RenderDevice::SetInputLayout(ResourceId inputLayout)
+{
+	_deviceContext->IASetInputLayout(inputLayout == 0 ? nullptr : GetResource(inputLayout).InputLayout.Get());
+}
+
+void D3D11RenderDevice::SetVertexShader(ResourceId vertexShader)
+{
+	_deviceContext->VSSetShader(vertexShader == 0 ? nullptr : GetResource(vertexShader).VertexShader.Get(), 0, 0);
+}
+
+void D3D11RenderDevice::SetPixelShader(ResourceId pixelShader)
+{
+	_deviceContext->PSSetShader(pixelShader == 0 ? nullptr : GetResource(pixelShader).PixelShader.Get(), 0, 0);
+}
+
+void D3D11RenderDevice::SetVertexBuffer(ResourceId vertexBuffer, uint32_t stride)
+{
+	ID3D11Buffer * buffer = (vertexBuffer == 0) ? nullptr : GetResource(vertexBuffer).Buffer.Get();
+	UINT offset = 0;
+	_deviceContext->IASetVertexBuffers(0, 1, &buffer, &stride, &offset);
+}
+
+void D3D11RenderDevice::SetInstanceBuffer(ResourceId instanceBuffer, uint32_t stride)
+{
+	ID3D11Buffer * buffer = (instanceBuffer == 0) ? nullptr : GetResource(instanceBuffer).Buffer.Get();
+	UINT offset = 0;
+	_deviceContext->IASetVertexBuffers(1, 1, &buffer, &stride, &offset);
+}
+
+void D3D11RenderDevice::SetIndexBuffer(ResourceId indexBuffer)
+{
+	_deviceContext->IASetIndexBuffer(indexBuffer == 0 ? nullptr : GetResource(indexBuffer).Buffer.Get(), DXGI_FORMAT_R32_UINT, 0);
+}
+
+void D3D11RenderDevice::SetConstantBuffer(uint32_t slot, ResourceId constantBuffer)
+{
+	ID3D11Buffer * buffer = (constantBuffer == 0) ? nullptr : GetResource(constantBuffer).Buffer.Get();
+	_deviceContext->VSSetConstantBuffers(slot, 1, &buffer);
+	_deviceContext->PSSetConstantBuffers(slot, 1, &buffer);
+}
+
+void D3D11RenderDevice::UpdateConstantBuffer(ResourceId constantBuffer, const void * data, size_t size)
+{
+	_deviceContext->UpdateSubresource(GetResource(constantBuffer).Buffer.Get(), 0, 0, data, 0, 0);
+}
+
+void D3D11RenderDevice::UpdateVertexBuffer(ResourceId dynamicVertexBuffer, const void * data, size_t size)
+{
+	// Discarding the previous contents lets the driver give us new memory rather than waiting
+	// for the GPU to finish with draws that are still using the buffer
+	ID3D11Buffer * buffer = GetResource(dynamicVertexBuffer).Buffer.Get();
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	ThrowIfFailed(_deviceContext->Map(buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped));
+	memcpy(mapped.pData, data, size);
+	_deviceContext->Unmap(buffer, 0);
+}
+
+void D3D11RenderDevice::DrawIndexed(uint32_t indexCount, uint32_t startIndex, int32_t baseVertex)
+{
+	_deviceContext->DrawIndexed(indexCount, startIndex, baseVertex);
+}
+
+void D3D11RenderDevice::DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex)
+{
+	_deviceContext->DrawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, 0);
+}
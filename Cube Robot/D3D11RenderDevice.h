@@ -0,0 +1,63 @@
+#pragma once
+#include "DirectXCore.h"
+#include "RenderDevice.h"
+#include <vector>
+
+// The Direct3D 11 implementation of RenderDevice
+
+class D3D11RenderDevice : public RenderDevice
+{
+public:
+	D3D11RenderDevice(ComPtr<ID3D11Device> device, ComPtr<ID3D11DeviceContext> deviceContext) : _device(device), _deviceContext(deviceContext) {}
+
+	ResourceId CreateVertexBuffer(const void * data, size_t size);
+	ResourceId CreateIndexBuffer(const void * data, size_t size);
+	ResourceId CreateConstantBuffer(size_t size);
+	ResourceId CreateDynamicVertexBuffer(size_t size);
+	ResourceId CreateVertexShader(const void * bytecode, size_t size);
+	ResourceId CreatePixelShader(const void * bytecode, size_t size);
+	ResourceId CreateInputLayout(const VertexElement * elements, size_t elementCount, const void * vertexShaderBytecode, size_t size);
+	void ReleaseResource(ResourceId resource);
+
+	void Clear(const float colour[4], float depth);
+	void SetViewport(float x, float y, float width, float height);
+
+	void SetPrimitiveTopology(PrimitiveTopology topology);
+	void SetInputLayout(ResourceId inputLayout);
+	void SetVertexShader(ResourceId vertexShader);
+	void SetPixelShader(ResourceId pixelShader);
+	void SetVertexBuffer(ResourceId vertexBuffer, uint32_t stride);
+	void SetInstanceBuffer(ResourceId instanceBuffer, uint32_t stride);
+	void SetIndexBuffer(ResourceId indexBuffer);
+	void SetConstantBuffer(uint32_t slot, ResourceId constantBuffer);
+	void UpdateConstantBuffer(ResourceId constantBuffer, const void * data, size_t size);
+	void UpdateVertexBuffer(ResourceId dynamicVertexBuffer, const void * data, size_t size);
+	void DrawIndexed(uint32_t indexCount, uint32_t startIndex, int32_t baseVertex);
+	void DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex);
+
+	// Bind the views that Clear and the draws go to.  These are created by the framework from the
+	// swap chain, and must be set again whenever the swap chain is resized.
+	void SetRenderTargets(ComPtr<ID3D11RenderTargetView> renderTargetView, ComPtr<ID3D11DepthStencilView> depthStencilView);
+
+private:
+	// Only one of the members is set, depending on the type of the resource
+	struct Resource
+	{
+		ComPtr<ID3D11Buffer>			Buffer;
+		ComPtr<ID3D11VertexShader>		VertexShader;
+		ComPtr<ID3D11PixelShader>		PixelShader;
+		ComPtr<ID3D11InputLayout>		InputLayout;
+	};
+
+	ComPtr<ID3D11Device>				_device;
+	ComPtr<ID3D11DeviceContext>			_deviceContext;
+	ComPtr<ID3D11RenderTargetView>		_renderTargetView;
+	ComPtr<ID3D11DepthStencilView>		_depthStencilView;
+
+	// The ResourceId of each resource is its index in this vector plus one
+	std::vector<Resource>				_resources;
+
+	ResourceId CreateBuffer(UINT bindFlags, D3D11_USAGE usage, const void * data, size_t size);
+	ResourceId AddResource(Resource&& resource);
+	inline const Resource& GetResource(ResourceId id) const { return _resources[id - 1]; }
+};
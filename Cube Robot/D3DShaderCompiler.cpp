@@ -0,0 +1,37 @@
+#include "D3DShaderCompiler.h"
+
+bool D3DShaderCompiler::Compile(const std::wstring& fileName, const std::string& entryPoint, const std::string& profile,
+								const std::vector<ShaderDefine>& defines, std::vector<char>& bytecode, std::string& messages)
+{
+	// The list of macros passed to the compiler is terminated by an entry with a null name
+	std::vector<D3D_SHADER_MACRO> macros;
+	for (const ShaderDefine& define : defines)
+	{
+		macros.push_back({ define.Name.c_str(), define.Value.c_str() });
+	}
+	macros.push_back({ nullptr, nullptr });
+
+	ComPtr<ID3DBlob> compiledShader = nullptr;
+	ComPtr<ID3DBlob> compilationMessages = nullptr;
+	HRESULT hr = D3DCompileFromFile(fileName.c_str(),
+		macros.data(), D3D_COMPILE_STANDARD_FILE_INCLUDE,
+		entryPoint.c_str(), profile.c_str(),
+		_flags, 0,
+		compiledShader.GetAddressOf(),
+		compilationMessages.GetAddressOf());
+
+	messages.clear();
+	if (compilationMessages.Get() != nullptr)
+	{
+		// If there were any compilation messages, display them
+		messages.assign(static_cast<const char *>(compilationMessages->GetBufferPointer()), compilationMessages->GetBufferSize());
+		MessageBoxA(0, messages.c_str(), 0, 0);
+	}
+	if (FAILED(hr) || compiledShader.Get() == nullptr)
+	{
+		return false;
+	}
+	const char * code = static_cast<const char *>(compiledShader->GetBufferPointer());
+	bytecode.assign(code, code + compiledShader->GetBufferSize());
+	return true;
+}
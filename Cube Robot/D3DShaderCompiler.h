@@ -0,0 +1,27 @@
+#pragma once
+#include "DirectXCore.h"
+#include "ShaderCompiler.h"
+
+// Compiles shaders with D3DCompileFromFile.  By default, debug builds compile with
+// debug information and without optimisation.  Any messages from the compiler are
+// also displayed in a message box.
+
+class D3DShaderCompiler : public ShaderCompiler
+{
+public:
+	D3DShaderCompiler() : D3DShaderCompiler(DEFAULT_FLAGS) {}
+	D3DShaderCompiler(uint32_t flags) : _flags(flags) {}
+
+	bool Compile(const std::wstring& fileName, const std::string& entryPoint, const std::string& profile,
+				 const std::vector<ShaderDefine>& defines, std::vector<char>& bytecode, std::string& messages);
+	inline uint32_t GetFlags() const { return _flags; }
+
+#if defined( _DEBUG )
+	static constexpr uint32_t DEFAULT_FLAGS = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+#else
+	static constexpr uint32_t DEFAULT_FLAGS = 0;
+#endif
+
+private:
+	uint32_t		_flags;
+};
@@ -1,17 +1,18 @@
 #pragma once
 #include "DirectXFramework.h"
+#include "Robot.h"
 
 class DirectXApp : public DirectXFramework
 {
 public:
 	void CreateSceneGraph();
 	void UpdateSceneGraph();
-	float _rotationAngle;
 	float _yOffset;
 	bool _isGoingUp;
-	float shoulderOffsetX;
-	float shoulderOffsetY; 
-	float shoulderOffsetZ;
+
+private:
+	unique_ptr<AnimationSystem> _animation;
+	uint32_t _robotRig;
 
 };
 
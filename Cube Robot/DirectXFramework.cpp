@@ -1,4 +1,17 @@
 #include "DirectXFramework.h"
+#include "SceneGraphBenchmark.h"
+#include "RenderBenchmark.h"
+#include "RasterizerBenchmark.h"
+#include "AnimationBenchmark.h"
+#include "CrowdBenchmark.h"
+#include "FramePacingBenchmark.h"
+#include "ProfilerBenchmark.h"
+#include "FrameStatisticsBenchmark.h"
+#include "AllocationBenchmark.h"
+#include "NormalsBenchmark.h"
+#include "WeldingBenchmark.h"
+#include "Profiler.h"
+#include <algorithm>
 
 // DirectX libraries that are needed
 #pragma comment(lib, "d3d11.lib")
@@ -90,25 +103,108 @@ bool DirectXFramework::Initialise()
 	{
 		return false;
 	}
+	_renderDevice = make_unique<D3D11RenderDevice>(_device, _deviceContext);
+	_countingRenderDevice = make_unique<CountingRenderDevice>(*_renderDevice, _renderStatistics);
+	// Compiled shaders are kept in the shader cache file, so they only need compiling again when they change
+	_shaderCompiler = make_unique<D3DShaderCompiler>();
+	_shaderCache = make_unique<CachingShaderCompiler>(*_shaderCompiler, L"ShaderCache.bin");
+	_resourceCache = make_unique<ResourceCache>(*_renderDevice, *_shaderCache);
 	OnResize(SIZE_RESTORED);
 	
 	SetCameraPosition(Vector3(0.0f, 20.0f, -90.0f));
 	SetCameraFocalPoint(Vector3(0.0f, 20.0f, 0.0f));
-	_sceneGraph = make_shared<SceneGraph>();
+	_sceneGraph = _nodePool.Create<SceneGraph>();
+	_sceneGraph->SetRenderQueue(&_renderQueue);
+	_sceneGraph->SetOcclusionCuller(&_occlusionCuller);
 	CreateSceneGraph();
-	return _sceneGraph->Initialise();
+	if (!_sceneGraph->Initialise())
+	{
+		return false;
+	}
+
+	// The scene is updated at a fixed rate, so frames are drawn between the last two updates
+	_sceneGraph->EnableInterpolation(true);
+
+	// Frames are submitted on the render thread, so that the next frame can be updated at the same time
+	_framePipeline = make_unique<FramePipeline>(FRAME_PACKETS,
+												[this](FramePacket& packet)
+												{
+													PROFILE_ZONE("DirectXFramework::SubmitFrame");
+													// Clear the render target and the depth stencil view, then sort the draws
+													// to reduce state changes and submit them
+													_countingRenderDevice->Clear(packet.BackgroundColour, 1.0f);
+													packet.Queue.Sort();
+													packet.Queue.Submit(*_countingRenderDevice);
+													// Now display the scene
+													{
+														PROFILE_ZONE("Present");
+														ThrowIfFailed(_swapChain->Present(0, 0));
+													}
+													// The device has counted the draws, and the node counts come with the packet
+													RenderCounters& counters = _renderStatistics.GetCounters();
+													counters.NodesVisited = packet.Counters.NodesVisited;
+													counters.NodesCulled = packet.Counters.NodesCulled;
+													counters.NodesOccluded = packet.Counters.NodesOccluded;
+													counters.NodesDrawn = packet.Counters.NodesDrawn;
+													_renderStatistics.EndFrame(packet.FrameNumber);
+												});
+	_framePipeline->SetWaitFunction([this]()
+									{
+										// Only the messages sent from other threads are handled, so nothing from the
+										// message queue is dispatched until the main loop gets to it
+										_handlingSentMessages = true;
+										MSG message;
+										PeekMessage(&message, nullptr, 0, 0, PM_NOREMOVE | PM_QS_SENDMESSAGE);
+										_handlingSentMessages = false;
+									});
+	return true;
 	
 }
 
 void DirectXFramework::Shutdown()
 {
+	// Finish submitting any frames before the nodes release their resources.  The pipeline is flushed
+	// first so that the messages Present sends are handled while the last frames are submitted.
+	if (_framePipeline)
+	{
+		_framePipeline->Flush();
+	}
+	_framePipeline.reset();
 	// Required because we called CoInitialize above
 	_sceneGraph->Shutdown();
 	CoUninitialize();
 }
 
+int DirectXFramework::RunBenchmarks()
+{
+	static int (* const benchmarks[])() =
+	{
+		[]() { return RunSceneGraphBenchmarks("SceneGraphBenchmark.csv"); },
+		[]() { return RunRenderBenchmarks("RenderBenchmark.csv"); },
+		[]() { return RunRasterizerBenchmarks("RasterizerBenchmark.csv"); },
+		[]() { return RunAnimationBenchmarks("AnimationBenchmark.csv"); },
+		[]() { return RunCrowdBenchmarks("CrowdBenchmark.csv"); },
+		[]() { return RunPacingBenchmarks("PacingBenchmark.csv"); },
+		[]() { return RunProfilerBenchmarks("ProfilerBenchmark.csv", "ProfilerTrace.json"); },
+		[]() { return RunFrameStatisticsBenchmarks("FrameStatisticsBenchmark.csv", "FrameStatisticsBenchmark.log"); },
+		[]() { return RunAllocationBenchmarks("AllocationBenchmark.csv", "AllocationBenchmarkReport.csv"); },
+		[]() { return RunNormalsBenchmarks("NormalsBenchmark.csv"); },
+		[]() { return RunWeldingBenchmarks("WeldingBenchmark.csv"); }
+	};
+	for (auto runBenchmarks : benchmarks)
+	{
+		int result = runBenchmarks();
+		if (result != 0)
+		{
+			return result;
+		}
+	}
+	return 0;
+}
+
 void DirectXFramework::Update()
 {
+	PROFILE_ZONE("DirectXFramework::Update");
 	// Do any updates to the scene graph nodes
 	UpdateSceneGraph();
 	// Now apply any updates that have been made to world transformations
@@ -119,13 +215,39 @@ void DirectXFramework::Update()
 
 void DirectXFramework::Render()
 {
-	// Clear the render target and the depth stencil view
-	_deviceContext->ClearRenderTargetView(_renderTargetView.Get(), _backgroundColour);
-	_deviceContext->ClearDepthStencilView(_depthStencilView.Get(), D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
-	// Now recurse through the scene graph, rendering each object
+	PROFILE_ZONE("DirectXFramework::Render");
+	// Skip the frame if the window thread is waiting for the render thread, and apply any resize that
+	// was put off while it waited
+	if (_handlingSentMessages)
+	{
+		return;
+	}
+	if (_resizePending)
+	{
+		OnResize(SIZE_RESTORED);
+	}
+
+	// Nodes that moved in the last update are drawn part of the way between where they were before it and after it
+	_sceneGraph->Interpolate(GetInterpolation());
+
+	// Draw any occluders, then recurse through the scene graph, queuing the draws for each object that
+	// is inside the view frustum and not hidden.  The draws carry copies of everything needed to submit
+	// them, so the frame is handed over to be submitted on the render thread while the next frame is updated.
+	FramePacket& packet = _framePipeline->BeginFrame();
+	std::copy(_backgroundColour, _backgroundColour + 4, packet.BackgroundColour);
+	packet.Queue.CopyResources(_renderQueue);
+	Matrix viewProjectionTransformation = _viewTransformation * _projectionTransformation;
+	_occlusionCuller.BeginFrame(viewProjectionTransformation);
+	packet.Queue.BeginFrame(_viewTransformation, _nearPlane, _farPlane);
+	_sceneGraph->SetRenderQueue(&packet.Queue);
+	_sceneGraph->SetViewFrustum(Frustum(viewProjectionTransformation));
 	_sceneGraph->Render();
-	// Now display the scene
-	ThrowIfFailed(_swapChain->Present(0, 0));
+	const CullingStatistics& culling = _sceneGraph->GetCullingStatistics();
+	packet.Counters.NodesVisited = culling.NodesVisited;
+	packet.Counters.NodesCulled = culling.NodesCulled;
+	packet.Counters.NodesOccluded = culling.NodesOccluded;
+	packet.Counters.NodesDrawn = culling.NodesDrawn;
+	_framePipeline->EndFrame();
 }
 
 void DirectXFramework::OnResize(WPARAM wParam)
@@ -135,13 +257,27 @@ void DirectXFramework::OnResize(WPARAM wParam)
 		return;
 	}
 
+	// The render thread must have finished with the device before the buffers are changed.  If the
+	// window thread is already waiting for it, the resize is left for the next frame.
+	if (_handlingSentMessages)
+	{
+		_resizePending = true;
+		return;
+	}
+	_resizePending = false;
+	if (_framePipeline)
+	{
+		_framePipeline->Flush();
+	}
+
 	// Update view and projection matrices to allow for the window size change
 	_viewTransformation = XMMatrixLookAtLH(_eyePosition, _focalPointPosition, _upVector);
-	_projectionTransformation = XMMatrixPerspectiveFovLH(XM_PIDIV4, (float)GetWindowWidth() / GetWindowHeight(), 1.0f, 10000.0f);
+	_projectionTransformation = XMMatrixPerspectiveFovLH(XM_PIDIV4, (float)GetWindowWidth() / GetWindowHeight(), _nearPlane, _farPlane);
 		
 
 	// This will free any existing render and depth views (which
 	// would be the case if the window was being resized)
+	_renderDevice->SetRenderTargets(nullptr, nullptr);
 	_renderTargetView = nullptr;
 	_depthStencilView = nullptr;
 	_depthStencilBuffer = nullptr;
@@ -175,17 +311,10 @@ void DirectXFramework::OnResize(WPARAM wParam)
 
 	// Bind the render target view buffer and the depth stencil view buffer to the output-merger stage
 	// of the pipeline. 
-	_deviceContext->OMSetRenderTargets(1, _renderTargetView.GetAddressOf(), _depthStencilView.Get());
+	_renderDevice->SetRenderTargets(_renderTargetView, _depthStencilView);
 
 	// Specify a viewport of the required size
-	D3D11_VIEWPORT viewPort = { 0 };
-	viewPort.Width = static_cast<float>(GetWindowWidth());
-	viewPort.Height = static_cast<float>(GetWindowHeight());
-	viewPort.MinDepth = 0.0f;
-	viewPort.MaxDepth = 1.0f;
-	viewPort.TopLeftX = 0;
-	viewPort.TopLeftY = 0;
-	_deviceContext->RSSetViewports(1, &viewPort);
+	_renderDevice->SetViewport(0.0f, 0.0f, static_cast<float>(GetWindowWidth()), static_cast<float>(GetWindowHeight()));
 }
 
 bool DirectXFramework::GetDeviceAndSwapChain()
@@ -3,6 +3,19 @@
 #include "Framework.h"
 #include "DirectXCore.h"
 #include "SceneGraph.h"
+#include "D3D11RenderDevice.h"
+#include "D3DShaderCompiler.h"
+#include "CachingShaderCompiler.h"
+#include "RenderQueue.h"
+#include "ResourceCache.h"
+#include "OcclusionCuller.h"
+#include "NodeAllocator.h"
+#include "FramePipeline.h"
+#include "CountingRenderDevice.h"
+
+// The number of frame packets.  With two, the scene is updated for the next frame while the last
+// one is submitted on a render thread (see FramePipeline).
+constexpr size_t FRAME_PACKETS = 2;
 
 class DirectXFramework : public Framework
 {
@@ -19,11 +32,24 @@ public:
 	void OnResize(WPARAM wParam);
 	void Shutdown();
 
+	// Runs each set of benchmarks and checks in turn, stopping at the first set that does not return 0.
+	// None of them need a window or a GPU.  Each Run...Benchmarks function writes its results to the
+	// files it is given and returns 0 if every check passed, 1 if a check failed, or -1 if one of its
+	// files could not be written.  The result of the last set run is returned, and is the exit code of
+	// the application when it is started with the -benchmark option.
+	int RunBenchmarks();
+
 	static DirectXFramework *			GetDXFramework();
 
 	inline SceneGraphPointer			GetSceneGraph() { return _sceneGraph; }
-	inline ComPtr<ID3D11Device>			GetDevice() { return _device; }
-	inline ComPtr<ID3D11DeviceContext>	GetDeviceContext() { return _deviceContext; }
+	inline RenderDevice *				GetRenderDevice() { return _renderDevice.get(); }
+	inline RenderQueue&					GetRenderQueue() { return _renderQueue; }
+	inline ResourceCache *				GetResourceCache() { return _resourceCache.get(); }
+	inline OcclusionCuller&				GetOcclusionCuller() { return _occlusionCuller; }
+	inline NodePool&					GetNodePool() { return _nodePool; }
+
+	// What was drawn in the last frame submitted.  This can be called from any thread.
+	inline RenderCounters				GetRenderStatistics() const { return _renderStatistics.GetLastFrame(); }
 
 	void SetCameraPosition(Vector3 cameraPosition);
 	void SetCameraFocalPoint(Vector3 cameraFocalPoint);
@@ -50,11 +76,50 @@ private:
 
 	Matrix								_viewTransformation;
 	Matrix								_projectionTransformation;
+	float								_nearPlane{ 1.0f };
+	float								_farPlane{ 10000.0f };
+
+	// The resources shared by the nodes are held in the resource cache.  These are declared before
+	// the scene graph so that they are destroyed after it.
+	unique_ptr<D3D11RenderDevice>		_renderDevice;
+	unique_ptr<D3DShaderCompiler>		_shaderCompiler;
+	unique_ptr<CachingShaderCompiler>	_shaderCache;
+	unique_ptr<ResourceCache>			_resourceCache;
+
+	// Nodes should be created with _nodePool.Create rather than make_shared, so that nodes of each
+	// type are kept together in memory.  The pool is declared before the scene graph so that it is
+	// destroyed after it.
+	NodePool							_nodePool;
 
 	SceneGraphPointer					_sceneGraph;
 
+	// Nodes add their programs and meshes to the render queue.  Each frame, the draws are added to the
+	// queue of a frame packet that uses the same programs and meshes, which is then sorted and submitted
+	// to the render device by the frame pipeline.
+	RenderQueue							_renderQueue;
+
+	// Frames are submitted through the counting device, which counts what is drawn in each frame
+	RenderStatistics					_renderStatistics;
+	unique_ptr<CountingRenderDevice>	_countingRenderDevice;
+
+	// Nodes added to the occlusion culler as occluders hide the nodes behind them.  Its statistics
+	// give the number of draws rejected and the time taken for the last frame.
+	OcclusionCuller						_occlusionCuller;
+
 	float							    _backgroundColour[4];
 
+	// Present is called on the render thread, and may send messages to the window and wait for them to
+	// be handled.  So that this cannot deadlock, the window thread handles those messages whenever it
+	// waits for the render thread.  Rendering or resizing from one of them would wait for the render
+	// thread again, so frames are skipped while the messages are handled, and a resize is put off
+	// until the next frame.
+	bool								_handlingSentMessages{ false };
+	bool								_resizePending{ false };
+
+	// The render thread uses the swap chain, the counting device and the statistics above, so the
+	// pipeline is declared last, so that the thread is stopped before any of them are destroyed
+	unique_ptr<FramePipeline>			_framePipeline;
+
 	bool GetDeviceAndSwapChain();
 };
 
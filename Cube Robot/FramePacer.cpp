@@ -0,0 +1,94 @@
+#include "FramePacer.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+#if defined( _WIN32 )
+#include <windows.h>
+#include <timeapi.h>
+#pragma comment(lib, "winmm.lib")
+#endif
+
+SteadyFrameClock::SteadyFrameClock()
+{
+#if defined( _WIN32 )
+	// By default, Windows only wakes sleeping threads every 15.6ms
+	timeBeginPeriod(1);
+#endif
+}
+
+SteadyFrameClock::~SteadyFrameClock()
+{
+#if defined( _WIN32 )
+	timeEndPeriod(1);
+#endif
+}
+
+double SteadyFrameClock::Now()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void SteadyFrameClock::SleepUntil(double time)
+{
+	double sleepTime = time - Now() - SPIN_TIME;
+	if (sleepTime > 0.0)
+	{
+		std::this_thread::sleep_for(std::chrono::duration<double>(sleepTime));
+	}
+	while (Now() < time)
+	{
+		std::this_thread::yield();
+	}
+}
+
+FramePacer::FramePacer(FrameClock& clock, double simulationStep, double frameInterval, unsigned int maximumSteps)
+	: _clock(clock), _simulationStep(simulationStep), _frameInterval(frameInterval), _maximumSteps(maximumSteps)
+{
+	_lastFrameStart = _clock.Now();
+	_nextFrameStart = _lastFrameStart;
+}
+
+unsigned int FramePacer::BeginFrame()
+{
+	double now = _clock.Now();
+	_frameTime = now - _lastFrameStart;
+	_lastFrameStart = now;
+	_frameCount++;
+
+	// When frames are paced at a multiple of the step, the time is a whole number of steps give or take
+	// rounding errors, so a step that is very nearly due is run now rather than in the next frame
+	_accumulatedTime += _frameTime;
+	double steps = std::floor(_accumulatedTime / _simulationStep + STEP_TOLERANCE);
+	_accumulatedTime = std::max(_accumulatedTime - steps * _simulationStep, 0.0);
+	if (steps > _maximumSteps)
+	{
+		_droppedStepCount += static_cast<unsigned long long>(steps) - _maximumSteps;
+		steps = _maximumSteps;
+	}
+	_stepCount += static_cast<unsigned long long>(steps);
+	return static_cast<unsigned int>(steps);
+}
+
+void FramePacer::WaitForNextFrame()
+{
+	if (_frameInterval <= 0.0)
+	{
+		return;
+	}
+	_nextFrameStart += _frameInterval;
+	double now = _clock.Now();
+	if (_nextFrameStart + _frameInterval < now)
+	{
+		// More than a frame behind.  Start the next frame now, since trying to catch up would mean
+		// drawing several frames as quickly as possible.
+		_droppedFrameCount += static_cast<unsigned long long>((now - _nextFrameStart) / _frameInterval);
+		_nextFrameStart = now;
+		return;
+	}
+	if (_nextFrameStart > now)
+	{
+		_clock.SleepUntil(_nextFrameStart);
+	}
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+// The source of time for a FramePacer.  Times are in seconds from an arbitrary starting point.  The
+// pacer only uses the clock through this interface, so a fake clock can be used to check it.
+
+class FrameClock
+{
+public:
+	virtual ~FrameClock() {}
+
+	virtual double Now() = 0;
+
+	// Return once the given time has been reached
+	virtual void SleepUntil(double time) = 0;
+};
+
+// The real clock.  Sleeps can wake up late by up to a tick of the operating system's scheduler, so
+// SleepUntil sleeps until shortly before the deadline and then yields the processor until it passes.
+// On Windows, the timer resolution is raised to 1ms while the clock exists.
+
+class SteadyFrameClock : public FrameClock
+{
+public:
+	SteadyFrameClock();
+	~SteadyFrameClock();
+
+	SteadyFrameClock(const SteadyFrameClock&) = delete;
+	SteadyFrameClock& operator=(const SteadyFrameClock&) = delete;
+
+	double Now();
+	void SleepUntil(double time);
+
+	// How long before the deadline SleepUntil stops sleeping
+	static constexpr double SPIN_TIME = 0.001;
+};
+
+// Paces the main loop.  The simulation is moved on in fixed steps, however often frames are drawn,
+// and the loop sleeps between frames rather than polling the clock.
+//
+// Each frame, BeginFrame adds the time since the last frame to the time waiting to be simulated and
+// returns the number of whole steps to run.  What is left over, as a fraction of a step, is given by
+// GetInterpolation, so that the frame can be drawn part of the way between the last two steps (see
+// SceneGraph::EnableInterpolation).  WaitForNextFrame then sleeps until the next frame is due.
+//
+// If frames take so long that more than maximumSteps steps are due, the extra steps are dropped and
+// the simulation slows down rather than falling further and further behind.  If the loop falls more
+// than a frame behind, the frames that were missed are dropped rather than drawn as quickly as
+// possible to catch up.
+
+class FramePacer
+{
+public:
+	FramePacer(FrameClock& clock, double simulationStep, double frameInterval, unsigned int maximumSteps = DEFAULT_MAXIMUM_STEPS);
+
+	// Start a frame, returning the number of simulation steps to run before it is drawn
+	unsigned int BeginFrame();
+
+	// Sleep until the next frame is due.  If the frame interval is 0, this returns immediately.
+	void WaitForNextFrame();
+
+	// How far the frame is between the last two simulation steps, from 0 (the one before last) to 1 (the last)
+	inline float GetInterpolation() const { return static_cast<float>(_accumulatedTime / _simulationStep); }
+
+	// The time between the start of the last two frames
+	inline double GetFrameTime() const { return _frameTime; }
+
+	// When the next call to WaitForNextFrame will return, unless the loop has fallen more than a frame behind
+	inline double GetNextFrameStart() const { return _nextFrameStart + _frameInterval; }
+
+	inline double GetSimulationStep() const { return _simulationStep; }
+	inline double GetFrameInterval() const { return _frameInterval; }
+	inline void SetFrameInterval(double frameInterval) { _frameInterval = frameInterval; }
+
+	inline unsigned long long GetFrameCount() const { return _frameCount; }
+	inline unsigned long long GetStepCount() const { return _stepCount; }
+	inline unsigned long long GetDroppedStepCount() const { return _droppedStepCount; }
+	inline unsigned long long GetDroppedFrameCount() const { return _droppedFrameCount; }
+
+	static constexpr unsigned int DEFAULT_MAXIMUM_STEPS = 8;
+
+	// A step is run once the time waiting to be simulated is within this fraction of a step of it
+	static constexpr double STEP_TOLERANCE = 1e-6;
+
+private:
+	FrameClock&				_clock;
+	double					_simulationStep;
+	double					_frameInterval;
+	unsigned int			_maximumSteps;
+
+	double					_lastFrameStart;
+	double					_nextFrameStart;
+	double					_accumulatedTime{ 0.0 };	// Time not yet simulated, always less than a step after BeginFrame
+	double					_frameTime{ 0.0 };
+
+	unsigned long long		_frameCount{ 0 };
+	unsigned long long		_stepCount{ 0 };
+	unsigned long long		_droppedStepCount{ 0 };
+	unsigned long long		_droppedFrameCount{ 0 };
+};
@@ -0,0 +1,270 @@
+#include "FramePacingBenchmark.h"
+#include "BenchmarkFixtures.h"
+#include "FramePacer.h"
+#include "SceneGraph.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <vector>
+
+#if defined( _WIN32 )
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#endif
+
+using namespace std;
+
+// Number of frames run for each scenario with the simulated clock
+constexpr int PACING_BENCHMARK_FRAMES = 600;
+
+// Number of frames timed with the real clock for each way of waiting
+constexpr int PACING_BENCHMARK_REAL_FRAMES = 120;
+
+constexpr double PACING_BENCHMARK_STEP = 1.0 / 60.0;
+
+// A clock whose time only moves on when it is told to.  Sleeps return straight away, with the
+// clock moved on to the deadline, and the deadlines are recorded so that they can be checked.
+
+class SimulatedFrameClock : public FrameClock
+{
+public:
+	double Now() { return _time; }
+
+	void SleepUntil(double time)
+	{
+		_sleptIntoThePast = _sleptIntoThePast || time < _time;
+		_deadlines.push_back(time);
+		_time = max(_time, time);
+	}
+
+	inline void Advance(double time) { _time += time; }
+	inline const vector<double>& GetDeadlines() const { return _deadlines; }
+	inline bool SleptIntoThePast() const { return _sleptIntoThePast; }
+
+private:
+	double				_time{ 100.0 };
+	vector<double>		_deadlines;
+	bool				_sleptIntoThePast{ false };
+};
+
+// A main loop run against the simulated clock.  Each frame takes workTime to update and draw,
+// apart from hitchFrame, which takes hitchTime.  The number of steps in every frame after the first
+// should be from minimumSteps to maximumSteps.  When the frame interval is not a multiple of the
+// step, the number of steps in each frame varies.
+
+struct PacingScenario
+{
+	const char *	Name;
+	double			FrameInterval;
+	double			WorkTime;
+	int				HitchFrame;
+	double			HitchTime;
+	unsigned int	MinimumSteps;
+	unsigned int	MaximumSteps;
+	bool			DropsSteps;
+	bool			DropsFrames;
+};
+
+// Processor time used by the whole process so far, in seconds
+
+double ProcessorSecondsUsed()
+{
+#if defined( _WIN32 )
+	FILETIME creationTime;
+	FILETIME exitTime;
+	FILETIME kernelTime;
+	FILETIME userTime;
+	if (GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime))
+	{
+		// Given in units of 100ns
+		auto seconds = [](const FILETIME& time) { return ((static_cast<unsigned long long>(time.dwHighDateTime) << 32) | time.dwLowDateTime) * 1e-7; };
+		return seconds(kernelTime) + seconds(userTime);
+	}
+	return 0.0;
+#else
+	rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) == 0)
+	{
+		return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+	}
+	return 0.0;
+#endif
+}
+
+// The x coordinate of the node's cumulative world transformation
+
+float CumulativeX(const SceneNodePointer& node)
+{
+	return node->GetCumulativeWorldTransform().m[3][0];
+}
+
+int RunPacingBenchmarks(const std::string& resultsFileName)
+{
+	ofstream results(resultsFileName);
+	if (!results)
+	{
+		return -1;
+	}
+
+	// For each scenario, check that the time simulated plus the time still waiting adds up to the time
+	// that has passed, that the loop slept until the start of each frame when it was not behind and
+	// that steps and frames were only dropped when they should have been
+	bool allPassed = true;
+	const PacingScenario scenarios[] =
+	{
+		{ "matched",		1.0 / 60.0,		0.004,	-1,		0.0,	1,	1,	false,	false },
+		{ "display_144hz",	1.0 / 144.0,	0.002,	-1,		0.0,	0,	1,	false,	false },
+		{ "display_30hz",	1.0 / 30.0,		0.010,	-1,		0.0,	2,	2,	false,	false },
+		{ "uncapped",		0.0,			0.007,	-1,		0.0,	0,	1,	false,	false },
+		{ "hitch",			1.0 / 60.0,		0.004,	300,	0.1,	1,	6,	false,	true },
+		{ "overloaded",		1.0 / 60.0,		0.200,	-1,		0.0,	FramePacer::DEFAULT_MAXIMUM_STEPS,	FramePacer::DEFAULT_MAXIMUM_STEPS,	true,	true },
+	};
+	results << "benchmark,scenario,frame_interval,simulation_step,frames,steps,dropped_steps,dropped_frames,sleeps,min_steps_per_frame,max_steps_per_frame,"
+			<< "unaccounted_time,largest_deadline_error,passes" << endl;
+	for (const PacingScenario& scenario : scenarios)
+	{
+		SimulatedFrameClock clock;
+		double startTime = clock.Now();
+		FramePacer pacer(clock, PACING_BENCHMARK_STEP, scenario.FrameInterval);
+		unsigned int minimumSteps = ~0u;
+		unsigned int maximumSteps = 0;
+		bool interpolationInRange = true;
+		double lastFrameStart = startTime;
+		for (int frame = 0; frame < PACING_BENCHMARK_FRAMES; frame++)
+		{
+			unsigned int steps = pacer.BeginFrame();
+			lastFrameStart = clock.Now();
+			if (frame > 0)
+			{
+				minimumSteps = min(minimumSteps, steps);
+				maximumSteps = max(maximumSteps, steps);
+			}
+			float interpolation = pacer.GetInterpolation();
+			interpolationInRange = interpolationInRange && interpolation >= 0.0f && interpolation < 1.0f;
+			clock.Advance(frame == scenario.HitchFrame ? scenario.HitchTime : scenario.WorkTime);
+			pacer.WaitForNextFrame();
+		}
+		double simulatedTime = (pacer.GetStepCount() + pacer.GetDroppedStepCount() + pacer.GetInterpolation()) * PACING_BENCHMARK_STEP;
+		double unaccountedTime = fabs(lastFrameStart - startTime - simulatedTime);
+
+		// Until the loop falls behind, every frame should start exactly one interval after the one before
+		const vector<double>& deadlines = clock.GetDeadlines();
+		double largestDeadlineError = 0.0;
+		if (!scenario.DropsFrames)
+		{
+			for (size_t i = 0; i < deadlines.size(); i++)
+			{
+				largestDeadlineError = max(largestDeadlineError, fabs(deadlines[i] - (startTime + (i + 1) * scenario.FrameInterval)));
+			}
+		}
+		size_t expectedSleeps = scenario.FrameInterval > 0.0 && !scenario.DropsFrames ? PACING_BENCHMARK_FRAMES : 0;
+		bool passes = interpolationInRange && !clock.SleptIntoThePast()
+					  && unaccountedTime < 1e-6 && largestDeadlineError < 1e-6
+					  && minimumSteps >= scenario.MinimumSteps && maximumSteps <= scenario.MaximumSteps
+					  && (pacer.GetDroppedStepCount() != 0) == scenario.DropsSteps
+					  && (pacer.GetDroppedFrameCount() != 0) == scenario.DropsFrames
+					  && (scenario.DropsFrames ? deadlines.size() < PACING_BENCHMARK_FRAMES : deadlines.size() == expectedSleeps);
+		allPassed = allPassed && passes;
+		results << "simulated_clock," << scenario.Name << "," << scenario.FrameInterval << "," << PACING_BENCHMARK_STEP << "," << pacer.GetFrameCount() << ","
+				<< pacer.GetStepCount() << "," << pacer.GetDroppedStepCount() << "," << pacer.GetDroppedFrameCount() << "," << deadlines.size() << ","
+				<< minimumSteps << "," << maximumSteps << "," << unaccountedTime << "," << largestDeadlineError << "," << (passes ? "yes" : "no") << endl;
+	}
+
+	// With the real clock, each frame does 2ms of work and then waits for the next frame, either by
+	// sleeping or by polling the clock as the main loop used to.  How late each frame starts is
+	// measured from the deadline it was waiting for.
+	results << "benchmark,method,frames,wall_seconds,processor_seconds,processor_fraction,mean_lateness_ms,max_lateness_ms" << endl;
+	{
+		SteadyFrameClock clock;
+		for (bool sleeping : { true, false })
+		{
+			double interval = 1.0 / 60.0;
+			double totalLateness = 0.0;
+			double maximumLateness = 0.0;
+			double startProcessorTime = ProcessorSecondsUsed();
+			double startTime = clock.Now();
+			FramePacer pacer(clock, PACING_BENCHMARK_STEP, interval);
+			double nextFrameStart = startTime;
+			for (int frame = 0; frame < PACING_BENCHMARK_REAL_FRAMES; frame++)
+			{
+				double workEnd = clock.Now() + 0.002;
+				while (clock.Now() < workEnd)
+				{
+				}
+				double deadline;
+				if (sleeping)
+				{
+					pacer.BeginFrame();
+					deadline = pacer.GetNextFrameStart();
+					pacer.WaitForNextFrame();
+				}
+				else
+				{
+					nextFrameStart += interval;
+					deadline = nextFrameStart;
+					while (clock.Now() < deadline)
+					{
+					}
+				}
+				double lateness = max(0.0, clock.Now() - deadline);
+				totalLateness += lateness;
+				maximumLateness = max(maximumLateness, lateness);
+			}
+			double wallTime = clock.Now() - startTime;
+			double processorTime = ProcessorSecondsUsed() - startProcessorTime;
+			results << "real_clock," << (sleeping ? "sleep" : "poll") << "," << PACING_BENCHMARK_REAL_FRAMES << "," << wallTime << "," << processorTime << ","
+					<< processorTime / wallTime << "," << totalLateness * 1000.0 / PACING_BENCHMARK_REAL_FRAMES << "," << maximumLateness * 1000.0 << endl;
+		}
+	}
+
+	// Interpolation: a scene graph moving 10 units along x each update, with a child that moves with
+	// it and a node that stays still.  Blending only changes the cumulative transformations used to
+	// draw the nodes that moved, and never the results of the next update.
+	{
+		SceneGraphPointer root = make_shared<SceneGraph>(L"Root");
+		SceneGraphPointer mover = make_shared<SceneGraph>(L"Mover");
+		SceneNodePointer rider = make_shared<BenchmarkNode>(L"Rider");
+		SceneNodePointer still = make_shared<BenchmarkNode>(L"Still");
+		rider->SetWorldTransform(Matrix::CreateTranslation(Vector3(0.0f, 1.0f, 0.0f)));
+		still->SetWorldTransform(Matrix::CreateTranslation(Vector3(-5.0f, 0.0f, 0.0f)));
+		mover->Add(rider);
+		root->Add(mover);
+		root->Add(still);
+		root->EnableInterpolation(true);
+		Matrix identity;
+		auto moveTo = [&](float x)
+		{
+			mover->SetWorldTransform(Matrix::CreateTranslation(Vector3(x, 0.0f, 0.0f)));
+			root->Update(identity);
+		};
+		auto closeTo = [](float value, float expected) { return fabsf(value - expected) < 1e-4f; };
+
+		moveTo(0.0f);
+		root->Interpolate(0.5f);
+		bool firstUpdateNotBlended = closeTo(CumulativeX(rider), 0.0f);
+		moveTo(10.0f);
+		moveTo(20.0f);
+		root->Interpolate(0.25f);
+		bool blended = closeTo(CumulativeX(mover), 12.5f) && closeTo(CumulativeX(rider), 12.5f) && closeTo(CumulativeX(still), -5.0f);
+		root->Interpolate(0.75f);
+		bool blendedAgain = closeTo(CumulativeX(rider), 17.5f);
+		root->Update(identity);
+		root->Interpolate(0.5f);
+		bool stoppedNotBlended = closeTo(CumulativeX(rider), 20.0f) && closeTo(CumulativeX(mover), 20.0f);
+		moveTo(30.0f);
+		root->Interpolate(0.5f);
+		bool resumedBlended = closeTo(CumulativeX(rider), 25.0f);
+		root->EnableInterpolation(false);
+		root->Interpolate(0.5f);
+		bool disabledRestored = closeTo(CumulativeX(rider), 30.0f) && closeTo(CumulativeX(mover), 30.0f);
+
+		bool passes = firstUpdateNotBlended && blended && blendedAgain && stoppedNotBlended && resumedBlended && disabledRestored;
+		allPassed = allPassed && passes;
+		results << "benchmark,first_update_not_blended,blended,blended_again,stopped_not_blended,resumed_blended,disabled_restored,passes" << endl;
+		results << "interpolation," << (firstUpdateNotBlended ? "yes" : "no") << "," << (blended ? "yes" : "no") << "," << (blendedAgain ? "yes" : "no") << ","
+				<< (stoppedNotBlended ? "yes" : "no") << "," << (resumedBlended ? "yes" : "no") << "," << (disabledRestored ? "yes" : "no") << ","
+				<< (passes ? "yes" : "no") << endl;
+	}
+	return allPassed ? 0 : 1;
+}
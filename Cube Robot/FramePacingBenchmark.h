@@ -0,0 +1,14 @@
+#pragma once
+#include <string>
+
+// Checks and benchmarks for FramePacer.  The pacer is first run against a simulated clock, with
+// frames of different lengths and at different frame rates, and the simulation steps it runs, the
+// interpolation it gives and the deadlines it sleeps until are checked against what they should be.
+// Then the real clock is used to compare how much processor time the main loop uses when it sleeps
+// between frames and when it polls the clock as it used to, and how late the sleeps wake up.  These
+// times are only reported, since they depend on what else the machine is doing.  Finally,
+// SceneGraph::Interpolate is checked on a scene with moving nodes.
+//
+// The results are written as comma-separated values to the file given.
+
+int RunPacingBenchmarks(const std::string& resultsFileName);
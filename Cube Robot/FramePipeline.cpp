@@ -0,0 +1,138 @@
+#include "FramePipeline.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+
+// How often the wait function is called while waiting for the render thread
+constexpr std::chrono::milliseconds PIPELINE_WAIT_INTERVAL(1);
+
+FramePipeline::FramePipeline(size_t packetCount, SubmitFunction submit) : _submit(std::move(submit))
+{
+	packetCount = std::max<size_t>(packetCount, 1);
+	for (size_t i = 0; i < packetCount; i++)
+	{
+		_packets.push_back(std::make_unique<FramePacket>());
+	}
+	if (packetCount > 1)
+	{
+		_renderThread = std::thread(&FramePipeline::RenderLoop, this);
+	}
+}
+
+FramePipeline::~FramePipeline()
+{
+	// The render thread submits any frames that are still waiting before it stops
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stopping = true;
+	}
+	_frameReady.notify_one();
+	if (_renderThread.joinable())
+	{
+		_renderThread.join();
+	}
+}
+
+FramePacket& FramePipeline::BeginFrame()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	// The packet was last used by the frame _packets.size() frames ago, which must have been submitted
+	WaitForRenderThread(lock, [this]() { return _framesQueued - _framesSubmitted < _packets.size(); });
+	ThrowError();
+	FramePacket& packet = *_packets[_framesQueued % _packets.size()];
+	packet.FrameNumber = _framesQueued;
+	packet.ProfilerFrame = Profiler::GetFrameNumber();
+	return packet;
+}
+
+void FramePipeline::EndFrame()
+{
+	if (!IsThreaded())
+	{
+		_framesQueued++;
+		_submit(*_packets[0]);
+		_framesSubmitted++;
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_framesQueued++;
+	}
+	_frameReady.notify_one();
+}
+
+void FramePipeline::Flush()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	WaitForRenderThread(lock, [this]() { return _framesSubmitted == _framesQueued; });
+	ThrowError();
+}
+
+template <typename Predicate>
+void FramePipeline::WaitForRenderThread(std::unique_lock<std::mutex>& lock, Predicate done)
+{
+	if (!_wait)
+	{
+		_frameSubmitted.wait(lock, done);
+		return;
+	}
+	while (!_frameSubmitted.wait_for(lock, PIPELINE_WAIT_INTERVAL, done))
+	{
+		// The render thread may be waiting for the wait function, so the lock is released while it runs
+		lock.unlock();
+		_wait();
+		lock.lock();
+	}
+}
+
+void FramePipeline::RenderLoop()
+{
+	Profiler::SetThreadName("Render");
+	for (;;)
+	{
+		FramePacket * packet;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_frameReady.wait(lock, [this]() { return _framesSubmitted < _framesQueued || _stopping; });
+			if (_framesSubmitted == _framesQueued)
+			{
+				return;
+			}
+			packet = _packets[_framesSubmitted % _packets.size()].get();
+		}
+
+		// The packet is not touched by the update thread until it has been submitted, so no lock is needed.
+		// By now the main loop may have moved on to the next frame, so the zones are tagged with this one.
+		Profiler::SetThreadFrameNumber(packet->ProfilerFrame);
+		std::exception_ptr error;
+		try
+		{
+			_submit(*packet);
+		}
+		catch (...)
+		{
+			error = std::current_exception();
+		}
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_framesSubmitted++;
+			if (error != nullptr && _error == nullptr)
+			{
+				_error = error;
+			}
+		}
+		_frameSubmitted.notify_all();
+	}
+}
+
+void FramePipeline::ThrowError()
+{
+	// Called with the mutex held
+	if (_error != nullptr)
+	{
+		std::exception_ptr error = _error;
+		_error = nullptr;
+		std::rethrow_exception(error);
+	}
+}
@@ -0,0 +1,96 @@
+#pragma once
+#include "RenderQueue.h"
+#include "RenderStatistics.h"
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Everything needed to submit one frame.  The draws in the render queue carry their own copies of
+// the constants of each visible node (its world matrices, colours and so on), so once the packet
+// has been filled the scene can go on to be updated for the next frame while this one is submitted.
+
+struct FramePacket
+{
+	RenderQueue		Queue;
+	float			BackgroundColour[4]{ 0.0f, 0.0f, 0.0f, 0.0f };
+	uint64_t		FrameNumber{ 0 };
+	uint64_t		ProfilerFrame{ 0 };			// The profiler's frame when the packet was filled, which the zones submitting it are tagged with
+	RenderCounters	Counters;			// The node counts, found while filling the queue
+};
+
+// Overlaps the update of one frame with the submission of the one before.
+//
+// Each frame, the packet returned by BeginFrame is filled (normally by culling the scene graph into
+// its render queue) and handed over with EndFrame.  A render thread then passes the packets, in
+// order, to the submit function given to the constructor, which sorts and submits the queue and
+// presents the frame.  With two packets, frame N + 1 can be updated while frame N is submitted.
+// With three, the update can get a further frame ahead, which smooths out frames whose update and
+// submission times vary, at the cost of another frame of latency.  BeginFrame waits while every
+// packet is still waiting to be submitted.
+//
+// With one packet there is no render thread, and EndFrame submits the packet straight away.
+//
+// While frames are being submitted, nothing else may use the render device, so nodes that cannot be
+// added to the packet's queue (see SceneNode::Enqueue) are not drawn.  Flush should be called before
+// anything else uses the device, such as resizing the window.
+//
+// If the submit function presents the frame, Present may send messages to the window and wait for
+// them to be handled, so the thread that owns the window must not simply block while BeginFrame or
+// Flush waits for the render thread.  SetWaitFunction gives a function that is called about once a
+// millisecond while they wait, which can handle those messages.
+//
+// Exceptions thrown by the submit function are passed on by the next call to BeginFrame or Flush.
+
+class FramePipeline
+{
+public:
+	typedef std::function<void(FramePacket& packet)> SubmitFunction;
+	typedef std::function<void()> WaitFunction;
+
+	FramePipeline(size_t packetCount, SubmitFunction submit);
+	~FramePipeline();
+
+	FramePipeline(const FramePipeline&) = delete;
+	FramePipeline& operator=(const FramePipeline&) = delete;
+
+	// Returns the packet to fill for the next frame.  Its queue still holds the draws from the frame
+	// it was last used for, so RenderQueue::BeginFrame must be called on it.
+	FramePacket& BeginFrame();
+
+	// Hand the packet returned by BeginFrame over to be submitted
+	void EndFrame();
+
+	// Wait until every packet handed over has been submitted
+	void Flush();
+
+	// Called on the waiting thread while BeginFrame or Flush waits for the render thread.  It must not
+	// call BeginFrame, EndFrame or Flush.
+	inline void SetWaitFunction(WaitFunction wait) { _wait = std::move(wait); }
+
+	inline size_t GetPacketCount() const { return _packets.size(); }
+	inline bool IsThreaded() const { return _renderThread.joinable(); }
+
+private:
+	std::vector<std::unique_ptr<FramePacket>>	_packets;
+	SubmitFunction								_submit;
+	WaitFunction								_wait;
+	std::thread									_renderThread;
+
+	std::mutex									_mutex;
+	std::condition_variable						_frameReady;
+	std::condition_variable						_frameSubmitted;
+	uint64_t									_framesQueued{ 0 };		// Frames handed over by EndFrame
+	uint64_t									_framesSubmitted{ 0 };
+	bool										_stopping{ false };
+	std::exception_ptr							_error;
+
+	template <typename Predicate>
+	void WaitForRenderThread(std::unique_lock<std::mutex>& lock, Predicate done);
+	void RenderLoop();
+	void ThrowError();
+};
@@ -0,0 +1,192 @@
+#include "FrameStatistics.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace
+{
+	// Durations below LINEAR_BUCKETS nanoseconds have a bucket each.  Above that, each power of two is
+	// split into SUB_BUCKETS buckets.
+	constexpr unsigned int LINEAR_BITS = 8;
+	constexpr size_t LINEAR_BUCKETS = size_t(1) << LINEAR_BITS;
+	constexpr size_t SUB_BUCKETS = LINEAR_BUCKETS / 2;
+	constexpr unsigned int HIGHEST_BIT = 39;
+	constexpr size_t HISTOGRAM_BUCKETS = LINEAR_BUCKETS + (HIGHEST_BIT - LINEAR_BITS + 1) * SUB_BUCKETS;
+
+	// The position of the highest bit set in value, which must not be 0
+
+	inline unsigned int HighestBit(uint64_t value)
+	{
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanReverse64(&index, value);
+		return static_cast<unsigned int>(index);
+#else
+		return 63 - static_cast<unsigned int>(__builtin_clzll(value));
+#endif
+	}
+}
+
+LatencyHistogram::LatencyHistogram() : _counts(HISTOGRAM_BUCKETS, 0)
+{
+}
+
+size_t LatencyHistogram::GetBucketIndex(uint64_t value)
+{
+	if (value < LINEAR_BUCKETS)
+	{
+		return static_cast<size_t>(value);
+	}
+	unsigned int highestBit = HighestBit(value);
+	unsigned int shift = highestBit - (LINEAR_BITS - 1);
+	size_t subBucket = static_cast<size_t>(value >> shift) - SUB_BUCKETS;
+	return LINEAR_BUCKETS + (highestBit - LINEAR_BITS) * SUB_BUCKETS + subBucket;
+}
+
+uint64_t LatencyHistogram::GetBucketHighestValue(size_t index)
+{
+	if (index < LINEAR_BUCKETS)
+	{
+		return index;
+	}
+	size_t octave = (index - LINEAR_BUCKETS) / SUB_BUCKETS;
+	uint64_t subBucket = SUB_BUCKETS + (index - LINEAR_BUCKETS) % SUB_BUCKETS;
+	unsigned int shift = static_cast<unsigned int>(octave) + 1;
+	return ((subBucket + 1) << shift) - 1;
+}
+
+void LatencyHistogram::Record(uint64_t nanoseconds)
+{
+	nanoseconds = std::min(nanoseconds, MAXIMUM_VALUE);
+	_counts[GetBucketIndex(nanoseconds)]++;
+	_count++;
+	_total += nanoseconds;
+	_minimum = std::min(_minimum, nanoseconds);
+	_maximum = std::max(_maximum, nanoseconds);
+}
+
+void LatencyHistogram::Clear()
+{
+	std::fill(_counts.begin(), _counts.end(), 0);
+	_count = 0;
+	_total = 0;
+	_minimum = UINT64_MAX;
+	_maximum = 0;
+}
+
+uint64_t LatencyHistogram::GetPercentile(double fraction) const
+{
+	if (_count == 0)
+	{
+		return 0;
+	}
+
+	// The value at this rank, counting from 1, is the one wanted
+	uint64_t rank = static_cast<uint64_t>(std::ceil(std::min(std::max(fraction, 0.0), 1.0) * _count));
+	rank = std::max<uint64_t>(rank, 1);
+	uint64_t counted = 0;
+	for (size_t i = 0; i < _counts.size(); i++)
+	{
+		counted += _counts[i];
+		if (counted >= rank)
+		{
+			return std::min(GetBucketHighestValue(i), _maximum);
+		}
+	}
+	return _maximum;
+}
+
+double LatencyHistogram::GetMean() const
+{
+	return _count == 0 ? 0.0 : static_cast<double>(_total) / _count;
+}
+
+FrameStatistics::FrameStatistics(const std::string& logFileName, double reportInterval)
+	: _logFileName(logFileName), _reportInterval(reportInterval)
+{
+}
+
+void FrameStatistics::Record(double frameTime, double updateTime, double renderTime)
+{
+	const double times[MEASUREMENT_COUNT] = { frameTime, updateTime, renderTime };
+	for (size_t i = 0; i < MEASUREMENT_COUNT; i++)
+	{
+		uint64_t nanoseconds = static_cast<uint64_t>(std::max(times[i], 0.0) * 1e9);
+		_period[i].Record(nanoseconds);
+		_total[i].Record(nanoseconds);
+	}
+	_elapsedTime += frameTime;
+	_periodTime += frameTime;
+	if (_periodTime >= _reportInterval)
+	{
+		Report();
+	}
+}
+
+void FrameStatistics::Report()
+{
+	if (_period[0].GetCount() == 0)
+	{
+		return;
+	}
+
+	// The log is only created once there is something to write to it
+	if (!_logOpened && !_logFileName.empty())
+	{
+		_log.open(_logFileName);
+		if (_log)
+		{
+			_log << "time_s,measurement,frames,p50_ms,p95_ms,p99_ms,max_ms" << std::endl;
+		}
+		_logOpened = true;
+	}
+	static const char * names[MEASUREMENT_COUNT] = { "frame", "update", "render" };
+	for (size_t i = 0; i < MEASUREMENT_COUNT; i++)
+	{
+		FrameMeasurement measurement = static_cast<FrameMeasurement>(i);
+		_lastReport[i] = GetSummary(measurement);
+		if (_log.is_open() && _log)
+		{
+			const FrameTimeSummary& summary = _lastReport[i];
+			_log << _elapsedTime << "," << names[i] << "," << summary.Frames << "," << summary.Median * 1000.0 << "," << summary.Percentile95 * 1000.0 << ","
+				 << summary.Percentile99 * 1000.0 << "," << summary.Maximum * 1000.0 << std::endl;
+		}
+		_period[i].Clear();
+	}
+	_periodTime = 0.0;
+	_reportCount++;
+}
+
+void FrameStatistics::Clear()
+{
+	for (size_t i = 0; i < MEASUREMENT_COUNT; i++)
+	{
+		_period[i].Clear();
+		_total[i].Clear();
+		_lastReport[i] = FrameTimeSummary();
+	}
+	_elapsedTime = 0.0;
+	_periodTime = 0.0;
+	_reportCount = 0;
+}
+
+const LatencyHistogram& FrameStatistics::GetHistogram(FrameMeasurement measurement, bool total) const
+{
+	size_t index = static_cast<size_t>(measurement);
+	return total ? _total[index] : _period[index];
+}
+
+FrameTimeSummary FrameStatistics::GetSummary(FrameMeasurement measurement, bool total) const
+{
+	const LatencyHistogram& histogram = GetHistogram(measurement, total);
+	FrameTimeSummary summary;
+	summary.Frames = histogram.GetCount();
+	summary.Median = histogram.GetPercentile(0.50) * 1e-9;
+	summary.Percentile95 = histogram.GetPercentile(0.95) * 1e-9;
+	summary.Percentile99 = histogram.GetPercentile(0.99) * 1e-9;
+	summary.Maximum = histogram.GetMaximum() * 1e-9;
+	return summary;
+}
@@ -0,0 +1,121 @@
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// A histogram of durations in nanoseconds that takes a fixed amount of memory, however many values
+// are recorded, and gives percentiles to within 1%.
+//
+// The layout is that of an HDR histogram.  Durations below 256ns each have a bucket of their own.
+// Above that, each power of two is split into 128 buckets of equal width, so the width of a bucket
+// is never more than 1/128 of the durations in it.  Durations of more than MAXIMUM_VALUE (about 18
+// minutes) are counted as MAXIMUM_VALUE.  Recording a duration is a few instructions, with no
+// allocation and no searching.
+
+class LatencyHistogram
+{
+public:
+	LatencyHistogram();
+
+	void Record(uint64_t nanoseconds);
+	void Clear();
+
+	// The duration that the given fraction (from 0 to 1) of the recorded durations were no longer than.
+	// This is the largest duration in the bucket that it was counted in, so it is never an underestimate
+	// by more than rounding, and never more than GetMaximum.  Returns 0 if nothing has been recorded.
+	uint64_t GetPercentile(double fraction) const;
+
+	inline uint64_t GetCount() const { return _count; }
+	inline uint64_t GetMaximum() const { return _maximum; }
+	inline uint64_t GetMinimum() const { return _count == 0 ? 0 : _minimum; }
+	double GetMean() const;
+
+	// The memory used by the histogram, which is the same however many durations are recorded
+	inline size_t GetMemoryBytes() const { return sizeof(*this) + _counts.size() * sizeof(uint64_t); }
+
+	static constexpr uint64_t MAXIMUM_VALUE = (1ull << 40) - 1;
+
+private:
+	std::vector<uint64_t>	_counts;
+	uint64_t				_count{ 0 };
+	uint64_t				_total{ 0 };
+	uint64_t				_minimum{ UINT64_MAX };
+	uint64_t				_maximum{ 0 };
+
+	static size_t GetBucketIndex(uint64_t value);
+	static uint64_t GetBucketHighestValue(size_t index);
+};
+
+// The percentiles of one of the measurements kept by FrameStatistics, in seconds
+
+struct FrameTimeSummary
+{
+	uint64_t	Frames{ 0 };
+	double		Median{ 0.0 };
+	double		Percentile95{ 0.0 };
+	double		Percentile99{ 0.0 };
+	double		Maximum{ 0.0 };
+};
+
+enum class FrameMeasurement
+{
+	Frame = 0,			// The time from the start of one frame to the start of the next
+	Update = 1,			// The time taken by all of the simulation steps run in the frame
+	Render = 2,			// The time taken to draw the frame
+	Count = 3
+};
+
+// Keeps histograms of the frame, update and render times of the main loop.
+//
+// Each frame's times are passed to Record, which adds them to the histograms for the current period
+// and to the histograms of every frame since the statistics were created (or last cleared).  Every
+// reportInterval seconds of frame time, the percentiles of the current period are written to the log
+// file, once for each measurement, and its histograms are cleared.  Both sets of histograms can be
+// read at any time.  If the log file name is empty, or the file cannot be written, nothing is logged
+// but the statistics are still kept.
+//
+// Each line of the log gives the time since the first frame, the measurement, the number of frames and
+// the median, 95th and 99th percentiles and the maximum time, in milliseconds.
+
+class FrameStatistics
+{
+public:
+	FrameStatistics(const std::string& logFileName, double reportInterval = DEFAULT_REPORT_INTERVAL);
+
+	FrameStatistics(const FrameStatistics&) = delete;
+	FrameStatistics& operator=(const FrameStatistics&) = delete;
+
+	// Times are in seconds
+	void Record(double frameTime, double updateTime, double renderTime);
+
+	// Write out the current period now, even if it is not yet reportInterval long
+	void Report();
+
+	void Clear();
+
+	// The histogram of the current period, or of every frame if total is true
+	const LatencyHistogram& GetHistogram(FrameMeasurement measurement, bool total = false) const;
+	FrameTimeSummary GetSummary(FrameMeasurement measurement, bool total = false) const;
+
+	// The summary of the last period that was reported
+	inline const FrameTimeSummary& GetLastReport(FrameMeasurement measurement) const { return _lastReport[static_cast<size_t>(measurement)]; }
+	inline uint64_t GetReportCount() const { return _reportCount; }
+
+	static constexpr double DEFAULT_REPORT_INTERVAL = 5.0;
+
+private:
+	static constexpr size_t MEASUREMENT_COUNT = static_cast<size_t>(FrameMeasurement::Count);
+
+	std::string			_logFileName;
+	std::ofstream		_log;
+	bool				_logOpened{ false };
+	double				_reportInterval;
+	double				_elapsedTime{ 0.0 };			// Since the first frame
+	double				_periodTime{ 0.0 };				// Since the last report
+	uint64_t			_reportCount{ 0 };
+
+	LatencyHistogram	_period[MEASUREMENT_COUNT];
+	LatencyHistogram	_total[MEASUREMENT_COUNT];
+	FrameTimeSummary	_lastReport[MEASUREMENT_COUNT];
+};
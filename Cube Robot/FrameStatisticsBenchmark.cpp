@@ -0,0 +1,169 @@
+#include "FrameStatisticsBenchmark.h"
+#include "FrameStatistics.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+// Durations in each distribution checked
+constexpr size_t STATISTICS_BENCHMARK_SAMPLES = 100000;
+
+// Durations recorded when timing the histogram
+constexpr int STATISTICS_BENCHMARK_RECORDS = 10000000;
+
+// Frames passed to FrameStatistics, the frame on which it stutters and for how long, and how often it reports
+constexpr int STATISTICS_BENCHMARK_FRAMES = 600;
+constexpr int STATISTICS_BENCHMARK_STUTTER_FRAME = 300;
+constexpr double STATISTICS_BENCHMARK_STUTTER_TIME = 0.1;
+constexpr double STATISTICS_BENCHMARK_REPORT_INTERVAL = 1.0;
+
+// A percentile may be overestimated by up to the width of a bucket, which is at most 1/128 of the durations in it
+constexpr double STATISTICS_BENCHMARK_TOLERANCE = 1.0 / 128.0;
+
+// The exact duration that the given fraction of the durations were no longer than.  durations must be sorted.
+
+uint64_t ExactPercentile(const vector<uint64_t>& durations, double fraction)
+{
+	size_t rank = static_cast<size_t>(ceil(fraction * durations.size()));
+	return durations[min(max<size_t>(rank, 1), durations.size()) - 1];
+}
+
+int RunFrameStatisticsBenchmarks(const std::string& resultsFileName, const std::string& logFileName)
+{
+	ofstream results(resultsFileName);
+	if (!results)
+	{
+		return -1;
+	}
+
+	// Each distribution is generated from the same seed every time, so the results can be compared between runs
+	bool allPassed = true;
+	results << "benchmark,distribution,samples,percentile,exact_ns,histogram_ns,relative_error,passes" << endl;
+	const char * distributionNames[] = { "steady_60hz", "stutters", "short_durations" };
+	for (int distribution = 0; distribution < 3; distribution++)
+	{
+		mt19937_64 random(12345 + distribution);
+		normal_distribution<double> steady(1e9 / 60.0, 3e5);
+		uniform_real_distribution<double> uniform(0.0, 1.0);
+		vector<uint64_t> durations;
+		LatencyHistogram histogram;
+		for (size_t i = 0; i < STATISTICS_BENCHMARK_SAMPLES; i++)
+		{
+			double duration;
+			if (distribution == 0)
+			{
+				duration = steady(random);
+			}
+			else if (distribution == 1)
+			{
+				// One frame in a hundred takes from 3 to 6 frames
+				duration = uniform(random) < 0.01 ? steady(random) * (3.0 + uniform(random) * 3.0) : steady(random);
+			}
+			else
+			{
+				// Spread evenly over the powers of ten from 10ns to 1ms
+				duration = pow(10.0, 1.0 + uniform(random) * 5.0);
+			}
+			uint64_t nanoseconds = static_cast<uint64_t>(max(duration, 0.0));
+			durations.push_back(nanoseconds);
+			histogram.Record(nanoseconds);
+		}
+		sort(durations.begin(), durations.end());
+		for (double fraction : { 0.5, 0.95, 0.99, 0.999, 1.0 })
+		{
+			uint64_t exact = ExactPercentile(durations, fraction);
+			uint64_t estimate = histogram.GetPercentile(fraction);
+			double relativeError = (static_cast<double>(estimate) - static_cast<double>(exact)) / max<double>(static_cast<double>(exact), 1.0);
+			bool passes = estimate >= exact && relativeError <= STATISTICS_BENCHMARK_TOLERANCE;
+			allPassed = allPassed && passes;
+			results << "percentile," << distributionNames[distribution] << "," << STATISTICS_BENCHMARK_SAMPLES << "," << fraction << "," << exact << ","
+					<< estimate << "," << relativeError << "," << (passes ? "yes" : "no") << endl;
+		}
+	}
+
+	// The cost of recording a duration and of finding a percentile
+	results << "benchmark,records,ns_per_record,ns_per_percentile,memory_bytes" << endl;
+	{
+		LatencyHistogram histogram;
+		mt19937_64 random(54321);
+		vector<uint64_t> durations(4096);
+		for (uint64_t& duration : durations)
+		{
+			duration = static_cast<uint64_t>(pow(10.0, 3.0 + generate_canonical<double, 32>(random) * 5.0));
+		}
+		auto start = chrono::steady_clock::now();
+		for (int i = 0; i < STATISTICS_BENCHMARK_RECORDS; i++)
+		{
+			histogram.Record(durations[i & (durations.size() - 1)]);
+		}
+		double recordTime = static_cast<double>(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count()) / STATISTICS_BENCHMARK_RECORDS;
+		start = chrono::steady_clock::now();
+		uint64_t sum = 0;
+		for (int i = 0; i < 1000; i++)
+		{
+			sum += histogram.GetPercentile(0.99);
+		}
+		double percentileTime = static_cast<double>(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count()) / 1000.0;
+		results << "record," << histogram.GetCount() << "," << recordTime << "," << (sum != 0 ? percentileTime : 0.0) << "," << histogram.GetMemoryBytes() << endl;
+	}
+
+	// Frames at 60Hz with one stutter.  Only the report for the period with the stutter, and the
+	// totals, should see it.
+	results << "benchmark,frames,reports,log_lines,stutter_report_max_ms,other_reports_max_ms,total_p50_ms,total_p99_ms,total_max_ms,passes" << endl;
+	{
+		FrameStatistics statistics(logFileName, STATISTICS_BENCHMARK_REPORT_INTERVAL);
+		double stutterReportMaximum = 0.0;
+		double otherReportsMaximum = 0.0;
+		for (int frame = 0; frame <= STATISTICS_BENCHMARK_FRAMES; frame++)
+		{
+			uint64_t reports = statistics.GetReportCount();
+			if (frame < STATISTICS_BENCHMARK_FRAMES)
+			{
+				double frameTime = frame == STATISTICS_BENCHMARK_STUTTER_FRAME ? STATISTICS_BENCHMARK_STUTTER_TIME : 1.0 / 60.0;
+				statistics.Record(frameTime, 0.002, 0.004);
+			}
+			else
+			{
+				// Report whatever is left over after the last full period
+				statistics.Report();
+			}
+			if (statistics.GetReportCount() != reports)
+			{
+				double maximum = statistics.GetLastReport(FrameMeasurement::Frame).Maximum;
+				if (frame >= STATISTICS_BENCHMARK_STUTTER_FRAME && stutterReportMaximum == 0.0)
+				{
+					stutterReportMaximum = maximum;
+				}
+				else
+				{
+					otherReportsMaximum = max(otherReportsMaximum, maximum);
+				}
+			}
+		}
+
+		size_t logLines = 0;
+		{
+			ifstream log(logFileName);
+			string line;
+			while (getline(log, line))
+			{
+				logLines++;
+			}
+		}
+		FrameTimeSummary total = statistics.GetSummary(FrameMeasurement::Frame, true);
+		FrameTimeSummary totalRender = statistics.GetSummary(FrameMeasurement::Render, true);
+		uint64_t reports = statistics.GetReportCount();
+		bool passes = total.Frames == STATISTICS_BENCHMARK_FRAMES && logLines == 1 + 3 * reports
+					  && fabs(stutterReportMaximum - STATISTICS_BENCHMARK_STUTTER_TIME) < 1e-6 && otherReportsMaximum < 1.0 / 60.0 + 1e-6
+					  && fabs(total.Maximum - STATISTICS_BENCHMARK_STUTTER_TIME) < 1e-6 && total.Percentile99 < 1.0 / 60.0 * (1.0 + STATISTICS_BENCHMARK_TOLERANCE)
+					  && fabs(totalRender.Median - 0.004) < 0.004 * STATISTICS_BENCHMARK_TOLERANCE;
+		allPassed = allPassed && passes;
+		results << "reporting," << total.Frames << "," << reports << "," << logLines << "," << stutterReportMaximum * 1000.0 << "," << otherReportsMaximum * 1000.0 << ","
+				<< total.Median * 1000.0 << "," << total.Percentile99 * 1000.0 << "," << total.Maximum * 1000.0 << "," << (passes ? "yes" : "no") << endl;
+	}
+	return allPassed ? 0 : 1;
+}
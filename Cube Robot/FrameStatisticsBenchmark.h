@@ -0,0 +1,13 @@
+#pragma once
+#include <string>
+
+// Benchmarks and checks for the frame statistics.  The percentiles given by LatencyHistogram are
+// compared with the exact percentiles of the same durations, for steady frame times, frame times
+// with occasional stutters and a wide spread of short durations, and the cost of recording a
+// duration is measured.  Then a run of frames with a stutter part of the way through is passed to
+// FrameStatistics, and the reports it logs are checked.
+//
+// The results are written as comma-separated values to the file given, and the frame statistics are
+// logged to logFileName.
+
+int RunFrameStatisticsBenchmarks(const std::string& resultsFileName, const std::string& logFileName);
@@ -1,9 +1,24 @@
 #include "Framework.h"
+#include "FramePacer.h"
+#include "Profiler.h"
+#include "AllocationTracker.h"
 
 constexpr auto DEFAULT_FRAMERATE = 60;
 constexpr auto DEFAULT_WIDTH     = 800;
 constexpr auto DEFAULT_HEIGHT    = 600;
 
+// When started with -profile, the zones from this many frames before the application closes are written to PROFILE_TRACE_FILE
+constexpr uint64_t PROFILE_TRACE_FRAMES = 300;
+constexpr auto PROFILE_TRACE_FILE = "ProfileTrace.json";
+
+// When started with -allocations, the allocations made in each frame are counted and written to
+// ALLOCATION_REPORT_FILE.  Started with -assertallocations instead, the application also fails
+// (returning 1) if any frame allocates once the first few frames have gone.
+constexpr auto ALLOCATION_REPORT_FILE = "AllocationReport.csv";
+
+// The percentiles of the frame, update and render times are written here every few seconds
+constexpr auto FRAME_STATISTICS_FILE = "FrameStatistics.log";
+
 // Reference to ourselves - primarily used to access the message handler correctly
 // This is initialised in the constructor
 Framework *	_thisFramework = NULL;
@@ -20,13 +35,39 @@ int APIENTRY wWinMain(_In_	   HINSTANCE hInstance,
 					  _In_	   int       nCmdShow)
 {
 	UNREFERENCED_PARAMETER(hPrevInstance);
-	UNREFERENCED_PARAMETER(lpCmdLine);
 
 	// We can only run if an instance of a class that inherits from Framework
 	// has been created
 	if (_thisFramework)
 	{
-		return _thisFramework->Run(hInstance, nCmdShow);
+		if (lpCmdLine != nullptr && wcsstr(lpCmdLine, L"-benchmark") != nullptr)
+		{
+			return _thisFramework->RunBenchmarks();
+		}
+		bool profiling = lpCmdLine != nullptr && wcsstr(lpCmdLine, L"-profile") != nullptr;
+		bool assertNoAllocations = lpCmdLine != nullptr && wcsstr(lpCmdLine, L"-assertallocations") != nullptr;
+		bool trackingAllocations = assertNoAllocations || (lpCmdLine != nullptr && wcsstr(lpCmdLine, L"-allocations") != nullptr);
+
+		// Allocations are put down to the profiler zone they were made in, so the profiler is needed too
+		Profiler::SetEnabled(profiling || trackingAllocations);
+		AllocationTracker::CheckSteadyState(assertNoAllocations);
+		AllocationTracker::SetEnabled(trackingAllocations);
+		int result = _thisFramework->Run(hInstance, nCmdShow);
+		if (profiling)
+		{
+			uint64_t lastFrame = Profiler::GetFrameNumber();
+			Profiler::WriteChromeTrace(PROFILE_TRACE_FILE, lastFrame > PROFILE_TRACE_FRAMES ? lastFrame - PROFILE_TRACE_FRAMES : 0, lastFrame);
+		}
+		if (trackingAllocations)
+		{
+			AllocationTracker::SetEnabled(false);
+			AllocationTracker::WriteReport(ALLOCATION_REPORT_FILE);
+			if (assertNoAllocations && AllocationTracker::GetFailedFrameCount() > 0)
+			{
+				return 1;
+			}
+		}
+		return result;
 	}
 	return -1;
 }
@@ -36,7 +77,8 @@ Framework::Framework() : Framework(DEFAULT_WIDTH, DEFAULT_HEIGHT)
 }
 
 Framework::Framework(unsigned int width, unsigned int height)
-	: _hInstance(0), _hWnd(0), _width(width), _height(height), _timeSpan(0)
+	: _hInstance(0), _hWnd(0), _width(width), _height(height), _timeSpan(0), _simulationStep(1.0 / DEFAULT_FRAMERATE), _interpolation(1.0f),
+	  _frameStatistics(FRAME_STATISTICS_FILE)
 {
 	_thisFramework = this;
 }
@@ -60,62 +102,64 @@ int Framework::Run(HINSTANCE hInstance, int nCmdShow)
 	return returnValue;
 }
 
-// Main program loop.  
+// Main program loop.  Messages are handled as they arrive, then the simulation is moved on by as
+// many fixed steps as are due and the frame is drawn.  Between frames the loop sleeps rather than
+// polling the clock, so it does not keep a processor busy.  The time taken by each frame is added to
+// the frame statistics once the next frame starts.
 
 int Framework::MainLoop()
 {
 	MSG msg;
 	HACCEL hAccelTable = LoadAccelerators(_hInstance, MAKEINTRESOURCE(IDC_DirectXApp));
-	LARGE_INTEGER counterFrequency;
-	LARGE_INTEGER nextTime;
-	LARGE_INTEGER currentTime;
-	LARGE_INTEGER lastTime;
-	bool updateFlag = true;
-
-	// Initialise timer
-	QueryPerformanceFrequency(&counterFrequency);
-	DWORD msPerFrame = static_cast<DWORD>(counterFrequency.QuadPart / DEFAULT_FRAMERATE);
-	double timeFactor = 1.0 / counterFrequency.QuadPart;
-	QueryPerformanceCounter(&nextTime);
-	lastTime = nextTime;
+	SteadyFrameClock clock;
+	FramePacer pacer(clock, _simulationStep, 1.0 / DEFAULT_FRAMERATE);
+	Profiler::SetThreadName("Main");
+	double updateTime = 0.0;
+	double renderTime = 0.0;
 
 	// Main message loop:
 	msg.message = WM_NULL;
 	while (msg.message != WM_QUIT)
 	{
-		if (updateFlag)
+		Profiler::BeginFrame();
+		AllocationTracker::BeginFrame();
+		PROFILE_ZONE("Framework::MainLoop");
+		while (PeekMessage(&msg, 0, 0, 0, PM_REMOVE))
 		{
-			QueryPerformanceCounter(&currentTime);
-			_timeSpan = (currentTime.QuadPart - lastTime.QuadPart) * timeFactor;
-			lastTime = currentTime;
-			Update();
-			updateFlag = false;
-		}
-		QueryPerformanceCounter(&currentTime);
-		// Is it time to render the frame?
-		if (currentTime.QuadPart > nextTime.QuadPart)
-		{
-			Render();
-			// Set time for next frame
-			nextTime.QuadPart += msPerFrame;
-			// If we get more than a frame ahead, allow one to be dropped
-			// Otherwise, we will never catch up if we let the error accumulate
-			// and message handling will suffer
-			if (nextTime.QuadPart < currentTime.QuadPart)
+			if (msg.message == WM_QUIT)
 			{
-				nextTime.QuadPart = currentTime.QuadPart + msPerFrame;
+				break;
 			}
-			updateFlag = true;
-		}
-		if (PeekMessage(&msg, 0, 0, 0, PM_REMOVE))
-		{
 			if (!TranslateAccelerator(msg.hwnd, hAccelTable, &msg))
 			{
 				TranslateMessage(&msg);
 				DispatchMessage(&msg);
 			}
 		}
+		if (msg.message == WM_QUIT)
+		{
+			break;
+		}
+		unsigned int steps = pacer.BeginFrame();
+		_timeSpan = pacer.GetFrameTime();
+		if (pacer.GetFrameCount() > 1)
+		{
+			_frameStatistics.Record(_timeSpan, updateTime, renderTime);
+		}
+		double updateStart = clock.Now();
+		for (unsigned int step = 0; step < steps; step++)
+		{
+			Update();
+		}
+		_interpolation = pacer.GetInterpolation();
+		double renderStart = clock.Now();
+		Render();
+		updateTime = renderStart - updateStart;
+		renderTime = clock.Now() - renderStart;
+		PROFILE_ZONE("FramePacer::WaitForNextFrame");
+		pacer.WaitForNextFrame();
 	}
+	_frameStatistics.Report();
 	return static_cast<int>(msg.wParam);
 }
 
@@ -1,5 +1,6 @@
 #pragma once
 #include "Core.h"
+#include "FrameStatistics.h"
 
 using namespace std;
 
@@ -18,6 +19,19 @@ public:
 	inline unsigned int GetWindowHeight() { return _height; }
 	inline HWND GetHWnd() {	return _hWnd; }
 
+	// Update is called every simulation step, however often frames are drawn.  When a frame is drawn,
+	// it is normally part of the way through the next step, given by GetInterpolation as a fraction
+	// from 0 (the state before the last update) to 1 (the state after it).
+	inline double GetSimulationStep() { return _simulationStep; }
+	inline void SetSimulationStep(double simulationStep) { _simulationStep = simulationStep; }
+	inline float GetInterpolation() { return _interpolation; }
+
+	// The time between the start of the last two frames
+	inline double GetTimeSpan() { return _timeSpan; }
+
+	// Percentiles of the frame, update and render times, which are also logged every few seconds
+	inline const FrameStatistics& GetFrameStatistics() const { return _frameStatistics; }
+
 	// Initialise the application.  Called after the window and bitmap has been
 	// created, but before the main loop starts
 	//
@@ -26,6 +40,7 @@ public:
 
 	// Perform any updates to the structures that will be used
 	// to render the window (i.e. transformation matrices, etc).
+	// Called once for every simulation step (see GetSimulationStep).
 	virtual void Update() {}
 
 	// Render the contents of the window. 
@@ -34,6 +49,10 @@ public:
 	// Perform any application shutdown or cleanup that is needed
 	virtual void Shutdown() {}
 
+	// Run any headless benchmarks.  This is called instead of creating the window
+	// when the application is started with the -benchmark command line option.
+	virtual int RunBenchmarks() { return -1; }
+
 	// Handlers for Windows messages. If you need more, add them
 	// here and call them from MsgProc. The only one we need to handle is WM_SIZE
 	virtual void OnResize(WPARAM wParam) {}
@@ -46,6 +65,9 @@ private:
 
 	// Used in timing loop
 	double			_timeSpan;
+	double			_simulationStep;
+	float			_interpolation;
+	FrameStatistics	_frameStatistics;
 
 	bool InitialiseMainWindow(int nCmdShow);
 	int MainLoop();
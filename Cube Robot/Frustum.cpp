@@ -0,0 +1,72 @@
+#include "Frustum.h"
+#include <cmath>
+
+Frustum::Frustum(const Matrix& viewProjectionTransformation)
+{
+	// Since vertices are multiplied as row vectors (v * M), a point is inside the view volume
+	// if -w <= x <= w, -w <= y <= w and 0 <= z <= w, where x, y, z and w are the dot products
+	// of the point with the columns of the matrix.  Each inequality gives one plane.
+	const Matrix& m = viewProjectionTransformation;
+	Vector4 column0(m.m[0][0], m.m[1][0], m.m[2][0], m.m[3][0]);
+	Vector4 column1(m.m[0][1], m.m[1][1], m.m[2][1], m.m[3][1]);
+	Vector4 column2(m.m[0][2], m.m[1][2], m.m[2][2], m.m[3][2]);
+	Vector4 column3(m.m[0][3], m.m[1][3], m.m[2][3], m.m[3][3]);
+
+	_planes[0] = Vector4(column3.x + column0.x, column3.y + column0.y, column3.z + column0.z, column3.w + column0.w);		// Left
+	_planes[1] = Vector4(column3.x - column0.x, column3.y - column0.y, column3.z - column0.z, column3.w - column0.w);		// Right
+	_planes[2] = Vector4(column3.x + column1.x, column3.y + column1.y, column3.z + column1.z, column3.w + column1.w);		// Bottom
+	_planes[3] = Vector4(column3.x - column1.x, column3.y - column1.y, column3.z - column1.z, column3.w - column1.w);		// Top
+	_planes[4] = column2;																									// Near
+	_planes[5] = Vector4(column3.x - column2.x, column3.y - column2.y, column3.z - column2.z, column3.w - column2.w);		// Far
+
+	for (Vector4& plane : _planes)
+	{
+		float length = sqrtf(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+		if (length > 0.0f)
+		{
+			plane.x /= length;
+			plane.y /= length;
+			plane.z /= length;
+			plane.w /= length;
+		}
+	}
+}
+
+FrustumTest Frustum::Test(const BoundingSphere& sphere) const
+{
+	FrustumTest result = FrustumTest::Inside;
+	for (const Vector4& plane : _planes)
+	{
+		float distance = plane.x * sphere.Center.x + plane.y * sphere.Center.y + plane.z * sphere.Center.z + plane.w;
+		if (distance < -sphere.Radius)
+		{
+			return FrustumTest::Outside;
+		}
+		if (distance < sphere.Radius)
+		{
+			result = FrustumTest::Intersects;
+		}
+	}
+	return result;
+}
+
+FrustumTest Frustum::Test(const BoundingBox& box) const
+{
+	FrustumTest result = FrustumTest::Inside;
+	for (const Vector4& plane : _planes)
+	{
+		// The distance from the centre of the box to the plane, and the furthest
+		// that any corner of the box can be from its centre along the plane normal
+		float distance = plane.x * box.Center.x + plane.y * box.Center.y + plane.z * box.Center.z + plane.w;
+		float radius = fabsf(plane.x) * box.Extents.x + fabsf(plane.y) * box.Extents.y + fabsf(plane.z) * box.Extents.z;
+		if (distance < -radius)
+		{
+			return FrustumTest::Outside;
+		}
+		if (distance < radius)
+		{
+			result = FrustumTest::Intersects;
+		}
+	}
+	return result;
+}
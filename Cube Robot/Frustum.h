@@ -0,0 +1,32 @@
+#pragma once
+#include "DirectXCore.h"
+
+// The result of testing a bounding volume against a frustum
+
+enum class FrustumTest
+{
+	Outside,			// Completely outside the frustum
+	Intersects,			// Partly inside the frustum
+	Inside				// Completely inside the frustum
+};
+
+// The six planes of a view frustum, extracted from a combined view x projection transformation.
+// Each plane is stored as (a, b, c, d) with the normal (a, b, c) normalised and pointing into the
+// frustum, so a point p is inside a plane if a * p.x + b * p.y + c * p.z + d >= 0.
+
+class Frustum
+{
+public:
+	Frustum() {};
+	Frustum(const Matrix& viewProjectionTransformation);
+
+	FrustumTest Test(const BoundingSphere& sphere) const;
+	FrustumTest Test(const BoundingBox& box) const;
+
+	inline const Vector4& GetPlane(int plane) const { return _planes[plane]; }
+
+	static constexpr int PLANE_COUNT = 6;
+
+private:
+	Vector4		_planes[PLANE_COUNT];
+};
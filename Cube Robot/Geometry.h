@@ -1,42 +1,46 @@
 #pragma once
+#include "ShaderStructures.h"
 
 
 #define ShaderFileName		L"shader.hlsl"
 #define VertexShaderName	"VS"
+#define InstancedVertexShaderName	"VSInstanced"
 #define PixelShaderName		"PS"
 
 
 
-// Format of the constant buffer. This must match the format of the
-// cbuffer structure in the shader
+// The description of the vertex that is passed to CreateInputLayout.  This must
+// match the format of the vertex above and the format of the input vertex in the shader
 
-struct CBuffer
+VertexElement vertexDesc[] =
 {
-	Matrix		WorldViewProjection;
-	Matrix		World;
-	Vector4		MaterialColour;
-	Vector4		AmbientLightColour;
-	Vector4		DirectionalLightColour;
-	Vector4		DirectionalLightVector;
+	{ "POSITION", 0, VertexFormat::Float3 },
+	{ "NORMAL", 0, VertexFormat::Float3 },
 };
 
-// Structure of a single vertex.  This must match the
-// structure of the input vertex in the shader
+// The description of the vertex passed to the instanced vertex shader.  The per-instance
+// elements are the start of CBuffer, up to and including AmbientLightColour.
 
-struct Vertex
+VertexElement instancedVertexDesc[] =
 {
-	Vector3		Position;
-	Vector3		Normal;
+	{ "POSITION", 0, VertexFormat::Float3 },
+	{ "NORMAL", 0, VertexFormat::Float3 },
+	{ "WORLDVIEWPROJECTION", 0, VertexFormat::Float4, true },
+	{ "WORLDVIEWPROJECTION", 1, VertexFormat::Float4, true },
+	{ "WORLDVIEWPROJECTION", 2, VertexFormat::Float4, true },
+	{ "WORLDVIEWPROJECTION", 3, VertexFormat::Float4, true },
+	{ "WORLD", 0, VertexFormat::Float4, true },
+	{ "WORLD", 1, VertexFormat::Float4, true },
+	{ "WORLD", 2, VertexFormat::Float4, true },
+	{ "WORLD", 3, VertexFormat::Float4, true },
+	{ "MATERIAL", 0, VertexFormat::Float4, true },
+	{ "AMBIENT", 0, VertexFormat::Float4, true },
 };
 
-// The description of the vertex that is passed to CreateInputLayout.  This must
-// match the format of the vertex above and the format of the input vertex in the shader
+const uint32_t InstanceSize = offsetof(CBuffer, DirectionalLightColour);
 
-D3D11_INPUT_ELEMENT_DESC vertexDesc[] =
-{
-	{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-	{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-};
+// The largest number of cubes drawn by a single instanced draw
+const uint32_t MaximumInstances = 1024;
 
 // This example uses hard-coded vertices and indices for a cube. Usually, you will load the verticesa and indices from a model file. 
 // We will see this later in the module. 
@@ -0,0 +1,151 @@
+#include "MappedFile.h"
+#include <cstring>
+
+#if defined( _WIN32 )
+
+#include <windows.h>
+
+bool MappedFile::Open(const std::wstring& fileName)
+{
+	Close();
+	// Allow the file to be appended to while it is mapped
+	HANDLE file = CreateFileW(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+							  nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size))
+	{
+		CloseHandle(file);
+		return false;
+	}
+	_file = file;
+	_isOpen = true;
+	if (size.QuadPart == 0)
+	{
+		// An empty file cannot be mapped
+		return true;
+	}
+	_mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (_mapping != nullptr)
+	{
+		_data = static_cast<const char *>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+	}
+	if (_data == nullptr)
+	{
+		Close();
+		return false;
+	}
+	_size = static_cast<size_t>(size.QuadPart);
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (_data != nullptr)
+	{
+		UnmapViewOfFile(_data);
+	}
+	if (_mapping != nullptr)
+	{
+		CloseHandle(_mapping);
+	}
+	if (_file != nullptr)
+	{
+		CloseHandle(_file);
+	}
+	_data = nullptr;
+	_mapping = nullptr;
+	_file = nullptr;
+	_size = 0;
+	_isOpen = false;
+}
+
+FILE * OpenFileStream(const std::wstring& fileName, const char * mode)
+{
+	std::wstring wideMode(mode, mode + strlen(mode));
+	return _wfopen(fileName.c_str(), wideMode.c_str());
+}
+
+bool RenameFile(const std::wstring& oldFileName, const std::wstring& newFileName)
+{
+	return MoveFileExW(oldFileName.c_str(), newFileName.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+}
+
+#else
+
+#include <codecvt>
+#include <locale>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+	std::string NarrowFileName(const std::wstring& fileName)
+	{
+		return std::wstring_convert<std::codecvt_utf8<wchar_t>>().to_bytes(fileName);
+	}
+}
+
+bool MappedFile::Open(const std::wstring& fileName)
+{
+	Close();
+	int file = open(NarrowFileName(fileName).c_str(), O_RDONLY);
+	if (file < 0)
+	{
+		return false;
+	}
+	struct stat status;
+	if (fstat(file, &status) != 0)
+	{
+		close(file);
+		return false;
+	}
+	_file = file;
+	_isOpen = true;
+	if (status.st_size == 0)
+	{
+		return true;
+	}
+	void * data = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_SHARED, file, 0);
+	if (data == MAP_FAILED)
+	{
+		Close();
+		return false;
+	}
+	_data = static_cast<const char *>(data);
+	_size = static_cast<size_t>(status.st_size);
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (_data != nullptr)
+	{
+		munmap(const_cast<char *>(_data), _size);
+	}
+	if (_file >= 0)
+	{
+		close(_file);
+	}
+	_data = nullptr;
+	_file = -1;
+	_size = 0;
+	_isOpen = false;
+}
+
+FILE * OpenFileStream(const std::wstring& fileName, const char * mode)
+{
+	return fopen(NarrowFileName(fileName).c_str(), mode);
+}
+
+bool RenameFile(const std::wstring& oldFileName, const std::wstring& newFileName)
+{
+	return rename(NarrowFileName(oldFileName).c_str(), NarrowFileName(newFileName).c_str()) == 0;
+}
+
+#endif
@@ -0,0 +1,44 @@
+#pragma once
+#include <cstddef>
+#include <cstdio>
+#include <string>
+
+// A read-only view of the whole of a file, mapped into memory.
+//
+// Other handles may still write to the file while it is mapped, as long as they only append to it.
+// Anything appended after the file was opened is not visible through the view.
+
+class MappedFile
+{
+public:
+	MappedFile() {}
+	~MappedFile() { Close(); }
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// Returns false if the file does not exist or cannot be mapped.  An empty file is opened with a size of 0.
+	bool Open(const std::wstring& fileName);
+	void Close();
+
+	inline bool IsOpen() const { return _isOpen; }
+	inline const char * GetData() const { return _data; }
+	inline size_t GetSize() const { return _size; }
+
+private:
+	bool			_isOpen{ false };
+	const char *	_data{ nullptr };
+	size_t			_size{ 0 };
+#if defined( _WIN32 )
+	void *			_file{ nullptr };
+	void *			_mapping{ nullptr };
+#else
+	int				_file{ -1 };
+#endif
+};
+
+// Open a file with a wide file name, as fopen does.  Returns nullptr on failure.
+FILE * OpenFileStream(const std::wstring& fileName, const char * mode);
+
+// Rename a file, replacing any existing file with the new name.  Returns false on failure.
+bool RenameFile(const std::wstring& oldFileName, const std::wstring& newFileName);
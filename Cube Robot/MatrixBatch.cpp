@@ -0,0 +1,366 @@
+#include "MatrixBatch.h"
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define MATRIX_BATCH_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+// MSVC allows any instruction set to be used through intrinsics.  GCC and Clang need
+// to be told which functions may use instructions beyond the baseline.
+#if defined(__GNUC__)
+#define TARGET_AVX2		__attribute__((target("avx2")))
+#define TARGET_AVX512	__attribute__((target("avx512f")))
+#else
+#define TARGET_AVX2
+#define TARGET_AVX512
+#endif
+
+// Every path multiplies and adds in the same order without fused multiply-adds, so that they all give
+// exactly the same results.  GCC would otherwise fuse a multiply and the add that follows it wherever
+// the instruction set allows.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+namespace
+{
+	typedef void (*ConcatenateFunction)(const TransformBatch& batch, size_t first, size_t end);
+
+	inline const float * ParentWorldTransformation(const TransformBatch& batch, size_t index)
+	{
+		int parent = batch.Parents[index];
+		const Matrix& parentTransformation = (parent < 0) ? batch.RootTransformation : batch.WorldTransformations[parent];
+		return reinterpret_cast<const float *>(&parentTransformation);
+	}
+
+	inline float * NodeWorldTransformation(const TransformBatch& batch, size_t index)
+	{
+		return (batch.NodeWorldTransformations != nullptr) ? reinterpret_cast<float *>(batch.NodeWorldTransformations[index]) : nullptr;
+	}
+
+	// The end of the run of nodes from first that have the same parent.  The SIMD paths load
+	// the parent matrix once for each run.
+	inline size_t SiblingRunEnd(const TransformBatch& batch, size_t first, size_t end)
+	{
+		int parent = batch.Parents[first];
+		size_t runEnd = first + 1;
+		while (runEnd < end && batch.Parents[runEnd] == parent)
+		{
+			runEnd++;
+		}
+		return runEnd;
+	}
+
+	//--------------------------------------------------------------------------------------
+	// Scalar.  Each element of the result is added up in the same order as the SIMD
+	// paths, rather than using the SimpleMath multiplication.
+	//--------------------------------------------------------------------------------------
+
+	// Kept as separate statements so that no compiler fuses a multiply with the add that follows it
+	inline float MultiplyElement(const float * localRow, const float * parent, int column)
+	{
+		float sum = localRow[0] * parent[column];
+		float product = localRow[1] * parent[4 + column];
+		sum = sum + product;
+		product = localRow[2] * parent[8 + column];
+		sum = sum + product;
+		product = localRow[3] * parent[12 + column];
+		return sum + product;
+	}
+
+	void ConcatenateScalar(const TransformBatch& batch, size_t first, size_t end)
+	{
+		for (size_t i = first; i < end; i++)
+		{
+			const float * local = reinterpret_cast<const float *>(batch.LocalTransformations[i]);
+			const float * parent = ParentWorldTransformation(batch, i);
+			Matrix result;
+			float * resultElements = reinterpret_cast<float *>(&result);
+			for (int row = 0; row < 4; row++)
+			{
+				resultElements[row * 4] = MultiplyElement(local + row * 4, parent, 0);
+				resultElements[row * 4 + 1] = MultiplyElement(local + row * 4, parent, 1);
+				resultElements[row * 4 + 2] = MultiplyElement(local + row * 4, parent, 2);
+				resultElements[row * 4 + 3] = MultiplyElement(local + row * 4, parent, 3);
+			}
+			batch.WorldTransformations[i] = result;
+			if (batch.NodeWorldTransformations != nullptr)
+			{
+				*batch.NodeWorldTransformations[i] = result;
+			}
+		}
+	}
+
+#if defined(MATRIX_BATCH_X86)
+
+	//--------------------------------------------------------------------------------------
+	// SSE.  Each row of the result is the sum of the rows of the parent matrix, each
+	// multiplied by the corresponding element of the same row of the local matrix.  The
+	// parent rows are loaded once for each run of siblings.
+	//--------------------------------------------------------------------------------------
+
+	inline void MultiplySSE(const float * local, const __m128 parentRows[4], float * result, float * copy)
+	{
+		for (int row = 0; row < 4; row++)
+		{
+			__m128 localRow = _mm_loadu_ps(local + row * 4);
+			__m128 resultRow = _mm_mul_ps(_mm_shuffle_ps(localRow, localRow, _MM_SHUFFLE(0, 0, 0, 0)), parentRows[0]);
+			resultRow = _mm_add_ps(resultRow, _mm_mul_ps(_mm_shuffle_ps(localRow, localRow, _MM_SHUFFLE(1, 1, 1, 1)), parentRows[1]));
+			resultRow = _mm_add_ps(resultRow, _mm_mul_ps(_mm_shuffle_ps(localRow, localRow, _MM_SHUFFLE(2, 2, 2, 2)), parentRows[2]));
+			resultRow = _mm_add_ps(resultRow, _mm_mul_ps(_mm_shuffle_ps(localRow, localRow, _MM_SHUFFLE(3, 3, 3, 3)), parentRows[3]));
+			_mm_storeu_ps(result + row * 4, resultRow);
+			if (copy != nullptr)
+			{
+				_mm_storeu_ps(copy + row * 4, resultRow);
+			}
+		}
+	}
+
+	void ConcatenateSSE(const TransformBatch& batch, size_t first, size_t end)
+	{
+		size_t i = first;
+		while (i < end)
+		{
+			size_t runEnd = SiblingRunEnd(batch, i, end);
+			const float * parent = ParentWorldTransformation(batch, i);
+			const __m128 parentRows[4] = { _mm_loadu_ps(parent), _mm_loadu_ps(parent + 4), _mm_loadu_ps(parent + 8), _mm_loadu_ps(parent + 12) };
+			for (; i < runEnd; i++)
+			{
+				MultiplySSE(reinterpret_cast<const float *>(batch.LocalTransformations[i]),
+							parentRows,
+							reinterpret_cast<float *>(&batch.WorldTransformations[i]),
+							NodeWorldTransformation(batch, i));
+			}
+		}
+	}
+
+	//--------------------------------------------------------------------------------------
+	// AVX2.  As SSE, but two rows of the result are calculated at once, with each
+	// parent row repeated in both halves of the register.
+	//--------------------------------------------------------------------------------------
+
+	TARGET_AVX2 inline void MultiplyAVX2(const float * local, const __m256 parentRows[4], float * result, float * copy)
+	{
+		for (int rows = 0; rows < 2; rows++)
+		{
+			__m256 localRows = _mm256_loadu_ps(local + rows * 8);
+			__m256 resultRows = _mm256_mul_ps(_mm256_shuffle_ps(localRows, localRows, _MM_SHUFFLE(0, 0, 0, 0)), parentRows[0]);
+			resultRows = _mm256_add_ps(resultRows, _mm256_mul_ps(_mm256_shuffle_ps(localRows, localRows, _MM_SHUFFLE(1, 1, 1, 1)), parentRows[1]));
+			resultRows = _mm256_add_ps(resultRows, _mm256_mul_ps(_mm256_shuffle_ps(localRows, localRows, _MM_SHUFFLE(2, 2, 2, 2)), parentRows[2]));
+			resultRows = _mm256_add_ps(resultRows, _mm256_mul_ps(_mm256_shuffle_ps(localRows, localRows, _MM_SHUFFLE(3, 3, 3, 3)), parentRows[3]));
+			_mm256_storeu_ps(result + rows * 8, resultRows);
+			if (copy != nullptr)
+			{
+				_mm256_storeu_ps(copy + rows * 8, resultRows);
+			}
+		}
+	}
+
+	TARGET_AVX2 void ConcatenateAVX2(const TransformBatch& batch, size_t first, size_t end)
+	{
+		size_t i = first;
+		while (i < end)
+		{
+			size_t runEnd = SiblingRunEnd(batch, i, end);
+			const __m128 * parent = reinterpret_cast<const __m128 *>(ParentWorldTransformation(batch, i));
+			const __m256 parentRows[4] = { _mm256_broadcast_ps(parent), _mm256_broadcast_ps(parent + 1), _mm256_broadcast_ps(parent + 2), _mm256_broadcast_ps(parent + 3) };
+			for (; i < runEnd; i++)
+			{
+				MultiplyAVX2(reinterpret_cast<const float *>(batch.LocalTransformations[i]),
+							 parentRows,
+							 reinterpret_cast<float *>(&batch.WorldTransformations[i]),
+							 NodeWorldTransformation(batch, i));
+			}
+		}
+	}
+
+	//--------------------------------------------------------------------------------------
+	// AVX-512.  The whole matrix fits in one register, so all four rows are calculated at
+	// once.
+	//--------------------------------------------------------------------------------------
+
+	TARGET_AVX512 inline void MultiplyAVX512(const float * local, const __m512 parentRows[4], float * result, float * copy)
+	{
+		__m512 localRows = _mm512_loadu_ps(local);
+		__m512 resultRows = _mm512_mul_ps(_mm512_permute_ps(localRows, _MM_SHUFFLE(0, 0, 0, 0)), parentRows[0]);
+		resultRows = _mm512_add_ps(resultRows, _mm512_mul_ps(_mm512_permute_ps(localRows, _MM_SHUFFLE(1, 1, 1, 1)), parentRows[1]));
+		resultRows = _mm512_add_ps(resultRows, _mm512_mul_ps(_mm512_permute_ps(localRows, _MM_SHUFFLE(2, 2, 2, 2)), parentRows[2]));
+		resultRows = _mm512_add_ps(resultRows, _mm512_mul_ps(_mm512_permute_ps(localRows, _MM_SHUFFLE(3, 3, 3, 3)), parentRows[3]));
+		_mm512_storeu_ps(result, resultRows);
+		if (copy != nullptr)
+		{
+			_mm512_storeu_ps(copy, resultRows);
+		}
+	}
+
+	TARGET_AVX512 void ConcatenateAVX512(const TransformBatch& batch, size_t first, size_t end)
+	{
+		size_t i = first;
+		while (i < end)
+		{
+			size_t runEnd = SiblingRunEnd(batch, i, end);
+			const float * parent = ParentWorldTransformation(batch, i);
+			const __m512 parentRows[4] = { _mm512_broadcast_f32x4(_mm_loadu_ps(parent)), _mm512_broadcast_f32x4(_mm_loadu_ps(parent + 4)),
+										   _mm512_broadcast_f32x4(_mm_loadu_ps(parent + 8)), _mm512_broadcast_f32x4(_mm_loadu_ps(parent + 12)) };
+			for (; i < runEnd; i++)
+			{
+				MultiplyAVX512(reinterpret_cast<const float *>(batch.LocalTransformations[i]),
+							   parentRows,
+							   reinterpret_cast<float *>(&batch.WorldTransformations[i]),
+							   NodeWorldTransformation(batch, i));
+			}
+		}
+	}
+
+	//--------------------------------------------------------------------------------------
+	// Processor feature detection
+	//--------------------------------------------------------------------------------------
+
+	void CpuId(int leaf, int subleaf, int registers[4])
+	{
+#if defined(_MSC_VER)
+		__cpuidex(registers, leaf, subleaf);
+#else
+		unsigned int eax, ebx, ecx, edx;
+		__cpuid_count(leaf, subleaf, eax, ebx, ecx, edx);
+		registers[0] = static_cast<int>(eax);
+		registers[1] = static_cast<int>(ebx);
+		registers[2] = static_cast<int>(ecx);
+		registers[3] = static_cast<int>(edx);
+#endif
+	}
+
+	unsigned long long ReadExtendedControlRegister()
+	{
+#if defined(_MSC_VER)
+		return _xgetbv(0);
+#else
+		unsigned int eax, edx;
+		__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+		return (static_cast<unsigned long long>(edx) << 32) | eax;
+#endif
+	}
+
+	MatrixInstructionSet DetectInstructionSet()
+	{
+		int registers[4];
+		CpuId(0, 0, registers);
+		int maximumLeaf = registers[0];
+
+		CpuId(1, 0, registers);
+		bool osxsave = (registers[2] & (1 << 27)) != 0;
+		if (!osxsave || maximumLeaf < 7)
+		{
+			return MatrixInstructionSet::SSE;
+		}
+
+		// Check that the operating system saves the AVX (and AVX-512) registers
+		unsigned long long enabledState = ReadExtendedControlRegister();
+		bool avxState = (enabledState & 0x06) == 0x06;
+		bool avx512State = (enabledState & 0xE6) == 0xE6;
+
+		CpuId(7, 0, registers);
+		bool avx2 = (registers[1] & (1 << 5)) != 0;
+		bool avx512f = (registers[1] & (1 << 16)) != 0;
+
+		if (avx512f && avx512State)
+		{
+			return MatrixInstructionSet::AVX512;
+		}
+		if (avx2 && avxState)
+		{
+			return MatrixInstructionSet::AVX2;
+		}
+		return MatrixInstructionSet::SSE;
+	}
+
+#else
+
+	MatrixInstructionSet DetectInstructionSet()
+	{
+		return MatrixInstructionSet::Scalar;
+	}
+
+#endif
+
+	//--------------------------------------------------------------------------------------
+	// Dispatch
+	//--------------------------------------------------------------------------------------
+
+	MatrixInstructionSet SupportedInstructionSet()
+	{
+		static const MatrixInstructionSet supported = DetectInstructionSet();
+		return supported;
+	}
+
+	ConcatenateFunction GetConcatenateFunction(MatrixInstructionSet instructionSet)
+	{
+		switch (instructionSet)
+		{
+#if defined(MATRIX_BATCH_X86)
+			case MatrixInstructionSet::SSE:
+				return ConcatenateSSE;
+
+			case MatrixInstructionSet::AVX2:
+				return ConcatenateAVX2;
+
+			case MatrixInstructionSet::AVX512:
+				return ConcatenateAVX512;
+#endif
+			default:
+				return ConcatenateScalar;
+		}
+	}
+
+	MatrixInstructionSet	currentInstructionSet = SupportedInstructionSet();
+	ConcatenateFunction		currentConcatenateFunction = GetConcatenateFunction(currentInstructionSet);
+}
+
+void ConcatenateTransforms(const TransformBatch& batch, size_t first, size_t end)
+{
+	currentConcatenateFunction(batch, first, end);
+}
+
+MatrixInstructionSet GetMatrixInstructionSet()
+{
+	return currentInstructionSet;
+}
+
+bool IsMatrixInstructionSetSupported(MatrixInstructionSet instructionSet)
+{
+	return instructionSet <= SupportedInstructionSet();
+}
+
+bool SetMatrixInstructionSet(MatrixInstructionSet instructionSet)
+{
+	if (!IsMatrixInstructionSetSupported(instructionSet))
+	{
+		return false;
+	}
+	currentInstructionSet = instructionSet;
+	currentConcatenateFunction = GetConcatenateFunction(instructionSet);
+	return true;
+}
+
+const char * GetMatrixInstructionSetName(MatrixInstructionSet instructionSet)
+{
+	switch (instructionSet)
+	{
+		case MatrixInstructionSet::SSE:
+			return "SSE";
+
+		case MatrixInstructionSet::AVX2:
+			return "AVX2";
+
+		case MatrixInstructionSet::AVX512:
+			return "AVX-512";
+
+		default:
+			return "Scalar";
+	}
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include "DirectXCore.h"
+#include <cstddef>
+
+// Batched matrix concatenation for hierarchy updates.
+//
+// Calculates WorldTransformations[i] = *LocalTransformations[i] * WorldTransformations[Parents[i]]
+// for every i in a range, where a parent of -1 means RootTransformation.  The inputs are held as
+// parallel arrays (one entry per node) in depth-first order, so the parent of a node is always
+// calculated before the node itself.  Since each node depends on one calculated earlier in the same
+// batch, nodes are processed in order and the vector width is used across the rows of each matrix:
+// SSE calculates one row per instruction, AVX2 two rows and AVX-512 all four.  Consecutive nodes
+// with the same parent (such as the leaves under a node) are processed as a run, with the rows of
+// the parent loaded into registers once for the whole run.  Putting a different node in each lane
+// instead would mean transposing every matrix on the way in and out, since they are stored one per
+// node, and that costs more than it saves.
+//
+// No path uses fused multiply-adds, and each adds up its products in the same order, so every
+// instruction set gives exactly the same results.
+//
+// The instruction set is chosen at runtime from those supported by the processor.
+
+struct TransformBatch
+{
+	const Matrix * const *	LocalTransformations{ nullptr };		// Local transformation of each node
+	const int *				Parents{ nullptr };						// Index of the parent of each node (-1 for RootTransformation)
+	Matrix *				WorldTransformations{ nullptr };		// Calculated world transformation of each node
+	Matrix * const *		NodeWorldTransformations{ nullptr };	// If not nullptr, each result is also copied here
+	Matrix					RootTransformation;
+};
+
+enum class MatrixInstructionSet
+{
+	Scalar,
+	SSE,
+	AVX2,
+	AVX512
+};
+
+void ConcatenateTransforms(const TransformBatch& batch, size_t first, size_t end);
+
+// The instruction set currently used by ConcatenateTransforms.  This defaults to the best
+// one supported by the processor, but can be changed (for example, to compare them).
+// SetMatrixInstructionSet returns false if the processor does not support the one requested.
+MatrixInstructionSet GetMatrixInstructionSet();
+bool SetMatrixInstructionSet(MatrixInstructionSet instructionSet);
+bool IsMatrixInstructionSetSupported(MatrixInstructionSet instructionSet);
+const char * GetMatrixInstructionSetName(MatrixInstructionSet instructionSet);
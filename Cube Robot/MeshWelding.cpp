@@ -0,0 +1,146 @@
+#include "MeshWelding.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	// Marks the end of a bucket's list of vertices
+	constexpr uint32_t WELD_NO_VERTEX = UINT32_MAX;
+
+	// The size of the cells, in tolerances.  A vertex is only compared with the vertices in the cells that
+	// are within the tolerance of it, which is usually just its own cell, and a cell is only looked at if
+	// the box the size of the tolerance around the vertex reaches it.
+	constexpr float WELD_CELL_TOLERANCES = 4.0f;
+
+	// The smallest cell used, so that a tolerance of 0 (which only merges identical vertices) does not give infinite cell coordinates
+	constexpr float WELD_MINIMUM_CELL_SIZE = 1e-6f;
+
+	// The largest cell coordinate used.  Positions further out than this (and positions that are not numbers)
+	// all go in the cells at the edge, well short of where stepping to the next cell would overflow.
+	constexpr double WELD_MAXIMUM_CELL = 4611686018427387904.0;
+
+	struct WeldCell
+	{
+		int64_t		X;
+		int64_t		Y;
+		int64_t		Z;
+	};
+
+	inline int64_t CellCoordinate(float coordinate, float offset, double inverseCellSize)
+	{
+		double cell = std::floor((static_cast<double>(coordinate) + offset) * inverseCellSize);
+		if (!(cell > -WELD_MAXIMUM_CELL))
+		{
+			return static_cast<int64_t>(-WELD_MAXIMUM_CELL);
+		}
+		return static_cast<int64_t>(std::min(cell, WELD_MAXIMUM_CELL));
+	}
+
+	inline WeldCell CellOf(const Vector3& position, float offset, double inverseCellSize)
+	{
+		return { CellCoordinate(position.x, offset, inverseCellSize),
+				 CellCoordinate(position.y, offset, inverseCellSize),
+				 CellCoordinate(position.z, offset, inverseCellSize) };
+	}
+
+	inline size_t BucketOf(int64_t x, int64_t y, int64_t z, size_t bucketMask)
+	{
+		uint64_t hash = static_cast<uint64_t>(x) * 0x9E3779B97F4A7C15ull ^ static_cast<uint64_t>(y) * 0xC2B2AE3D27D4EB4Full ^ static_cast<uint64_t>(z) * 0x165667B19E3779F9ull;
+		return static_cast<size_t>(hash ^ (hash >> 32)) & bucketMask;
+	}
+}
+
+WeldStatistics MeshWelder::Weld(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, float positionTolerance,
+								WeldAttributes attributes, float normalTolerance)
+{
+	WeldStatistics statistics;
+	statistics.VerticesBefore = vertices.size();
+
+	// At least twice as many buckets as vertices, so that most lists are short
+	size_t bucketCount = 1;
+	while (bucketCount < vertices.size() * 2)
+	{
+		bucketCount *= 2;
+	}
+	const size_t bucketMask = bucketCount - 1;
+	_bucketHeads.assign(bucketCount, WELD_NO_VERTEX);
+	_nextInBucket.resize(vertices.size());
+	_remap.resize(vertices.size());
+
+	const float tolerance = std::max(positionTolerance, 0.0f);
+	const float toleranceSquared = tolerance * tolerance;
+	const double inverseCellSize = 1.0 / std::max(tolerance * WELD_CELL_TOLERANCES, WELD_MINIMUM_CELL_SIZE);
+	const bool normalsCompared = attributes == WeldAttributes::PositionAndNormal;
+
+	// The vertices that are kept are moved down over the ones that were merged.  Since no more vertices
+	// are kept than have been looked at, a vertex is never overwritten before it has been looked at.
+	uint32_t keptCount = 0;
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		const Vertex vertex = vertices[i];
+		WeldCell cell = CellOf(vertex.Position, 0.0f, inverseCellSize);
+		WeldCell lowest = CellOf(vertex.Position, -tolerance, inverseCellSize);
+		WeldCell highest = CellOf(vertex.Position, tolerance, inverseCellSize);
+		uint32_t match = WELD_NO_VERTEX;
+		for (int64_t z = lowest.Z; z <= highest.Z; z++)
+		{
+			for (int64_t y = lowest.Y; y <= highest.Y; y++)
+			{
+				for (int64_t x = lowest.X; x <= highest.X; x++)
+				{
+					// The earliest vertex kept wins, wherever it is
+					for (uint32_t kept = _bucketHeads[BucketOf(x, y, z, bucketMask)]; kept != WELD_NO_VERTEX; kept = _nextInBucket[kept])
+					{
+						// Written so that a position that is not a number is never merged
+						const Vertex& candidate = vertices[kept];
+						if (!((candidate.Position - vertex.Position).LengthSquared() <= toleranceSquared))
+						{
+							continue;
+						}
+						if (normalsCompared && (std::fabs(candidate.Normal.x - vertex.Normal.x) > normalTolerance ||
+												std::fabs(candidate.Normal.y - vertex.Normal.y) > normalTolerance ||
+												std::fabs(candidate.Normal.z - vertex.Normal.z) > normalTolerance))
+						{
+							continue;
+						}
+						match = std::min(match, kept);
+					}
+				}
+			}
+		}
+		if (match != WELD_NO_VERTEX)
+		{
+			_remap[i] = match;
+			continue;
+		}
+
+		size_t bucket = BucketOf(cell.X, cell.Y, cell.Z, bucketMask);
+		vertices[keptCount] = vertex;
+		_nextInBucket[keptCount] = _bucketHeads[bucket];
+		_bucketHeads[bucket] = keptCount;
+		_remap[i] = keptCount;
+		keptCount++;
+	}
+	vertices.resize(keptCount);
+
+	// Any indices after the last whole triangle are dropped along with the triangles that collapsed
+	size_t triangleCount = indices.size() / 3;
+	size_t keptIndexCount = 0;
+	for (size_t triangle = 0; triangle < triangleCount; triangle++)
+	{
+		uint32_t index0 = _remap[indices[triangle * 3]];
+		uint32_t index1 = _remap[indices[triangle * 3 + 1]];
+		uint32_t index2 = _remap[indices[triangle * 3 + 2]];
+		if (index0 == index1 || index1 == index2 || index2 == index0)
+		{
+			continue;
+		}
+		indices[keptIndexCount++] = index0;
+		indices[keptIndexCount++] = index1;
+		indices[keptIndexCount++] = index2;
+	}
+	statistics.TrianglesRemoved = triangleCount - keptIndexCount / 3;
+	indices.resize(keptIndexCount);
+	statistics.VerticesAfter = keptCount;
+	return statistics;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include "ShaderStructures.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Welding of the vertices of indexed triangle lists.
+//
+// Meshes that are built a patch or a strip at a time end up with several copies of the same vertex: a
+// repeated column down the seam of a sphere, a whole ring of vertices at each pole, and, for a mesh
+// loaded as a list of separate triangles, a copy for every triangle a vertex is in.  MeshWelder
+// merges each vertex into the first vertex before it that is within positionTolerance of it (and,
+// unless only positions are compared, whose normal is within normalTolerance of its own in each
+// component).  The vertices that are kept stay in the order they are in the vertex array, and
+// vertices that no triangle uses are kept too.  The indices are changed to use the vertices that were
+// kept, and any triangle that is left with two corners at the same vertex is removed, since it covers
+// no pixels.  A vertex whose position is not a number is never merged.
+//
+// The vertices are found with a spatial hash: the positions are divided into cells a few times the
+// size of the tolerance, so a vertex only has to be compared with the vertices already kept in the
+// cells within the tolerance of it, which is usually just its own cell.  Cells whose hashes collide
+// share a bucket, which costs comparisons but never merges vertices that are too far apart.  The
+// buckets and remapping table are kept by the welder, so welding another mesh of the same size or
+// smaller does not allocate.
+
+enum class WeldAttributes
+{
+	Position,			// Merge vertices in the same place, whatever their normals
+	PositionAndNormal	// Merge vertices in the same place only if their normals also match, so hard edges are kept
+};
+
+struct WeldStatistics
+{
+	size_t	VerticesBefore;
+	size_t	VerticesAfter;
+	size_t	TrianglesRemoved;		// Triangles that collapsed to a line or a point
+};
+
+class MeshWelder
+{
+public:
+	WeldStatistics Weld(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, float positionTolerance = 1e-5f,
+						WeldAttributes attributes = WeldAttributes::PositionAndNormal, float normalTolerance = 1e-3f);
+
+private:
+	std::vector<uint32_t>	_bucketHeads;		// The last vertex kept in each bucket
+	std::vector<uint32_t>	_nextInBucket;		// The vertex kept before each kept vertex in the same bucket
+	std::vector<uint32_t>	_remap;				// The vertex that each original vertex was merged into
+};
@@ -0,0 +1,139 @@
+#include "NodeAllocator.h"
+#include <algorithm>
+#include <cstdint>
+
+namespace
+{
+	inline size_t RoundUp(size_t size, size_t alignment)
+	{
+		return (size + alignment - 1) / alignment * alignment;
+	}
+
+	// Allocate a chunk of blockCount blocks and return the address of the first block.  new only
+	// guarantees the default alignment, so extra space is allocated to align the first block.
+	char * AllocateChunk(std::vector<std::unique_ptr<char[]>>& chunks, size_t blockSize, size_t alignment, size_t blockCount, size_t& reservedBytes)
+	{
+		size_t chunkSize = blockSize * blockCount + alignment - 1;
+		chunks.emplace_back(new char[chunkSize]);
+		reservedBytes += chunkSize;
+		uintptr_t address = reinterpret_cast<uintptr_t>(chunks.back().get());
+		return reinterpret_cast<char *>(RoundUp(address, alignment));
+	}
+}
+
+NodePool::NodePool(size_t blocksPerChunk) : _blocksPerChunk(std::max<size_t>(blocksPerChunk, 1))
+{
+}
+
+void * NodePool::Allocate(size_t size, size_t alignment)
+{
+	// Free blocks hold a pointer to the next one, so must be aligned for it
+	SizeClass& sizeClass = FindSizeClass(size, std::max(alignment, alignof(FreeBlock)));
+	if (sizeClass.FreeList == nullptr)
+	{
+		// Link the blocks of a new chunk in order, so that nodes created one after another are
+		// next to each other in memory
+		char * first = AllocateChunk(sizeClass.Chunks, sizeClass.BlockSize, sizeClass.Alignment, _blocksPerChunk, _reservedBytes);
+		for (size_t i = _blocksPerChunk; i > 0; i--)
+		{
+			FreeBlock * block = reinterpret_cast<FreeBlock *>(first + (i - 1) * sizeClass.BlockSize);
+			block->Next = sizeClass.FreeList;
+			sizeClass.FreeList = block;
+		}
+	}
+	FreeBlock * block = sizeClass.FreeList;
+	sizeClass.FreeList = block->Next;
+	_liveBlockCount++;
+	return block;
+}
+
+void NodePool::Deallocate(void * block, size_t size, size_t alignment) noexcept
+{
+	alignment = std::max(alignment, alignof(FreeBlock));
+	for (SizeClass& sizeClass : _sizeClasses)
+	{
+		if (sizeClass.Size == size && sizeClass.Alignment == alignment)
+		{
+			FreeBlock * freeBlock = static_cast<FreeBlock *>(block);
+			freeBlock->Next = sizeClass.FreeList;
+			sizeClass.FreeList = freeBlock;
+			_liveBlockCount--;
+			return;
+		}
+	}
+}
+
+bool NodePool::Release()
+{
+	if (_liveBlockCount != 0)
+	{
+		return false;
+	}
+	_sizeClasses.clear();
+	_reservedBytes = 0;
+	return true;
+}
+
+NodePool::SizeClass& NodePool::FindSizeClass(size_t size, size_t alignment)
+{
+	// There is one size class for each type of node, so there are only ever a few of them
+	for (SizeClass& sizeClass : _sizeClasses)
+	{
+		if (sizeClass.Size == size && sizeClass.Alignment == alignment)
+		{
+			return sizeClass;
+		}
+	}
+	SizeClass sizeClass;
+	sizeClass.Size = size;
+	sizeClass.Alignment = alignment;
+	sizeClass.BlockSize = RoundUp(std::max(size, sizeof(FreeBlock)), alignment);
+	_sizeClasses.push_back(std::move(sizeClass));
+	return _sizeClasses.back();
+}
+
+NodeArena::NodeArena(size_t blocksPerChunk) : _blocksPerChunk(std::max<size_t>(blocksPerChunk, 1))
+{
+}
+
+void * NodeArena::Allocate(size_t size, size_t alignment)
+{
+	SizeClass& sizeClass = FindSizeClass(size, alignment);
+	if (sizeClass.Next == sizeClass.End)
+	{
+		sizeClass.Next = AllocateChunk(sizeClass.Chunks, sizeClass.BlockSize, sizeClass.Alignment, _blocksPerChunk, _reservedBytes);
+		sizeClass.End = sizeClass.Next + sizeClass.BlockSize * _blocksPerChunk;
+	}
+	void * block = sizeClass.Next;
+	sizeClass.Next += sizeClass.BlockSize;
+	_liveBlockCount++;
+	return block;
+}
+
+bool NodeArena::Reset()
+{
+	if (_liveBlockCount != 0)
+	{
+		return false;
+	}
+	_sizeClasses.clear();
+	_reservedBytes = 0;
+	return true;
+}
+
+NodeArena::SizeClass& NodeArena::FindSizeClass(size_t size, size_t alignment)
+{
+	for (SizeClass& sizeClass : _sizeClasses)
+	{
+		if (sizeClass.Size == size && sizeClass.Alignment == alignment)
+		{
+			return sizeClass;
+		}
+	}
+	SizeClass sizeClass;
+	sizeClass.Size = size;
+	sizeClass.Alignment = alignment;
+	sizeClass.BlockSize = RoundUp(size, alignment);
+	_sizeClasses.push_back(std::move(sizeClass));
+	return _sizeClasses.back();
+}
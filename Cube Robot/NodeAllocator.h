@@ -0,0 +1,161 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// Allocators for scene nodes.  Creating every node with make_shared gives each one (and its
+// shared_ptr control block) its own heap allocation, so nodes that are used together end up
+// scattered around memory, and building or destroying a large scene makes one call to the heap
+// for every node.
+//
+// NodePool and NodeArena instead carve nodes out of large chunks of memory.  Allocations are
+// grouped by size and alignment, and since std::allocate_shared allocates the control block
+// and the node together, and the control block is a different type for every node type, this
+// gives each type of node its own chunks.  Nodes created one after another are next to each
+// other in memory.
+//
+// Both have a Create method that is used in place of make_shared:
+//
+//		shared_ptr<CubeNode> body = pool.Create<CubeNode>(L"Body", colour);
+//
+// The pointers returned are ordinary shared_ptrs, so they can be added to scene graphs, stored
+// and released just like those returned by make_shared.  NodeAllocator can also be passed to
+// std::allocate_shared directly.
+//
+// The pool or arena must outlive every node created from it.  Neither is thread-safe.
+
+template <typename T, typename Source>
+class NodeAllocator
+{
+public:
+	typedef T value_type;
+
+	NodeAllocator(Source& source) noexcept : _source(&source) {}
+	template <typename U>
+	NodeAllocator(const NodeAllocator<U, Source>& other) noexcept : _source(other.GetSource()) {}
+
+	inline T * allocate(size_t count) { return static_cast<T *>(_source->Allocate(count * sizeof(T), alignof(T))); }
+	inline void deallocate(T * pointer, size_t count) noexcept { _source->Deallocate(pointer, count * sizeof(T), alignof(T)); }
+
+	inline Source * GetSource() const noexcept { return _source; }
+
+private:
+	Source *	_source;
+};
+
+template <typename T, typename U, typename Source>
+inline bool operator==(const NodeAllocator<T, Source>& left, const NodeAllocator<U, Source>& right) noexcept
+{
+	return left.GetSource() == right.GetSource();
+}
+
+template <typename T, typename U, typename Source>
+inline bool operator!=(const NodeAllocator<T, Source>& left, const NodeAllocator<U, Source>& right) noexcept
+{
+	return left.GetSource() != right.GetSource();
+}
+
+// A pool of fixed-size blocks for each size of allocation.  Freed blocks go on a free list and
+// are reused by the next node of the same type, so the pool suits scenes where nodes are added
+// and removed over time.  The memory is only returned to the heap by Release, or when the pool
+// is destroyed.
+
+class NodePool
+{
+public:
+	static constexpr size_t DEFAULT_BLOCKS_PER_CHUNK = 256;
+
+	NodePool(size_t blocksPerChunk = DEFAULT_BLOCKS_PER_CHUNK);
+
+	NodePool(const NodePool&) = delete;
+	NodePool& operator=(const NodePool&) = delete;
+
+	template <typename T, typename... Args>
+	inline std::shared_ptr<T> Create(Args&&... args)
+	{
+		return std::allocate_shared<T>(NodeAllocator<T, NodePool>(*this), std::forward<Args>(args)...);
+	}
+
+	void * Allocate(size_t size, size_t alignment);
+	void Deallocate(void * block, size_t size, size_t alignment) noexcept;
+
+	// Free all of the pool's memory in one go.  Returns false (and frees nothing) if any of the
+	// nodes created from the pool still exist.
+	bool Release();
+
+	inline size_t GetLiveBlockCount() const { return _liveBlockCount; }
+	inline size_t GetReservedBytes() const { return _reservedBytes; }
+
+private:
+	struct FreeBlock
+	{
+		FreeBlock *		Next;
+	};
+
+	struct SizeClass
+	{
+		size_t								Size;
+		size_t								Alignment;
+		size_t								BlockSize;
+		FreeBlock *							FreeList{ nullptr };
+		std::vector<std::unique_ptr<char[]>>	Chunks;
+	};
+
+	size_t						_blocksPerChunk;
+	std::vector<SizeClass>		_sizeClasses;
+	size_t						_liveBlockCount{ 0 };
+	size_t						_reservedBytes{ 0 };
+
+	SizeClass& FindSizeClass(size_t size, size_t alignment);
+};
+
+// Hands out memory in order from chunks kept for each size of allocation.  Memory is never
+// reused: destroying a node runs its destructor but leaves its memory in place until Reset
+// frees everything at once.  The arena suits scenes that are built in one go and thrown away in
+// one go, such as a level that is streamed in and later unloaded.
+
+class NodeArena
+{
+public:
+	static constexpr size_t DEFAULT_BLOCKS_PER_CHUNK = 1024;
+
+	NodeArena(size_t blocksPerChunk = DEFAULT_BLOCKS_PER_CHUNK);
+
+	NodeArena(const NodeArena&) = delete;
+	NodeArena& operator=(const NodeArena&) = delete;
+
+	template <typename T, typename... Args>
+	inline std::shared_ptr<T> Create(Args&&... args)
+	{
+		return std::allocate_shared<T>(NodeAllocator<T, NodeArena>(*this), std::forward<Args>(args)...);
+	}
+
+	void * Allocate(size_t size, size_t alignment);
+	inline void Deallocate(void *, size_t, size_t) noexcept { _liveBlockCount--; }
+
+	// Free all of the arena's memory in one go.  Returns false (and frees nothing) if any of the
+	// nodes created from the arena still exist.
+	bool Reset();
+
+	inline size_t GetLiveBlockCount() const { return _liveBlockCount; }
+	inline size_t GetReservedBytes() const { return _reservedBytes; }
+
+private:
+	struct SizeClass
+	{
+		size_t								Size;
+		size_t								Alignment;
+		size_t								BlockSize;
+		char *								Next{ nullptr };
+		char *								End{ nullptr };
+		std::vector<std::unique_ptr<char[]>>	Chunks;
+	};
+
+	size_t						_blocksPerChunk;
+	std::vector<SizeClass>		_sizeClasses;
+	size_t						_liveBlockCount{ 0 };
+	size_t						_reservedBytes{ 0 };
+
+	SizeClass& FindSizeClass(size_t size, size_t alignment);
+};
@@ -0,0 +1,177 @@
+#include "NodeRegistry.h"
+#include "SceneNode.h"
+#include <algorithm>
+
+void NodeRegistry::Register(SceneNode * node)
+{
+	// Intern the name of the node
+	auto nameEntry = _nameIds.find(node->GetName());
+	uint32_t nameId;
+	if (nameEntry == _nameIds.end())
+	{
+		nameId = static_cast<uint32_t>(_nodesByName.size());
+		_nameIds.emplace(node->GetName(), nameId);
+		_nodesByName.emplace_back();
+	}
+	else
+	{
+		nameId = nameEntry->second;
+	}
+
+	// Reuse a free slot if there is one
+	uint32_t index;
+	if (!_freeSlots.empty())
+	{
+		index = _freeSlots.back();
+		_freeSlots.pop_back();
+	}
+	else
+	{
+		index = static_cast<uint32_t>(_slots.size());
+		_slots.emplace_back();
+	}
+	_slots[index].Node = node;
+	_slots[index].NameId = nameId;
+	_nodesByName[nameId].push_back(index);
+	node->_registryIndex = index;
+}
+
+void NodeRegistry::Unregister(SceneNode * node)
+{
+	uint32_t index = node->_registryIndex;
+	if (index >= _slots.size() || _slots[index].Node != node)
+	{
+		return;
+	}
+
+	vector<uint32_t>& namedNodes = _nodesByName[_slots[index].NameId];
+	auto namedNode = std::find(namedNodes.begin(), namedNodes.end(), index);
+	if (namedNode != namedNodes.end())
+	{
+		namedNodes.erase(namedNode);
+	}
+
+	// Incrementing the generation invalidates any handles to this slot
+	_slots[index].Node = nullptr;
+	_slots[index].Generation++;
+	_freeSlots.push_back(index);
+	node->_registryIndex = UINT32_MAX;
+}
+
+void NodeRegistry::Clear()
+{
+	// The slots are kept (but freed) so that their generation counts
+	// carry on increasing and old handles stay invalid
+	_freeSlots.clear();
+	for (uint32_t index = 0; index < _slots.size(); index++)
+	{
+		Slot& slot = _slots[index];
+		if (slot.Node != nullptr)
+		{
+			slot.Node->_registryIndex = UINT32_MAX;
+			slot.Node = nullptr;
+			slot.Generation++;
+		}
+		_freeSlots.push_back(index);
+	}
+	for (vector<uint32_t>& namedNodes : _nodesByName)
+	{
+		namedNodes.clear();
+	}
+	_scopes.clear();
+	_freeScopes.clear();
+}
+
+NodeHandle NodeRegistry::Find(const std::wstring& name) const
+{
+	const vector<uint32_t>& namedNodes = FindAll(name);
+	if (namedNodes.empty())
+	{
+		return NodeHandle();
+	}
+	return GetHandle(namedNodes.front());
+}
+
+NodeHandle NodeRegistry::GetHandle(const SceneNode * node) const
+{
+	uint32_t index = node->_registryIndex;
+	if (index >= _slots.size() || _slots[index].Node != node)
+	{
+		return NodeHandle();
+	}
+	return GetHandle(index);
+}
+
+const std::vector<uint32_t>& NodeRegistry::FindAll(const std::wstring& name) const
+{
+	static const vector<uint32_t> noNodes;
+	auto nameEntry = _nameIds.find(name);
+	if (nameEntry == _nameIds.end())
+	{
+		return noNodes;
+	}
+	return _nodesByName[nameEntry->second];
+}
+
+uint32_t NodeRegistry::CreateScope()
+{
+	if (!_freeScopes.empty())
+	{
+		uint32_t scope = _freeScopes.back();
+		_freeScopes.pop_back();
+		return scope;
+	}
+	_scopes.emplace_back();
+	return static_cast<uint32_t>(_scopes.size() - 1);
+}
+
+void NodeRegistry::ReleaseScope(uint32_t scope)
+{
+	// The memory is freed rather than kept for the next scope, since the scope that reuses the index
+	// may be much smaller
+	vector<ScopeEntry>().swap(_scopes[scope]);
+	_freeScopes.push_back(scope);
+}
+
+void NodeRegistry::AddToScope(uint32_t scope, const SceneNode * node)
+{
+	// Nodes with the same name are kept in the order they were added, as they are in _nodesByName
+	vector<ScopeEntry>& entries = _scopes[scope];
+	ScopeEntry entry{ _slots[node->_registryIndex].NameId, node->_registryIndex };
+	auto position = std::upper_bound(entries.begin(), entries.end(), entry,
+									 [](const ScopeEntry& left, const ScopeEntry& right) { return left.NameId < right.NameId; });
+	entries.insert(position, entry);
+}
+
+void NodeRegistry::RemoveFromScope(uint32_t scope, const SceneNode * node)
+{
+	uint32_t index = node->_registryIndex;
+	if (index >= _slots.size() || _slots[index].Node != node)
+	{
+		return;
+	}
+	vector<ScopeEntry>& entries = _scopes[scope];
+	auto entry = std::find_if(entries.begin(), entries.end(), [index](const ScopeEntry& current) { return current.Index == index; });
+	if (entry != entries.end())
+	{
+		entries.erase(entry);
+	}
+}
+
+std::pair<const NodeRegistry::ScopeEntry *, const NodeRegistry::ScopeEntry *> NodeRegistry::FindInScope(uint32_t scope, const std::wstring& name) const
+{
+	auto nameEntry = _nameIds.find(name);
+	if (nameEntry == _nameIds.end())
+	{
+		return { nullptr, nullptr };
+	}
+	const vector<ScopeEntry>& entries = _scopes[scope];
+	ScopeEntry key{ nameEntry->second, 0 };
+	auto range = std::equal_range(entries.begin(), entries.end(), key,
+								  [](const ScopeEntry& left, const ScopeEntry& right) { return left.NameId < right.NameId; });
+	if (range.first == range.second)
+	{
+		return { nullptr, nullptr };
+	}
+	return { &*range.first, &*range.first + (range.second - range.first) };
+}
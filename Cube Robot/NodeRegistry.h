@@ -0,0 +1,103 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class SceneNode;
+
+// A lightweight reference to a node in a scene graph.  Handles can be stored and resolved
+// back to the node in constant time (see SceneGraph::Resolve).  Each slot in the registry
+// has a generation count that is incremented when the slot is reused, so a handle to a node
+// that has since been removed from the scene graph resolves to nullptr rather than to
+// whichever node now occupies the slot.
+
+struct NodeHandle
+{
+	uint32_t	Index{ UINT32_MAX };
+	uint32_t	Generation{ 0 };
+
+	inline bool IsValid() const { return Index != UINT32_MAX; }
+};
+
+// The index of every node in a scene graph, kept by the root SceneGraph and maintained
+// by SceneGraph::Add and SceneGraph::Remove.
+//
+// Node names are interned, so finding a node by name costs a single hash lookup rather
+// than a comparison against every node in the graph.
+//
+// Nodes can also be indexed by scope.  A scope is a subtree (normally a single model) whose nodes
+// are listed on their own, so that a name used in every copy of a model can be found in one copy
+// without going through the nodes of all of the others.  A node is added to every scope that it is
+// inside.  The nodes of each scope are kept sorted by name, so scopes are meant to be small.
+
+class NodeRegistry
+{
+public:
+	static constexpr uint32_t NO_SCOPE = UINT32_MAX;
+
+	struct ScopeEntry
+	{
+		uint32_t	NameId;
+		uint32_t	Index;
+	};
+
+	void Register(SceneNode * node);
+	void Unregister(SceneNode * node);
+	void Clear();
+
+	// Returns the handle of the first registered node with the given name, or an
+	// invalid handle if there is no such node
+	NodeHandle Find(const std::wstring& name) const;
+
+	// Returns all of the registered nodes with the given name
+	const std::vector<uint32_t>& FindAll(const std::wstring& name) const;
+
+	// Scopes are identified by index, which is reused once a scope is released.  A node must be
+	// removed from its scopes before it is unregistered.
+	uint32_t CreateScope();
+	void ReleaseScope(uint32_t scope);
+	void AddToScope(uint32_t scope, const SceneNode * node);
+	void RemoveFromScope(uint32_t scope, const SceneNode * node);
+
+	// Returns the range of entries for the nodes in a scope with the given name, in the order they
+	// were added to it
+	std::pair<const ScopeEntry *, const ScopeEntry *> FindInScope(uint32_t scope, const std::wstring& name) const;
+
+	// Returns the node that a handle refers to, or nullptr if the handle is no longer valid
+	inline SceneNode * Resolve(NodeHandle handle) const
+	{
+		if (handle.Index >= _slots.size() || _slots[handle.Index].Generation != handle.Generation)
+		{
+			return nullptr;
+		}
+		return _slots[handle.Index].Node;
+	}
+
+	inline NodeHandle GetHandle(uint32_t index) const { return NodeHandle{ index, _slots[index].Generation }; }
+
+	// Returns the handle of a registered node, or an invalid handle if the node is not registered
+	NodeHandle GetHandle(const SceneNode * node) const;
+	inline SceneNode * GetNode(uint32_t index) const { return _slots[index].Node; }
+	inline size_t GetNodeCount() const { return _slots.size() - _freeSlots.size(); }
+
+private:
+	struct Slot
+	{
+		SceneNode *	Node{ nullptr };
+		uint32_t	Generation{ 0 };
+		uint32_t	NameId{ 0 };
+	};
+
+	std::vector<Slot>							_slots;
+	std::vector<uint32_t>						_freeSlots;
+
+	// Interned names.  Each distinct name is given an id which indexes _nodesByName.
+	std::unordered_map<std::wstring, uint32_t>	_nameIds;
+	std::vector<std::vector<uint32_t>>			_nodesByName;
+
+	// The nodes in each scope, sorted by name id
+	std::vector<std::vector<ScopeEntry>>		_scopes;
+	std::vector<uint32_t>						_freeScopes;
+};
@@ -0,0 +1,248 @@
+#include "NormalsBenchmark.h"
+#include "VertexNormals.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// Rings and segments in the sphere, which gives 2 * 700 * 1400 = 1,960,000 triangles
+constexpr uint32_t NORMALS_BENCHMARK_RINGS = 700;
+constexpr uint32_t NORMALS_BENCHMARK_SEGMENTS = 1400;
+
+// Times the normals of each mesh are generated by each method
+constexpr int NORMALS_BENCHMARK_REPEATS = 5;
+
+// How far each vertex of the uneven sphere is moved, as a fraction of the radius
+constexpr float NORMALS_BENCHMARK_NOISE = 0.002f;
+
+// SSE and the scalar code add up the same values in the same order, but may round differently
+constexpr float NORMALS_BENCHMARK_TOLERANCE = 1e-4f;
+
+// The smallest cosine allowed between a normal of the smooth sphere and the direction away from its centre
+constexpr float NORMALS_BENCHMARK_MINIMUM_RADIAL_DOT = 0.999f;
+
+// Build a sphere of radius 1 with a row of vertices for each ring, from pole to pole, and a column for
+// each segment plus a repeated column at the seam.  The vertex after the sphere is not used by any
+// triangle.  If noise is not 0, each vertex is moved by a random amount up to noise in each direction.
+
+void BuildNormalsSphere(vector<Vertex>& vertices, vector<uint32_t>& indices, float noise)
+{
+	const float pi = 3.14159265358979f;
+	mt19937 random(54321);
+	uniform_real_distribution<float> offset(-noise, noise);
+	vertices.clear();
+	for (uint32_t ring = 0; ring <= NORMALS_BENCHMARK_RINGS; ring++)
+	{
+		float latitude = pi * ring / NORMALS_BENCHMARK_RINGS;
+		for (uint32_t segment = 0; segment <= NORMALS_BENCHMARK_SEGMENTS; segment++)
+		{
+			float longitude = 2.0f * pi * segment / NORMALS_BENCHMARK_SEGMENTS;
+			Vertex vertex;
+			vertex.Position = Vector3(sinf(latitude) * cosf(longitude), cosf(latitude), sinf(latitude) * sinf(longitude));
+			if (noise != 0.0f)
+			{
+				vertex.Position += Vector3(offset(random), offset(random), offset(random));
+			}
+			vertex.Normal = Vector3(0.0f, 0.0f, 0.0f);
+			vertices.push_back(vertex);
+		}
+	}
+	Vertex unused;
+	unused.Position = Vector3(2.0f, 0.0f, 0.0f);
+	unused.Normal = Vector3(1.0f, 0.0f, 0.0f);
+	vertices.push_back(unused);
+
+	// Wound clockwise when seen from outside, as the left-handed samples expect
+	indices.clear();
+	const uint32_t rowLength = NORMALS_BENCHMARK_SEGMENTS + 1;
+	for (uint32_t ring = 0; ring < NORMALS_BENCHMARK_RINGS; ring++)
+	{
+		for (uint32_t segment = 0; segment < NORMALS_BENCHMARK_SEGMENTS; segment++)
+		{
+			uint32_t topLeft = ring * rowLength + segment;
+			uint32_t bottomLeft = topLeft + rowLength;
+			indices.insert(indices.end(), { topLeft, topLeft + 1, bottomLeft });
+			indices.insert(indices.end(), { topLeft + 1, bottomLeft + 1, bottomLeft });
+		}
+	}
+}
+
+// The loop that CubeNode used before VertexNormalGenerator
+
+void LegacyVertexNormals(vector<Vertex>& vertices, const vector<uint32_t>& indices)
+{
+	vector<int> contributingCounts(vertices.size(), 0);
+	for (Vertex& vertex : vertices)
+	{
+		vertex.Normal = Vector3(0.0f, 0.0f, 0.0f);
+	}
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		Vector3 polygonNormal = (vertices[indices[i + 1]].Position - vertices[indices[i]].Position).Cross(vertices[indices[i + 2]].Position - vertices[indices[i]].Position);
+		for (size_t j = 0; j < 3; j++)
+		{
+			vertices[indices[i + j]].Normal += polygonNormal;
+			contributingCounts[indices[i + j]]++;
+		}
+	}
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		if (contributingCounts[i] > 0)
+		{
+			vertices[i].Normal /= static_cast<float>(contributingCounts[i]);
+			vertices[i].Normal.Normalize();
+		}
+	}
+}
+
+float MaximumNormalDifference(const vector<Vertex>& a, const vector<Vertex>& b)
+{
+	float difference = 0.0f;
+	for (size_t i = 0; i < a.size(); i++)
+	{
+		difference = max(difference, fabsf(a[i].Normal.x - b[i].Normal.x));
+		difference = max(difference, fabsf(a[i].Normal.y - b[i].Normal.y));
+		difference = max(difference, fabsf(a[i].Normal.z - b[i].Normal.z));
+	}
+	return difference;
+}
+
+bool NormalsIdentical(const vector<Vertex>& a, const vector<Vertex>& b)
+{
+	return a.size() == b.size() && memcmp(a.data(), b.data(), a.size() * sizeof(Vertex)) == 0;
+}
+
+// The smallest cosine between a normal of the smooth sphere and the direction from the centre to its
+// vertex.  The rows at the poles are left out, since each of their vertices is used by a single
+// triangle, half of which are degenerate.
+
+float MinimumRadialDot(const vector<Vertex>& vertices)
+{
+	float minimum = 1.0f;
+	const size_t rowLength = NORMALS_BENCHMARK_SEGMENTS + 1;
+	for (size_t i = rowLength; i < NORMALS_BENCHMARK_RINGS * rowLength; i++)
+	{
+		Vector3 radial = vertices[i].Position;
+		radial.Normalize();
+		minimum = min(minimum, radial.Dot(vertices[i].Normal));
+	}
+	return minimum;
+}
+
+double NormalsSecondsSince(chrono::steady_clock::time_point start)
+{
+	return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+int RunNormalsBenchmarks(const std::string& resultsFileName)
+{
+	ofstream results(resultsFileName);
+	if (!results)
+	{
+		return -1;
+	}
+
+	unsigned int maximumThreads = max(thread::hardware_concurrency(), 2u);
+	const char * meshNames[] = { "sphere", "uneven_sphere" };
+	const NormalWeighting weightings[] = { NormalWeighting::Area, NormalWeighting::Angle, NormalWeighting::Uniform };
+	const char * weightingNames[] = { "area", "angle", "uniform" };
+	bool allPassed = true;
+	vector<Vertex> vertices;
+	vector<uint32_t> indices;
+	VertexNormalGenerator generator;
+	results << "benchmark,mesh,weighting,method,threads,vertices,triangles,ms,speedup,max_difference,min_radial_dot,passes" << endl;
+	for (int mesh = 0; mesh < 2; mesh++)
+	{
+		BuildNormalsSphere(vertices, indices, mesh == 0 ? 0.0f : NORMALS_BENCHMARK_NOISE);
+		const size_t triangleCount = indices.size() / 3;
+
+		// The legacy loop, which the area weighted normals are compared with
+		vector<Vertex> legacy = vertices;
+		double legacySeconds = 0.0;
+		for (int repeat = 0; repeat < NORMALS_BENCHMARK_REPEATS; repeat++)
+		{
+			auto start = chrono::steady_clock::now();
+			LegacyVertexNormals(legacy, indices);
+			legacySeconds += NormalsSecondsSince(start);
+		}
+		double legacyMs = 1000.0 * legacySeconds / NORMALS_BENCHMARK_REPEATS;
+		results << "normals," << meshNames[mesh] << ",area,legacy,1," << vertices.size() << "," << triangleCount << ","
+				<< legacyMs << ",1,0," << (mesh == 0 ? MinimumRadialDot(legacy) : 0.0f) << ",yes" << endl;
+
+		for (int weighting = 0; weighting < 3; weighting++)
+		{
+			// Scalar on one thread, then SSE on one thread and on up to the number of hardware threads
+			vector<Vertex> scalar;
+			vector<Vertex> singleThread;
+			for (int method = 0; method < 2; method++)
+			{
+				generator.SetSimdUsed(method == 1);
+				for (unsigned int threads = 1; threads <= (method == 0 ? 1 : maximumThreads); threads *= 2)
+				{
+					ThreadPool threadPool(threads);
+					vector<Vertex> generated = vertices;
+					double seconds = 0.0;
+					for (int repeat = 0; repeat < NORMALS_BENCHMARK_REPEATS; repeat++)
+					{
+						auto start = chrono::steady_clock::now();
+						generator.Generate(generated, indices, weightings[weighting], threads == 1 ? nullptr : &threadPool);
+						seconds += NormalsSecondsSince(start);
+					}
+					double ms = 1000.0 * seconds / NORMALS_BENCHMARK_REPEATS;
+
+					// The unused vertex must be given a zero normal
+					const Vector3& unusedNormal = generated.back().Normal;
+					bool passes = unusedNormal.x == 0.0f && unusedNormal.y == 0.0f && unusedNormal.z == 0.0f;
+					float difference = 0.0f;
+					if (method == 0)
+					{
+						scalar = generated;
+					}
+					else
+					{
+						difference = MaximumNormalDifference(generated, scalar);
+						passes = passes && difference <= NORMALS_BENCHMARK_TOLERANCE;
+					}
+					if (weightings[weighting] == NormalWeighting::Area)
+					{
+						float legacyDifference = MaximumNormalDifference(generated, legacy);
+						difference = max(difference, legacyDifference);
+						passes = passes && legacyDifference <= NORMALS_BENCHMARK_TOLERANCE;
+					}
+					if (method == 1 && threads == 1)
+					{
+						singleThread = generated;
+					}
+					else if (method == 1)
+					{
+						passes = passes && NormalsIdentical(generated, singleThread);
+					}
+					float radialDot = 0.0f;
+					if (mesh == 0)
+					{
+						radialDot = MinimumRadialDot(generated);
+						passes = passes && radialDot >= NORMALS_BENCHMARK_MINIMUM_RADIAL_DOT;
+					}
+					allPassed = allPassed && passes;
+					results << "normals," << meshNames[mesh] << "," << weightingNames[weighting] << "," << (method == 0 ? "scalar" : "sse") << ","
+							<< threads << "," << vertices.size() << "," << triangleCount << "," << ms << "," << legacyMs / ms << ","
+							<< difference << "," << radialDot << "," << (passes ? "yes" : "no") << endl;
+
+					// Make sure that the largest thread count is always measured
+					if (threads < maximumThreads && threads * 2 > maximumThreads)
+					{
+						threads = maximumThreads / 2;
+					}
+				}
+			}
+		}
+	}
+	return allPassed ? 0 : 1;
+}
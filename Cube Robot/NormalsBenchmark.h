@@ -0,0 +1,13 @@
+#pragma once
+#include <string>
+
+// Benchmarks and checks for VertexNormalGenerator.  The normals of a finely divided sphere, and of the
+// same sphere with its vertices moved by random amounts, are generated with each weighting, with and
+// without SSE and on different numbers of threads, and timed against the scalar loop that CubeNode used
+// before.  Area weighting must give the same normals as that loop, SSE must give the same normals as the
+// scalar code, every thread count must give exactly the same normals as one thread, and the normals of
+// the smooth sphere must point away from its centre.
+//
+// The results are written as comma-separated values to the file given.
+
+int RunNormalsBenchmarks(const std::string& resultsFileName);
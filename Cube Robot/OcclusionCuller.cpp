@@ -0,0 +1,357 @@
+#include "OcclusionCuller.h"
+#include "SceneNode.h"
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define OCCLUSION_X86 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	// Occluders are clipped to the near plane and to a guard band this many times the size of the
+	// screen, which keeps the screen coordinates small enough to rasterize accurately
+	constexpr float GUARD_BAND = 4.0f;
+	constexpr int CLIP_PLANES = 5;
+	constexpr int MAXIMUM_CLIPPED_VERTICES = 3 + CLIP_PLANES;
+
+	float PlaneDistance(const Vector4& vertex, int plane)
+	{
+		switch (plane)
+		{
+			case 0: return vertex.z;
+			case 1: return GUARD_BAND * vertex.w + vertex.x;
+			case 2: return GUARD_BAND * vertex.w - vertex.x;
+			case 3: return GUARD_BAND * vertex.w + vertex.y;
+			default: return GUARD_BAND * vertex.w - vertex.y;
+		}
+	}
+
+	Vector4 Transform(const Vector3& position, const Matrix& m)
+	{
+		return Vector4(position.x * m.m[0][0] + position.y * m.m[1][0] + position.z * m.m[2][0] + m.m[3][0],
+					   position.x * m.m[0][1] + position.y * m.m[1][1] + position.z * m.m[2][1] + m.m[3][1],
+					   position.x * m.m[0][2] + position.y * m.m[1][2] + position.z * m.m[2][2] + m.m[3][2],
+					   position.x * m.m[0][3] + position.y * m.m[1][3] + position.z * m.m[2][3] + m.m[3][3]);
+	}
+
+	double MicrosecondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+OcclusionCuller::OcclusionCuller(uint32_t width, uint32_t height)
+{
+	_blocksAcross = std::max((width + BLOCK_SIZE - 1) / BLOCK_SIZE, 1u);
+	_blocksDown = std::max((height + BLOCK_SIZE - 1) / BLOCK_SIZE, 1u);
+	_width = _blocksAcross * BLOCK_SIZE;
+	_height = _blocksDown * BLOCK_SIZE;
+	_depthBuffer.assign(static_cast<size_t>(_width) * _height, 1.0f);
+	_blockDepths.assign(static_cast<size_t>(_blocksAcross) * _blocksDown, 1.0f);
+}
+
+void OcclusionCuller::AddOccluder(std::shared_ptr<SceneNode> node, const std::vector<Vector3>& vertices, const std::vector<uint32_t>& indices)
+{
+	_occluders.push_back({ node, vertices, indices });
+}
+
+void OcclusionCuller::RemoveOccluder(const SceneNode * node)
+{
+	_occluders.erase(std::remove_if(_occluders.begin(), _occluders.end(), [node](const Occluder& occluder) { return occluder.Node.get() == node; }),
+					 _occluders.end());
+}
+
+void OcclusionCuller::BeginFrame(const Matrix& viewProjectionTransformation)
+{
+	auto start = std::chrono::steady_clock::now();
+	_statistics = OcclusionStatistics();
+	_viewProjectionTransformation = viewProjectionTransformation;
+	std::fill(_depthBuffer.begin(), _depthBuffer.end(), 1.0f);
+	for (const Occluder& occluder : _occluders)
+	{
+		Matrix transformation = occluder.Node->GetCumulativeWorldTransform() * viewProjectionTransformation;
+		_clipVertices.resize(occluder.Vertices.size());
+		for (size_t i = 0; i < occluder.Vertices.size(); i++)
+		{
+			_clipVertices[i] = Transform(occluder.Vertices[i], transformation);
+		}
+		for (size_t i = 0; i + 2 < occluder.Indices.size(); i += 3)
+		{
+			DrawTriangle(_clipVertices[occluder.Indices[i]], _clipVertices[occluder.Indices[i + 1]], _clipVertices[occluder.Indices[i + 2]]);
+		}
+	}
+	_hasOccluders = _statistics.OccluderTriangles > 0;
+	BuildBlockDepths();
+	_statistics.RasterizeTime = MicrosecondsSince(start);
+}
+
+bool OcclusionCuller::IsOccluded(const BoundingSphere& bounds)
+{
+	if (!_hasOccluders)
+	{
+		return false;
+	}
+	auto start = std::chrono::steady_clock::now();
+	_statistics.NodesTested++;
+
+	// Project the corners of the box around the sphere.  The nearest depth of the box is at one of
+	// its corners, and the box covers no more of the screen than the rectangle around its corners.
+	float minimumX = FLT_MAX;
+	float minimumY = FLT_MAX;
+	float maximumX = -FLT_MAX;
+	float maximumY = -FLT_MAX;
+	float nearestDepth = FLT_MAX;
+	for (int corner = 0; corner < 8; corner++)
+	{
+		Vector3 position(bounds.Center.x + ((corner & 1) ? bounds.Radius : -bounds.Radius),
+						 bounds.Center.y + ((corner & 2) ? bounds.Radius : -bounds.Radius),
+						 bounds.Center.z + ((corner & 4) ? bounds.Radius : -bounds.Radius));
+		Vector4 clip = Transform(position, _viewProjectionTransformation);
+		if (clip.z < 0.0f || clip.w <= 0.0f)
+		{
+			// Part of the bounds is in front of the near plane, so nothing can be in front of it
+			_statistics.TestTime += MicrosecondsSince(start);
+			return false;
+		}
+		float inverseW = 1.0f / clip.w;
+		float x = (clip.x * inverseW * 0.5f + 0.5f) * _width;
+		float y = (0.5f - clip.y * inverseW * 0.5f) * _height;
+		minimumX = std::min(minimumX, x);
+		maximumX = std::max(maximumX, x);
+		minimumY = std::min(minimumY, y);
+		maximumY = std::max(maximumY, y);
+		nearestDepth = std::min(nearestDepth, clip.z * inverseW);
+	}
+
+	// Every pixel the rectangle touches must be covered by an occluder in front of the nearest depth.
+	// Anything off the screen cannot be seen anyway.
+	const int32_t blockSize = static_cast<int32_t>(BLOCK_SIZE);
+	int32_t firstX = static_cast<int32_t>(std::min(std::max(minimumX, 0.0f), static_cast<float>(_width)));
+	int32_t firstY = static_cast<int32_t>(std::min(std::max(minimumY, 0.0f), static_cast<float>(_height)));
+	int32_t lastX = static_cast<int32_t>(std::floor(std::max(std::min(maximumX, _width - 1.0f), -1.0f)));
+	int32_t lastY = static_cast<int32_t>(std::floor(std::max(std::min(maximumY, _height - 1.0f), -1.0f)));
+	bool occluded = firstX <= lastX && firstY <= lastY;
+	for (int32_t blockY = firstY / blockSize; occluded && blockY <= lastY / blockSize; blockY++)
+	{
+		for (int32_t blockX = firstX / blockSize; occluded && blockX <= lastX / blockSize; blockX++)
+		{
+			if (_blockDepths[blockY * _blocksAcross + blockX] < nearestDepth)
+			{
+				continue;
+			}
+			int32_t endX = std::min(lastX, blockX * blockSize + blockSize - 1);
+			int32_t endY = std::min(lastY, blockY * blockSize + blockSize - 1);
+			for (int32_t y = std::max(firstY, blockY * blockSize); occluded && y <= endY; y++)
+			{
+				const float * row = _depthBuffer.data() + static_cast<size_t>(y) * _width;
+				for (int32_t x = std::max(firstX, blockX * blockSize); x <= endX; x++)
+				{
+					if (row[x] >= nearestDepth)
+					{
+						occluded = false;
+						break;
+					}
+				}
+			}
+		}
+	}
+	if (occluded)
+	{
+		_statistics.NodesOccluded++;
+	}
+	_statistics.TestTime += MicrosecondsSince(start);
+	return occluded;
+}
+
+void OcclusionCuller::DrawTriangle(const Vector4& vertex0, const Vector4& vertex1, const Vector4& vertex2)
+{
+	Vector4 polygons[2][MAXIMUM_CLIPPED_VERTICES] = { { vertex0, vertex1, vertex2 } };
+	Vector4 * input = polygons[0];
+	Vector4 * output = polygons[1];
+	int inputCount = 3;
+	for (int plane = 0; plane < CLIP_PLANES && inputCount >= 3; plane++)
+	{
+		bool inside = true;
+		for (int i = 0; i < inputCount && inside; i++)
+		{
+			inside = PlaneDistance(input[i], plane) >= 0.0f;
+		}
+		if (inside)
+		{
+			continue;
+		}
+		int outputCount = 0;
+		for (int i = 0; i < inputCount; i++)
+		{
+			const Vector4& current = input[i];
+			const Vector4& next = input[(i + 1) % inputCount];
+			float currentDistance = PlaneDistance(current, plane);
+			float nextDistance = PlaneDistance(next, plane);
+			if (currentDistance >= 0.0f)
+			{
+				output[outputCount++] = current;
+			}
+			if ((currentDistance >= 0.0f) != (nextDistance >= 0.0f))
+			{
+				float t = currentDistance / (currentDistance - nextDistance);
+				output[outputCount++] = Vector4(current.x + t * (next.x - current.x), current.y + t * (next.y - current.y),
+												current.z + t * (next.z - current.z), current.w + t * (next.w - current.w));
+			}
+		}
+		std::swap(input, output);
+		inputCount = outputCount;
+	}
+
+	float x[MAXIMUM_CLIPPED_VERTICES];
+	float y[MAXIMUM_CLIPPED_VERTICES];
+	float z[MAXIMUM_CLIPPED_VERTICES];
+	for (int i = 0; i < inputCount; i++)
+	{
+		float inverseW = 1.0f / input[i].w;
+		x[i] = (input[i].x * inverseW * 0.5f + 0.5f) * _width;
+		y[i] = (0.5f - input[i].y * inverseW * 0.5f) * _height;
+		z[i] = input[i].z * inverseW;
+	}
+	for (int i = 1; i + 1 < inputCount; i++)
+	{
+		const float triangleX[3] = { x[0], x[i], x[i + 1] };
+		const float triangleY[3] = { y[0], y[i], y[i + 1] };
+		const float triangleZ[3] = { z[0], z[i], z[i + 1] };
+		RasterizeTriangle(triangleX, triangleY, triangleZ);
+	}
+}
+
+void OcclusionCuller::RasterizeTriangle(const float x[3], const float y[3], const float z[3])
+{
+	// Occluders are drawn from both sides, so put the vertices in clockwise order
+	int first = 0;
+	int second = 1;
+	int third = 2;
+	float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+	if (area < 0.0f)
+	{
+		std::swap(second, third);
+		area = -area;
+	}
+	if (area < 1e-6f)
+	{
+		return;
+	}
+	const int order[3] = { first, second, third };
+
+	// Only pixels that are completely inside the triangle are covered.  A pixel is completely
+	// inside an edge if the edge function at its centre is at least half the sum of its gradients.
+	float edgeX[3];
+	float edgeY[3];
+	float edgeConstant[3];
+	for (int i = 0; i < 3; i++)
+	{
+		int a = order[i];
+		int b = order[(i + 1) % 3];
+		edgeX[i] = y[a] - y[b];
+		edgeY[i] = x[b] - x[a];
+		edgeConstant[i] = -(edgeX[i] * x[a] + edgeY[i] * y[a]) - 0.5f * (fabsf(edgeX[i]) + fabsf(edgeY[i]));
+	}
+
+	// Each pixel is given the farthest depth of the triangle within it
+	float depthX = ((z[order[1]] - z[order[0]]) * (y[order[2]] - y[order[0]]) - (z[order[2]] - z[order[0]]) * (y[order[1]] - y[order[0]])) / area;
+	float depthY = ((z[order[2]] - z[order[0]]) * (x[order[1]] - x[order[0]]) - (z[order[1]] - z[order[0]]) * (x[order[2]] - x[order[0]])) / area;
+	float depthConstant = z[order[0]] - depthX * x[order[0]] - depthY * y[order[0]] + 0.5f * (fabsf(depthX) + fabsf(depthY));
+
+	int32_t firstX = std::max(static_cast<int32_t>(std::ceil(std::min({ x[0], x[1], x[2] }))), 0);
+	int32_t firstY = std::max(static_cast<int32_t>(std::ceil(std::min({ y[0], y[1], y[2] }))), 0);
+	int32_t lastX = std::min(static_cast<int32_t>(std::floor(std::max({ x[0], x[1], x[2] }))) - 1, static_cast<int32_t>(_width) - 1);
+	int32_t lastY = std::min(static_cast<int32_t>(std::floor(std::max({ y[0], y[1], y[2] }))) - 1, static_cast<int32_t>(_height) - 1);
+	if (firstX > lastX || firstY > lastY)
+	{
+		return;
+	}
+	_statistics.OccluderTriangles++;
+
+#if defined(OCCLUSION_X86)
+	// Four pixels at a time.  Rows are a multiple of four pixels long, and pixels outside the
+	// triangle's bounds always fail the edge tests, so each row starts on a multiple of four.
+	const __m128 laneCentres = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 cleared = _mm_set1_ps(1.0f);
+	const __m128 edgeStepX[3] = { _mm_set1_ps(edgeX[0]), _mm_set1_ps(edgeX[1]), _mm_set1_ps(edgeX[2]) };
+	const __m128 depthStepX = _mm_set1_ps(depthX);
+	int32_t alignedFirstX = firstX & ~3;
+	for (int32_t row = firstY; row <= lastY; row++)
+	{
+		float centreY = row + 0.5f;
+		__m128 edgeRow[3];
+		for (int i = 0; i < 3; i++)
+		{
+			edgeRow[i] = _mm_set1_ps(edgeY[i] * centreY + edgeConstant[i]);
+		}
+		__m128 depthRow = _mm_set1_ps(depthY * centreY + depthConstant);
+		float * depths = _depthBuffer.data() + static_cast<size_t>(row) * _width;
+		for (int32_t column = alignedFirstX; column <= lastX; column += 4)
+		{
+			__m128 centreX = _mm_add_ps(_mm_set1_ps(static_cast<float>(column)), laneCentres);
+			__m128 inside = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeStepX[0], centreX), edgeRow[0]), zero);
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeStepX[1], centreX), edgeRow[1]), zero));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeStepX[2], centreX), edgeRow[2]), zero));
+			if (_mm_movemask_ps(inside) == 0)
+			{
+				continue;
+			}
+			__m128 depth = _mm_add_ps(_mm_mul_ps(depthStepX, centreX), depthRow);
+			depth = _mm_or_ps(_mm_and_ps(inside, depth), _mm_andnot_ps(inside, cleared));
+			_mm_storeu_ps(depths + column, _mm_min_ps(_mm_loadu_ps(depths + column), depth));
+		}
+	}
+#else
+	for (int32_t row = firstY; row <= lastY; row++)
+	{
+		float centreY = row + 0.5f;
+		float * depths = _depthBuffer.data() + static_cast<size_t>(row) * _width;
+		for (int32_t column = firstX; column <= lastX; column++)
+		{
+			float centreX = column + 0.5f;
+			if (edgeX[0] * centreX + edgeY[0] * centreY + edgeConstant[0] >= 0.0f &&
+				edgeX[1] * centreX + edgeY[1] * centreY + edgeConstant[1] >= 0.0f &&
+				edgeX[2] * centreX + edgeY[2] * centreY + edgeConstant[2] >= 0.0f)
+			{
+				depths[column] = std::min(depths[column], depthX * centreX + depthY * centreY + depthConstant);
+			}
+		}
+	}
+#endif
+}
+
+void OcclusionCuller::BuildBlockDepths()
+{
+	for (uint32_t blockY = 0; blockY < _blocksDown; blockY++)
+	{
+		for (uint32_t blockX = 0; blockX < _blocksAcross; blockX++)
+		{
+			const float * depths = _depthBuffer.data() + static_cast<size_t>(blockY) * BLOCK_SIZE * _width + blockX * BLOCK_SIZE;
+#if defined(OCCLUSION_X86)
+			__m128 farthest = _mm_setzero_ps();
+			for (uint32_t row = 0; row < BLOCK_SIZE; row++, depths += _width)
+			{
+				for (uint32_t column = 0; column < BLOCK_SIZE; column += 4)
+				{
+					farthest = _mm_max_ps(farthest, _mm_loadu_ps(depths + column));
+				}
+			}
+			farthest = _mm_max_ps(farthest, _mm_shuffle_ps(farthest, farthest, _MM_SHUFFLE(1, 0, 3, 2)));
+			farthest = _mm_max_ps(farthest, _mm_shuffle_ps(farthest, farthest, _MM_SHUFFLE(2, 3, 0, 1)));
+			_blockDepths[blockY * _blocksAcross + blockX] = _mm_cvtss_f32(farthest);
+#else
+			float farthest = 0.0f;
+			for (uint32_t row = 0; row < BLOCK_SIZE; row++, depths += _width)
+			{
+				farthest = std::max(farthest, *std::max_element(depths, depths + BLOCK_SIZE));
+			}
+			_blockDepths[blockY * _blocksAcross + blockX] = farthest;
+#endif
+		}
+	}
+}
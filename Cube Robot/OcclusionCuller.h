@@ -0,0 +1,86 @@
+#pragma once
+#include "DirectXCore.h"
+#include <memory>
+#include <vector>
+
+class SceneNode;
+
+// What the occlusion culler did in the last frame.  The times are in microseconds.
+
+struct OcclusionStatistics
+{
+	size_t		OccluderTriangles{ 0 };			// Occluder triangles drawn into the depth buffer
+	size_t		NodesTested{ 0 };
+	size_t		NodesOccluded{ 0 };				// Nodes (or whole subtrees) found to be hidden
+	double		RasterizeTime{ 0.0 };			// Time taken to draw the occluders and build the hierarchical depth
+	double		TestTime{ 0.0 };				// Total time taken by the calls to IsOccluded
+};
+
+// Culls nodes that are hidden behind other geometry, entirely on the CPU.
+//
+// Each frame, BeginFrame draws the occluders (simple meshes that stand in for large, solid
+// objects such as walls) into a small depth buffer, four pixels at a time with SSE.  It then
+// records the farthest depth in each block of BLOCK_SIZE x BLOCK_SIZE pixels.  IsOccluded
+// projects a bounding sphere onto the screen and compares its nearest depth with the blocks it
+// covers, only looking at individual pixels for blocks that are not completely in front of it.
+//
+// The test is conservative: occluders only cover the pixels they cover completely, at the
+// farthest depth they reach in each pixel, so a node is never culled if any part of it could
+// be seen.  Occluders are drawn from both sides.  Depths are as in Direct3D (0 at the near
+// plane, 1 at the far plane).
+//
+// SceneGraph::SetOcclusionCuller makes the scene graph test each node with IsOccluded before
+// it is drawn.
+
+class OcclusionCuller
+{
+public:
+	static constexpr uint32_t DEFAULT_WIDTH = 256;
+	static constexpr uint32_t DEFAULT_HEIGHT = 128;
+	static constexpr uint32_t BLOCK_SIZE = 8;
+
+	// The width and height are rounded up to a multiple of BLOCK_SIZE
+	OcclusionCuller(uint32_t width = DEFAULT_WIDTH, uint32_t height = DEFAULT_HEIGHT);
+
+	// Use the triangles given as an occluder.  The vertices are in the coordinate space of the
+	// node, and the node's world transformation is used to place them each frame.
+	void AddOccluder(std::shared_ptr<SceneNode> node, const std::vector<Vector3>& vertices, const std::vector<uint32_t>& indices);
+	void RemoveOccluder(const SceneNode * node);
+	inline size_t GetOccluderCount() const { return _occluders.size(); }
+
+	// Draw the occluders.  This should be called each frame after SceneGraph::Update and before SceneGraph::Render.
+	void BeginFrame(const Matrix& viewProjectionTransformation);
+
+	// Returns true if everything inside the bounds (in world space) is hidden behind the occluders
+	bool IsOccluded(const BoundingSphere& bounds);
+
+	inline const OcclusionStatistics& GetStatistics() const { return _statistics; }
+
+	inline uint32_t GetWidth() const { return _width; }
+	inline uint32_t GetHeight() const { return _height; }
+	inline const std::vector<float>& GetDepthBuffer() const { return _depthBuffer; }
+
+private:
+	struct Occluder
+	{
+		std::shared_ptr<SceneNode>	Node;
+		std::vector<Vector3>		Vertices;
+		std::vector<uint32_t>		Indices;
+	};
+
+	uint32_t					_width;
+	uint32_t					_height;
+	uint32_t					_blocksAcross;
+	uint32_t					_blocksDown;
+	std::vector<Occluder>		_occluders;
+	std::vector<float>			_depthBuffer;
+	std::vector<float>			_blockDepths;			// The farthest depth in each block
+	std::vector<Vector4>		_clipVertices;
+	Matrix						_viewProjectionTransformation;
+	bool						_hasOccluders{ false };	// Whether anything was drawn by the last BeginFrame
+	OcclusionStatistics			_statistics;
+
+	void DrawTriangle(const Vector4& vertex0, const Vector4& vertex1, const Vector4& vertex2);
+	void RasterizeTriangle(const float x[3], const float y[3], const float z[3]);
+	void BuildBlockDepths();
+};
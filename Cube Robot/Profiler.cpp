@@ -0,0 +1,162 @@
+#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+
+std::atomic<bool> Profiler::_enabled{ false };
+std::atomic<uint64_t> Profiler::_frameNumber{ 0 };
+thread_local const char * Profiler::_currentZone = nullptr;
+thread_local uint64_t Profiler::_threadFrameNumber = Profiler::MAIN_LOOP_FRAME;
+
+// Every buffer that has been created, and the names given to the threads that own them
+struct ProfileThreads
+{
+	std::mutex									Mutex;
+	std::vector<std::unique_ptr<ProfileBuffer>>	Buffers;
+	std::vector<std::string>					Names;
+	size_t										Capacity{ Profiler::DEFAULT_BUFFER_CAPACITY };
+};
+
+ProfileThreads& GetProfileThreads()
+{
+	static ProfileThreads threads;
+	return threads;
+}
+
+const std::chrono::steady_clock::time_point profilerStart = std::chrono::steady_clock::now();
+thread_local ProfileBuffer *	currentThreadBuffer = nullptr;
+thread_local std::string		currentThreadName;
+
+ProfileBuffer::ProfileBuffer(uint32_t threadId, size_t capacity)
+	: _slots(new Slot[std::max<size_t>(capacity, 1)]), _capacity(std::max<size_t>(capacity, 1)), _threadId(threadId)
+{
+}
+
+void ProfileBuffer::Read(std::vector<ProfileEvent>& events) const
+{
+	uint64_t written = _written.load(std::memory_order_acquire);
+	uint64_t first = written > _capacity ? written - _capacity : 0;
+	size_t start = events.size();
+	for (uint64_t i = first; i < written; i++)
+	{
+		const Slot& slot = _slots[i % _capacity];
+		events.push_back(ProfileEvent{ slot.Name.load(std::memory_order_relaxed), slot.Start.load(std::memory_order_relaxed),
+									   slot.End.load(std::memory_order_relaxed), slot.Frame.load(std::memory_order_relaxed) });
+	}
+
+	// The owning thread may have gone on writing while the zones were copied.  Zone i shares its slot
+	// with zone i + capacity, so if that zone (or a later one) has been started, zone i may have been
+	// copied part way through being overwritten and is dropped.  The fence makes sure that if any part
+	// of a newer zone was copied, the count of zones started is seen to include it.
+	std::atomic_thread_fence(std::memory_order_acquire);
+	uint64_t started = _started.load(std::memory_order_relaxed);
+	if (started > first + _capacity)
+	{
+		size_t overwritten = static_cast<size_t>(std::min(started - first - _capacity, written - first));
+		events.erase(events.begin() + start, events.begin() + start + overwritten);
+	}
+}
+
+void Profiler::SetEnabled(bool enabled)
+{
+	_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+uint64_t Profiler::Now()
+{
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - profilerStart).count());
+}
+
+void Profiler::SetThreadName(const std::string& name)
+{
+	currentThreadName = name;
+	if (currentThreadBuffer != nullptr)
+	{
+		ProfileThreads& threads = GetProfileThreads();
+		std::lock_guard<std::mutex> lock(threads.Mutex);
+		threads.Names[currentThreadBuffer->GetThreadId()] = name;
+	}
+}
+
+void Profiler::SetBufferCapacity(size_t capacity)
+{
+	ProfileThreads& threads = GetProfileThreads();
+	std::lock_guard<std::mutex> lock(threads.Mutex);
+	threads.Capacity = capacity;
+}
+
+ProfileBuffer& Profiler::GetThreadBuffer()
+{
+	if (currentThreadBuffer == nullptr)
+	{
+		ProfileThreads& threads = GetProfileThreads();
+		std::lock_guard<std::mutex> lock(threads.Mutex);
+		uint32_t threadId = static_cast<uint32_t>(threads.Buffers.size());
+		threads.Buffers.push_back(std::make_unique<ProfileBuffer>(threadId, threads.Capacity));
+		threads.Names.push_back(currentThreadName.empty() ? "Thread " + std::to_string(threadId) : currentThreadName);
+		currentThreadBuffer = threads.Buffers.back().get();
+	}
+	return *currentThreadBuffer;
+}
+
+// Zone names are identifiers and the like, but quotes and backslashes would break the JSON
+
+void WriteJsonString(std::ostream& stream, const char * text)
+{
+	stream << '"';
+	for (const char * character = text; *character != '\0'; character++)
+	{
+		if (*character == '"' || *character == '\\')
+		{
+			stream << '\\';
+		}
+		if (static_cast<unsigned char>(*character) >= ' ')
+		{
+			stream << *character;
+		}
+	}
+	stream << '"';
+}
+
+bool Profiler::WriteChromeTrace(const std::string& fileName, uint64_t firstFrame, uint64_t lastFrame)
+{
+	std::ofstream trace(fileName);
+	if (!trace)
+	{
+		return false;
+	}
+
+	// Times in a Chrome trace are in microseconds
+	trace << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+	trace.setf(std::ios::fixed);
+	trace.precision(3);
+	bool first = true;
+	ProfileThreads& threads = GetProfileThreads();
+	std::lock_guard<std::mutex> lock(threads.Mutex);
+	std::vector<ProfileEvent> events;
+	for (const std::unique_ptr<ProfileBuffer>& buffer : threads.Buffers)
+	{
+		uint32_t threadId = buffer->GetThreadId();
+		trace << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << threadId << ",\"args\":{\"name\":";
+		WriteJsonString(trace, threads.Names[threadId].c_str());
+		trace << "}}";
+		first = false;
+
+		events.clear();
+		buffer->Read(events);
+		for (const ProfileEvent& event : events)
+		{
+			if (event.Frame < firstFrame || event.Frame > lastFrame)
+			{
+				continue;
+			}
+			trace << ",\n{\"name\":";
+			WriteJsonString(trace, event.Name);
+			trace << ",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":" << threadId << ",\"ts\":" << event.Start / 1000.0
+				  << ",\"dur\":" << (event.End - event.Start) / 1000.0 << ",\"args\":{\"frame\":" << event.Frame << "}}";
+		}
+	}
+	trace << "\n]}\n";
+	return static_cast<bool>(trace);
+}
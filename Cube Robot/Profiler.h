@@ -0,0 +1,185 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// A lightweight CPU profiler.
+//
+// Code to be measured is marked with PROFILE_ZONE, which times the rest of the enclosing scope:
+//
+//		void SceneGraph::Update(const Matrix& worldTransformation)
+//		{
+//			PROFILE_ZONE("SceneGraph::Update");
+//			...
+//
+// Zone names must be string literals (or otherwise live for as long as the program), since only the
+// pointer is stored.  While the profiler is disabled, a zone costs a single check of a flag.  While
+// it is enabled, the start and end of each zone are read from a nanosecond clock and the zone is
+// written to a ring buffer belonging to the thread that ran it, so threads never wait for each
+// other.  Once a buffer is full, the oldest zones in it are overwritten.
+//
+// While the profiler is enabled, each thread also keeps track of the innermost zone it is in (see
+// GetCurrentZone), so that the allocation tracker can say which zone made an allocation.
+//
+// Each zone is tagged with the number of the frame that the main loop was on when the zone started
+// (see BeginFrame), or, on a thread working on an earlier frame such as the render thread, the frame
+// it is working on (see SetThreadFrameNumber).  A range of frames can then be written out as a Chrome
+// trace and viewed with chrome://tracing or https://ui.perfetto.dev.  Nested zones are shown nested in
+// the trace.
+//
+// Defining PROFILER_DISABLED removes the zones completely.
+
+struct ProfileEvent
+{
+	const char *	Name;
+	uint64_t		Start;			// Nanoseconds since the profiler started
+	uint64_t		End;
+	uint64_t		Frame;
+};
+
+// The zones recorded by one thread.  Only the owning thread writes to the buffer.  Other threads can
+// read it at any time, but a zone that is overwritten while it is being read is discarded.  This works
+// like a sequence lock: the count of zones started is raised before a slot is written and the count
+// written after, so a reader can tell which of the zones it copied may have changed under it.
+
+class ProfileBuffer
+{
+public:
+	ProfileBuffer(uint32_t threadId, size_t capacity);
+
+	ProfileBuffer(const ProfileBuffer&) = delete;
+	ProfileBuffer& operator=(const ProfileBuffer&) = delete;
+
+	inline void Record(const ProfileEvent& event)
+	{
+		uint64_t written = _written.load(std::memory_order_relaxed);
+		_started.store(written + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		Slot& slot = _slots[written % _capacity];
+		slot.Name.store(event.Name, std::memory_order_relaxed);
+		slot.Start.store(event.Start, std::memory_order_relaxed);
+		slot.End.store(event.End, std::memory_order_relaxed);
+		slot.Frame.store(event.Frame, std::memory_order_relaxed);
+		_written.store(written + 1, std::memory_order_release);
+	}
+
+	// Append the zones still in the buffer, oldest first, to events
+	void Read(std::vector<ProfileEvent>& events) const;
+
+	inline uint32_t GetThreadId() const { return _threadId; }
+	inline size_t GetCapacity() const { return _capacity; }
+	inline uint64_t GetWrittenCount() const { return _written.load(std::memory_order_acquire); }
+
+private:
+	// A ProfileEvent whose fields can be read while the owning thread writes them
+	struct Slot
+	{
+		std::atomic<const char *>	Name;
+		std::atomic<uint64_t>		Start;
+		std::atomic<uint64_t>		End;
+		std::atomic<uint64_t>		Frame;
+	};
+
+	std::unique_ptr<Slot[]>			_slots;
+	size_t							_capacity;
+	std::atomic<uint64_t>			_started{ 0 };
+	std::atomic<uint64_t>			_written{ 0 };
+	uint32_t						_threadId;
+};
+
+class Profiler
+{
+public:
+	static void SetEnabled(bool enabled);
+	static inline bool IsEnabled() { return _enabled.load(std::memory_order_relaxed); }
+
+	// Nanoseconds since the profiler started
+	static uint64_t Now();
+
+	// Called by the main loop at the start of each frame
+	static inline void BeginFrame() { _frameNumber.fetch_add(1, std::memory_order_relaxed); }
+
+	// The frame that zones started by the calling thread are tagged with.  This is the main loop's
+	// frame, unless the thread has set the frame it is working on with SetThreadFrameNumber.
+	static inline uint64_t GetFrameNumber() { return _threadFrameNumber != MAIN_LOOP_FRAME ? _threadFrameNumber : _frameNumber.load(std::memory_order_relaxed); }
+
+	// Tag the zones started by the calling thread with frame, rather than the frame the main loop is on.
+	// Passing MAIN_LOOP_FRAME goes back to following the main loop.
+	static inline void SetThreadFrameNumber(uint64_t frame) { _threadFrameNumber = frame; }
+
+	// The innermost zone that the calling thread is in, or nullptr if it is not in one or the profiler
+	// was disabled when the zone started
+	static inline const char * GetCurrentZone() { return _currentZone; }
+	static inline void SetCurrentZone(const char * name) { _currentZone = name; }
+
+	// Name the calling thread in the trace
+	static void SetThreadName(const std::string& name);
+
+	// The number of zones held by the buffer of each thread that starts recording after this is called
+	static void SetBufferCapacity(size_t capacity);
+
+	// The calling thread's buffer, which is created the first time it is asked for.  Buffers are kept
+	// after their threads finish, so that their zones can still be written out.
+	static ProfileBuffer& GetThreadBuffer();
+
+	// Write every zone still held that started in a frame from firstFrame to lastFrame, inclusive, as a
+	// Chrome trace.  Returns false if the file cannot be written.
+	static bool WriteChromeTrace(const std::string& fileName, uint64_t firstFrame, uint64_t lastFrame);
+
+	static constexpr size_t DEFAULT_BUFFER_CAPACITY = 65536;
+	static constexpr uint64_t MAIN_LOOP_FRAME = UINT64_MAX;
+
+private:
+	static std::atomic<bool>		_enabled;
+	static std::atomic<uint64_t>	_frameNumber;
+	static thread_local const char *	_currentZone;
+	static thread_local uint64_t		_threadFrameNumber;
+};
+
+// Times the scope it is declared in.  Use PROFILE_ZONE rather than creating these directly.
+
+class ProfileZone
+{
+public:
+	inline ProfileZone(const char * name)
+	{
+		if (Profiler::IsEnabled())
+		{
+			_name = name;
+			_parent = Profiler::GetCurrentZone();
+			Profiler::SetCurrentZone(name);
+			_frame = Profiler::GetFrameNumber();
+			_start = Profiler::Now();
+		}
+	}
+
+	inline ~ProfileZone()
+	{
+		if (_name != nullptr)
+		{
+			uint64_t end = Profiler::Now();
+			Profiler::GetThreadBuffer().Record(ProfileEvent{ _name, _start, end, _frame });
+			Profiler::SetCurrentZone(_parent);
+		}
+	}
+
+	ProfileZone(const ProfileZone&) = delete;
+	ProfileZone& operator=(const ProfileZone&) = delete;
+
+private:
+	const char *	_name{ nullptr };
+	const char *	_parent{ nullptr };
+	uint64_t		_start{ 0 };
+	uint64_t		_frame{ 0 };
+};
+
+#define PROFILE_ZONE_VARIABLE_NAME(line) profileZone##line
+#define PROFILE_ZONE_VARIABLE(line) PROFILE_ZONE_VARIABLE_NAME(line)
+
+#if defined( PROFILER_DISABLED )
+#define PROFILE_ZONE(name)
+#else
+#define PROFILE_ZONE(name) ProfileZone PROFILE_ZONE_VARIABLE(__LINE__)(name)
+#endif
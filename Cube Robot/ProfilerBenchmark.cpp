@@ -0,0 +1,384 @@
+#include "ProfilerBenchmark.h"
+#include "BenchmarkFixtures.h"
+#include "FramePipeline.h"
+#include "Profiler.h"
+#include "SceneGraph.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <thread>
+
+using namespace std;
+
+// Number of zones timed when measuring the cost of a zone
+constexpr int PROFILER_BENCHMARK_ZONES = 10000000;
+
+// The scene updated and culled with and without profiling
+constexpr size_t PROFILER_BENCHMARK_GROUPS = 100;
+constexpr size_t PROFILER_BENCHMARK_NODES_PER_GROUP = 100;
+constexpr int PROFILER_BENCHMARK_FRAMES = 200;
+
+// Frames recorded when checking the trace, and the range of them written to it
+constexpr uint64_t PROFILER_CHECK_FRAMES = 10;
+constexpr uint64_t PROFILER_CHECK_FIRST_TRACED = 3;
+constexpr uint64_t PROFILER_CHECK_LAST_TRACED = 6;
+constexpr int PROFILER_CHECK_TASKS = 8;
+
+// The capacity of the buffer used to check that the oldest zones are overwritten, and the number of zones written to it
+constexpr size_t PROFILER_RING_CAPACITY = 100;
+constexpr uint64_t PROFILER_RING_ZONES = 250;
+
+// The number of zones written while another thread reads the same buffer
+constexpr uint64_t PROFILER_CONCURRENT_ZONES = 2000000;
+
+// Frames submitted on a render thread while the main loop moves on to the next frame
+constexpr uint64_t PROFILER_PIPELINE_FRAMES = 20;
+
+// A node that is timed when it is drawn, as the nodes that draw cubes are
+
+class ProfiledBenchmarkNode : public BenchmarkNode
+{
+public:
+	ProfiledBenchmarkNode(wstring name) : BenchmarkNode(name) {}
+
+	void Render() { PROFILE_ZONE("ProfiledBenchmarkNode::Render"); }
+};
+
+// Something for the zones being timed to do, so that the loop is not optimised away
+
+volatile uint64_t profiledWork = 0;
+
+void DoProfiledWork()
+{
+	profiledWork = profiledWork + 1;
+}
+
+void DoProfiledZone()
+{
+	PROFILE_ZONE("DoProfiledZone");
+	profiledWork = profiledWork + 1;
+}
+
+// A zone read back from a trace written by Profiler::WriteChromeTrace.  Each zone is on a line of its own.
+
+struct TracedZone
+{
+	string		Name;
+	uint32_t	ThreadId;
+	double		Start;
+	double		Duration;
+	uint64_t	Frame;
+};
+
+// The text following key in line, up to the next comma, quote or brace
+
+string TraceValue(const string& line, const string& key)
+{
+	size_t start = line.find(key);
+	if (start == string::npos)
+	{
+		return string();
+	}
+	start += key.size();
+	size_t end = line.find_first_of(",\"}", start);
+	return line.substr(start, end - start);
+}
+
+vector<TracedZone> ReadTracedZones(const string& traceFileName)
+{
+	vector<TracedZone> zones;
+	ifstream trace(traceFileName);
+	string line;
+	while (getline(trace, line))
+	{
+		if (line.find("\"ph\":\"X\"") == string::npos)
+		{
+			continue;
+		}
+		TracedZone zone;
+		zone.Name = TraceValue(line, "\"name\":\"");
+		zone.ThreadId = static_cast<uint32_t>(stoul(TraceValue(line, "\"tid\":")));
+		zone.Start = stod(TraceValue(line, "\"ts\":"));
+		zone.Duration = stod(TraceValue(line, "\"dur\":"));
+		zone.Frame = stoull(TraceValue(line, "\"frame\":"));
+		zones.push_back(zone);
+	}
+	return zones;
+}
+
+// Time the updating and culling of the scene for PROFILER_BENCHMARK_FRAMES frames, in nanoseconds per frame
+
+double TimeProfiledFrames(SceneGraph& sceneGraph, vector<SceneNodePointer>& movers)
+{
+	Matrix identity;
+	auto start = chrono::steady_clock::now();
+	for (int frame = 0; frame < PROFILER_BENCHMARK_FRAMES; frame++)
+	{
+		for (SceneNodePointer& mover : movers)
+		{
+			mover->SetWorldTransform(Matrix::CreateTranslation(Vector3(static_cast<float>(frame), 0.0f, 0.0f)));
+		}
+		sceneGraph.Update(identity);
+		sceneGraph.Render();
+	}
+	double nanoseconds = static_cast<double>(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count());
+	return nanoseconds / PROFILER_BENCHMARK_FRAMES;
+}
+
+int RunProfilerBenchmarks(const std::string& resultsFileName, const std::string& traceFileName)
+{
+	ofstream results(resultsFileName);
+	if (!results)
+	{
+		return -1;
+	}
+	bool wasEnabled = Profiler::IsEnabled();
+
+	// The cost of a zone, over and above the work inside it
+	auto nanosecondsPerCall = [](void (*function)())
+	{
+		auto start = chrono::steady_clock::now();
+		for (int i = 0; i < PROFILER_BENCHMARK_ZONES; i++)
+		{
+			function();
+		}
+		return static_cast<double>(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count()) / PROFILER_BENCHMARK_ZONES;
+	};
+	double baseline = nanosecondsPerCall(DoProfiledWork);
+	Profiler::SetEnabled(false);
+	double disabled = nanosecondsPerCall(DoProfiledZone);
+	Profiler::SetEnabled(true);
+	double enabled = nanosecondsPerCall(DoProfiledZone);
+	results << "benchmark,profiler,ns_per_zone" << endl;
+	results << "zone,disabled," << max(0.0, disabled - baseline) << endl;
+	results << "zone,enabled," << max(0.0, enabled - baseline) << endl;
+
+	// Every node in the scene is drawn each frame, and one in ten moves
+	results << "benchmark,nodes,profiler,ns_per_frame,zones_per_frame,overhead" << endl;
+	{
+		SceneGraphPointer sceneGraph = make_shared<SceneGraph>(L"Root");
+		vector<SceneNodePointer> movers;
+		for (size_t group = 0; group < PROFILER_BENCHMARK_GROUPS; group++)
+		{
+			SceneGraphPointer groupGraph = make_shared<SceneGraph>(L"Group" + to_wstring(group));
+			for (size_t i = 0; i < PROFILER_BENCHMARK_NODES_PER_GROUP; i++)
+			{
+				SceneNodePointer node = make_shared<ProfiledBenchmarkNode>(L"Node" + to_wstring(i));
+				if (i % 10 == 0)
+				{
+					movers.push_back(node);
+				}
+				groupGraph->Add(node);
+			}
+			sceneGraph->Add(groupGraph);
+		}
+		sceneGraph->DisableCulling();
+		size_t nodeCount = PROFILER_BENCHMARK_GROUPS * PROFILER_BENCHMARK_NODES_PER_GROUP;
+		Profiler::SetEnabled(false);
+		TimeProfiledFrames(*sceneGraph, movers);
+		double disabledFrame = TimeProfiledFrames(*sceneGraph, movers);
+		Profiler::SetEnabled(true);
+		uint64_t zonesBefore = Profiler::GetThreadBuffer().GetWrittenCount();
+		double enabledFrame = TimeProfiledFrames(*sceneGraph, movers);
+		uint64_t zonesPerFrame = (Profiler::GetThreadBuffer().GetWrittenCount() - zonesBefore) / PROFILER_BENCHMARK_FRAMES;
+		results << "scene," << nodeCount << ",disabled," << disabledFrame << ",0," << endl;
+		results << "scene," << nodeCount << ",enabled," << enabledFrame << "," << zonesPerFrame << "," << enabledFrame / disabledFrame - 1.0 << endl;
+	}
+
+	// Record nested zones on a thread pool over several frames, then write some of the frames out
+	bool allPassed = true;
+	results << "benchmark,threads,frames_traced,outer_zones,inner_zones,expected_outer_zones,expected_inner_zones,zones_outside_frames,unnested_zones,passes" << endl;
+	{
+		ThreadPool threadPool(4);
+		uint64_t firstFrame = Profiler::GetFrameNumber() + 1;
+		for (uint64_t frame = 0; frame < PROFILER_CHECK_FRAMES; frame++)
+		{
+			Profiler::BeginFrame();
+			for (int task = 0; task < PROFILER_CHECK_TASKS; task++)
+			{
+				threadPool.Submit([]()
+								  {
+									  PROFILE_ZONE("ProfilerCheckOuter");
+									  for (int inner = 0; inner < 2; inner++)
+									  {
+										  PROFILE_ZONE("ProfilerCheckInner");
+										  for (int i = 0; i < 1000; i++)
+										  {
+											  DoProfiledWork();
+										  }
+									  }
+								  });
+			}
+			threadPool.Wait();
+		}
+		uint64_t firstTraced = firstFrame + PROFILER_CHECK_FIRST_TRACED;
+		uint64_t lastTraced = firstFrame + PROFILER_CHECK_LAST_TRACED;
+		if (!Profiler::WriteChromeTrace(traceFileName, firstTraced, lastTraced))
+		{
+			Profiler::SetEnabled(wasEnabled);
+			return -1;
+		}
+
+		vector<TracedZone> zones = ReadTracedZones(traceFileName);
+		size_t outerZones = 0;
+		size_t innerZones = 0;
+		size_t zonesOutsideFrames = 0;
+		size_t unnestedZones = 0;
+		for (const TracedZone& zone : zones)
+		{
+			if (zone.Frame < firstTraced || zone.Frame > lastTraced)
+			{
+				zonesOutsideFrames++;
+			}
+			if (zone.Name == "ProfilerCheckOuter")
+			{
+				outerZones++;
+			}
+			else if (zone.Name == "ProfilerCheckInner")
+			{
+				// Each inner zone must lie within an outer zone on the same thread
+				innerZones++;
+				bool nested = false;
+				for (const TracedZone& outer : zones)
+				{
+					if (outer.Name == "ProfilerCheckOuter" && outer.ThreadId == zone.ThreadId && outer.Frame == zone.Frame
+						&& outer.Start <= zone.Start && zone.Start + zone.Duration <= outer.Start + outer.Duration)
+					{
+						nested = true;
+						break;
+					}
+				}
+				unnestedZones += nested ? 0 : 1;
+			}
+		}
+		size_t framesTraced = static_cast<size_t>(lastTraced - firstTraced + 1);
+		size_t expectedOuterZones = framesTraced * PROFILER_CHECK_TASKS;
+		bool passes = outerZones == expectedOuterZones && innerZones == expectedOuterZones * 2 && zonesOutsideFrames == 0 && unnestedZones == 0;
+		allPassed = allPassed && passes;
+		results << "trace," << threadPool.GetThreadCount() << "," << framesTraced << "," << outerZones << "," << innerZones << "," << expectedOuterZones << ","
+				<< expectedOuterZones * 2 << "," << zonesOutsideFrames << "," << unnestedZones << "," << (passes ? "yes" : "no") << endl;
+	}
+
+	// A thread with a small buffer should be left with only its most recent zones
+	results << "benchmark,capacity,zones_written,zones_kept,oldest_kept,newest_kept,passes" << endl;
+	{
+		Profiler::SetBufferCapacity(PROFILER_RING_CAPACITY);
+		vector<ProfileEvent> kept;
+		uint64_t written = 0;
+		thread ringThread([&]()
+						  {
+							  Profiler::SetThreadName("Ring check");
+							  ProfileBuffer& buffer = Profiler::GetThreadBuffer();
+							  for (uint64_t i = 0; i < PROFILER_RING_ZONES; i++)
+							  {
+								  buffer.Record(ProfileEvent{ "ProfilerRingCheck", i, i, 0 });
+							  }
+							  written = buffer.GetWrittenCount();
+							  buffer.Read(kept);
+						  });
+		ringThread.join();
+		Profiler::SetBufferCapacity(Profiler::DEFAULT_BUFFER_CAPACITY);
+		bool inOrder = true;
+		for (size_t i = 0; i < kept.size(); i++)
+		{
+			inOrder = inOrder && kept[i].Start == PROFILER_RING_ZONES - kept.size() + i;
+		}
+		bool passes = written == PROFILER_RING_ZONES && kept.size() == PROFILER_RING_CAPACITY && inOrder;
+		allPassed = allPassed && passes;
+		results << "ring_buffer," << PROFILER_RING_CAPACITY << "," << written << "," << kept.size() << ","
+				<< (kept.empty() ? 0 : kept.front().Start) << "," << (kept.empty() ? 0 : kept.back().Start) << "," << (passes ? "yes" : "no") << endl;
+	}
+
+	// Another thread reads a buffer while it is being written.  Each zone written has the same start,
+	// end and frame, so a zone that was copied part way through being overwritten would show up.
+	results << "benchmark,capacity,zones_written,reads,zones_read,torn_zones,out_of_order,passes" << endl;
+	{
+		Profiler::SetBufferCapacity(PROFILER_RING_CAPACITY);
+		atomic<bool> writing{ true };
+		ProfileBuffer * ringBuffer = nullptr;
+		atomic<bool> bufferReady{ false };
+		thread writer([&]()
+					  {
+						  Profiler::SetThreadName("Concurrent check");
+						  ringBuffer = &Profiler::GetThreadBuffer();
+						  bufferReady = true;
+						  for (uint64_t i = 0; i < PROFILER_CONCURRENT_ZONES; i++)
+						  {
+							  ringBuffer->Record(ProfileEvent{ "ProfilerConcurrentCheck", i, i, i });
+						  }
+						  writing = false;
+					  });
+		while (!bufferReady)
+		{
+			this_thread::yield();
+		}
+		Profiler::SetBufferCapacity(Profiler::DEFAULT_BUFFER_CAPACITY);
+		size_t reads = 0;
+		size_t zonesRead = 0;
+		size_t tornZones = 0;
+		size_t outOfOrder = 0;
+		vector<ProfileEvent> events;
+		do
+		{
+			events.clear();
+			ringBuffer->Read(events);
+			for (size_t i = 0; i < events.size(); i++)
+			{
+				tornZones += events[i].Start == events[i].End && events[i].Start == events[i].Frame ? 0 : 1;
+				outOfOrder += i == 0 || events[i].Start == events[i - 1].Start + 1 ? 0 : 1;
+			}
+			zonesRead += events.size();
+			reads++;
+		}
+		while (writing);
+		writer.join();
+		bool passes = tornZones == 0 && outOfOrder == 0 && ringBuffer->GetWrittenCount() == PROFILER_CONCURRENT_ZONES;
+		allPassed = allPassed && passes;
+		results << "concurrent_read," << PROFILER_RING_CAPACITY << "," << PROFILER_CONCURRENT_ZONES << "," << reads << "," << zonesRead << ","
+				<< tornZones << "," << outOfOrder << "," << (passes ? "yes" : "no") << endl;
+	}
+
+	// The render thread submits each frame after the main loop has moved on to the next one.  Its
+	// zones must be tagged with the frame that it is submitting.
+	results << "benchmark,frames,mistagged_frames,passes" << endl;
+	{
+		vector<uint64_t> filledFrames(PROFILER_PIPELINE_FRAMES);
+		vector<uint64_t> taggedFrames(PROFILER_PIPELINE_FRAMES);
+		atomic<uint64_t> mainLoopFrame{ Profiler::GetFrameNumber() };
+		{
+			FramePipeline pipeline(2,
+								   [&](FramePacket& packet)
+								   {
+									   while (mainLoopFrame == filledFrames[packet.FrameNumber])
+									   {
+										   this_thread::yield();
+									   }
+									   PROFILE_ZONE("ProfilerCheckSubmit");
+									   taggedFrames[packet.FrameNumber] = Profiler::GetFrameNumber();
+								   });
+			for (uint64_t frame = 0; frame < PROFILER_PIPELINE_FRAMES; frame++)
+			{
+				Profiler::BeginFrame();
+				mainLoopFrame = Profiler::GetFrameNumber();
+				FramePacket& packet = pipeline.BeginFrame();
+				filledFrames[packet.FrameNumber] = Profiler::GetFrameNumber();
+				pipeline.EndFrame();
+			}
+			Profiler::BeginFrame();
+			mainLoopFrame = Profiler::GetFrameNumber();
+			pipeline.Flush();
+		}
+		size_t mistaggedFrames = 0;
+		for (uint64_t frame = 0; frame < PROFILER_PIPELINE_FRAMES; frame++)
+		{
+			mistaggedFrames += taggedFrames[frame] == filledFrames[frame] ? 0 : 1;
+		}
+		bool passes = mistaggedFrames == 0;
+		allPassed = allPassed && passes;
+		results << "render_thread_frames," << PROFILER_PIPELINE_FRAMES << "," << mistaggedFrames << "," << (passes ? "yes" : "no") << endl;
+	}
+	Profiler::SetEnabled(wasEnabled);
+	return allPassed ? 0 : 1;
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include <string>
+
+// Benchmarks and checks for the profiler.  The cost of a zone is measured with the profiler disabled
+// and enabled, along with how much it slows down updating and culling a scene graph.  Then several
+// threads record nested zones over a number of frames, and the Chrome trace written for some of those
+// frames is checked to hold exactly the zones from those frames, with the nested zones inside the
+// zones that contain them.  A thread that records more zones than its buffer holds should keep only
+// the most recent ones, a buffer read while it is being written must never give a zone that was
+// overwritten part way through, and zones on the render thread must be tagged with the frame it is
+// submitting rather than the one the main loop is on.
+//
+// The results are written as comma-separated values to the file given, and the trace to traceFileName.
+
+int RunProfilerBenchmarks(const std::string& resultsFileName, const std::string& traceFileName);
@@ -0,0 +1,206 @@
+#include "RasterizerBenchmark.h"
+#include "SoftwareRasterizer.h"
+#include "SoftwareRenderDevice.h"
+#include "teapot.h"
+#include "MeshWelding.h"
+#include "VertexNormals.h"
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <thread>
+
+using namespace std;
+
+// Number of frames timed for each resolution and thread count.  The teapot turns a little each frame.
+constexpr int RASTERIZER_BENCHMARK_FRAMES = 10;
+
+// The scenes drawn: the teapot on its own, as in the sample, and a grid of smaller teapots
+constexpr uint32_t RASTERIZER_BENCHMARK_GRID_SIZE = 8;
+
+struct BenchmarkResolution
+{
+	uint32_t	Width;
+	uint32_t	Height;
+};
+
+// Build the teapot the way the sample does, scaled by 1.5.  Any vertices in the same place are welded
+// before the normal of each vertex is set from the normals of the triangles that use it, weighted by
+// their area, so that every triangle around a vertex counts towards its normal.
+
+WeldStatistics BuildTeapot(vector<Vertex>& vertices, vector<uint32_t>& indices)
+{
+	const float size = 1.5f;
+	for (size_t i = 0; i + 2 < ARRAYSIZE(teapotVertexFloats); i += 3)
+	{
+		Vertex vertex;
+		vertex.Position = Vector3(teapotVertexFloats[i] * size, teapotVertexFloats[i + 1] * size, teapotVertexFloats[i + 2] * size);
+		vertex.Normal = Vector3(0.0f, 0.0f, 0.0f);
+		vertices.push_back(vertex);
+	}
+	indices.assign(teapotIndices, teapotIndices + ARRAYSIZE(teapotIndices));
+
+	WeldStatistics statistics = MeshWelder().Weld(vertices, indices, 1e-5f, WeldAttributes::Position);
+	VertexNormalGenerator().Generate(vertices, indices);
+	return statistics;
+}
+
+// The constants for each teapot in a frame, lit and viewed as in the sample
+
+void BuildTeapotConstants(uint32_t width, uint32_t height, uint32_t gridSize, int frame, vector<CBuffer>& constants)
+{
+	Matrix view = XMMatrixLookAtLH(Vector3(0.0f, 0.0f, -10.0f), Vector3(0.0f, 0.0f, 0.0f), Vector3(0.0f, 1.0f, 0.0f));
+	Matrix projection = XMMatrixPerspectiveFovLH(XM_PIDIV4, static_cast<float>(width) / height, 1.0f, 100.0f);
+	Matrix rotation = Matrix::CreateRotationY(frame * 5.0f * XM_PI / 180.0f);
+	float scale = gridSize == 1 ? 1.0f : 1.0f / 3.0f;
+	constants.clear();
+	for (uint32_t row = 0; row < gridSize; row++)
+	{
+		for (uint32_t column = 0; column < gridSize; column++)
+		{
+			Vector3 position((column - (gridSize - 1) * 0.5f), (row - (gridSize - 1) * 0.5f), 0.0f);
+			CBuffer teapot;
+			teapot.World = Matrix::CreateScale(Vector3(scale, scale, scale)) * rotation * Matrix::CreateTranslation(position);
+			teapot.WorldViewProjection = teapot.World * view * projection;
+			teapot.MaterialColour = Vector4(1.0f, 0.0f, 1.0f, 1.0f);
+			teapot.AmbientLightColour = Vector4(0.5f, 0.5f, 0.5f, 1.0f);
+			teapot.DirectionalLightVector = Vector4(-1.0f, -1.0f, 1.0f, 0.0f);
+			teapot.DirectionalLightColour = Vector4(0.0f, 1.0f, 1.0f, 1.0f);
+			constants.push_back(teapot);
+		}
+	}
+}
+
+double SecondsSince(chrono::steady_clock::time_point start)
+{
+	return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+int RunRasterizerBenchmarks(const std::string& resultsFileName)
+{
+	ofstream results(resultsFileName);
+	if (!results)
+	{
+		return -1;
+	}
+
+	vector<Vertex> vertices;
+	vector<uint32_t> indices;
+	WeldStatistics welding = BuildTeapot(vertices, indices);
+	const uint32_t indexCount = static_cast<uint32_t>(indices.size());
+	const float background[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+
+	// Each scene is drawn on one thread and then on up to the number of hardware threads.  The
+	// last frame drawn with each thread count must match the one drawn on a single thread.
+	const BenchmarkResolution resolutions[] = { { 800, 600 }, { 3840, 2160 } };
+	unsigned int maximumThreads = max(thread::hardware_concurrency(), 1u);
+	bool imagesMatch = true;
+	bool imageSaved = false;
+	vector<CBuffer> constants;
+	results << "benchmark,width,height,teapots,threads,ms_per_frame,triangles_per_second,pixels_per_second,triangles_rasterized,pixels_shaded,matches_single_thread" << endl;
+	for (const BenchmarkResolution& resolution : resolutions)
+	{
+		for (uint32_t gridSize : { 1u, RASTERIZER_BENCHMARK_GRID_SIZE })
+		{
+			SoftwareRasterizer rasterizer(resolution.Width, resolution.Height);
+			vector<uint32_t> singleThreadImage;
+			for (unsigned int threads = 1; threads <= maximumThreads; threads *= 2)
+			{
+				ThreadPool threadPool(threads);
+				rasterizer.SetThreadPool(threads == 1 ? nullptr : &threadPool);
+				rasterizer.ResetStatistics();
+				double seconds = 0.0;
+				for (int frame = 0; frame < RASTERIZER_BENCHMARK_FRAMES; frame++)
+				{
+					BuildTeapotConstants(resolution.Width, resolution.Height, gridSize, frame, constants);
+					auto start = chrono::steady_clock::now();
+					rasterizer.Clear(background, 1.0f);
+					for (const CBuffer& teapot : constants)
+					{
+						rasterizer.DrawIndexed(vertices.data(), sizeof(Vertex), indices.data(), indexCount, teapot);
+					}
+					rasterizer.Flush();
+					seconds += SecondsSince(start);
+					if (!imageSaved)
+					{
+						imageSaved = rasterizer.SaveImage(L"RasterizerBenchmark.ppm");
+					}
+				}
+				bool matches = true;
+				if (threads == 1)
+				{
+					singleThreadImage = rasterizer.GetColourBuffer();
+				}
+				else
+				{
+					matches = rasterizer.GetColourBuffer() == singleThreadImage;
+				}
+				imagesMatch = imagesMatch && matches;
+				const RasterizerStatistics& statistics = rasterizer.GetStatistics();
+				results << "rasterizer," << resolution.Width << "," << resolution.Height << "," << constants.size() << "," << threads << ","
+						<< 1000.0 * seconds / RASTERIZER_BENCHMARK_FRAMES << "," << statistics.TrianglesSubmitted / seconds << ","
+						<< statistics.PixelsShaded / seconds << "," << statistics.TrianglesRasterized / RASTERIZER_BENCHMARK_FRAMES << ","
+						<< statistics.PixelsShaded / RASTERIZER_BENCHMARK_FRAMES << "," << (matches ? "yes" : "no") << endl;
+				rasterizer.SetThreadPool(nullptr);
+
+				// Make sure that the largest thread count is always measured
+				if (threads < maximumThreads && threads * 2 > maximumThreads)
+				{
+					threads = maximumThreads / 2;
+				}
+			}
+		}
+	}
+
+	// Drawing the grid through SoftwareRenderDevice, one draw at a time and then as a single
+	// instanced draw, must give the same image as drawing with the rasterizer directly
+	const BenchmarkResolution& resolution = resolutions[0];
+	SoftwareRasterizer reference(resolution.Width, resolution.Height);
+	BuildTeapotConstants(resolution.Width, resolution.Height, RASTERIZER_BENCHMARK_GRID_SIZE, 0, constants);
+	reference.Clear(background, 1.0f);
+	for (const CBuffer& teapot : constants)
+	{
+		reference.DrawIndexed(vertices.data(), sizeof(Vertex), indices.data(), indexCount, teapot);
+	}
+	reference.Flush();
+
+	SoftwareRenderDevice device(1, 1);
+	device.SetViewport(0.0f, 0.0f, static_cast<float>(resolution.Width), static_cast<float>(resolution.Height));
+	ResourceId vertexBuffer = device.CreateVertexBuffer(vertices.data(), vertices.size() * sizeof(Vertex));
+	ResourceId indexBuffer = device.CreateIndexBuffer(indices.data(), indices.size() * sizeof(uint32_t));
+	ResourceId constantBuffer = device.CreateConstantBuffer(sizeof(CBuffer));
+	ResourceId instanceBuffer = device.CreateDynamicVertexBuffer(constants.size() * offsetof(CBuffer, DirectionalLightColour));
+	device.SetPrimitiveTopology(PrimitiveTopology::TriangleList);
+	device.SetVertexBuffer(vertexBuffer, sizeof(Vertex));
+	device.SetIndexBuffer(indexBuffer);
+	device.SetConstantBuffer(0, constantBuffer);
+	device.Clear(background, 1.0f);
+	for (const CBuffer& teapot : constants)
+	{
+		device.UpdateConstantBuffer(constantBuffer, &teapot, sizeof(teapot));
+		device.DrawIndexed(indexCount, 0, 0);
+	}
+	device.GetRasterizer().Flush();
+	bool drawsMatch = device.GetRasterizer().GetColourBuffer() == reference.GetColourBuffer();
+
+	// As with the render queue, each instance holds the start of its constants, up to the lights.  The
+	// lights are the same for every teapot, so they are left in the constant buffer.
+	const size_t instanceSize = offsetof(CBuffer, DirectionalLightColour);
+	vector<char> instances(constants.size() * instanceSize);
+	for (size_t i = 0; i < constants.size(); i++)
+	{
+		memcpy(instances.data() + i * instanceSize, &constants[i], instanceSize);
+	}
+	device.SetInstanceBuffer(instanceBuffer, static_cast<uint32_t>(instanceSize));
+	device.UpdateVertexBuffer(instanceBuffer, instances.data(), instances.size());
+	device.Clear(background, 1.0f);
+	device.DrawIndexedInstanced(indexCount, static_cast<uint32_t>(constants.size()), 0, 0);
+	device.GetRasterizer().Flush();
+	bool instancesMatch = device.GetRasterizer().GetColourBuffer() == reference.GetColourBuffer();
+	results << "benchmark,teapots,draws_match,instanced_draws_match" << endl;
+	results << "software_device," << constants.size() << "," << (drawsMatch ? "yes" : "no") << "," << (instancesMatch ? "yes" : "no") << endl;
+	results << "benchmark,vertices_before,vertices_after,triangles_removed" << endl;
+	results << "teapot_welding," << welding.VerticesBefore << "," << welding.VerticesAfter << "," << welding.TrianglesRemoved << endl;
+	return imagesMatch && imageSaved && drawsMatch && instancesMatch ? 0 : 1;
+}
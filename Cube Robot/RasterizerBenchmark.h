@@ -0,0 +1,10 @@
+#pragma once
+#include <string>
+
+// Benchmarks for SoftwareRasterizer, drawing the teapot from the "Directional light on object"
+// sample with the lighting in shader.hlsl.
+//
+// The results are written as comma-separated values to the file given, and the first frame
+// drawn is saved as RasterizerBenchmark.ppm.
+
+int RunRasterizerBenchmarks(const std::string& resultsFileName);
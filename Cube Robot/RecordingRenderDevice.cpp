@@ -0,0 +1,181 @@
+#include "RecordingRenderDevice.h"
+#include "AllocationTracker.h"
+#include <cstring>
+
+ResourceId RecordingRenderDevice::CreateVertexBuffer(const void * data, size_t size)
+{
+	Hash(data, size);
+	return RecordCreate(RenderCommandType::CreateVertexBuffer, 0, size);
+}
+
+ResourceId RecordingRenderDevice::CreateIndexBuffer(const void * data, size_t size)
+{
+	Hash(data, size);
+	return RecordCreate(RenderCommandType::CreateIndexBuffer, 0, size);
+}
+
+ResourceId RecordingRenderDevice::CreateConstantBuffer(size_t size)
+{
+	return RecordCreate(RenderCommandType::CreateConstantBuffer, 0, size);
+}
+
+ResourceId RecordingRenderDevice::CreateDynamicVertexBuffer(size_t size)
+{
+	return RecordCreate(RenderCommandType::CreateDynamicVertexBuffer, 0, size);
+}
+
+ResourceId RecordingRenderDevice::CreateVertexShader(const void * bytecode, size_t size)
+{
+	Hash(bytecode, size);
+	return RecordCreate(RenderCommandType::CreateVertexShader, 0, size);
+}
+
+ResourceId RecordingRenderDevice::CreatePixelShader(const void * bytecode, size_t size)
+{
+	Hash(bytecode, size);
+	return RecordCreate(RenderCommandType::CreatePixelShader, 0, size);
+}
+
+ResourceId RecordingRenderDevice::CreateInputLayout(const VertexElement * elements, size_t elementCount, const void * vertexShaderBytecode, size_t size)
+{
+	for (size_t i = 0; i < elementCount; i++)
+	{
+		Hash(elements[i].SemanticName, strlen(elements[i].SemanticName) + 1);
+		Hash(&elements[i].SemanticIndex, sizeof(elements[i].SemanticIndex));
+		Hash(&elements[i].Format, sizeof(elements[i].Format));
+		Hash(&elements[i].PerInstance, sizeof(elements[i].PerInstance));
+	}
+	Hash(vertexShaderBytecode, size);
+	return RecordCreate(RenderCommandType::CreateInputLayout, static_cast<uint32_t>(elementCount), size);
+}
+
+void RecordingRenderDevice::ReleaseResource(ResourceId resource)
+{
+	if (resource != 0)
+	{
+		Record(RenderCommandType::ReleaseResource, resource, 0, 0);
+		_liveResourceCount--;
+	}
+}
+
+void RecordingRenderDevice::Clear(const float colour[4], float depth)
+{
+	Hash(colour, 4 * sizeof(float));
+	Hash(&depth, sizeof(depth));
+	Record(RenderCommandType::Clear, 0, 0, 0);
+}
+
+void RecordingRenderDevice::SetViewport(float x, float y, float width, float height)
+{
+	const float viewport[] = { x, y, width, height };
+	Hash(viewport, sizeof(viewport));
+	Record(RenderCommandType::SetViewport, 0, 0, 0);
+}
+
+void RecordingRenderDevice::SetPrimitiveTopology(PrimitiveTopology topology)
+{
+	Record(RenderCommandType::SetPrimitiveTopology, 0, static_cast<uint32_t>(topology), 0);
+}
+
+void RecordingRenderDevice::SetInputLayout(ResourceId inputLayout)
+{
+	Record(RenderCommandType::SetInputLayout, inputLayout, 0, 0);
+}
+
+void RecordingRenderDevice::SetVertexShader(ResourceId vertexShader)
+{
+	Record(RenderCommandType::SetVertexShader, vertexShader, 0, 0);
+}
+
+void RecordingRenderDevice::SetPixelShader(ResourceId pixelShader)
+{
+	Record(RenderCommandType::SetPixelShader, pixelShader, 0, 0);
+}
+
+void RecordingRenderDevice::SetVertexBuffer(ResourceId vertexBuffer, uint32_t stride)
+{
+	Record(RenderCommandType::SetVertexBuffer, vertexBuffer, stride, 0);
+}
+
+void RecordingRenderDevice::SetInstanceBuffer(ResourceId instanceBuffer, uint32_t stride)
+{
+	Record(RenderCommandType::SetInstanceBuffer, instanceBuffer, stride, 0);
+}
+
+void RecordingRenderDevice::SetIndexBuffer(ResourceId indexBuffer)
+{
+	Record(RenderCommandType::SetIndexBuffer, indexBuffer, 0, 0);
+}
+
+void RecordingRenderDevice::SetConstantBuffer(uint32_t slot, ResourceId constantBuffer)
+{
+	Record(RenderCommandType::SetConstantBuffer, constantBuffer, slot, 0);
+}
+
+void RecordingRenderDevice::UpdateConstantBuffer(ResourceId constantBuffer, const void * data, size_t size)
+{
+	Hash(data, size);
+	Record(RenderCommandType::UpdateConstantBuffer, constantBuffer, 0, size);
+}
+
+void RecordingRenderDevice::UpdateVertexBuffer(ResourceId dynamicVertexBuffer, const void * data, size_t size)
+{
+	Hash(data, size);
+	Record(RenderCommandType::UpdateVertexBuffer, dynamicVertexBuffer, 0, size);
+}
+
+void RecordingRenderDevice::DrawIndexed(uint32_t indexCount, uint32_t startIndex, int32_t baseVertex)
+{
+	Hash(&startIndex, sizeof(startIndex));
+	Hash(&baseVertex, sizeof(baseVertex));
+	Record(RenderCommandType::DrawIndexed, 0, indexCount, 0);
+}
+
+void RecordingRenderDevice::DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex)
+{
+	const uint32_t arguments[] = { indexCount, startIndex, static_cast<uint32_t>(baseVertex) };
+	Hash(arguments, sizeof(arguments));
+	Record(RenderCommandType::DrawIndexedInstanced, 0, instanceCount, 0);
+}
+
+void RecordingRenderDevice::Clear()
+{
+	_commands.clear();
+	for (size_t& count : _commandCounts)
+	{
+		count = 0;
+	}
+	_byteCount = 0;
+	_commandHash = HASH_OFFSET;
+}
+
+ResourceId RecordingRenderDevice::RecordCreate(RenderCommandType type, uint32_t value, size_t bytes)
+{
+	ResourceId resource = ++_lastResource;
+	Record(type, resource, value, bytes);
+	AllocationTracker::RecordResource(bytes);
+	_liveResourceCount++;
+	return resource;
+}
+
+void RecordingRenderDevice::Record(RenderCommandType type, ResourceId resource, uint32_t value, size_t bytes)
+{
+	_commands.push_back({ type, resource, value, static_cast<uint32_t>(bytes) });
+	_commandCounts[static_cast<size_t>(type)]++;
+	_byteCount += bytes;
+	const uint64_t arguments[] = { static_cast<uint64_t>(type), resource, value, bytes };
+	Hash(arguments, sizeof(arguments));
+}
+
+void RecordingRenderDevice::Hash(const void * data, size_t size)
+{
+	if (!_hashing || data == nullptr)
+	{
+		return;
+	}
+	const unsigned char * bytes = static_cast<const unsigned char *>(data);
+	for (size_t i = 0; i < size; i++)
+	{
+		_commandHash = (_commandHash ^ bytes[i]) * HASH_PRIME;
+	}
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include "RenderDevice.h"
+#include <cstdint>
+#include <vector>
+
+enum class RenderCommandType
+{
+	CreateVertexBuffer,
+	CreateIndexBuffer,
+	CreateConstantBuffer,
+	CreateDynamicVertexBuffer,
+	CreateVertexShader,
+	CreatePixelShader,
+	CreateInputLayout,
+	ReleaseResource,
+	Clear,
+	SetViewport,
+	SetPrimitiveTopology,
+	SetInputLayout,
+	SetVertexShader,
+	SetPixelShader,
+	SetVertexBuffer,
+	SetInstanceBuffer,
+	SetIndexBuffer,
+	SetConstantBuffer,
+	UpdateConstantBuffer,
+	UpdateVertexBuffer,
+	DrawIndexed,
+	DrawIndexedInstanced,
+	Count
+};
+
+// One call made to a RecordingRenderDevice.  Resource is the resource created, released, bound or
+// updated, Value holds the other argument of the call (the stride, slot, index count, instance count
+// or number of vertex elements) and Bytes is the amount of data passed with it.
+
+struct RenderCommand
+{
+	RenderCommandType	Type;
+	ResourceId			Resource;
+	uint32_t			Value;
+	uint32_t			Bytes;
+};
+
+// A RenderDevice that draws nothing, but records every call made to it.  This lets the code that
+// creates resources and submits draws be checked and timed on machines without a GPU.
+
+class RecordingRenderDevice : public RenderDevice
+{
+public:
+	ResourceId CreateVertexBuffer(const void * data, size_t size);
+	ResourceId CreateIndexBuffer(const void * data, size_t size);
+	ResourceId CreateConstantBuffer(size_t size);
+	ResourceId CreateDynamicVertexBuffer(size_t size);
+	ResourceId CreateVertexShader(const void * bytecode, size_t size);
+	ResourceId CreatePixelShader(const void * bytecode, size_t size);
+	ResourceId CreateInputLayout(const VertexElement * elements, size_t elementCount, const void * vertexShaderBytecode, size_t size);
+	void ReleaseResource(ResourceId resource);
+
+	void Clear(const float colour[4], float depth);
+	void SetViewport(float x, float y, float width, float height);
+
+	void SetPrimitiveTopology(PrimitiveTopology topology);
+	void SetInputLayout(ResourceId inputLayout);
+	void SetVertexShader(ResourceId vertexShader);
+	void SetPixelShader(ResourceId pixelShader);
+	void SetVertexBuffer(ResourceId vertexBuffer, uint32_t stride);
+	void SetInstanceBuffer(ResourceId instanceBuffer, uint32_t stride);
+	void SetIndexBuffer(ResourceId indexBuffer);
+	void SetConstantBuffer(uint32_t slot, ResourceId constantBuffer);
+	void UpdateConstantBuffer(ResourceId constantBuffer, const void * data, size_t size);
+	void UpdateVertexBuffer(ResourceId dynamicVertexBuffer, const void * data, size_t size);
+	void DrawIndexed(uint32_t indexCount, uint32_t startIndex, int32_t baseVertex);
+	void DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex);
+
+	// Discard the commands recorded so far.  The count of live resources is kept.
+	void Clear();
+
+	inline const std::vector<RenderCommand>& GetCommands() const { return _commands; }
+	inline size_t GetCommandCount(RenderCommandType type) const { return _commandCounts[static_cast<size_t>(type)]; }
+	inline size_t GetByteCount() const { return _byteCount; }
+
+	// If hashing is on, every call is added to a hash along with all of its arguments and the data
+	// passed with it, so that two command streams can be compared without keeping a copy of the data.
+	// It is off by default, since reading all of the data would slow the timed benchmarks down.
+	inline void SetHashing(bool hashing) { _hashing = hashing; }
+	inline uint64_t GetCommandHash() const { return _commandHash; }
+
+	// The number of resources that have been created and not yet released
+	inline size_t GetLiveResourceCount() const { return _liveResourceCount; }
+
+private:
+	// The command hash is FNV-1a
+	static constexpr uint64_t	HASH_OFFSET = 14695981039346656037ull;
+	static constexpr uint64_t	HASH_PRIME = 1099511628211ull;
+
+	std::vector<RenderCommand>	_commands;
+	size_t						_commandCounts[static_cast<size_t>(RenderCommandType::Count)]{};
+	size_t						_byteCount{ 0 };
+	ResourceId					_lastResource{ 0 };
+	size_t						_liveResourceCount{ 0 };
+	bool						_hashing{ false };
+	uint64_t					_commandHash{ HASH_OFFSET };
+
+	ResourceId RecordCreate(RenderCommandType type, uint32_t value, size_t bytes);
+	void Record(RenderCommandType type, ResourceId resource, uint32_t value, size_t bytes);
+	void Hash(const void * data, size_t size);
+};
@@ -0,0 +1,557 @@
+#include "RenderBenchmark.h"
+#include "BenchmarkFixtures.h"
+#include "RenderQueue.h"
+#include "RecordingRenderDevice.h"
+#include "CountingRenderDevice.h"
+#include "SceneGraph.h"
+#include "ResourceCache.h"
+#include "CachingShaderCompiler.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <thread>
+
+using namespace std;
+
+// Size of the constants passed with each draw (the same as the CBuffer used by shader.hlsl)
+constexpr size_t BENCHMARK_CONSTANTS_SIZE = 2 * sizeof(Matrix) + 4 * sizeof(Vector4);
+
+// Number of times each operation is timed
+constexpr int BENCHMARK_REPEATS = 10;
+
+constexpr uint32_t BENCHMARK_PROGRAMS = 16;
+constexpr uint32_t BENCHMARK_MESHES = 256;
+constexpr uint32_t BENCHMARK_MATERIALS = 64;
+
+// Size of the per-instance part of the constants (the world x view x projection and world
+// matrices, and the material and ambient colours), and the instances in each instanced draw
+constexpr uint32_t BENCHMARK_INSTANCE_SIZE = 2 * sizeof(Matrix) + 2 * sizeof(Vector4);
+constexpr uint32_t BENCHMARK_MAXIMUM_INSTANCES = 1024;
+
+// Frames counted while another thread reads the render statistics
+constexpr size_t BENCHMARK_STATISTICS_FRAMES = 100000;
+
+// Number of cubes in the robot that shares its resources through the resource cache
+constexpr size_t BENCHMARK_ROBOT_NODES = 7;
+
+// A shader compiler that returns the name of the entry point and any defines as the bytecode, and
+// counts how many times it is called.  Entry points that start with "Broken" fail to compile.
+
+class CountingShaderCompiler : public ShaderCompiler
+{
+public:
+	bool Compile(const std::wstring& fileName, const std::string& entryPoint, const std::string& profile,
+				 const std::vector<ShaderDefine>& defines, std::vector<char>& bytecode, std::string& messages)
+	{
+		_compileCount++;
+		if (entryPoint.compare(0, 6, "Broken") == 0)
+		{
+			messages = "error: " + entryPoint + " does not compile";
+			return false;
+		}
+		string code = entryPoint;
+		for (const ShaderDefine& define : defines)
+		{
+			code += " " + define.Name + "=" + define.Value;
+		}
+		bytecode.assign(code.begin(), code.end());
+		messages.clear();
+		return true;
+	}
+
+	inline uint32_t GetFlags() const { return 0; }
+	inline size_t GetCompileCount() const { return _compileCount; }
+
+private:
+	size_t _compileCount{ 0 };
+};
+
+// Files used to check the shader cache.  They are removed once the check is complete.
+const char * const BENCHMARK_SHADER_FILE = "ShaderCacheBenchmark.hlsl";
+const char * const BENCHMARK_INCLUDE_FILE = "ShaderCacheBenchmark.hlsli";
+const char * const BENCHMARK_CACHE_FILE = "ShaderCacheBenchmark.bin";
+constexpr int BENCHMARK_CACHE_LOOKUPS = 1000;
+
+// Number of draw nodes given to each SceneGraph node in the frame benchmark, and the number of meshes they use
+constexpr size_t BENCHMARK_FRAME_GROUP_SIZE = 16;
+constexpr uint32_t BENCHMARK_FRAME_MESHES = 8;
+
+// The resources each cube in the robot acquires
+
+struct RobotNodeResources
+{
+	MeshResourcePointer				Mesh;
+	ShaderResourcePointer			VertexShader;
+	ShaderResourcePointer			PixelShader;
+	ConstantBufferResourcePointer	ConstantBuffer;
+};
+
+// Fill a render queue with the draws for one frame, in the order given
+
+void FillRenderQueue(RenderQueue& queue, const vector<uint64_t>& keys)
+{
+	queue.BeginFrame(Matrix(), 1.0f, 10000.0f);
+	for (uint64_t key : keys)
+	{
+		queue.Add(key, queue.AllocateConstants(BENCHMARK_CONSTANTS_SIZE));
+	}
+}
+
+double NanosecondsSince(chrono::steady_clock::time_point start)
+{
+	return static_cast<double>(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count());
+}
+
+void WriteTextFile(const char * fileName, const string& text, const char * mode = "wb")
+{
+	FILE * file = fopen(fileName, mode);
+	if (file != nullptr)
+	{
+		fwrite(text.data(), 1, text.size(), file);
+		fclose(file);
+	}
+}
+
+wstring WideFileName(const char * fileName)
+{
+	return wstring(fileName, fileName + strlen(fileName));
+}
+
+// Compile a shader from the benchmark shader file, returning true if the bytecode is what the counting compiler produces
+
+bool CompileBenchmarkShader(ShaderCompiler& compiler, const string& entryPoint, const string& profile, const vector<ShaderDefine>& defines)
+{
+	vector<char> bytecode;
+	string messages;
+	if (!compiler.Compile(WideFileName(BENCHMARK_SHADER_FILE), entryPoint, profile, defines, bytecode, messages))
+	{
+		return false;
+	}
+	string expected = entryPoint;
+	for (const ShaderDefine& define : defines)
+	{
+		expected += " " + define.Name + "=" + define.Value;
+	}
+	return string(bytecode.begin(), bytecode.end()) == expected;
+}
+
+int RunRenderBenchmarks(const std::string& resultsFileName)
+{
+	ofstream results(resultsFileName);
+	if (!results)
+	{
+		return -1;
+	}
+
+	// Sorting and submitting a frame of draws with random state and depth, compared with submitting
+	// them in the order they were added.  The state changes are counted by the recording device.
+	RenderQueue queue;
+	for (uint32_t i = 0; i < BENCHMARK_PROGRAMS; i++)
+	{
+		ShaderProgram program;
+		program.VertexShader = 3 * i + 1;
+		program.PixelShader = 3 * i + 2;
+		program.InputLayout = i + 1;
+		program.ConstantBuffer = 3 * i + 3;
+		program.ConstantsSize = BENCHMARK_CONSTANTS_SIZE;
+		queue.AddShaderProgram(program);
+	}
+	for (uint32_t i = 0; i < BENCHMARK_MESHES; i++)
+	{
+		MeshBuffers mesh;
+		mesh.VertexBuffer = 1000 + 2 * i;
+		mesh.VertexStride = 24;
+		mesh.IndexBuffer = 1001 + 2 * i;
+		mesh.IndexCount = 36;
+		queue.AddMesh(mesh);
+	}
+
+	const size_t packetCounts[] = { 1000, 10000, 100000, 1000000 };
+	mt19937 random(12345);
+	uniform_int_distribution<uint32_t> programs(0, BENCHMARK_PROGRAMS - 1);
+	uniform_int_distribution<uint32_t> meshes(0, BENCHMARK_MESHES - 1);
+	uniform_int_distribution<uint32_t> materials(0, BENCHMARK_MATERIALS - 1);
+	uniform_real_distribution<float> depths(0.0f, 1.0f);
+	RecordingRenderDevice device;
+	results << "benchmark,packets,radix_sort_ns_per_packet,std_sort_ns_per_packet,sorted_submit_ns_per_packet,unsorted_state_changes,sorted_state_changes,sorted_correctly" << endl;
+	for (size_t packetCount : packetCounts)
+	{
+		vector<uint64_t> keys;
+		for (size_t i = 0; i < packetCount; i++)
+		{
+			keys.push_back(RenderQueue::MakeKey(RenderPass::Opaque, programs(random), meshes(random), materials(random), depths(random)));
+		}
+
+		FillRenderQueue(queue, keys);
+		device.Clear();
+		RenderQueueStatistics unsorted = queue.Submit(device);
+
+		double radixSort = 0.0;
+		double standardSort = 0.0;
+		double submit = 0.0;
+		RenderQueueStatistics sorted;
+		bool sortedCorrectly = true;
+		for (int repeat = 0; repeat < BENCHMARK_REPEATS; repeat++)
+		{
+			FillRenderQueue(queue, keys);
+			auto start = chrono::steady_clock::now();
+			queue.Sort();
+			radixSort += NanosecondsSince(start);
+
+			const vector<DrawPacket>& packets = queue.GetPackets();
+			sortedCorrectly = sortedCorrectly && is_sorted(packets.begin(), packets.end(), [](const DrawPacket& a, const DrawPacket& b) { return a.Key < b.Key; });
+
+			device.Clear();
+			start = chrono::steady_clock::now();
+			sorted = queue.Submit(device);
+			submit += NanosecondsSince(start);
+
+			vector<DrawPacket> comparison;
+			for (uint64_t key : keys)
+			{
+				comparison.push_back({ key, nullptr });
+			}
+			start = chrono::steady_clock::now();
+			sort(comparison.begin(), comparison.end(), [](const DrawPacket& a, const DrawPacket& b) { return a.Key < b.Key; });
+			standardSort += NanosecondsSince(start);
+		}
+		double samples = static_cast<double>(BENCHMARK_REPEATS) * packetCount;
+		results << "render_queue," << packetCount << "," << radixSort / samples << "," << standardSort / samples << "," << submit / samples << ","
+				<< unsorted.ProgramChanges + unsorted.MeshChanges << "," << sorted.ProgramChanges + sorted.MeshChanges << "," << (sortedCorrectly ? "yes" : "no") << endl;
+	}
+
+	// Many copies of the same mesh, drawn one at a time and then with instancing.  Only the
+	// program differs between the two.
+	bool instancedCorrectly = true;
+	results << "benchmark,objects,submit_ns_per_object,instanced_submit_ns_per_object,draws,instanced_draws,instance_bytes,instanced_correctly" << endl;
+	for (size_t objectCount : { 100, 1000, 10000, 100000 })
+	{
+		RenderQueue instancingQueue;
+		uint32_t singleProgram = instancingQueue.AddShaderProgram(BenchmarkCubeProgram(BENCHMARK_CONSTANTS_SIZE));
+		uint32_t instancedProgram = instancingQueue.AddShaderProgram(BenchmarkCubeProgram(BENCHMARK_CONSTANTS_SIZE, BENCHMARK_INSTANCE_SIZE, BENCHMARK_MAXIMUM_INSTANCES));
+		uint32_t meshIndex = instancingQueue.AddMesh(BenchmarkCubeMesh());
+
+		double submitTimes[2] = { 0.0, 0.0 };
+		RenderQueueStatistics statistics[2];
+		for (int instancing = 0; instancing < 2; instancing++)
+		{
+			vector<uint64_t> keys;
+			for (size_t i = 0; i < objectCount; i++)
+			{
+				keys.push_back(RenderQueue::MakeKey(RenderPass::Opaque, instancing ? instancedProgram : singleProgram, meshIndex, 0, depths(random)));
+			}
+			for (int repeat = 0; repeat < BENCHMARK_REPEATS; repeat++)
+			{
+				FillRenderQueue(instancingQueue, keys);
+				instancingQueue.Sort();
+				device.Clear();
+				auto start = chrono::steady_clock::now();
+				statistics[instancing] = instancingQueue.Submit(device);
+				submitTimes[instancing] += NanosecondsSince(start);
+			}
+		}
+		size_t instanceBytes = device.GetCommandCount(RenderCommandType::UpdateVertexBuffer) == 0 ? 0 : device.GetByteCount() - statistics[1].Draws * BENCHMARK_CONSTANTS_SIZE;
+		size_t expectedDraws = (objectCount + BENCHMARK_MAXIMUM_INSTANCES - 1) / BENCHMARK_MAXIMUM_INSTANCES;
+		instancedCorrectly = instancedCorrectly && statistics[0].Draws == objectCount && statistics[0].InstancedDraws == 0 &&
+							 statistics[1].Draws == expectedDraws && statistics[1].InstancedDraws == expectedDraws &&
+							 statistics[1].Instances == objectCount && instanceBytes == objectCount * BENCHMARK_INSTANCE_SIZE &&
+							 device.GetCommandCount(RenderCommandType::DrawIndexedInstanced) == expectedDraws &&
+							 device.GetCommandCount(RenderCommandType::DrawIndexed) == 0;
+		double samples = static_cast<double>(BENCHMARK_REPEATS) * objectCount;
+		results << "instancing," << objectCount << "," << submitTimes[0] / samples << "," << submitTimes[1] / samples << "," << statistics[0].Draws << ","
+				<< statistics[1].Draws << "," << instanceBytes << "," << (instancedCorrectly ? "yes" : "no") << endl;
+	}
+
+	// A whole frame, from updating the scene graph to submitting the sorted draws.  The device
+	// records every call made, so the cost of each stage can be timed without a GPU.  The draws are
+	// submitted through a counting device, as they are by the framework, and what it counts is
+	// checked against the calls recorded.
+	bool countedCorrectly = true;
+	results << "benchmark,nodes,update_ns,queue_ns,sort_ns,submit_ns,frame_ns,draws,state_changes,device_calls,device_bytes,"
+			<< "counted_draws,triangles,vertices,constant_bytes,device_state_changes,redundant_state_changes,counted_correctly" << endl;
+	for (size_t nodeCount : { 1000, 10000, 100000 })
+	{
+		RenderQueue frameQueue;
+		uint32_t programIndex = frameQueue.AddShaderProgram(BenchmarkCubeProgram(BENCHMARK_CONSTANTS_SIZE, BENCHMARK_INSTANCE_SIZE, BENCHMARK_MAXIMUM_INSTANCES));
+		vector<uint32_t> meshIndices;
+		for (uint32_t i = 0; i < BENCHMARK_FRAME_MESHES; i++)
+		{
+			meshIndices.push_back(frameQueue.AddMesh(BenchmarkCubeMesh(i)));
+		}
+
+		SceneGraphPointer scene = make_shared<SceneGraph>();
+		for (size_t i = 0; i < nodeCount; i += BENCHMARK_FRAME_GROUP_SIZE)
+		{
+			SceneGraphPointer group = make_shared<SceneGraph>(L"Group" + to_wstring(i));
+			group->SetWorldTransform(Matrix::CreateTranslation(Vector3(static_cast<float>(i % 100), 0.0f, static_cast<float>(i / 100))));
+			for (size_t j = 0; j < BENCHMARK_FRAME_GROUP_SIZE && i + j < nodeCount; j++)
+			{
+				SceneNodePointer node = make_shared<BenchmarkCubeNode>(L"Draw" + to_wstring(i + j), Vector4(0.5f, 0.5f, 0.5f, 1.0f), Matrix::Identity, programIndex,
+																		  meshIndices[(i + j) % BENCHMARK_FRAME_MESHES]);
+				node->SetWorldTransform(Matrix::CreateTranslation(Vector3(0.0f, static_cast<float>(j), 0.0f)));
+				group->Add(node);
+			}
+			scene->Add(group);
+		}
+		scene->Initialise();
+		scene->SetRenderQueue(&frameQueue);
+		scene->DisableCulling();
+
+		const float background[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		double stageTimes[4] = { 0.0, 0.0, 0.0, 0.0 };
+		RenderQueueStatistics frameStatistics;
+		RenderStatistics renderStatistics;
+		CountingRenderDevice countingDevice(device, renderStatistics);
+		for (int frame = 0; frame < BENCHMARK_REPEATS; frame++)
+		{
+			device.Clear();
+			auto start = chrono::steady_clock::now();
+			scene->SetWorldTransform(Matrix::CreateRotationY(0.01f * frame));
+			scene->Update(Matrix());
+			stageTimes[0] += NanosecondsSince(start);
+
+			start = chrono::steady_clock::now();
+			frameQueue.BeginFrame(Matrix::CreateTranslation(Vector3(0.0f, 0.0f, 10.0f)), 1.0f, 10000.0f);
+			scene->Render();
+			stageTimes[1] += NanosecondsSince(start);
+
+			start = chrono::steady_clock::now();
+			frameQueue.Sort();
+			stageTimes[2] += NanosecondsSince(start);
+
+			start = chrono::steady_clock::now();
+			countingDevice.Clear(background, 1.0f);
+			frameStatistics = frameQueue.Submit(countingDevice);
+			renderStatistics.EndFrame(frame);
+			stageTimes[3] += NanosecondsSince(start);
+		}
+
+		// Each node draws one instance of a cube of 12 triangles
+		RenderCounters counters = renderStatistics.GetLastFrame();
+		size_t recordedStateChanges = 0;
+		for (RenderCommandType type : { RenderCommandType::SetPrimitiveTopology, RenderCommandType::SetInputLayout, RenderCommandType::SetVertexShader,
+										RenderCommandType::SetPixelShader, RenderCommandType::SetVertexBuffer, RenderCommandType::SetInstanceBuffer,
+										RenderCommandType::SetIndexBuffer, RenderCommandType::SetConstantBuffer })
+		{
+			recordedStateChanges += device.GetCommandCount(type);
+		}
+		bool counted = counters.FrameNumber == BENCHMARK_REPEATS - 1 && counters.DrawCalls == frameStatistics.Draws
+					   && counters.DrawCalls == device.GetCommandCount(RenderCommandType::DrawIndexed) + device.GetCommandCount(RenderCommandType::DrawIndexedInstanced)
+					   && counters.InstancedDrawCalls == frameStatistics.InstancedDraws && counters.Instances == nodeCount
+					   && counters.Triangles == 12 * nodeCount && counters.Vertices == 36 * nodeCount
+					   && counters.ConstantBufferUpdates == device.GetCommandCount(RenderCommandType::UpdateConstantBuffer)
+					   && counters.StateChanges == recordedStateChanges && counters.RedundantStateChanges <= counters.StateChanges;
+		countedCorrectly = countedCorrectly && counted;
+		double frameTime = stageTimes[0] + stageTimes[1] + stageTimes[2] + stageTimes[3];
+		results << "frame," << nodeCount << "," << stageTimes[0] / BENCHMARK_REPEATS << "," << stageTimes[1] / BENCHMARK_REPEATS << ","
+				<< stageTimes[2] / BENCHMARK_REPEATS << "," << stageTimes[3] / BENCHMARK_REPEATS << "," << frameTime / BENCHMARK_REPEATS << ","
+				<< frameStatistics.Draws << "," << frameStatistics.ProgramChanges + frameStatistics.MeshChanges << ","
+				<< device.GetCommands().size() << "," << device.GetByteCount() << "," << counters.DrawCalls << "," << counters.Triangles << ","
+				<< counters.Vertices << "," << counters.ConstantBufferBytes << "," << counters.StateChanges << "," << counters.RedundantStateChanges << ","
+				<< (counted ? "yes" : "no") << endl;
+	}
+
+	// The counters are read by another thread while frames are counted.  Every counter in a frame is
+	// set to the frame number, so a reader that sees counters from two different frames shows that the
+	// frames were not kept apart.
+	{
+		RenderStatistics renderStatistics;
+		atomic<bool> counting{ true };
+		size_t reads = 0;
+		size_t tornReads = 0;
+		thread reader([&]()
+					  {
+						  while (counting)
+						  {
+							  RenderCounters counters = renderStatistics.GetLastFrame();
+							  size_t frame = static_cast<size_t>(counters.FrameNumber);
+							  if (counters.DrawCalls != frame || counters.Triangles != frame || counters.StateChanges != frame || counters.NodesDrawn != frame)
+							  {
+								  tornReads++;
+							  }
+							  reads++;
+						  }
+					  });
+		auto start = chrono::steady_clock::now();
+		for (size_t frame = 1; frame <= BENCHMARK_STATISTICS_FRAMES; frame++)
+		{
+			RenderCounters& counters = renderStatistics.GetCounters();
+			counters.DrawCalls = frame;
+			counters.Triangles = frame;
+			counters.StateChanges = frame;
+			counters.NodesDrawn = frame;
+			renderStatistics.EndFrame(frame);
+		}
+		double endFrameTime = NanosecondsSince(start) / BENCHMARK_STATISTICS_FRAMES;
+		counting = false;
+		reader.join();
+		bool consistent = tornReads == 0 && renderStatistics.GetLastFrame().FrameNumber == BENCHMARK_STATISTICS_FRAMES;
+		countedCorrectly = countedCorrectly && consistent;
+		results << "benchmark,frames,end_frame_ns,reads,torn_reads,consistent" << endl;
+		results << "render_statistics," << BENCHMARK_STATISTICS_FRAMES << "," << endFrameTime << "," << reads << "," << tornReads << "," << (consistent ? "yes" : "no") << endl;
+	}
+
+	// Every cube in the robot acquires the same mesh, shaders and constant buffer.  Each shader should
+	// be compiled once and each resource created once, and everything should be released from the
+	// device once the last cube lets go of it.  The same vertex shader acquired with another input
+	// layout is a separate resource with its own input layout.
+	const float cubeVertices[] = { -1.0f, -1.0f, 1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f, 1.0f };
+	const uint32_t cubeIndices[] = { 0, 1, 2 };
+	const VertexElement cubeLayout[] = { { "POSITION", 0, VertexFormat::Float3 } };
+	const VertexElement otherLayout[] = { { "POSITION", 0, VertexFormat::Float3 }, { "NORMAL", 0, VertexFormat::Float3 } };
+	CountingShaderCompiler compiler;
+	device.Clear();
+	size_t meshLoads = 0;
+	size_t hits = 0;
+	size_t misses = 0;
+	size_t liveResources = 0;
+	size_t cachedResources = 0;
+	bool compileFailureReported = false;
+	bool layoutsSeparate = false;
+	{
+		ResourceCache resourceCache(device, compiler);
+		vector<RobotNodeResources> nodes(BENCHMARK_ROBOT_NODES);
+		for (RobotNodeResources& node : nodes)
+		{
+			node.Mesh = resourceCache.AcquireMesh(L"Cube",
+												  [&](MeshData& mesh)
+												  {
+													  meshLoads++;
+													  mesh.Vertices = cubeVertices;
+													  mesh.VertexStride = 3 * sizeof(float);
+													  mesh.VertexCount = 3;
+													  mesh.Indices = cubeIndices;
+													  mesh.IndexCount = 3;
+												  });
+			node.VertexShader = resourceCache.AcquireVertexShader(L"shader.hlsl", "VS", "vs_5_0", cubeLayout, ARRAYSIZE(cubeLayout));
+			node.PixelShader = resourceCache.AcquirePixelShader(L"shader.hlsl", "PS", "ps_5_0");
+			node.ConstantBuffer = resourceCache.AcquireConstantBuffer(L"CBuffer", static_cast<uint32_t>(BENCHMARK_CONSTANTS_SIZE));
+		}
+		hits = resourceCache.GetHitCount();
+		misses = resourceCache.GetMissCount();
+		liveResources = device.GetLiveResourceCount();
+		ShaderResourcePointer otherLayoutShader = resourceCache.AcquireVertexShader(L"shader.hlsl", "VS", "vs_5_0", otherLayout, ARRAYSIZE(otherLayout));
+		layoutsSeparate = otherLayoutShader != nodes[0].VertexShader && otherLayoutShader->InputLayout != nodes[0].VertexShader->InputLayout;
+		otherLayoutShader.reset();
+		try
+		{
+			resourceCache.AcquirePixelShader(L"shader.hlsl", "BrokenPS", "ps_5_0");
+		}
+		catch (const runtime_error&)
+		{
+			compileFailureReported = true;
+		}
+		nodes.clear();
+		cachedResources = resourceCache.GetResourceCount();
+	}
+	size_t buffersCreated = device.GetCommandCount(RenderCommandType::CreateVertexBuffer) + device.GetCommandCount(RenderCommandType::CreateIndexBuffer) +
+							device.GetCommandCount(RenderCommandType::CreateConstantBuffer);
+	size_t shadersCreated = device.GetCommandCount(RenderCommandType::CreateVertexShader) + device.GetCommandCount(RenderCommandType::CreatePixelShader);
+	// Two shaders compiled, plus the vertex shader with the other layout and the one that fails.  A mesh,
+	// two shaders, an input layout and three buffers created for the robot, then another vertex shader
+	// and input layout.
+	bool cachedCorrectly = compiler.GetCompileCount() == 4 && meshLoads == 1 && buffersCreated == 3 && shadersCreated == 3 &&
+						   device.GetCommandCount(RenderCommandType::CreateInputLayout) == 2 && liveResources == 6 && layoutsSeparate &&
+						   misses == 4 && hits == 4 * (BENCHMARK_ROBOT_NODES - 1) && compileFailureReported &&
+						   cachedResources == 0 && device.GetLiveResourceCount() == 0;
+	results << "benchmark,nodes,compiles,buffers_created,shaders_created,cache_hits,cache_misses,live_after_release,cached_correctly" << endl;
+	results << "resource_cache," << BENCHMARK_ROBOT_NODES << "," << compiler.GetCompileCount() << "," << buffersCreated << "," << shadersCreated << ","
+			<< hits << "," << misses << "," << device.GetLiveResourceCount() << "," << (cachedCorrectly ? "yes" : "no") << endl;
+
+	// Shaders compiled through the shader cache are compiled once, then found in the cache file
+	// each time the application is run, until the shader or a file it includes changes.  Each block
+	// below is one run of the application.
+	remove(BENCHMARK_CACHE_FILE);
+	WriteTextFile(BENCHMARK_SHADER_FILE, "#include \"ShaderCacheBenchmark.hlsli\"\nfloat4 VS() : SV_POSITION { return Offset; }\nfloat4 PS() : SV_TARGET { return Offset; }\n");
+	WriteTextFile(BENCHMARK_INCLUDE_FILE, "static const float4 Offset = float4(0, 0, 0, 1);\n");
+	const vector<ShaderDefine> noDefines;
+	const vector<ShaderDefine> instancingDefines = { { "INSTANCING", "1" } };
+	CountingShaderCompiler shaderCompiler;
+	bool shaderCacheCorrect = true;
+	size_t firstRunCompiles = 0;
+	size_t cacheHits = 0;
+	size_t cacheMisses = 0;
+	size_t invalidations = 0;
+	size_t entriesBeforeCompacting = 0;
+	size_t entriesAfterCompacting = 0;
+	double lookup = 0.0;
+	{
+		CachingShaderCompiler shaderCache(shaderCompiler, WideFileName(BENCHMARK_CACHE_FILE));
+		shaderCacheCorrect = shaderCacheCorrect && shaderCache.GetEntryCount() == 0 &&
+							 CompileBenchmarkShader(shaderCache, "VS", "vs_5_0", noDefines) &&
+							 CompileBenchmarkShader(shaderCache, "PS", "ps_5_0", noDefines) &&
+							 CompileBenchmarkShader(shaderCache, "VS", "vs_5_0", noDefines) &&
+							 CompileBenchmarkShader(shaderCache, "VS", "vs_5_0", instancingDefines);
+		firstRunCompiles = shaderCompiler.GetCompileCount();
+		shaderCacheCorrect = shaderCacheCorrect && firstRunCompiles == 3 && shaderCache.GetHitCount() == 1;
+	}
+	{
+		// Nothing has changed, so nothing is compiled
+		CachingShaderCompiler shaderCache(shaderCompiler, WideFileName(BENCHMARK_CACHE_FILE));
+		auto start = chrono::steady_clock::now();
+		for (int i = 0; i < BENCHMARK_CACHE_LOOKUPS; i++)
+		{
+			shaderCacheCorrect = shaderCacheCorrect && CompileBenchmarkShader(shaderCache, "VS", "vs_5_0", noDefines);
+		}
+		lookup = NanosecondsSince(start) / BENCHMARK_CACHE_LOOKUPS;
+		shaderCacheCorrect = shaderCacheCorrect && CompileBenchmarkShader(shaderCache, "PS", "ps_5_0", noDefines) &&
+							 CompileBenchmarkShader(shaderCache, "VS", "vs_5_0", instancingDefines) &&
+							 shaderCompiler.GetCompileCount() == firstRunCompiles;
+
+		// Changing the included file means the shader has to be compiled again
+		WriteTextFile(BENCHMARK_INCLUDE_FILE, "static const float4 Offset = float4(0, 1, 0, 1);\n");
+		shaderCacheCorrect = shaderCacheCorrect && CompileBenchmarkShader(shaderCache, "VS", "vs_5_0", noDefines) &&
+							 CompileBenchmarkShader(shaderCache, "VS", "vs_5_0", noDefines) &&
+							 shaderCompiler.GetCompileCount() == firstRunCompiles + 1;
+		cacheHits = shaderCache.GetHitCount();
+		cacheMisses = shaderCache.GetMissCount();
+		invalidations = shaderCache.GetInvalidationCount();
+		entriesBeforeCompacting = shaderCache.GetEntryCount();
+	}
+	{
+		// The old version of the vertex shader was removed when the previous run ended.  Add some
+		// rubbish to the end of the file, as if a run had ended while a shader was being written.
+		CachingShaderCompiler shaderCache(shaderCompiler, WideFileName(BENCHMARK_CACHE_FILE));
+		entriesAfterCompacting = shaderCache.GetEntryCount();
+		shaderCacheCorrect = shaderCacheCorrect && CompileBenchmarkShader(shaderCache, "VS", "vs_5_0", noDefines) &&
+							 shaderCache.GetHitCount() == 1;
+	}
+	WriteTextFile(BENCHMARK_CACHE_FILE, "rubbish", "ab");
+	{
+		CachingShaderCompiler shaderCache(shaderCompiler, WideFileName(BENCHMARK_CACHE_FILE));
+		shaderCacheCorrect = shaderCacheCorrect && shaderCache.GetEntryCount() == entriesAfterCompacting &&
+							 CompileBenchmarkShader(shaderCache, "PS", "ps_5_0", instancingDefines);
+	}
+	{
+		CachingShaderCompiler shaderCache(shaderCompiler, WideFileName(BENCHMARK_CACHE_FILE));
+		shaderCacheCorrect = shaderCacheCorrect && shaderCache.GetEntryCount() == entriesAfterCompacting + 1;
+	}
+	{
+		// Two shaders compiled in the same run are both appended to the existing file, so they can be
+		// read back before the run ends
+		const vector<ShaderDefine> firstNewDefines = { { "INSTANCING", "2" } };
+		const vector<ShaderDefine> secondNewDefines = { { "INSTANCING", "3" } };
+		CachingShaderCompiler shaderCache(shaderCompiler, WideFileName(BENCHMARK_CACHE_FILE));
+		size_t compilesBefore = shaderCompiler.GetCompileCount();
+		shaderCacheCorrect = shaderCacheCorrect && CompileBenchmarkShader(shaderCache, "VS", "vs_5_0", firstNewDefines) &&
+							 CompileBenchmarkShader(shaderCache, "VS", "vs_5_0", secondNewDefines) &&
+							 shaderCompiler.GetCompileCount() == compilesBefore + 2;
+		CachingShaderCompiler appendedCache(shaderCompiler, WideFileName(BENCHMARK_CACHE_FILE));
+		shaderCacheCorrect = shaderCacheCorrect && appendedCache.GetEntryCount() == entriesAfterCompacting + 3 &&
+							 CompileBenchmarkShader(appendedCache, "VS", "vs_5_0", firstNewDefines) &&
+							 CompileBenchmarkShader(appendedCache, "VS", "vs_5_0", secondNewDefines) &&
+							 shaderCompiler.GetCompileCount() == compilesBefore + 2;
+	}
+	remove(BENCHMARK_SHADER_FILE);
+	remove(BENCHMARK_INCLUDE_FILE);
+	remove(BENCHMARK_CACHE_FILE);
+	shaderCacheCorrect = shaderCacheCorrect && cacheMisses == 1 && invalidations == 1 && entriesBeforeCompacting == 4 && entriesAfterCompacting == 3;
+	results << "benchmark,first_run_compiles,total_compiles,cache_hits,cache_misses,invalidations,lookup_ns,entries_after_compacting,cached_correctly" << endl;
+	results << "shader_cache," << firstRunCompiles << "," << shaderCompiler.GetCompileCount() << "," << cacheHits << "," << cacheMisses << ","
+			<< invalidations << "," << lookup << "," << entriesAfterCompacting << "," << (shaderCacheCorrect ? "yes" : "no") << endl;
+	return instancedCorrectly && countedCorrectly && cachedCorrectly && shaderCacheCorrect ? 0 : 1;
+}
@@ -0,0 +1,9 @@
+#pragma once
+#include <string>
+
+// Headless benchmarks for the render submission code.  Draws are submitted to a
+// RecordingRenderDevice.
+//
+// The results are written as comma-separated values to the file given.
+
+int RunRenderBenchmarks(const std::string& resultsFileName);
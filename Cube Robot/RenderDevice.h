@@ -0,0 +1,77 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Identifies a resource (a buffer, shader or input layout) held by a RenderDevice.  0 means no resource.
+typedef uint32_t ResourceId;
+
+enum class VertexFormat
+{
+	Float2,
+	Float3,
+	Float4
+};
+
+// One element of the vertices passed to a vertex shader.  Elements in the same input slot are
+// packed one after the other in the order they are given.  Per-instance elements (read from the
+// buffer set with SetInstanceBuffer) advance once per instance rather than once per vertex.
+
+struct VertexElement
+{
+	const char *	SemanticName;
+	uint32_t		SemanticIndex;
+	VertexFormat	Format;
+	bool			PerInstance{ false };
+};
+
+enum class PrimitiveTopology
+{
+	TriangleList,
+	TriangleStrip,
+	LineList
+};
+
+// The calls used to create resources on a graphics device and to draw with them.
+//
+// Code written against this interface rather than ID3D11Device and ID3D11DeviceContext (such as
+// ResourceCache, RenderQueue::Submit and the scene graph nodes) can be run against
+// RecordingRenderDevice on a machine without a GPU.  D3D11RenderDevice passes the calls on to
+// Direct3D 11.  Creating the window, swap chain and render target views is left to the
+// framework, since that depends on the platform.
+//
+// The create methods throw an exception if the resource cannot be created.  ResourceIds are
+// never reused, even once the resource has been released, and releasing resource 0 does nothing.
+// Constant buffers are bound to the same slot for both the vertex and pixel shaders.
+
+class RenderDevice
+{
+public:
+	virtual ~RenderDevice() {}
+
+	virtual ResourceId CreateVertexBuffer(const void * data, size_t size) = 0;
+	virtual ResourceId CreateIndexBuffer(const void * data, size_t size) = 0;
+	virtual ResourceId CreateConstantBuffer(size_t size) = 0;
+	// A vertex buffer whose contents are replaced each frame with UpdateVertexBuffer, such as a buffer of instances
+	virtual ResourceId CreateDynamicVertexBuffer(size_t size) = 0;
+	virtual ResourceId CreateVertexShader(const void * bytecode, size_t size) = 0;
+	virtual ResourceId CreatePixelShader(const void * bytecode, size_t size) = 0;
+	virtual ResourceId CreateInputLayout(const VertexElement * elements, size_t elementCount, const void * vertexShaderBytecode, size_t size) = 0;
+	virtual void ReleaseResource(ResourceId resource) = 0;
+
+	// Clear the render target to colour (red, green, blue, alpha) and the depth buffer to depth
+	virtual void Clear(const float colour[4], float depth) = 0;
+	virtual void SetViewport(float x, float y, float width, float height) = 0;
+
+	virtual void SetPrimitiveTopology(PrimitiveTopology topology) = 0;
+	virtual void SetInputLayout(ResourceId inputLayout) = 0;
+	virtual void SetVertexShader(ResourceId vertexShader) = 0;
+	virtual void SetPixelShader(ResourceId pixelShader) = 0;
+	virtual void SetVertexBuffer(ResourceId vertexBuffer, uint32_t stride) = 0;
+	virtual void SetInstanceBuffer(ResourceId instanceBuffer, uint32_t stride) = 0;
+	virtual void SetIndexBuffer(ResourceId indexBuffer) = 0;
+	virtual void SetConstantBuffer(uint32_t slot, ResourceId constantBuffer) = 0;
+	virtual void UpdateConstantBuffer(ResourceId constantBuffer, const void * data, size_t size) = 0;
+	virtual void UpdateVertexBuffer(ResourceId dynamicVertexBuffer, const void * data, size_t size) = 0;
+	virtual void DrawIndexed(uint32_t indexCount, uint32_t startIndex, int32_t baseVertex) = 0;
+	virtual void DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex) = 0;
+};
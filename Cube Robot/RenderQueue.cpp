@@ -0,0 +1,308 @@
+#include "RenderQueue.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+// Layout of the keys.  The pass always takes the top four bits.
+//
+// Opaque and overlay:  pass (4) | program (12) | mesh (16) | material (12) | depth (20)
+// Transparent:         pass (4) | inverted depth (20) | program (12) | mesh (16) | material (12)
+
+namespace
+{
+	constexpr int PASS_SHIFT = 60;
+	constexpr int DEPTH_BITS = 20;
+	constexpr uint64_t DEPTH_MASK = (1ull << DEPTH_BITS) - 1;
+
+	constexpr int OPAQUE_PROGRAM_SHIFT = 48;
+	constexpr int OPAQUE_MESH_SHIFT = 32;
+	constexpr int OPAQUE_MATERIAL_SHIFT = 20;
+
+	constexpr int TRANSPARENT_DEPTH_SHIFT = 40;
+	constexpr int TRANSPARENT_PROGRAM_SHIFT = 28;
+	constexpr int TRANSPARENT_MESH_SHIFT = 12;
+
+	// Below this number of packets, a comparison sort is quicker than eight passes of the radix sort
+	constexpr size_t RADIX_SORT_MINIMUM = 1024;
+}
+
+uint32_t RenderQueue::AddShaderProgram(const ShaderProgram& program)
+{
+	// Nodes that share resources also share an index, so that their draws sort together
+	for (size_t i = 0; i < _programs.size(); i++)
+	{
+		const ShaderProgram& existing = _programs[i];
+		if (existing.VertexShader == program.VertexShader && existing.PixelShader == program.PixelShader &&
+			existing.InputLayout == program.InputLayout && existing.ConstantBuffer == program.ConstantBuffer &&
+			existing.ConstantsSize == program.ConstantsSize && existing.InstancedVertexShader == program.InstancedVertexShader &&
+			existing.InstancedInputLayout == program.InstancedInputLayout && existing.InstanceBuffer == program.InstanceBuffer &&
+			existing.InstanceSize == program.InstanceSize && existing.MaximumInstances == program.MaximumInstances)
+		{
+			return static_cast<uint32_t>(i);
+		}
+	}
+	if (_programs.size() >= MAXIMUM_PROGRAMS)
+	{
+		return INVALID_INDEX;
+	}
+	_programs.push_back(program);
+	return static_cast<uint32_t>(_programs.size() - 1);
+}
+
+uint32_t RenderQueue::AddMesh(const MeshBuffers& mesh)
+{
+	for (size_t i = 0; i < _meshes.size(); i++)
+	{
+		const MeshBuffers& existing = _meshes[i];
+		if (existing.VertexBuffer == mesh.VertexBuffer && existing.VertexStride == mesh.VertexStride &&
+			existing.IndexBuffer == mesh.IndexBuffer && existing.IndexCount == mesh.IndexCount)
+		{
+			return static_cast<uint32_t>(i);
+		}
+	}
+	if (_meshes.size() >= MAXIMUM_MESHES)
+	{
+		return INVALID_INDEX;
+	}
+	_meshes.push_back(mesh);
+	return static_cast<uint32_t>(_meshes.size() - 1);
+}
+
+void RenderQueue::CopyResources(const RenderQueue& source)
+{
+	// Programs and meshes are never removed or changed once added, so the tables only need to be
+	// copied when the source has added more
+	if (_programs.size() != source._programs.size())
+	{
+		_programs = source._programs;
+	}
+	if (_meshes.size() != source._meshes.size())
+	{
+		_meshes = source._meshes;
+	}
+}
+
+void RenderQueue::BeginFrame(const Matrix& viewTransformation, float nearPlane, float farPlane)
+{
+	_packets.clear();
+	_constantBlock = 0;
+	_constantBlockUsed = 0;
+	_viewTransformation = viewTransformation;
+	_nearPlane = nearPlane;
+	_farPlane = farPlane;
+}
+
+void * RenderQueue::AllocateConstants(size_t size)
+{
+	// Keep each allocation 16 byte aligned, as required by the SSE instructions used by SimpleMath
+	size = (size + CONSTANT_ALIGNMENT - 1) & ~(CONSTANT_ALIGNMENT - 1);
+	if (size > CONSTANT_BLOCK_SIZE)
+	{
+		return nullptr;
+	}
+	if (_constantBlock < _constantBlocks.size() && _constantBlockUsed + size > CONSTANT_BLOCK_SIZE)
+	{
+		_constantBlock++;
+		_constantBlockUsed = 0;
+	}
+	if (_constantBlock == _constantBlocks.size())
+	{
+		// new char[] only guarantees the default alignment (8 bytes on 32-bit Windows), so the
+		// block is allocated with room to move its start up to the next 16 byte boundary
+		_constantBlocks.emplace_back(new char[CONSTANT_BLOCK_SIZE + CONSTANT_ALIGNMENT - 1]);
+	}
+	uintptr_t blockStart = reinterpret_cast<uintptr_t>(_constantBlocks[_constantBlock].get());
+	blockStart = (blockStart + CONSTANT_ALIGNMENT - 1) & ~static_cast<uintptr_t>(CONSTANT_ALIGNMENT - 1);
+	void * constants = reinterpret_cast<char *>(blockStart) + _constantBlockUsed;
+	_constantBlockUsed += size;
+	return constants;
+}
+
+void RenderQueue::Add(RenderPass pass, uint32_t program, uint32_t mesh, uint32_t material, const Vector3& worldPosition, const void * constants)
+{
+	float viewDepth = Vector3::Transform(worldPosition, _viewTransformation).z;
+	float depth = (viewDepth - _nearPlane) / (_farPlane - _nearPlane);
+	Add(MakeKey(pass, program, mesh, material, depth), constants);
+}
+
+void RenderQueue::Add(uint64_t key, const void * constants)
+{
+	_packets.push_back({ key, constants });
+}
+
+uint64_t RenderQueue::MakeKey(RenderPass pass, uint32_t program, uint32_t mesh, uint32_t material, float depth)
+{
+	uint64_t quantisedDepth = static_cast<uint64_t>(std::min(std::max(depth, 0.0f), 1.0f) * DEPTH_MASK);
+	uint64_t key = static_cast<uint64_t>(pass) << PASS_SHIFT;
+	if (pass == RenderPass::Transparent)
+	{
+		key |= (DEPTH_MASK - quantisedDepth) << TRANSPARENT_DEPTH_SHIFT;
+		key |= static_cast<uint64_t>(program & (MAXIMUM_PROGRAMS - 1)) << TRANSPARENT_PROGRAM_SHIFT;
+		key |= static_cast<uint64_t>(mesh & (MAXIMUM_MESHES - 1)) << TRANSPARENT_MESH_SHIFT;
+		key |= static_cast<uint64_t>(material & (MAXIMUM_MATERIALS - 1));
+	}
+	else
+	{
+		key |= static_cast<uint64_t>(program & (MAXIMUM_PROGRAMS - 1)) << OPAQUE_PROGRAM_SHIFT;
+		key |= static_cast<uint64_t>(mesh & (MAXIMUM_MESHES - 1)) << OPAQUE_MESH_SHIFT;
+		key |= static_cast<uint64_t>(material & (MAXIMUM_MATERIALS - 1)) << OPAQUE_MATERIAL_SHIFT;
+		key |= quantisedDepth;
+	}
+	return key;
+}
+
+void RenderQueue::DecodeKey(uint64_t key, uint32_t& program, uint32_t& mesh)
+{
+	if (static_cast<RenderPass>(key >> PASS_SHIFT) == RenderPass::Transparent)
+	{
+		program = static_cast<uint32_t>(key >> TRANSPARENT_PROGRAM_SHIFT) & (MAXIMUM_PROGRAMS - 1);
+		mesh = static_cast<uint32_t>(key >> TRANSPARENT_MESH_SHIFT) & (MAXIMUM_MESHES - 1);
+	}
+	else
+	{
+		program = static_cast<uint32_t>(key >> OPAQUE_PROGRAM_SHIFT) & (MAXIMUM_PROGRAMS - 1);
+		mesh = static_cast<uint32_t>(key >> OPAQUE_MESH_SHIFT) & (MAXIMUM_MESHES - 1);
+	}
+}
+
+void RenderQueue::Sort()
+{
+	PROFILE_ZONE("RenderQueue::Sort");
+	size_t count = _packets.size();
+	if (count < RADIX_SORT_MINIMUM)
+	{
+		std::sort(_packets.begin(), _packets.end(), [](const DrawPacket& a, const DrawPacket& b) { return a.Key < b.Key; });
+		return;
+	}
+
+	// A least significant digit first radix sort, one byte at a time.  The histograms for all
+	// eight bytes are built in a single pass.  Any byte that is the same in every key is skipped,
+	// which is common since most keys share the same pass and only a few programs are used.
+	size_t histograms[8][256] = {};
+	for (const DrawPacket& packet : _packets)
+	{
+		uint64_t key = packet.Key;
+		for (int digit = 0; digit < 8; digit++)
+		{
+			histograms[digit][(key >> (digit * 8)) & 0xFF]++;
+		}
+	}
+
+	_sortBuffer.resize(count);
+	DrawPacket * source = _packets.data();
+	DrawPacket * destination = _sortBuffer.data();
+	for (int digit = 0; digit < 8; digit++)
+	{
+		int shift = digit * 8;
+		size_t * histogram = histograms[digit];
+		if (histogram[(source[0].Key >> shift) & 0xFF] == count)
+		{
+			continue;
+		}
+
+		size_t offset = 0;
+		for (int value = 0; value < 256; value++)
+		{
+			size_t valueCount = histogram[value];
+			histogram[value] = offset;
+			offset += valueCount;
+		}
+		for (size_t i = 0; i < count; i++)
+		{
+			destination[histogram[(source[i].Key >> shift) & 0xFF]++] = source[i];
+		}
+		std::swap(source, destination);
+	}
+	if (source != _packets.data())
+	{
+		_packets.swap(_sortBuffer);
+	}
+}
+
+RenderQueueStatistics RenderQueue::Submit(RenderDevice& device)
+{
+	PROFILE_ZONE("RenderQueue::Submit");
+	RenderQueueStatistics statistics;
+	uint32_t currentProgram = INVALID_INDEX;
+	uint32_t currentMesh = INVALID_INDEX;
+	const ShaderProgram * program = nullptr;
+	const MeshBuffers * mesh = nullptr;
+	bool instancedShaderSet = false;
+	device.SetPrimitiveTopology(PrimitiveTopology::TriangleList);
+	size_t packetIndex = 0;
+	while (packetIndex < _packets.size())
+	{
+		// State is only changed when it differs from that of the previous draw
+		const DrawPacket& packet = _packets[packetIndex];
+		uint32_t programIndex;
+		uint32_t meshIndex;
+		DecodeKey(packet.Key, programIndex, meshIndex);
+		bool programChanged = programIndex != currentProgram;
+		if (programChanged)
+		{
+			currentProgram = programIndex;
+			program = &_programs[programIndex];
+			device.SetPixelShader(program->PixelShader);
+			device.SetConstantBuffer(0, program->ConstantBuffer);
+			statistics.ProgramChanges++;
+		}
+		if (meshIndex != currentMesh)
+		{
+			currentMesh = meshIndex;
+			mesh = &_meshes[meshIndex];
+			device.SetVertexBuffer(mesh->VertexBuffer, mesh->VertexStride);
+			device.SetIndexBuffer(mesh->IndexBuffer);
+			statistics.MeshChanges++;
+		}
+
+		// Find the following draws that can be drawn along with this one.  The draws share a program,
+		// mesh and material if the top bits of their keys (down to the material) are the same.
+		size_t runEnd = packetIndex + 1;
+		if (program->InstancedVertexShader != 0 && static_cast<RenderPass>(packet.Key >> PASS_SHIFT) != RenderPass::Transparent)
+		{
+			size_t maximumEnd = packetIndex + program->MaximumInstances;
+			while (runEnd < _packets.size() && runEnd < maximumEnd && ((_packets[runEnd].Key ^ packet.Key) >> OPAQUE_MATERIAL_SHIFT) == 0)
+			{
+				runEnd++;
+			}
+		}
+		size_t instanceCount = runEnd - packetIndex;
+		bool instanced = instanceCount > 1;
+		if (programChanged || instanced != instancedShaderSet)
+		{
+			device.SetInputLayout(instanced ? program->InstancedInputLayout : program->InputLayout);
+			device.SetVertexShader(instanced ? program->InstancedVertexShader : program->VertexShader);
+			if (instanced)
+			{
+				device.SetInstanceBuffer(program->InstanceBuffer, program->InstanceSize);
+			}
+			instancedShaderSet = instanced;
+		}
+
+		// The constants of the first draw supply everything that is not per-instance
+		device.UpdateConstantBuffer(program->ConstantBuffer, packet.Constants, program->ConstantsSize);
+		statistics.ConstantBytes += program->ConstantsSize;
+		if (instanced)
+		{
+			size_t instanceBytes = instanceCount * program->InstanceSize;
+			_instanceData.resize(instanceBytes);
+			for (size_t i = 0; i < instanceCount; i++)
+			{
+				memcpy(&_instanceData[i * program->InstanceSize], _packets[packetIndex + i].Constants, program->InstanceSize);
+			}
+			device.UpdateVertexBuffer(program->InstanceBuffer, _instanceData.data(), instanceBytes);
+			device.DrawIndexedInstanced(mesh->IndexCount, static_cast<uint32_t>(instanceCount), 0, 0);
+			statistics.InstancedDraws++;
+			statistics.Instances += instanceCount;
+			statistics.ConstantBytes += instanceBytes;
+		}
+		else
+		{
+			device.DrawIndexed(mesh->IndexCount, 0, 0);
+		}
+		statistics.Draws++;
+		packetIndex = runEnd;
+	}
+	return statistics;
+}
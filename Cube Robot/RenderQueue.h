@@ -0,0 +1,143 @@
+#pragma once
+#include "DirectXCore.h"
+#include "RenderDevice.h"
+#include <memory>
+#include <vector>
+
+// The passes that draws are grouped into.  All of the draws in one pass are submitted before any in the next.
+
+enum class RenderPass : uint32_t
+{
+	Opaque = 0,					// Sorted by state, then front to back
+	Transparent = 1,			// Sorted back to front, then by state
+	Overlay = 2					// Sorted by state, then front to back
+};
+
+// The resources used by a shader: the vertex and pixel shaders, the input layout that matches
+// the vertex shader and the constant buffer that each draw's constants are copied to.
+//
+// A program can also have an instanced variant of its vertex shader.  The first InstanceSize
+// bytes of each draw's constants are then treated as per-instance data, which the instanced
+// shader reads from InstanceBuffer rather than the constant buffer.  The rest of the constants
+// must be the same for every draw that uses the program and mesh.
+
+struct ShaderProgram
+{
+	ResourceId		VertexShader{ 0 };
+	ResourceId		PixelShader{ 0 };
+	ResourceId		InputLayout{ 0 };
+	ResourceId		ConstantBuffer{ 0 };
+	uint32_t		ConstantsSize{ 0 };
+
+	// Set InstancedVertexShader to 0 if the program cannot be instanced
+	ResourceId		InstancedVertexShader{ 0 };
+	ResourceId		InstancedInputLayout{ 0 };
+	ResourceId		InstanceBuffer{ 0 };
+	uint32_t		InstanceSize{ 0 };
+	uint32_t		MaximumInstances{ 0 };
+};
+
+struct MeshBuffers
+{
+	ResourceId		VertexBuffer{ 0 };
+	uint32_t		VertexStride{ 0 };
+	ResourceId		IndexBuffer{ 0 };
+	uint32_t		IndexCount{ 0 };
+};
+
+// A single draw.  Everything needed to submit it is either encoded in the key or pointed to by Constants.
+
+struct DrawPacket
+{
+	uint64_t		Key;
+	const void *	Constants;
+};
+
+struct RenderQueueStatistics
+{
+	size_t			Draws{ 0 };
+	size_t			InstancedDraws{ 0 };
+	size_t			Instances{ 0 };
+	size_t			ProgramChanges{ 0 };
+	size_t			MeshChanges{ 0 };
+	size_t			ConstantBytes{ 0 };
+};
+
+// A queue of the draws for one frame.
+//
+// Rather than drawing as they are reached, nodes add a packet for each draw to the queue.  Once
+// the whole scene has been added, the packets are sorted by their keys and submitted in order.
+// Each key holds (from most to least significant) the pass, and then the shader program, mesh,
+// material and depth of the draw, so that opaque draws that use the same state are submitted
+// together and in front to back order.  In the transparent pass, depth comes first (and back to
+// front) since the draws have to be blended in order.
+//
+// When consecutive opaque or overlay draws after sorting share a program that can be instanced, a
+// mesh and a material, they are submitted as a single instanced draw.
+//
+// Shader programs and meshes are added to the queue once and then referred to by the index
+// returned, which is encoded in the key.  The queue can hold up to MAXIMUM_PROGRAMS programs
+// and MAXIMUM_MESHES meshes.  The constants for each draw are copied into memory owned by the
+// queue (see AllocateConstants) and stay valid until the next call to BeginFrame.
+
+class RenderQueue
+{
+public:
+	RenderQueue() {};
+
+	RenderQueue(const RenderQueue&) = delete;
+	RenderQueue& operator=(const RenderQueue&) = delete;
+
+	// Return the index of the program or mesh for use in Add, or INVALID_INDEX if the queue is full.
+	// Adding a program or mesh that is already in the queue returns its existing index.
+	uint32_t AddShaderProgram(const ShaderProgram& program);
+	uint32_t AddMesh(const MeshBuffers& mesh);
+
+	// Use the same programs and meshes as another queue, so that the indices it returned can be used
+	// with this one.  This is used when the draws for successive frames are added to different queues
+	// (see FramePipeline).  Programs and meshes added to this queue directly are replaced.
+	void CopyResources(const RenderQueue& source);
+
+	// Discard the packets from the previous frame.  The view transformation and the distances to
+	// the near and far planes are used to work out the depth of each draw.
+	void BeginFrame(const Matrix& viewTransformation, float nearPlane, float farPlane);
+
+	void * AllocateConstants(size_t size);
+	void Add(RenderPass pass, uint32_t program, uint32_t mesh, uint32_t material, const Vector3& worldPosition, const void * constants);
+	void Add(uint64_t key, const void * constants);
+
+	void Sort();
+	RenderQueueStatistics Submit(RenderDevice& device);
+
+	inline size_t GetPacketCount() const { return _packets.size(); }
+	inline const std::vector<DrawPacket>& GetPackets() const { return _packets; }
+
+	// Make a key from its parts.  depth is the distance from the camera, from 0 at the near plane to 1 at the far plane.
+	static uint64_t MakeKey(RenderPass pass, uint32_t program, uint32_t mesh, uint32_t material, float depth);
+	static void DecodeKey(uint64_t key, uint32_t& program, uint32_t& mesh);
+
+	static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+	static constexpr uint32_t MAXIMUM_PROGRAMS = 1 << 12;
+	static constexpr uint32_t MAXIMUM_MESHES = 1 << 16;
+	static constexpr uint32_t MAXIMUM_MATERIALS = 1 << 12;
+
+private:
+	std::vector<ShaderProgram>			_programs;
+	std::vector<MeshBuffers>			_meshes;
+	std::vector<DrawPacket>				_packets;
+	std::vector<DrawPacket>				_sortBuffer;
+	std::vector<char>					_instanceData;
+
+	// Constants are allocated from a list of fixed size blocks, so that
+	// the pointers in earlier packets are not invalidated as the list grows
+	std::vector<std::unique_ptr<char[]>> _constantBlocks;
+	size_t								_constantBlock{ 0 };
+	size_t								_constantBlockUsed{ 0 };
+
+	Matrix								_viewTransformation;
+	float								_nearPlane{ 1.0f };
+	float								_farPlane{ 10000.0f };
+
+	static constexpr size_t CONSTANT_BLOCK_SIZE = 64 * 1024;
+	static constexpr size_t CONSTANT_ALIGNMENT = 16;
+};
@@ -0,0 +1,19 @@
+#include "RenderStatistics.h"
+
+void RenderStatistics::EndFrame(uint64_t frameNumber)
+{
+	_counters[_current].FrameNumber = frameNumber;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_current ^= 1;
+	}
+
+	// GetLastFrame only reads the other set, so these can be cleared without holding the lock
+	_counters[_current] = RenderCounters();
+}
+
+RenderCounters RenderStatistics::GetLastFrame() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _counters[_current ^ 1];
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+// What was drawn in one frame.  The device counts are made by CountingRenderDevice, and the node
+// counts are copied from the culling statistics of the scene graph.
+
+struct RenderCounters
+{
+	uint64_t	FrameNumber{ 0 };
+
+	size_t		DrawCalls{ 0 };					// Calls to DrawIndexed and DrawIndexedInstanced
+	size_t		InstancedDrawCalls{ 0 };
+	size_t		Instances{ 0 };					// Copies drawn, counting each draw that is not instanced as one
+	size_t		Triangles{ 0 };
+	size_t		Vertices{ 0 };					// Indices read by the draws, for every instance
+	size_t		ConstantBufferUpdates{ 0 };
+	size_t		ConstantBufferBytes{ 0 };
+	size_t		VertexBufferBytes{ 0 };			// Written to dynamic vertex buffers, such as instance buffers
+	size_t		StateChanges{ 0 };				// Calls that bind a shader, input layout, buffer or topology
+	size_t		RedundantStateChanges{ 0 };		// State changes that bound what was already bound
+
+	size_t		NodesVisited{ 0 };
+	size_t		NodesCulled{ 0 };
+	size_t		NodesOccluded{ 0 };
+	size_t		NodesDrawn{ 0 };
+};
+
+// The counters for the frame being drawn and for the last frame drawn.
+//
+// The frame being drawn is counted through GetCounters by the thread that is drawing it.  EndFrame
+// then swaps the two sets of counters over, so that the counters that were being filled become the
+// last frame's, and clears the others for the next frame.  GetLastFrame can be called from any
+// thread, and always returns the whole of one frame's counters.
+
+class RenderStatistics
+{
+public:
+	RenderStatistics() {}
+
+	RenderStatistics(const RenderStatistics&) = delete;
+	RenderStatistics& operator=(const RenderStatistics&) = delete;
+
+	// The counters for the frame being drawn.  These must only be used by the thread drawing the frame.
+	inline RenderCounters& GetCounters() { return _counters[_current]; }
+
+	void EndFrame(uint64_t frameNumber);
+
+	RenderCounters GetLastFrame() const;
+
+private:
+	RenderCounters			_counters[2];
+	size_t					_current{ 0 };		// Only changed by EndFrame, with the mutex held
+	mutable std::mutex		_mutex;
+};
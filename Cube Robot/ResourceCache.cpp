@@ -0,0 +1,167 @@
+#include "ResourceCache.h"
+#include <stdexcept>
+
+namespace
+{
+	// A description of an input layout that is the same for the same elements, so that a vertex
+	// shader acquired with a different layout is not given the input layout created for another
+	std::string DescribeLayout(const VertexElement * layout, size_t layoutElementCount)
+	{
+		std::string description;
+		for (size_t i = 0; i < layoutElementCount; i++)
+		{
+			description += layout[i].SemanticName;
+			description += std::to_string(layout[i].SemanticIndex);
+			description += ':';
+			description += std::to_string(static_cast<int>(layout[i].Format));
+			description += layout[i].PerInstance ? ":instance;" : ";";
+		}
+		return description;
+	}
+}
+
+MeshResourcePointer ResourceCache::AcquireMesh(const std::wstring& name, const std::function<void(MeshData&)>& loadMesh)
+{
+	MeshResourcePointer mesh = Find(_meshes, name);
+	if (mesh != nullptr)
+	{
+		return mesh;
+	}
+
+	MeshData data;
+	loadMesh(data);
+	MeshBuffers * buffers = new MeshBuffers();
+	buffers->VertexBuffer = _device.CreateVertexBuffer(data.Vertices, static_cast<size_t>(data.VertexStride) * data.VertexCount);
+	buffers->VertexStride = data.VertexStride;
+	buffers->IndexBuffer = _device.CreateIndexBuffer(data.Indices, sizeof(uint32_t) * data.IndexCount);
+	buffers->IndexCount = data.IndexCount;
+	return Add<std::wstring, MeshBuffers>(_meshes, name, buffers,
+										   [this](const MeshBuffers& released)
+										   {
+											   _device.ReleaseResource(released.VertexBuffer);
+											   _device.ReleaseResource(released.IndexBuffer);
+										   });
+}
+
+ShaderResourcePointer ResourceCache::AcquireVertexShader(const std::wstring& fileName, const std::string& entryPoint, const std::string& profile,
+														 const VertexElement * layout, size_t layoutElementCount)
+{
+	return AcquireShader(ShaderKey(fileName, entryPoint, profile, DescribeLayout(layout, layoutElementCount)),
+						 [&](const std::vector<char>& bytecode)
+						 {
+							 ShaderResource shader;
+							 shader.Shader = _device.CreateVertexShader(bytecode.data(), bytecode.size());
+							 shader.InputLayout = _device.CreateInputLayout(layout, layoutElementCount, bytecode.data(), bytecode.size());
+							 return shader;
+						 });
+}
+
+ShaderResourcePointer ResourceCache::AcquirePixelShader(const std::wstring& fileName, const std::string& entryPoint, const std::string& profile)
+{
+	return AcquireShader(ShaderKey(fileName, entryPoint, profile, std::string()),
+						 [&](const std::vector<char>& bytecode)
+						 {
+							 ShaderResource shader;
+							 shader.Shader = _device.CreatePixelShader(bytecode.data(), bytecode.size());
+							 return shader;
+						 });
+}
+
+ShaderResourcePointer ResourceCache::AcquireShader(const ShaderKey& key, const std::function<ShaderResource(const std::vector<char>&)>& createShader)
+{
+	ShaderResourcePointer shader = Find(_shaders, key);
+	if (shader != nullptr)
+	{
+		return shader;
+	}
+
+	std::vector<char> bytecode;
+	std::string messages;
+	if (!_compiler.Compile(std::get<0>(key), std::get<1>(key), std::get<2>(key), std::vector<ShaderDefine>(), bytecode, messages))
+	{
+		throw std::runtime_error(messages);
+	}
+	return Add<ShaderKey, ShaderResource>(_shaders, key, new ShaderResource(createShader(bytecode)),
+										  [this](const ShaderResource& released)
+										  {
+											  _device.ReleaseResource(released.Shader);
+											  _device.ReleaseResource(released.InputLayout);
+										  });
+}
+
+ConstantBufferResourcePointer ResourceCache::AcquireConstantBuffer(const std::wstring& name, uint32_t size)
+{
+	ConstantBufferKey key(name, size);
+	ConstantBufferResourcePointer constantBuffer = Find(_constantBuffers, key);
+	if (constantBuffer != nullptr)
+	{
+		return constantBuffer;
+	}
+
+	ConstantBufferResource * buffer = new ConstantBufferResource();
+	buffer->Buffer = _device.CreateConstantBuffer(size);
+	buffer->Size = size;
+	return Add<ConstantBufferKey, ConstantBufferResource>(_constantBuffers, key, buffer,
+														  [this](const ConstantBufferResource& released)
+														  {
+															  _device.ReleaseResource(released.Buffer);
+														  });
+}
+
+InstanceBufferResourcePointer ResourceCache::AcquireInstanceBuffer(const std::wstring& name, uint32_t instanceSize, uint32_t maximumInstances)
+{
+	InstanceBufferKey key(name, instanceSize, maximumInstances);
+	InstanceBufferResourcePointer instanceBuffer = Find(_instanceBuffers, key);
+	if (instanceBuffer != nullptr)
+	{
+		return instanceBuffer;
+	}
+
+	InstanceBufferResource * buffer = new InstanceBufferResource();
+	buffer->Buffer = _device.CreateDynamicVertexBuffer(static_cast<size_t>(instanceSize) * maximumInstances);
+	buffer->InstanceSize = instanceSize;
+	buffer->MaximumInstances = maximumInstances;
+	return Add<InstanceBufferKey, InstanceBufferResource>(_instanceBuffers, key, buffer,
+														  [this](const InstanceBufferResource& released)
+														  {
+															  _device.ReleaseResource(released.Buffer);
+														  });
+}
+
+template <typename Key, typename Resource>
+std::shared_ptr<const Resource> ResourceCache::Find(std::map<Key, std::weak_ptr<const Resource>>& resources, const Key& key)
+{
+	auto entry = resources.find(key);
+	if (entry != resources.end())
+	{
+		std::shared_ptr<const Resource> resource = entry->second.lock();
+		if (resource != nullptr)
+		{
+			_hitCount++;
+			return resource;
+		}
+	}
+	_missCount++;
+	return nullptr;
+}
+
+template <typename Key, typename Resource>
+std::shared_ptr<const Resource> ResourceCache::Add(std::map<Key, std::weak_ptr<const Resource>>& resources, const Key& key,
+												   Resource * resource, std::function<void(const Resource&)> release)
+{
+	// When the last pointer to the resource is destroyed, release it from the device and remove it from the cache
+	std::map<Key, std::weak_ptr<const Resource>> * cache = &resources;
+	std::shared_ptr<const Resource> pointer(resource,
+											[cache, key, release](const Resource * released)
+											{
+												release(*released);
+												auto entry = cache->find(key);
+												if (entry != cache->end() && entry->second.expired())
+												{
+													cache->erase(entry);
+												}
+												delete released;
+											});
+	resources[key] = pointer;
+	return pointer;
+}
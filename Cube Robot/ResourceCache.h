@@ -0,0 +1,109 @@
+#pragma once
+#include "RenderDevice.h"
+#include "RenderQueue.h"
+#include "ShaderCompiler.h"
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+
+// The geometry of a mesh, used to create its buffers the first time it is acquired
+
+struct MeshData
+{
+	const void *		Vertices{ nullptr };
+	uint32_t			VertexStride{ 0 };
+	uint32_t			VertexCount{ 0 };
+	const uint32_t *	Indices{ nullptr };
+	uint32_t			IndexCount{ 0 };
+};
+
+// A compiled shader.  InputLayout is only set for vertex shaders.
+
+struct ShaderResource
+{
+	ResourceId			Shader{ 0 };
+	ResourceId			InputLayout{ 0 };
+};
+
+struct ConstantBufferResource
+{
+	ResourceId			Buffer{ 0 };
+	uint32_t			Size{ 0 };
+};
+
+// A buffer that holds the per-instance data for up to MaximumInstances instances
+
+struct InstanceBufferResource
+{
+	ResourceId			Buffer{ 0 };
+	uint32_t			InstanceSize{ 0 };
+	uint32_t			MaximumInstances{ 0 };
+};
+
+typedef std::shared_ptr<const MeshBuffers>				MeshResourcePointer;
+typedef std::shared_ptr<const ShaderResource>			ShaderResourcePointer;
+typedef std::shared_ptr<const ConstantBufferResource>	ConstantBufferResourcePointer;
+typedef std::shared_ptr<const InstanceBufferResource>	InstanceBufferResourcePointer;
+
+// A cache of the meshes, shaders and constant buffers created on a render device, so that nodes
+// that use the same resources share a single copy rather than each creating their own.
+//
+// Meshes are identified by name, shaders by file name, entry point and profile (and, for vertex
+// shaders, the input layout), and constant and instance buffers by name and size.  The Acquire methods return the resource if it already exists, and
+// otherwise create it.  Each resource is reference counted by the shared_ptr returned, and is
+// released from the device once the last shared_ptr to it is destroyed.  The cache must
+// therefore outlive every pointer acquired from it.
+//
+// The cache is not thread-safe.
+
+class ResourceCache
+{
+public:
+	ResourceCache(RenderDevice& device, ShaderCompiler& compiler) : _device(device), _compiler(compiler) {}
+
+	ResourceCache(const ResourceCache&) = delete;
+	ResourceCache& operator=(const ResourceCache&) = delete;
+
+	// loadMesh is only called if the mesh is not already in the cache
+	MeshResourcePointer AcquireMesh(const std::wstring& name, const std::function<void(MeshData&)>& loadMesh);
+
+	// Throws a runtime_error containing the compiler messages if the shader cannot be compiled
+	ShaderResourcePointer AcquireVertexShader(const std::wstring& fileName, const std::string& entryPoint, const std::string& profile,
+											  const VertexElement * layout, size_t layoutElementCount);
+	ShaderResourcePointer AcquirePixelShader(const std::wstring& fileName, const std::string& entryPoint, const std::string& profile);
+
+	ConstantBufferResourcePointer AcquireConstantBuffer(const std::wstring& name, uint32_t size);
+	InstanceBufferResourcePointer AcquireInstanceBuffer(const std::wstring& name, uint32_t instanceSize, uint32_t maximumInstances);
+
+	inline size_t GetHitCount() const { return _hitCount; }
+	inline size_t GetMissCount() const { return _missCount; }
+	inline size_t GetResourceCount() const { return _meshes.size() + _shaders.size() + _constantBuffers.size() + _instanceBuffers.size(); }
+
+private:
+	// The last string describes the input layout of a vertex shader, and is empty for a pixel shader
+	typedef std::tuple<std::wstring, std::string, std::string, std::string>	ShaderKey;
+	typedef std::tuple<std::wstring, uint32_t>					ConstantBufferKey;
+	typedef std::tuple<std::wstring, uint32_t, uint32_t>		InstanceBufferKey;
+
+	RenderDevice&		_device;
+	ShaderCompiler&		_compiler;
+
+	std::map<std::wstring, std::weak_ptr<const MeshBuffers>>					_meshes;
+	std::map<ShaderKey, std::weak_ptr<const ShaderResource>>					_shaders;
+	std::map<ConstantBufferKey, std::weak_ptr<const ConstantBufferResource>>	_constantBuffers;
+	std::map<InstanceBufferKey, std::weak_ptr<const InstanceBufferResource>>	_instanceBuffers;
+
+	size_t				_hitCount{ 0 };
+	size_t				_missCount{ 0 };
+
+	ShaderResourcePointer AcquireShader(const ShaderKey& key, const std::function<ShaderResource(const std::vector<char>&)>& createShader);
+
+	template <typename Key, typename Resource>
+	std::shared_ptr<const Resource> Find(std::map<Key, std::weak_ptr<const Resource>>& resources, const Key& key);
+
+	template <typename Key, typename Resource>
+	std::shared_ptr<const Resource> Add(std::map<Key, std::weak_ptr<const Resource>>& resources, const Key& key,
+										Resource * resource, std::function<void(const Resource&)> release);
+};
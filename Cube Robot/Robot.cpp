@@ -0,0 +1,103 @@
+#include "Robot.h"
+#include <cmath>
+
+using namespace std;
+
+// The shoulders are offset from the body, and the arms are attached to them
+const Vector3 ShoulderOffset(0.0f, -4.25f, 0.0f);
+
+// Every part of the robot is the same colour
+const Vector4 RobotColour(1.0f, 0.0f, 1.0f, 1.0f); //Magenta
+
+std::vector<NodeHandle> BuildRobot(SceneGraph& robot, NodePool& nodePool, const RobotCubeFactory& createCube)
+{
+	// Every copy of the robot uses the same names, so each one is its own name scope
+	robot.SetNameScope(true);
+
+	// Body
+	SceneNodePointer body = createCube(L"Body", RobotColour);
+	body->SetWorldTransform(Matrix::CreateScale(Vector3(5.0f, 8.0f, 2.5f)) * Matrix::CreateTranslation(Vector3(0.0f, 23.0f, 0.0f)));
+	robot.Add(body);
+
+	// Left Leg
+	SceneNodePointer leftLeg = createCube(L"LeftLeg", RobotColour);
+	leftLeg->SetWorldTransform(Matrix::CreateScale(Vector3(1.0f, 7.5f, 1.0f)) * Matrix::CreateTranslation(Vector3(-4.0f, 7.5f, 0.0f)));
+	robot.Add(leftLeg);
+
+	// Right Leg
+	SceneNodePointer rightLeg = createCube(L"RightLeg", RobotColour);
+	rightLeg->SetWorldTransform(Matrix::CreateScale(Vector3(1.0f, 7.5f, 1.0f)) * Matrix::CreateTranslation(Vector3(4.0f, 7.5f, 0.0f)));
+	robot.Add(rightLeg);
+
+	// Head
+	SceneNodePointer head = createCube(L"Head", RobotColour);
+	head->SetWorldTransform(Matrix::CreateScale(Vector3(3.0f, 3.0f, 3.0f)) * Matrix::CreateTranslation(Vector3(0.0f, 34.0f, 0.0f)));
+	robot.Add(head);
+
+	// Create a scene graph for the left shoulder
+	SceneGraphPointer leftShoulder = nodePool.Create<SceneGraph>(L"LeftShoulder");
+	leftShoulder->SetWorldTransform(Matrix::CreateTranslation(Vector3(-ShoulderOffset.x, ShoulderOffset.y, ShoulderOffset.z)));
+	robot.Add(leftShoulder);
+
+	// Create a scene graph for the right shoulder
+	SceneGraphPointer rightShoulder = nodePool.Create<SceneGraph>(L"RightShoulder");
+	rightShoulder->SetWorldTransform(Matrix::CreateTranslation(ShoulderOffset));
+	robot.Add(rightShoulder);
+
+	// Left Arm
+	SceneNodePointer leftArm = createCube(L"LeftArm", RobotColour);
+	leftArm->SetWorldTransform(Matrix::CreateTranslation(Vector3(-6.0f, 22.0f, 0.0f)));
+	leftShoulder->Add(leftArm);
+
+	// Right Arm
+	SceneNodePointer rightArm = createCube(L"RightArm", RobotColour);
+	rightArm->SetWorldTransform(Matrix::CreateTranslation(Vector3(6.0f, 22.0f, 0.0f)));
+	rightShoulder->Add(rightArm);
+
+	return { robot.GetHandle(&robot), robot.FindHandle(L"LeftShoulder"), robot.FindHandle(L"LeftArm"),
+			 robot.FindHandle(L"RightShoulder"), robot.FindHandle(L"RightArm") };
+}
+
+// The robot turns through half a degree each frame, and its arms swing backwards and forwards
+// once per turn.
+
+AnimationClipPointer CreateRobotClip()
+{
+	const int framesPerTurn = 720;
+	const int framesPerKey = 10;
+	shared_ptr<AnimationClip> clip = make_shared<AnimationClip>(L"Robot", framesPerTurn * ANIMATION_FRAME_TIME);
+	for (int frame = 0; frame <= framesPerTurn; frame += framesPerKey)
+	{
+		float rotationAngle = frame * 0.5f;
+
+		// Define rotation angles for the arms
+		float leftArmRotation = sin(rotationAngle * XM_PI / 180.0f) * 180.0f;  // Swinging left arm
+		float rightArmRotation = -sin(rotationAngle * XM_PI / 180.0f) * 180.0f;  // Swinging right arm
+
+		const Matrix transformations[ROBOT_JOINT_COUNT] =
+		{
+			// Apply rotation to the entire robot
+			Matrix::CreateRotationY(rotationAngle * XM_PI / 180.0f),
+
+			// The shoulders are moved directly, and the arms are attached to them
+			Matrix::CreateTranslation(Vector3(-ShoulderOffset.x, ShoulderOffset.y, ShoulderOffset.z))
+				* Matrix::CreateRotationX(leftArmRotation * XM_PI / 180.0f)
+				* Matrix::CreateTranslation(Vector3(-6.0f, 30.0f, 0.0f)),
+			Matrix::CreateScale(Vector3(1.0f, 8.5f, 1.0f)) * Matrix::CreateTranslation(Vector3(0, -4.25f, 0)) * Matrix::CreateRotationY(leftArmRotation * XM_PI / 180.0f),
+			Matrix::CreateTranslation(ShoulderOffset)
+				* Matrix::CreateRotationX(rightArmRotation * XM_PI / 180.0f)
+				* Matrix::CreateTranslation(Vector3(6.0f, 30.0f, 0.0f)),
+			Matrix::CreateScale(Vector3(1.0f, 8.5f, 1.0f)) * Matrix::CreateTranslation(Vector3(0, -4.25f, 0)) * Matrix::CreateRotationY(leftArmRotation * XM_PI / 180.0f)
+		};
+		for (uint32_t joint = 0; joint < ROBOT_JOINT_COUNT; joint++)
+		{
+			Vector3 scale;
+			Quaternion rotation;
+			Vector3 translation;
+			Matrix transformation = transformations[joint];
+			transformation.Decompose(scale, rotation, translation);
+			clip->GetTrack(joint).AddKey(frame * ANIMATION_FRAME_TIME, translation, rotation, scale);
+		}
+	}
+	return clip;
+}
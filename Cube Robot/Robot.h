@@ -0,0 +1,31 @@
+#pragma once
+#include "SceneGraph.h"
+#include "NodeAllocator.h"
+#include "Animation.h"
+#include <functional>
+#include <vector>
+
+// The Cube Robot: a body, head and legs, with an arm hanging from a shoulder on each side.  This is
+// the robot drawn by DirectXApp, and is kept here so that the crowd benchmark can build many copies
+// of exactly the same hierarchy without needing a window or a GPU.
+
+// The animation is moved on by one frame each time the scene graph is updated
+constexpr float ANIMATION_FRAME_TIME = 1.0f / 60.0f;
+
+// The joints animated by the robot's clip, in the order returned by BuildRobot: the robot itself,
+// then the shoulder and arm on each side
+constexpr uint32_t ROBOT_JOINT_COUNT = 5;
+
+// Creates each cube of the robot.  DirectXApp creates CubeNodes, while the benchmarks create nodes
+// that do not need a device.
+typedef std::function<SceneNodePointer(const std::wstring& name, const Vector4& colour)> RobotCubeFactory;
+
+// Add the parts of the robot to the scene graph given, which becomes the robot's body.  The shoulders
+// are created from the node pool and the cubes by createCube.  Returns the handles of the joints for
+// AnimationSystem::AddRig, so the robot should already have been added to the scene graph that it
+// will be drawn in.  The robot is made a name scope (see SceneGraph::SetNameScope), so its parts can
+// be found by name however many robots there are.
+std::vector<NodeHandle> BuildRobot(SceneGraph& robot, NodePool& nodePool, const RobotCubeFactory& createCube);
+
+// The robot turning around while swinging its arms, sampled at regular intervals
+AnimationClipPointer CreateRobotClip();
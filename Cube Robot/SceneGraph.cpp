@@ -1,12 +1,14 @@
 // SceneGraph.cpp
 
 #include "SceneGraph.h"  // Include the header file that declares the SceneNode class
+#include "Profiler.h"
+#include <algorithm>
 
 // Implementation of the SceneNode class methods
 
 bool SceneGraph::Initialise() {
     // Implement the logic for Initialise method
-    for (auto child : _children) {
+    for (const SceneNodePointer& child : _children) {
         if (!child->Initialise()) {
             return false;
         }
@@ -15,23 +17,115 @@ bool SceneGraph::Initialise() {
 }
 
 void SceneGraph::Update(const Matrix& worldTransformation) {
-    // Implement the logic for Update method
-    SceneNode::Update(worldTransformation);
-    for (SceneNodePointer child : _children) {
-        child->Update(_cumulativeWorldTransformation);
+    PROFILE_ZONE("SceneGraph::Update");
+    // Rather than recursing through the children, the world transformations
+    // are calculated from a flattened copy of the hierarchy. This is only
+    // rebuilt when nodes are added or removed.
+    RootState& state = GetRootState();
+    if (_hierarchyChanged) {
+        state.Hierarchy.Build(this);
+        _hierarchyChanged = false;
+        _spatialIndexChanged = true;
+    }
+    if (_threadPool != nullptr) {
+        state.Hierarchy.Update(worldTransformation, *_threadPool, _minimumTaskSize);
+    }
+    else {
+        state.Hierarchy.Update(worldTransformation);
+    }
+
+    // The spatial index only has to be built from scratch if nodes have been
+    // added or removed. Otherwise its bounds are just moved to fit the nodes.
+    if (_spatialIndexEnabled) {
+        if (_spatialIndexChanged) {
+            state.SpatialIndex.Build(state.Hierarchy.GetNodes());
+            _spatialIndexChanged = false;
+        }
+        else if (state.Hierarchy.GetUpdatedTransformCount() > 0) {
+            state.SpatialIndex.Refit();
+        }
+    }
+}
+
+void SceneGraph::EnableSpatialIndex(bool enable) {
+    _spatialIndexEnabled = enable;
+    _spatialIndexChanged = true;
+    if (!enable && _rootState != nullptr) {
+        _rootState->SpatialIndex.Clear();
+    }
+}
+
+const BoundingVolumeHierarchy& SceneGraph::GetSpatialIndex() const {
+    // Until the index has been built there is nothing in it
+    static const BoundingVolumeHierarchy emptyIndex;
+    return _rootState != nullptr ? _rootState->SpatialIndex : emptyIndex;
+}
+
+void SceneGraph::SetThreadPool(ThreadPool * threadPool, size_t minimumTaskSize) {
+    _threadPool = threadPool;
+    _minimumTaskSize = minimumTaskSize;
+}
+
+void SceneGraph::UpdateRecursive(const Matrix& worldTransformation) {
+    SceneNode::UpdateRecursive(worldTransformation);
+    for (const SceneNodePointer& child : _children) {
+        child->UpdateRecursive(_cumulativeWorldTransformation);
     }
 }
 
 void SceneGraph::Render() {
-    // Implement the logic for Render method
-    for (auto child : _children) {
-        child->Render();
+    PROFILE_ZONE("SceneGraph::Render");
+    // If culling is disabled, every node is treated as being inside the frustum
+    _cullingStatistics = CullingStatistics();
+    if (_cullingEnabled && _spatialIndexEnabled && !_spatialIndexChanged) {
+        RootState& state = GetRootState();
+        state.VisibleNodes.clear();
+        state.SpatialIndex.QueryFrustum(_viewFrustum, state.VisibleNodes, &_cullingStatistics);
+        for (SceneNode * node : state.VisibleNodes) {
+            BoundingSphere bounds;
+            if (_occlusionCuller != nullptr && node->GetWorldBounds(bounds) == BoundsType::Finite && _occlusionCuller->IsOccluded(bounds)) {
+                _cullingStatistics.NodesOccluded++;
+                continue;
+            }
+            if (node->Draw(_renderQueue)) {
+                _cullingStatistics.NodesDrawn++;
+            }
+        }
+    }
+    else {
+        RenderVisible(_viewFrustum, !_cullingEnabled, _cullingStatistics, _renderQueue, _cullingEnabled ? _occlusionCuller : nullptr);
+    }
+}
+
+void SceneGraph::RenderVisible(const Frustum& frustum, bool insideFrustum, CullingStatistics& statistics, RenderQueue * queue, OcclusionCuller * occlusionCuller) {
+    // The bounds of a scene graph enclose everything below it, so if they are outside
+    // the frustum the whole subtree can be skipped. If they are completely inside it,
+    // none of the nodes below need to be tested.
+    statistics.NodesVisited++;
+    if (_worldBoundsType == BoundsType::Empty) {
+        return;
+    }
+    if (!insideFrustum && _worldBoundsType == BoundsType::Finite) {
+        FrustumTest result = frustum.Test(_worldBounds);
+        if (result == FrustumTest::Outside) {
+            statistics.NodesCulled++;
+            return;
+        }
+        insideFrustum = (result == FrustumTest::Inside);
+    }
+    // A subtree hidden behind the occluders can be skipped in the same way
+    if (occlusionCuller != nullptr && _worldBoundsType == BoundsType::Finite && occlusionCuller->IsOccluded(_worldBounds)) {
+        statistics.NodesOccluded++;
+        return;
+    }
+    for (auto& child : _children) {
+        child->RenderVisible(frustum, insideFrustum, statistics, queue, occlusionCuller);
     }
 }
 
 void SceneGraph::Shutdown() {
     // Implement the logic for Shutdown method
-    for (auto child : _children) {
+    for (const SceneNodePointer& child : _children) {
         child->Shutdown();
     }
 }
@@ -39,25 +133,197 @@ void SceneGraph::Shutdown() {
 void SceneGraph::Add(SceneNodePointer node) {
     // Implement the logic for Add method
     _children.push_back(node);
+    node->_parent = this;
+
+    // If a scene graph was added, it is no longer a root, so its own index, flattened
+    // hierarchy and spatial index are discarded. The new nodes are indexed by the root
+    // of this scene graph, if it has created its index yet.
+    SceneGraph * graph = dynamic_cast<SceneGraph *>(node.get());
+    if (graph != nullptr) {
+        graph->_rootState.reset();
+    }
+    SceneGraph * root = GetRoot();
+    if (root->_rootState != nullptr) {
+        RegisterSubtree(root->_rootState->Registry, node.get());
+    }
+    HierarchyChanged();
 }
 
 void SceneGraph::Remove(SceneNodePointer node) {
     auto it = std::remove(_children.begin(), _children.end(), node);
-    _children.erase(it, _children.end());
+    if (it != _children.end()) {
+        _children.erase(it, _children.end());
+        SceneGraph * root = GetRoot();
+        if (root->_rootState != nullptr) {
+            UnregisterSubtree(root->_rootState->Registry, node.get());
+        }
+        // A scene graph that has been removed becomes the root of its own hierarchy,
+        // and creates its own index when it is next needed
+        node->_parent = nullptr;
+        HierarchyChanged();
+    }
+}
+
+void SceneGraph::SetNameScope(bool scope) {
+    if (scope == _nameScope) {
+        return;
+    }
+    _nameScope = scope;
+
+    // The root is always searched as a whole. Otherwise, if the root has an index, the
+    // nodes below this one are added to the new scope or the scope is released.
+    SceneGraph * root = GetRoot();
+    if (root == this || root->_rootState == nullptr) {
+        return;
+    }
+    NodeRegistry& registry = root->_rootState->Registry;
+    if (scope) {
+        _scopeIndex = registry.CreateScope();
+        AddSubtreeToScope(registry, _scopeIndex, this);
+    }
+    else {
+        registry.ReleaseScope(_scopeIndex);
+        _scopeIndex = NodeRegistry::NO_SCOPE;
+    }
 }
 
 SceneNodePointer SceneGraph::Find(const std::wstring name) {
-    // Implement the logic for Find method
-    if (_name == name) {
-        return shared_from_this();
+    uint32_t index = FindIndex(name);
+    if (index == UINT32_MAX) {
+        return nullptr;
     }
+    return GetRoot()->_rootState->Registry.GetNode(index)->shared_from_this();
+}
 
-    for (auto child : _children) {
-        SceneNodePointer  foundNode = child->Find(name);
-        if (foundNode != nullptr) {
-            return foundNode;
+NodeHandle SceneGraph::FindHandle(const std::wstring& name) {
+    uint32_t index = FindIndex(name);
+    if (index == UINT32_MAX) {
+        return NodeHandle();
+    }
+    return GetRoot()->_rootState->Registry.GetHandle(index);
+}
+
+uint32_t SceneGraph::FindIndex(const std::wstring& name) {
+    // Look the name up in the index kept by the root of the scene graph rather than
+    // searching through every node. Only the nodes in the nearest scope are checked,
+    // and if that scope is this node, every one of them is below it.
+    SceneGraph * root = GetRoot();
+    NodeRegistry& registry = root->GetRootState().Registry;
+    SceneGraph * scope = this;
+    while (scope != root && scope->_scopeIndex == NodeRegistry::NO_SCOPE) {
+        scope = static_cast<SceneGraph *>(scope->_parent);
+    }
+    if (scope == root) {
+        for (uint32_t index : registry.FindAll(name)) {
+            if (scope == this || IsAncestorOf(registry.GetNode(index))) {
+                return index;
+            }
+        }
+        return UINT32_MAX;
+    }
+    auto entries = registry.FindInScope(scope->_scopeIndex, name);
+    for (const NodeRegistry::ScopeEntry * entry = entries.first; entry != entries.second; entry++) {
+        if (scope == this || IsAncestorOf(registry.GetNode(entry->Index))) {
+            return entry->Index;
+        }
+    }
+    return UINT32_MAX;
+}
+
+NodeHandle SceneGraph::GetHandle(const SceneNode * node) {
+    if (node == nullptr || !IsAncestorOf(node)) {
+        return NodeHandle();
+    }
+    return GetRoot()->GetRootState().Registry.GetHandle(node);
+}
+
+SceneNode * SceneGraph::Resolve(NodeHandle handle) {
+    return GetRoot()->GetRootState().Registry.Resolve(handle);
+}
+
+SceneGraph::RootState& SceneGraph::GetRootState() {
+    if (_rootState == nullptr) {
+        _rootState = std::make_unique<RootState>();
+
+        // The root's index covers every node below it, including any added before it was created.
+        // Any scope the root had while it was below another scene graph belonged to that one's index.
+        if (_parent == nullptr) {
+            _scopeIndex = NodeRegistry::NO_SCOPE;
+            _rootState->Registry.Register(this);
+            for (const SceneNodePointer& child : _children) {
+                RegisterSubtree(_rootState->Registry, child.get());
+            }
         }
     }
+    return *_rootState;
+}
+
+SceneGraph * SceneGraph::GetRoot() {
+    // Only scene graphs can be parents, so every ancestor is a SceneGraph
+    SceneGraph * root = this;
+    while (root->_parent != nullptr) {
+        root = static_cast<SceneGraph *>(root->_parent);
+    }
+    return root;
+}
 
-    return nullptr;
+bool SceneGraph::IsAncestorOf(const SceneNode * node) const {
+    for (const SceneNode * current = node; current != nullptr; current = current->_parent) {
+        if (current == this) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void SceneGraph::RegisterSubtree(NodeRegistry& registry, SceneNode * node) {
+    registry.Register(node);
+
+    // Add the node to every scope it is in, including its own if it is one. Only scene
+    // graphs can be parents, so every ancestor is a SceneGraph.
+    SceneGraph * graph = dynamic_cast<SceneGraph *>(node);
+    if (graph != nullptr) {
+        graph->_scopeIndex = graph->_nameScope ? registry.CreateScope() : NodeRegistry::NO_SCOPE;
+    }
+    for (SceneGraph * scope = graph != nullptr ? graph : static_cast<SceneGraph *>(node->_parent); scope != nullptr; scope = static_cast<SceneGraph *>(scope->_parent)) {
+        if (scope->_scopeIndex != NodeRegistry::NO_SCOPE) {
+            registry.AddToScope(scope->_scopeIndex, node);
+        }
+    }
+    for (size_t i = 0; i < node->GetChildCount(); i++) {
+        RegisterSubtree(registry, node->GetChild(i).get());
+    }
+}
+
+void SceneGraph::UnregisterSubtree(NodeRegistry& registry, SceneNode * node) {
+    // The children are removed first, since they are in this node's scope if it has one
+    for (size_t i = 0; i < node->GetChildCount(); i++) {
+        UnregisterSubtree(registry, node->GetChild(i).get());
+    }
+    for (SceneGraph * scope = static_cast<SceneGraph *>(node->_parent); scope != nullptr; scope = static_cast<SceneGraph *>(scope->_parent)) {
+        if (scope->_scopeIndex != NodeRegistry::NO_SCOPE) {
+            registry.RemoveFromScope(scope->_scopeIndex, node);
+        }
+    }
+    SceneGraph * graph = dynamic_cast<SceneGraph *>(node);
+    if (graph != nullptr && graph->_scopeIndex != NodeRegistry::NO_SCOPE) {
+        registry.ReleaseScope(graph->_scopeIndex);
+        graph->_scopeIndex = NodeRegistry::NO_SCOPE;
+    }
+    registry.Unregister(node);
+}
+
+void SceneGraph::AddSubtreeToScope(NodeRegistry& registry, uint32_t scope, SceneNode * node) {
+    registry.AddToScope(scope, node);
+    for (size_t i = 0; i < node->GetChildCount(); i++) {
+        AddSubtreeToScope(registry, scope, node->GetChild(i).get());
+    }
+}
+
+void SceneGraph::HierarchyChanged() {
+    // The flattened hierarchy of this node and every node above it
+    // now needs to be rebuilt
+    for (SceneNode * node = this; node != nullptr; node = node->_parent) {
+        static_cast<SceneGraph *>(node)->_hierarchyChanged = true;
+    }
 }
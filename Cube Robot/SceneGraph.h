@@ -1,28 +1,142 @@
 #pragma once
 #include "SceneNode.h"
+#include "TransformHierarchy.h"
+#include "BoundingVolumeHierarchy.h"
+#include <memory>
 #include <vector>
 
 
 class SceneGraph : public SceneNode
 {
 public:
-    SceneGraph() : SceneNode(L"Root") {};
+    SceneGraph() : SceneGraph(L"Root") {};
     SceneGraph(wstring name) : SceneNode(name) {};
     ~SceneGraph(void) {};
 
     virtual bool Initialise(void);
     virtual void Update(const Matrix& worldTransformation);
+    virtual void UpdateRecursive(const Matrix& worldTransformation);
     virtual void Render(void);
     virtual void Shutdown(void);
+    virtual BoundsType GetLocalBounds(BoundingSphere& bounds) const { return BoundsType::Empty; }
+    virtual void RenderVisible(const Frustum& frustum, bool insideFrustum, CullingStatistics& statistics, RenderQueue * queue, OcclusionCuller * occlusionCuller);
 
     void Add(SceneNodePointer node);
     void Remove(SceneNodePointer node);
     SceneNodePointer Find(wstring name);
 
+    // Find returns a pointer to a node, but looking a node up by name every frame is
+    // wasteful.  FindHandle returns a handle to the node that can be kept and then
+    // resolved with Resolve in constant time.  Resolve returns nullptr if the node has
+    // been removed from the scene graph since the handle was obtained.  Handles should be
+    // obtained once the scene graph has been built, since adding a scene graph to another
+    // one invalidates any handles obtained from it beforehand.
+    NodeHandle FindHandle(const wstring& name);
+    SceneNode * Resolve(NodeHandle handle);
+
+    // Returns the handle of a node below this one that is already known, without looking it up
+    // by name.
+    NodeHandle GetHandle(const SceneNode * node);
+
+    // Find and FindHandle search the nearest name scope that this node is in: the nearest scene
+    // graph at or above it that has been made a scope, or else the root.  Only the nodes of that
+    // scope with the given name are checked, so when each copy of a model is its own scope, its
+    // nodes are found in constant time however many copies use the same names.  Scopes are meant
+    // for small subtrees, such as a single model.
+    void SetNameScope(bool scope);
+    bool IsNameScope() const { return _nameScope; }
+    size_t GetChildCount() const { return _children.size(); }
+    SceneNodePointer GetChild(size_t index) const { return _children[index]; }
+
+    // The number of world transformations that were recalculated by the last call to Update.
+    // Nodes are only recalculated if they, or one of their ancestors, have moved.
+    size_t GetUpdatedTransformCount() const { return _rootState != nullptr ? _rootState->Hierarchy.GetUpdatedTransformCount() : 0; }
+
+    // Spread Update across the threads of a thread pool.  Each subtree of at least
+    // minimumTaskSize nodes is updated as a separate task.  Passing nullptr goes back
+    // to updating on the calling thread.  The thread pool is not owned by the scene graph.
+    void SetThreadPool(ThreadPool * threadPool, size_t minimumTaskSize = DEFAULT_MINIMUM_TASK_SIZE);
+
+    static constexpr size_t DEFAULT_MINIMUM_TASK_SIZE = 4096;
+
+    // Once a view frustum has been set, Render skips any node (or whole subtree) whose world
+    // bounds are outside it.  The bounds are calculated by Update, so this should be called
+    // each frame after the camera has moved.  GetCullingStatistics gives the counts for the
+    // last call to Render.
+    void SetViewFrustum(const Frustum& frustum) { _viewFrustum = frustum; _cullingEnabled = true; }
+    void DisableCulling() { _cullingEnabled = false; }
+    const CullingStatistics& GetCullingStatistics() const { return _cullingStatistics; }
+
+    // While culling is enabled, Render also skips nodes (or whole subtrees) that the occlusion
+    // culler finds to be hidden.  OcclusionCuller::BeginFrame must be called each frame before
+    // Render.  The occlusion culler is not owned by the scene graph.  Passing nullptr turns
+    // occlusion culling off.
+    void SetOcclusionCuller(OcclusionCuller * occlusionCuller) { _occlusionCuller = occlusionCuller; }
+
+    // Keep a bounding volume hierarchy over the nodes below this one, updated by Update.  This
+    // is used by Render to find the visible nodes (rather than walking the scene graph), and can
+    // be used for picking and other spatial queries.  Worthwhile for large scenes, particularly
+    // if the children of each scene graph node are spread far apart.
+    void EnableSpatialIndex(bool enable);
+    const BoundingVolumeHierarchy& GetSpatialIndex() const;
+
+    // When the scene is updated at a fixed rate rather than once per frame (see FramePacer), each
+    // frame can be drawn part of the way between the last two updates, so that movement looks smooth.
+    // Once interpolation is enabled, Interpolate sets the cumulative world transformation of each
+    // node that moved in the last Update to a blend of where it was before (alpha = 0) and where it
+    // is now (alpha = 1).
+    // Only the transformations used to draw the nodes are changed.  The bounds used for culling stay
+    // those of the last Update, and the next Update starts from its results.
+    void EnableInterpolation(bool enable) { GetRootState().Hierarchy.SetInterpolationEnabled(enable); }
+    void Interpolate(float alpha) { GetRootState().Hierarchy.Interpolate(alpha); }
+
+    // If a render queue is set, Render adds the draws for each visible node to it (see
+    // SceneNode::Enqueue) rather than drawing them immediately, and skips nodes that cannot
+    // be queued. The queue is not owned by the scene graph, and it is up to the caller to
+    // sort and submit it.
+    void SetRenderQueue(RenderQueue * queue) { _renderQueue = queue; }
+
+
 
-  
 private:
+    // The index of all of the nodes in the hierarchy, the flattened copy of the hierarchy used by
+    // Update and the spatial index used by Render.  These are only kept by the root (or by a scene
+    // graph that is updated on its own), and are created the first time they are needed, so the
+    // scene graphs below the root do not each carry a copy.
+    struct RootState {
+        NodeRegistry              Registry;
+        TransformHierarchy        Hierarchy;
+        BoundingVolumeHierarchy   SpatialIndex;
+        std::vector<SceneNode *>  VisibleNodes;
+    };
+
     std::vector<SceneNodePointer> _children; // Collection of child nodes
+
+    std::unique_ptr<RootState>    _rootState;
+    bool                          _hierarchyChanged{ true };
+    ThreadPool *                  _threadPool{ nullptr };
+    size_t                        _minimumTaskSize{ DEFAULT_MINIMUM_TASK_SIZE };
+
+    Frustum                       _viewFrustum;
+    bool                          _cullingEnabled{ false };
+    CullingStatistics             _cullingStatistics;
+    OcclusionCuller *             _occlusionCuller{ nullptr };
+    bool                          _spatialIndexEnabled{ false };
+    bool                          _spatialIndexChanged{ true };
+    RenderQueue *                 _renderQueue{ nullptr };
+
+    // The scope's index in the root's registry is only set while this is below the root
+    bool                          _nameScope{ false };
+    uint32_t                      _scopeIndex{ NodeRegistry::NO_SCOPE };
+
+    void HierarchyChanged();
+    SceneGraph * GetRoot();
+    RootState& GetRootState();
+    uint32_t FindIndex(const wstring& name);
+    bool IsAncestorOf(const SceneNode * node) const;
+    static void RegisterSubtree(NodeRegistry& registry, SceneNode * node);
+    static void UnregisterSubtree(NodeRegistry& registry, SceneNode * node);
+    static void AddSubtreeToScope(NodeRegistry& registry, uint32_t scope, SceneNode * node);
 };
 
 typedef std::shared_ptr<SceneGraph> SceneGraphPointer;
@@ -0,0 +1,749 @@
+#include "SceneGraphBenchmark.h"
+#include "BenchmarkFixtures.h"
+#include "SceneGraph.h"
+#include "MatrixBatch.h"
+#include "NodeAllocator.h"
+#include "RenderQueue.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <thread>
+
+// The radius of the bounds of the nodes with nothing to draw
+constexpr float BENCHMARK_NODE_RADIUS = 0.5f;
+
+// A node that remembers whether it was drawn by the last call to SceneGraph::Render
+
+class DrawnBenchmarkNode : public BenchmarkNode
+{
+public:
+	DrawnBenchmarkNode(wstring name) : BenchmarkNode(name, BENCHMARK_NODE_RADIUS) {}
+
+	void Render() { Drawn = true; }
+
+	bool Drawn{ false };
+};
+
+// Number of children given to each SceneGraph node in the benchmark scenes
+constexpr size_t BENCHMARK_BRANCHING_FACTOR = 8;
+
+// Number of updates that are timed for each scene
+constexpr int BENCHMARK_FRAMES = 20;
+
+// In the incremental update benchmark, one node in every BENCHMARK_ANIMATED_STRIDE is moved each frame
+constexpr size_t BENCHMARK_ANIMATED_STRIDE = 20;
+
+// Number of copies of the same model in the name lookup benchmark
+constexpr size_t BENCHMARK_LOOKUP_MODELS = 4096;
+
+// Creates nodes with make_shared, for comparison with NodePool and NodeArena
+
+struct HeapNodeFactory
+{
+	template <typename T, typename... Args>
+	shared_ptr<T> Create(Args&&... args) { return make_shared<T>(std::forward<Args>(args)...); }
+
+	size_t GetReservedBytes() const { return 0; }
+};
+
+// Build a scene graph containing nodeCount nodes (including the root).  Nodes are created
+// breadth-first with each SceneGraph node given BENCHMARK_BRANCHING_FACTOR children, which
+// gives a hierarchy similar in shape to a large number of small models.  The nodes are created
+// by the Create method of factory.
+
+template <typename NodeFactory>
+SceneGraphPointer BuildBenchmarkScene(size_t nodeCount, NodeFactory& factory)
+{
+	SceneGraphPointer root = factory.template Create<SceneGraph>();
+	vector<SceneGraph *> parents;
+	parents.push_back(root.get());
+	size_t created = 1;
+	size_t nextParent = 0;
+	while (created < nodeCount && nextParent < parents.size())
+	{
+		SceneGraph * parent = parents[nextParent++];
+		for (size_t i = 0; i < BENCHMARK_BRANCHING_FACTOR && created < nodeCount; i++)
+		{
+			// Only create more SceneGraph nodes if the remaining parents
+			// cannot hold all of the nodes that are still to be created
+			size_t remainingCapacity = (parents.size() - nextParent) * BENCHMARK_BRANCHING_FACTOR;
+			SceneNodePointer node;
+			wstring name = L"Node" + to_wstring(created);
+			if (created + remainingCapacity < nodeCount)
+			{
+				SceneGraphPointer graph = factory.template Create<SceneGraph>(name);
+				parents.push_back(graph.get());
+				node = graph;
+			}
+			else
+			{
+				node = factory.template Create<BenchmarkNode>(name, BENCHMARK_NODE_RADIUS);
+			}
+			float angle = static_cast<float>(created % 360) * XM_PI / 180.0f;
+			node->SetWorldTransform(Matrix::CreateRotationY(angle) * Matrix::CreateTranslation(Vector3(1.0f, 0.5f, 0.0f)));
+			parent->Add(node);
+			created++;
+		}
+	}
+	return root;
+}
+
+SceneGraphPointer BuildBenchmarkScene(size_t nodeCount)
+{
+	HeapNodeFactory factory;
+	return BuildBenchmarkScene(nodeCount, factory);
+}
+
+// Where the nodes of the occlusion benchmark are placed, relative to a wall with a doorway in it
+
+enum class OcclusionPlacement
+{
+	BehindWall,				// Completely hidden
+	BehindDoorway,			// Seen through the doorway
+	InFrontOfWall
+};
+
+constexpr float OCCLUSION_WALL_DISTANCE = 20.0f;
+constexpr float OCCLUSION_WALL_SIZE = 30.0f;
+constexpr float OCCLUSION_DOORWAY_SIZE = 2.0f;
+
+// Build a wall facing the camera (which is at the origin looking along z), with a square doorway in
+// the middle.  Behind it, and in front of it, are nodeCount nodes in groups of BENCHMARK_BRANCHING_FACTOR.
+// Every group is given one of the placements.  Positions are chosen by the tangents of the angles
+// from the camera, keeping the nodes a few pixels of the occlusion buffer away from the doorway edges.
+
+SceneGraphPointer BuildOcclusionScene(size_t nodeCount, SceneNodePointer& wall, vector<Vector3>& wallVertices, vector<uint32_t>& wallIndices,
+									  vector<pair<shared_ptr<DrawnBenchmarkNode>, OcclusionPlacement>>& nodes)
+{
+	SceneGraphPointer root = make_shared<SceneGraph>();
+	wall = make_shared<BenchmarkNode>(L"Wall", BENCHMARK_NODE_RADIUS);
+	wall->SetWorldTransform(Matrix::CreateTranslation(Vector3(0.0f, 0.0f, OCCLUSION_WALL_DISTANCE)));
+	root->Add(wall);
+
+	// The wall is made of four rectangles around the doorway
+	const float outer = OCCLUSION_WALL_SIZE;
+	const float inner = OCCLUSION_DOORWAY_SIZE;
+	const float rectangles[4][4] = { { -outer, -outer, outer, -inner }, { -outer, inner, outer, outer }, { -outer, -inner, -inner, inner }, { inner, -inner, outer, inner } };
+	wallVertices.clear();
+	wallIndices.clear();
+	for (const float * rectangle : rectangles)
+	{
+		uint32_t first = static_cast<uint32_t>(wallVertices.size());
+		wallVertices.push_back(Vector3(rectangle[0], rectangle[1], 0.0f));
+		wallVertices.push_back(Vector3(rectangle[0], rectangle[3], 0.0f));
+		wallVertices.push_back(Vector3(rectangle[2], rectangle[3], 0.0f));
+		wallVertices.push_back(Vector3(rectangle[2], rectangle[1], 0.0f));
+		for (uint32_t index : { 0u, 1u, 2u, 0u, 2u, 3u })
+		{
+			wallIndices.push_back(first + index);
+		}
+	}
+
+	mt19937 random(54321);
+	uniform_real_distribution<float> behindDistances(40.0f, 200.0f);
+	uniform_real_distribution<float> frontDistances(5.0f, 15.0f);
+	uniform_real_distribution<float> across(-0.7f, 0.7f);
+	uniform_real_distribution<float> wallHeights(0.15f, 0.35f);
+	uniform_real_distribution<float> doorway(-0.05f, 0.05f);
+	uniform_real_distribution<float> heights(-0.35f, 0.35f);
+	nodes.clear();
+	for (size_t i = 0; i < nodeCount; i += BENCHMARK_BRANCHING_FACTOR)
+	{
+		SceneGraphPointer group = make_shared<SceneGraph>(L"Group" + to_wstring(i));
+		OcclusionPlacement placement = (i / BENCHMARK_BRANCHING_FACTOR) % 4 == 3 ? OcclusionPlacement::InFrontOfWall :
+									   (i / BENCHMARK_BRANCHING_FACTOR) % 4 == 2 ? OcclusionPlacement::BehindDoorway : OcclusionPlacement::BehindWall;
+		for (size_t j = 0; j < BENCHMARK_BRANCHING_FACTOR && i + j < nodeCount; j++)
+		{
+			float distance;
+			float x;
+			float y;
+			switch (placement)
+			{
+				case OcclusionPlacement::BehindWall:
+					distance = behindDistances(random);
+					x = across(random);
+					y = (random() & 1) ? wallHeights(random) : -wallHeights(random);
+					break;
+				case OcclusionPlacement::BehindDoorway:
+					distance = behindDistances(random);
+					x = doorway(random);
+					y = doorway(random);
+					break;
+				default:
+					distance = frontDistances(random);
+					x = across(random);
+					y = heights(random);
+					break;
+			}
+			shared_ptr<DrawnBenchmarkNode> node = make_shared<DrawnBenchmarkNode>(L"Node" + to_wstring(i + j));
+			node->SetWorldTransform(Matrix::CreateTranslation(Vector3(x * distance, y * distance, distance)));
+			group->Add(node);
+			nodes.push_back(make_pair(node, placement));
+		}
+		root->Add(group);
+	}
+	return root;
+}
+
+// Collect all of the nodes in a scene graph in depth-first order
+
+void CollectNodes(SceneNodePointer node, vector<SceneNodePointer>& nodes)
+{
+	nodes.push_back(node);
+	for (size_t i = 0; i < node->GetChildCount(); i++)
+	{
+		CollectNodes(node->GetChild(i), nodes);
+	}
+}
+
+// Time a scene graph update function over a number of frames, returning
+// the average number of nanoseconds taken per node
+
+template <typename UpdateFunction>
+double TimeUpdate(size_t nodeCount, UpdateFunction update)
+{
+	// One untimed update so that any one-off work (such as building
+	// the flattened hierarchy) is not included in the timings
+	update();
+	auto start = chrono::steady_clock::now();
+	for (int frame = 0; frame < BENCHMARK_FRAMES; frame++)
+	{
+		update();
+	}
+	auto end = chrono::steady_clock::now();
+	double nanoseconds = static_cast<double>(chrono::duration_cast<chrono::nanoseconds>(end - start).count());
+	return nanoseconds / (static_cast<double>(BENCHMARK_FRAMES) * nodeCount);
+}
+
+int RunSceneGraphBenchmarks(const std::string& resultsFileName)
+{
+	ofstream results(resultsFileName);
+	if (!results)
+	{
+		return -1;
+	}
+
+	const size_t sceneSizes[] = { 1000, 10000, 100000, 1000000 };
+	Matrix identity;
+
+	// Full updates, where the root moves every frame so that every node has to be recalculated
+	results << "benchmark,nodes,recursive_ns_per_node,flattened_ns_per_node,speedup,updated_transforms" << endl;
+	for (size_t nodeCount : sceneSizes)
+	{
+		SceneGraphPointer sceneGraph = BuildBenchmarkScene(nodeCount);
+		float angle = 0.0f;
+		auto moveRoot = [&]()
+		{
+			angle += 0.01f;
+			sceneGraph->SetWorldTransform(Matrix::CreateRotationY(angle));
+		};
+		double recursive = TimeUpdate(nodeCount, [&]() { moveRoot(); sceneGraph->UpdateRecursive(identity); });
+		double flattened = TimeUpdate(nodeCount, [&]() { moveRoot(); sceneGraph->Update(identity); });
+		results << "update," << nodeCount << "," << recursive << "," << flattened << "," << recursive / flattened << "," << sceneGraph->GetUpdatedTransformCount() << endl;
+	}
+
+	// Incremental updates, where only one node in every BENCHMARK_ANIMATED_STRIDE moves each frame
+	for (size_t nodeCount : sceneSizes)
+	{
+		SceneGraphPointer sceneGraph = BuildBenchmarkScene(nodeCount);
+		vector<SceneNodePointer> nodes;
+		CollectNodes(sceneGraph, nodes);
+		vector<SceneNodePointer> animatedNodes;
+		for (size_t i = 1; i < nodes.size(); i += BENCHMARK_ANIMATED_STRIDE)
+		{
+			animatedNodes.push_back(nodes[i]);
+		}
+		float angle = 0.0f;
+		auto moveNodes = [&]()
+		{
+			angle += 0.01f;
+			Matrix rotation = Matrix::CreateRotationY(angle);
+			for (SceneNodePointer& node : animatedNodes)
+			{
+				node->SetWorldTransform(rotation);
+			}
+		};
+		double recursive = TimeUpdate(nodeCount, [&]() { moveNodes(); sceneGraph->UpdateRecursive(identity); });
+		double flattened = TimeUpdate(nodeCount, [&]() { moveNodes(); sceneGraph->Update(identity); });
+		results << "incremental_update," << nodeCount << "," << recursive << "," << flattened << "," << recursive / flattened << "," << sceneGraph->GetUpdatedTransformCount() << endl;
+	}
+
+	// Full updates with each of the instruction sets that the batched matrix calculation can use.  The
+	// results of each are checked against the scalar calculation, which they should match exactly.
+	MatrixInstructionSet defaultInstructionSet = GetMatrixInstructionSet();
+	const MatrixInstructionSet instructionSets[] = { MatrixInstructionSet::Scalar, MatrixInstructionSet::SSE, MatrixInstructionSet::AVX2, MatrixInstructionSet::AVX512 };
+	bool instructionSetsMatch = true;
+	results << "benchmark,nodes,instruction_set,ns_per_node,matches_scalar" << endl;
+	for (size_t nodeCount : sceneSizes)
+	{
+		SceneGraphPointer sceneGraph = BuildBenchmarkScene(nodeCount);
+		vector<SceneNodePointer> nodes;
+		CollectNodes(sceneGraph, nodes);
+		Matrix referenceTransformation = Matrix::CreateRotationY(1.0f);
+		vector<Matrix> scalarResults;
+		for (MatrixInstructionSet instructionSet : instructionSets)
+		{
+			if (!SetMatrixInstructionSet(instructionSet))
+			{
+				continue;
+			}
+			float angle = 0.0f;
+			double batched = TimeUpdate(nodeCount, [&]()
+										{
+											angle += 0.01f;
+											sceneGraph->SetWorldTransform(Matrix::CreateRotationY(angle));
+											sceneGraph->Update(identity);
+										});
+
+			sceneGraph->SetWorldTransform(referenceTransformation);
+			sceneGraph->Update(identity);
+			bool matches = true;
+			if (instructionSet == MatrixInstructionSet::Scalar)
+			{
+				for (SceneNodePointer& node : nodes)
+				{
+					scalarResults.push_back(node->GetCumulativeWorldTransform());
+				}
+			}
+			else
+			{
+				for (size_t i = 0; i < nodes.size() && matches; i++)
+				{
+					matches = memcmp(&scalarResults[i], &nodes[i]->GetCumulativeWorldTransform(), sizeof(Matrix)) == 0;
+				}
+			}
+			instructionSetsMatch = instructionSetsMatch && matches;
+			results << "matrix_batch," << nodeCount << "," << GetMatrixInstructionSetName(instructionSet) << "," << batched << "," << (matches ? "yes" : "no") << endl;
+		}
+	}
+	SetMatrixInstructionSet(defaultInstructionSet);
+
+	// Parallel updates using from 1 thread up to the number of hardware threads available.  The
+	// results of each parallel update are checked against those of the single-threaded update.
+	const size_t parallelSceneSizes[] = { 10000, 100000, 1000000 };
+	unsigned int maximumThreads = max(thread::hardware_concurrency(), 1u);
+	bool parallelMatches = true;
+	results << "benchmark,nodes,threads,ns_per_node,speedup,matches_serial" << endl;
+	for (size_t nodeCount : parallelSceneSizes)
+	{
+		SceneGraphPointer sceneGraph = BuildBenchmarkScene(nodeCount);
+		vector<SceneNodePointer> nodes;
+		CollectNodes(sceneGraph, nodes);
+
+		Matrix referenceTransformation = Matrix::CreateRotationY(1.0f);
+		sceneGraph->SetWorldTransform(referenceTransformation);
+		sceneGraph->Update(identity);
+		vector<Matrix> serialResults;
+		for (SceneNodePointer& node : nodes)
+		{
+			serialResults.push_back(node->GetCumulativeWorldTransform());
+		}
+
+		double singleThreaded = 0.0;
+		for (unsigned int threads = 1; threads <= maximumThreads; threads *= 2)
+		{
+			ThreadPool threadPool(threads);
+			sceneGraph->SetThreadPool(&threadPool);
+			float angle = 0.0f;
+			double parallel = TimeUpdate(nodeCount, [&]()
+										 {
+											 angle += 0.01f;
+											 sceneGraph->SetWorldTransform(Matrix::CreateRotationY(angle));
+											 sceneGraph->Update(identity);
+										 });
+			if (threads == 1)
+			{
+				singleThreaded = parallel;
+			}
+
+			sceneGraph->SetWorldTransform(referenceTransformation);
+			sceneGraph->Update(identity);
+			bool matches = true;
+			for (size_t i = 0; i < nodes.size() && matches; i++)
+			{
+				matches = memcmp(&serialResults[i], &nodes[i]->GetCumulativeWorldTransform(), sizeof(Matrix)) == 0;
+			}
+			sceneGraph->SetThreadPool(nullptr);
+			parallelMatches = parallelMatches && matches;
+			results << "parallel_update," << nodeCount << "," << threads << "," << parallel << "," << singleThreaded / parallel << "," << (matches ? "yes" : "no") << endl;
+
+			// Make sure that the largest thread count is always measured
+			if (threads < maximumThreads && threads * 2 > maximumThreads)
+			{
+				threads = maximumThreads / 2;
+			}
+		}
+	}
+
+	// A serial and a threaded update of the same scene, with interpolation enabled, over frames in which
+	// the root moves and frames in which only some leaves move.  Each update must recalculate exactly the
+	// nodes that moved or are below a node that moved, and the threaded update must give the same
+	// transformations, and the same interpolated transformations, as the serial one.  Small tasks are
+	// used so that most subtrees are updated by their own task.
+	results << "benchmark,nodes,threads,frame,moved,expected_updates,serial_updates,threaded_updates,transforms_match,interpolated_match" << endl;
+	for (size_t nodeCount : { 10000, 100000 })
+	{
+		SceneGraphPointer serialScene = BuildBenchmarkScene(nodeCount);
+		SceneGraphPointer threadedScene = BuildBenchmarkScene(nodeCount);
+		vector<SceneNodePointer> serialNodes;
+		vector<SceneNodePointer> threadedNodes;
+		CollectNodes(serialScene, serialNodes);
+		CollectNodes(threadedScene, threadedNodes);
+		unsigned int threads = max(maximumThreads, 2u);
+		ThreadPool threadPool(threads);
+		threadedScene->SetThreadPool(&threadPool, 16);
+		serialScene->EnableInterpolation(true);
+		threadedScene->EnableInterpolation(true);
+		for (int frame = 0; frame < 6; frame++)
+		{
+			// Odd frames move every 97th leaf, and the others move the root
+			size_t moved = 0;
+			for (size_t i = 0; i < serialNodes.size(); i++)
+			{
+				bool moveNode = frame % 2 == 0 ? i == 0 : serialNodes[i]->GetChildCount() == 0 && i % 97 == 0;
+				if (moveNode)
+				{
+					Matrix transformation = Matrix::CreateRotationY(0.01f * (frame + 1)) * serialNodes[i]->GetWorldTransform();
+					serialNodes[i]->SetWorldTransform(transformation);
+					threadedNodes[i]->SetWorldTransform(transformation);
+					moved++;
+				}
+			}
+			size_t expectedUpdates = frame % 2 == 0 ? serialNodes.size() : moved;
+			serialScene->Update(identity);
+			threadedScene->Update(identity);
+			bool transformsMatch = true;
+			for (size_t i = 0; i < serialNodes.size() && transformsMatch; i++)
+			{
+				transformsMatch = memcmp(&serialNodes[i]->GetCumulativeWorldTransform(), &threadedNodes[i]->GetCumulativeWorldTransform(), sizeof(Matrix)) == 0;
+			}
+			serialScene->Interpolate(0.5f);
+			threadedScene->Interpolate(0.5f);
+			bool interpolatedMatch = true;
+			for (size_t i = 0; i < serialNodes.size() && interpolatedMatch; i++)
+			{
+				interpolatedMatch = memcmp(&serialNodes[i]->GetCumulativeWorldTransform(), &threadedNodes[i]->GetCumulativeWorldTransform(), sizeof(Matrix)) == 0;
+			}
+			size_t serialUpdates = serialScene->GetUpdatedTransformCount();
+			size_t threadedUpdates = threadedScene->GetUpdatedTransformCount();
+			parallelMatches = parallelMatches && transformsMatch && interpolatedMatch && serialUpdates == expectedUpdates && threadedUpdates == expectedUpdates;
+			results << "parallel_interpolation," << nodeCount << "," << threads << "," << frame << "," << moved << "," << expectedUpdates << "," << serialUpdates << ","
+					<< threadedUpdates << "," << (transformsMatch ? "yes" : "no") << "," << (interpolatedMatch ? "yes" : "no") << endl;
+		}
+		threadedScene->SetThreadPool(nullptr);
+	}
+
+	// A task that throws must not stop the rest from running or leave Wait waiting for ever, and Wait
+	// must pass the exception on.  The pool must still work afterwards.
+	bool exceptionsPassedOn = true;
+	results << "benchmark,threads,tasks,completed,rethrown,completed_after,passes" << endl;
+	for (unsigned int threads : { 1u, max(maximumThreads, 2u) })
+	{
+		ThreadPool threadPool(threads);
+		const size_t taskCount = 64;
+		atomic<size_t> completed{ 0 };
+		for (size_t i = 0; i < taskCount; i++)
+		{
+			threadPool.Submit([&completed, i]()
+							  {
+								  if (i == taskCount / 2)
+								  {
+									  throw runtime_error("task failed");
+								  }
+								  completed++;
+							  });
+		}
+		bool rethrown = false;
+		try
+		{
+			threadPool.Wait();
+		}
+		catch (const runtime_error&)
+		{
+			rethrown = true;
+		}
+		size_t completedBefore = completed;
+		threadPool.Submit([&completed]() { completed++; });
+		threadPool.Wait();
+		bool passes = rethrown && completedBefore == taskCount - 1 && completed == taskCount;
+		exceptionsPassedOn = exceptionsPassedOn && passes;
+		results << "thread_pool_exception," << threads << "," << taskCount << "," << completedBefore << "," << (rethrown ? "yes" : "no") << ","
+				<< completed - completedBefore << "," << (passes ? "yes" : "no") << endl;
+	}
+
+	// Building, updating and destroying scenes whose nodes are created with make_shared, from a
+	// NodePool and from a NodeArena.  Destroying includes freeing the pool or arena's memory.  The
+	// transformations calculated for each scene are checked against those of the make_shared scene.
+	bool allocatorsMatch = true;
+	results << "benchmark,nodes,allocator,build_ns_per_node,update_ns_per_node,destroy_ns_per_node,reserved_bytes,matches_heap" << endl;
+	for (size_t nodeCount : { 10000, 100000, 1000000 })
+	{
+		vector<Matrix> heapResults;
+		auto timeAllocator = [&](const char * allocatorName, auto& factory, auto releaseMemory)
+		{
+			auto nanosecondsPerNode = [&](chrono::steady_clock::time_point start)
+			{
+				return static_cast<double>(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count()) / nodeCount;
+			};
+			auto start = chrono::steady_clock::now();
+			SceneGraphPointer sceneGraph = BuildBenchmarkScene(nodeCount, factory);
+			double build = nanosecondsPerNode(start);
+
+			float angle = 0.0f;
+			double update = TimeUpdate(nodeCount, [&]()
+									   {
+										   angle += 0.01f;
+										   sceneGraph->SetWorldTransform(Matrix::CreateRotationY(angle));
+										   sceneGraph->Update(identity);
+									   });
+			sceneGraph->SetWorldTransform(Matrix::CreateRotationY(1.0f));
+			sceneGraph->Update(identity);
+			vector<SceneNodePointer> nodes;
+			CollectNodes(sceneGraph, nodes);
+			bool matches = true;
+			if (heapResults.empty())
+			{
+				for (SceneNodePointer& node : nodes)
+				{
+					heapResults.push_back(node->GetCumulativeWorldTransform());
+				}
+			}
+			else
+			{
+				for (size_t i = 0; i < nodes.size() && matches; i++)
+				{
+					matches = memcmp(&heapResults[i], &nodes[i]->GetCumulativeWorldTransform(), sizeof(Matrix)) == 0;
+				}
+			}
+			nodes.clear();
+			size_t reservedBytes = factory.GetReservedBytes();
+
+			start = chrono::steady_clock::now();
+			sceneGraph.reset();
+			matches = releaseMemory() && matches;
+			double destroy = nanosecondsPerNode(start);
+			allocatorsMatch = allocatorsMatch && matches;
+			results << "allocation," << nodeCount << "," << allocatorName << "," << build << "," << update << "," << destroy << "," << reservedBytes << "," << (matches ? "yes" : "no") << endl;
+		};
+		HeapNodeFactory heap;
+		timeAllocator("make_shared", heap, []() { return true; });
+		NodePool pool;
+		timeAllocator("pool", pool, [&]() { return pool.Release(); });
+		NodeArena arena;
+		timeAllocator("arena", arena, [&]() { return arena.Reset(); });
+	}
+
+	// Rendering with and without frustum culling, with a camera that can only see part of the scene
+	Matrix viewTransformation = XMMatrixLookAtLH(Vector3(0.0f, 0.0f, -20.0f), Vector3(8.0f, 0.0f, 0.0f), Vector3(0.0f, 1.0f, 0.0f));
+	Matrix projectionTransformation = XMMatrixPerspectiveFovLH(XM_PI / 8.0f, 4.0f / 3.0f, 1.0f, 10000.0f);
+	Frustum frustum(viewTransformation * projectionTransformation);
+	results << "benchmark,nodes,unculled_ns_per_node,culled_ns_per_node,visited,culled,drawn" << endl;
+	for (size_t nodeCount : sceneSizes)
+	{
+		SceneGraphPointer sceneGraph = BuildBenchmarkScene(nodeCount);
+		sceneGraph->Update(identity);
+		sceneGraph->DisableCulling();
+		double unculled = TimeUpdate(nodeCount, [&]() { sceneGraph->Render(); });
+		sceneGraph->SetViewFrustum(frustum);
+		double culled = TimeUpdate(nodeCount, [&]() { sceneGraph->Render(); });
+		const CullingStatistics& statistics = sceneGraph->GetCullingStatistics();
+		results << "culling," << nodeCount << "," << unculled << "," << culled << "," << statistics.NodesVisited << "," << statistics.NodesCulled << "," << statistics.NodesDrawn << endl;
+	}
+
+	// The same culling using the bounding volume hierarchy, the cost of keeping it up to date and
+	// picking with it.  Each pick is checked against the result of testing every node in turn.
+	results << "benchmark,nodes,update_ns_per_node,indexed_update_ns_per_node,culled_ns_per_node,drawn,brute_force_pick_ns,pick_ns,picks_match" << endl;
+	for (size_t nodeCount : sceneSizes)
+	{
+		SceneGraphPointer sceneGraph = BuildBenchmarkScene(nodeCount);
+		float angle = 0.0f;
+		auto moveRoot = [&]()
+		{
+			angle += 0.01f;
+			sceneGraph->SetWorldTransform(Matrix::CreateRotationY(angle));
+		};
+		double update = TimeUpdate(nodeCount, [&]() { moveRoot(); sceneGraph->Update(identity); });
+		sceneGraph->EnableSpatialIndex(true);
+		double indexedUpdate = TimeUpdate(nodeCount, [&]() { moveRoot(); sceneGraph->Update(identity); });
+		sceneGraph->SetViewFrustum(frustum);
+		double culled = TimeUpdate(nodeCount, [&]() { sceneGraph->Render(); });
+
+		vector<SceneNodePointer> nodes;
+		CollectNodes(sceneGraph, nodes);
+		vector<Ray> rays;
+		Vector3 rayStart(0.0f, 0.0f, -20.0f);
+		for (size_t i = 1; i < nodes.size(); i += max<size_t>(nodes.size() / 100, 1))
+		{
+			Vector3 direction = nodes[i]->GetCumulativeWorldTransform().Translation() - rayStart;
+			direction.Normalize();
+			rays.push_back(Ray(rayStart, direction));
+		}
+		vector<float> bruteForceDistances;
+		auto start = chrono::steady_clock::now();
+		for (const Ray& ray : rays)
+		{
+			float closestDistance = FLT_MAX;
+			for (SceneNodePointer& node : nodes)
+			{
+				BoundingSphere bounds;
+				float distance;
+				if (node->GetChildCount() == 0 && node->GetWorldBounds(bounds) == BoundsType::Finite && ray.Intersects(bounds, distance))
+				{
+					closestDistance = min(closestDistance, distance);
+				}
+			}
+			bruteForceDistances.push_back(closestDistance);
+		}
+		auto end = chrono::steady_clock::now();
+		double bruteForcePick = static_cast<double>(chrono::duration_cast<chrono::nanoseconds>(end - start).count()) / rays.size();
+
+		bool picksMatch = true;
+		start = chrono::steady_clock::now();
+		for (size_t i = 0; i < rays.size(); i++)
+		{
+			float distance = FLT_MAX;
+			sceneGraph->GetSpatialIndex().Pick(rays[i], distance);
+			picksMatch = picksMatch && fabsf(distance - bruteForceDistances[i]) <= 1e-4f * max(1.0f, distance);
+		}
+		end = chrono::steady_clock::now();
+		double pick = static_cast<double>(chrono::duration_cast<chrono::nanoseconds>(end - start).count()) / rays.size();
+		results << "spatial_index," << nodeCount << "," << update << "," << indexedUpdate << "," << culled << "," << sceneGraph->GetCullingStatistics().NodesDrawn << ","
+				<< bruteForcePick << "," << pick << "," << (picksMatch ? "yes" : "no") << endl;
+	}
+
+	// Frustum culling alone, then with occlusion culling, in a scene where a wall hides half of the
+	// nodes.  The time for occlusion culling includes drawing the wall into the occlusion buffer.
+	// Every node behind the solid part of the wall should be culled, and no node that can be seen
+	// (through the doorway or in front of the wall) may be.
+	Matrix occlusionView = XMMatrixLookAtLH(Vector3(0.0f, 0.0f, 0.0f), Vector3(0.0f, 0.0f, 1.0f), Vector3(0.0f, 1.0f, 0.0f));
+	Matrix occlusionProjection = XMMatrixPerspectiveFovLH(XM_PI / 4.0f, 2.0f, 1.0f, 1000.0f);
+	Matrix occlusionViewProjection = occlusionView * occlusionProjection;
+	bool occludedCorrectly = true;
+	results << "benchmark,nodes,frustum_ns_per_node,occlusion_ns_per_node,drawn_without_occlusion,drawn,occluded,rasterize_us,test_us,occluded_correctly" << endl;
+	for (size_t nodeCount : { 1000, 10000, 100000 })
+	{
+		SceneNodePointer wall;
+		vector<Vector3> wallVertices;
+		vector<uint32_t> wallIndices;
+		vector<pair<shared_ptr<DrawnBenchmarkNode>, OcclusionPlacement>> nodes;
+		SceneGraphPointer sceneGraph = BuildOcclusionScene(nodeCount, wall, wallVertices, wallIndices, nodes);
+		sceneGraph->Update(identity);
+		sceneGraph->SetViewFrustum(Frustum(occlusionViewProjection));
+		double frustumOnly = TimeUpdate(nodeCount, [&]() { sceneGraph->Render(); });
+		size_t drawnWithoutOcclusion = sceneGraph->GetCullingStatistics().NodesDrawn;
+
+		OcclusionCuller occlusionCuller;
+		occlusionCuller.AddOccluder(wall, wallVertices, wallIndices);
+		sceneGraph->SetOcclusionCuller(&occlusionCuller);
+		double occlusion = TimeUpdate(nodeCount, [&]() { occlusionCuller.BeginFrame(occlusionViewProjection); sceneGraph->Render(); });
+
+		for (auto& node : nodes)
+		{
+			node.first->Drawn = false;
+		}
+		occlusionCuller.BeginFrame(occlusionViewProjection);
+		sceneGraph->Render();
+		for (auto& node : nodes)
+		{
+			occludedCorrectly = occludedCorrectly && node.first->Drawn == (node.second != OcclusionPlacement::BehindWall);
+		}
+		const CullingStatistics& statistics = sceneGraph->GetCullingStatistics();
+		const OcclusionStatistics& occlusionStatistics = occlusionCuller.GetStatistics();
+		results << "occlusion," << nodeCount << "," << frustumOnly << "," << occlusion << "," << drawnWithoutOcclusion << "," << statistics.NodesDrawn << ","
+				<< occlusionStatistics.NodesOccluded << "," << occlusionStatistics.RasterizeTime << "," << occlusionStatistics.TestTime << ","
+				<< (occludedCorrectly ? "yes" : "no") << endl;
+	}
+
+	// Once a render queue is set, it may be submitted on another thread (see FramePipeline), so nodes
+	// that cannot be added to it must be skipped rather than drawn immediately
+	bool unqueuedSkipped = true;
+	{
+		SceneGraphPointer sceneGraph = make_shared<SceneGraph>();
+		vector<shared_ptr<DrawnBenchmarkNode>> nodes;
+		for (size_t i = 0; i < BENCHMARK_BRANCHING_FACTOR; i++)
+		{
+			nodes.push_back(make_shared<DrawnBenchmarkNode>(L"Node" + to_wstring(i)));
+			sceneGraph->Add(nodes.back());
+		}
+		sceneGraph->Initialise();
+		sceneGraph->Update(identity);
+		RenderQueue queue;
+		sceneGraph->SetRenderQueue(&queue);
+		sceneGraph->Render();
+		unqueuedSkipped = sceneGraph->GetCullingStatistics().NodesDrawn == 0 && queue.GetPacketCount() == 0;
+		for (const auto& node : nodes)
+		{
+			unqueuedSkipped = unqueuedSkipped && !node->Drawn;
+		}
+
+		// Without a queue, they are drawn immediately
+		sceneGraph->SetRenderQueue(nullptr);
+		sceneGraph->Render();
+		unqueuedSkipped = unqueuedSkipped && sceneGraph->GetCullingStatistics().NodesDrawn == nodes.size();
+		for (const auto& node : nodes)
+		{
+			unqueuedSkipped = unqueuedSkipped && node->Drawn;
+		}
+	}
+	results << "benchmark,unqueued_nodes_skipped" << endl;
+	results << "render_queue," << (unqueuedSkipped ? "yes" : "no") << endl;
+
+	// Every model uses the same names.  Without scopes, finding a part of one model checks the parts
+	// of every model with that name, while with each model its own scope only its own parts are
+	// checked.  The parts must still be found from the model's joint (which is not a scope), after
+	// another model has been removed, and in the removed model once it has become a root.
+	bool foundCorrectly = true;
+	results << "benchmark,models,scoped,ns_per_lookup,scene_graph_bytes,found_correctly" << endl;
+	for (bool scoped : { false, true })
+	{
+		SceneGraphPointer root = make_shared<SceneGraph>();
+		vector<SceneGraphPointer> models;
+		vector<SceneNode *> lastParts;
+		for (size_t i = 0; i < BENCHMARK_LOOKUP_MODELS; i++)
+		{
+			SceneGraphPointer model = make_shared<SceneGraph>(L"Model");
+			root->Add(model);
+			model->SetNameScope(scoped);
+			SceneGraphPointer joint = make_shared<SceneGraph>(L"Joint");
+			model->Add(joint);
+			for (size_t part = 0; part < BENCHMARK_BRANCHING_FACTOR; part++)
+			{
+				SceneNodePointer node = make_shared<BenchmarkNode>(L"Part" + to_wstring(part));
+				joint->Add(node);
+				lastParts.push_back(node.get());
+			}
+			models.push_back(model);
+		}
+		const wstring lastPart = L"Part" + to_wstring(BENCHMARK_BRANCHING_FACTOR - 1);
+		vector<NodeHandle> handles(models.size());
+		// The root's index is created by the first lookup, which is not timed
+		root->FindHandle(lastPart);
+		auto start = chrono::steady_clock::now();
+		for (size_t i = 0; i < models.size(); i++)
+		{
+			handles[i] = models[i]->FindHandle(lastPart);
+		}
+		double lookup = static_cast<double>(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count()) / models.size();
+		for (size_t i = 0; i < models.size(); i++)
+		{
+			SceneNode * part = lastParts[(i + 1) * BENCHMARK_BRANCHING_FACTOR - 1];
+			SceneGraph * joint = static_cast<SceneGraph *>(models[i]->GetChild(0).get());
+			foundCorrectly = foundCorrectly && root->Resolve(handles[i]) == part && joint->Find(lastPart).get() == part;
+		}
+
+		SceneGraphPointer removed = models.front();
+		root->Remove(removed);
+		foundCorrectly = foundCorrectly && root->Resolve(handles.front()) == nullptr && root->Resolve(handles.back()) == lastParts.back() &&
+						 models.back()->Find(lastPart).get() == lastParts.back() &&
+						 removed->Find(lastPart).get() == lastParts[BENCHMARK_BRANCHING_FACTOR - 1] && removed->Find(L"Model") == removed;
+		results << "name_lookup," << BENCHMARK_LOOKUP_MODELS << "," << (scoped ? "yes" : "no") << "," << lookup << "," << sizeof(SceneGraph) << ","
+				<< (foundCorrectly ? "yes" : "no") << endl;
+	}
+	return occludedCorrectly && allocatorsMatch && exceptionsPassedOn && instructionSetsMatch && parallelMatches && unqueuedSkipped && foundCorrectly ? 0 : 1;
+}
@@ -0,0 +1,8 @@
+#pragma once
+#include <string>
+
+// Headless benchmarks for the scene graph.
+//
+// The results are written as comma-separated values to the file given.
+
+int RunSceneGraphBenchmarks(const std::string& resultsFileName);
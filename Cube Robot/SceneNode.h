@@ -1,16 +1,40 @@
 #pragma once
 #include "core.h"
 #include "DirectXCore.h"
+#include "NodeRegistry.h"
+#include "Frustum.h"
+#include "OcclusionCuller.h"
 
 using namespace std;
 
-// Abstract base class for all nodes of the scene graph.  
+// Abstract base class for all nodes of the scene graph.
 // This scene graph implements the Composite Design Pattern
 
 class SceneNode;
+class RenderQueue;
 
 typedef shared_ptr<SceneNode>	SceneNodePointer;
 
+// What is known about the extent of the geometry drawn by a node (and, for a
+// scene graph, by all of the nodes below it)
+
+enum class BoundsType
+{
+	Empty,				// Nothing is drawn
+	Finite,				// Everything drawn is inside a bounding sphere
+	Infinite			// The extent is unknown, so the node is never culled
+};
+
+// Counts of the nodes processed by the last call to SceneGraph::Render
+
+struct CullingStatistics
+{
+	size_t		NodesVisited{ 0 };		// Nodes tested while walking the scene graph (or the spatial index, if enabled)
+	size_t		NodesCulled{ 0 };		// Nodes (or whole subtrees) rejected as being outside the view frustum
+	size_t		NodesOccluded{ 0 };		// Nodes (or whole subtrees) rejected as being hidden behind occluders
+	size_t		NodesDrawn{ 0 };		// Nodes that were rendered
+};
+
 class SceneNode : public enable_shared_from_this<SceneNode>
 {
 public:
@@ -19,23 +43,107 @@ public:
 
 	// Core methods
 	virtual bool Initialise() = 0;
-	virtual void Update(const Matrix& worldTransformation) { _cumulativeWorldTransformation = _thisWorldTransformation * worldTransformation; }	
+	virtual void Update(const Matrix& worldTransformation) { UpdateRecursive(worldTransformation); }
 	virtual void Render() = 0;
 	virtual void Shutdown() {}
 
-	void SetWorldTransform(const Matrix& worldTransformation) { _thisWorldTransformation = worldTransformation; }
-		
+	// The original recursive update.  SceneGraph::Update uses a flattened copy of the
+	// hierarchy instead, but this is kept so that the two can be compared.
+	virtual void UpdateRecursive(const Matrix& worldTransformation) { _cumulativeWorldTransformation = _thisWorldTransformation * worldTransformation; }
+
+	// The bounds of the geometry drawn by this node, in its own coordinate space.  Nodes that
+	// do not override this are treated as being visible from everywhere and are never culled.
+	virtual BoundsType GetLocalBounds(BoundingSphere& bounds) const { return BoundsType::Infinite; }
+
+	// Add the draws for this node to a render queue rather than drawing immediately.  Returns
+	// false if the node does not support this or cannot be drawn.
+	virtual bool Enqueue(RenderQueue& queue) { return false; }
+
+	// Draw the node using the render queue if there is one, or immediately if not.  The queue may be
+	// submitted on another thread (see FramePipeline), so a node that cannot be added to it is skipped
+	// rather than drawn immediately.  Returns false if the node was skipped.
+	bool Draw(RenderQueue * queue)
+	{
+		if (queue != nullptr)
+		{
+			return Enqueue(*queue);
+		}
+		Render();
+		return true;
+	}
+
+	// Draw the node if it can be seen.  If insideFrustum is true, an ancestor has already been
+	// found to be completely inside the frustum, so no further tests are needed.  If there is an
+	// occlusion culler, nodes hidden behind its occluders are not drawn either.
+	virtual void RenderVisible(const Frustum& frustum, bool insideFrustum, CullingStatistics& statistics, RenderQueue * queue, OcclusionCuller * occlusionCuller)
+	{
+		statistics.NodesVisited++;
+		if (!insideFrustum && _worldBoundsType == BoundsType::Finite && frustum.Test(_worldBounds) == FrustumTest::Outside)
+		{
+			statistics.NodesCulled++;
+			return;
+		}
+		if (occlusionCuller != nullptr && _worldBoundsType == BoundsType::Finite && occlusionCuller->IsOccluded(_worldBounds))
+		{
+			statistics.NodesOccluded++;
+			return;
+		}
+		if (Draw(queue))
+		{
+			statistics.NodesDrawn++;
+		}
+	}
+
+	void SetWorldTransform(const Matrix& worldTransformation) { _thisWorldTransformation = worldTransformation; TransformChanged(); }
+	inline const Matrix& GetWorldTransform() const { return _thisWorldTransformation; }
+	inline const Matrix& GetCumulativeWorldTransform() const { return _cumulativeWorldTransformation; }
+	inline const wstring& GetName() const { return _name; }
+	inline SceneNode * GetParent() const { return _parent; }
+
+	// The bounds of this node (and everything below it) in world space, as calculated by the last
+	// call to SceneGraph::Update.  The return value says whether the bounds can be used.
+	inline BoundsType GetWorldBounds(BoundingSphere& bounds) const { bounds = _worldBounds; return _worldBoundsType; }
+
 	// Although only required in the composite class, these are provided
 	// in order to simplify the code base for recursive operations
 
 	virtual void Add(SceneNodePointer node) {}
 	virtual void Remove(SceneNodePointer node) {};
 	virtual	SceneNodePointer Find(wstring name) { return (_name == name) ? shared_from_this() : nullptr; }
-	
+	virtual size_t GetChildCount() const { return 0; }
+	virtual SceneNodePointer GetChild(size_t index) const { return nullptr; }
+
 
 protected:
 	Matrix				_thisWorldTransformation;
 	Matrix				_cumulativeWorldTransformation;
 	wstring				_name;
+	SceneNode *			_parent{ nullptr };
+
+	// Used to avoid recalculating the world transformations of nodes that have not moved.
+	// _transformChanged is set when SetWorldTransform is called on this node and
+	// _descendantChanged is set on all of its ancestors.
+	bool				_transformChanged{ true };
+	bool				_descendantChanged{ false };
+
+	// Calculated by SceneGraph::Update along with _cumulativeWorldTransformation
+	BoundingSphere		_worldBounds;
+	BoundsType			_worldBoundsType{ BoundsType::Infinite };
+
+	// Index of this node in the NodeRegistry of the root of its scene graph
+	uint32_t			_registryIndex{ UINT32_MAX };
+
+	void TransformChanged()
+	{
+		_transformChanged = true;
+		for (SceneNode * ancestor = _parent; ancestor != nullptr && !ancestor->_descendantChanged; ancestor = ancestor->_parent)
+		{
+			ancestor->_descendantChanged = true;
+		}
+	}
+
+	friend class SceneGraph;
+	friend class TransformHierarchy;
+	friend class NodeRegistry;
 };
 
@@ -0,0 +1,32 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A preprocessor definition passed to the shader compiler
+
+struct ShaderDefine
+{
+	std::string		Name;
+	std::string		Value;
+};
+
+// Compiles shaders from source files into bytecode.
+//
+// Code that needs shaders compiled (such as ResourceCache) is written against this interface,
+// so that it can be used with D3DShaderCompiler on Windows or with a stand-in elsewhere.
+
+class ShaderCompiler
+{
+public:
+	virtual ~ShaderCompiler() {}
+
+	// Compile entryPoint in fileName for the given profile (for example, "vs_5_0").  On failure,
+	// returns false with the reason in messages.  Warnings may be returned in messages even if
+	// the compilation succeeds.
+	virtual bool Compile(const std::wstring& fileName, const std::string& entryPoint, const std::string& profile,
+						 const std::vector<ShaderDefine>& defines, std::vector<char>& bytecode, std::string& messages) = 0;
+
+	// The flags the compiler is run with.  Shaders compiled with different flags produce different bytecode.
+	virtual uint32_t GetFlags() const = 0;
+};
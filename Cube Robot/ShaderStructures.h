@@ -0,0 +1,27 @@
+#pragma once
+#include "DirectXCore.h"
+
+// The structures shared by the code that draws with shader.hlsl.  These are used both to
+// fill the buffers passed to the GPU and by SoftwareRasterizer, which runs the same shaders on the CPU.
+
+// Format of the constant buffer. This must match the format of the
+// cbuffer structure in the shader
+
+struct CBuffer
+{
+	Matrix		WorldViewProjection;
+	Matrix		World;
+	Vector4		MaterialColour;
+	Vector4		AmbientLightColour;
+	Vector4		DirectionalLightColour;
+	Vector4		DirectionalLightVector;
+};
+
+// Structure of a single vertex.  This must match the
+// structure of the input vertex in the shader
+
+struct Vertex
+{
+	Vector3		Position;
+	Vector3		Normal;
+};
@@ -0,0 +1,386 @@
+#include "SoftwareRasterizer.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	// Positions on screen are held in fixed point with this many bits after the point
+	constexpr int32_t SUBPIXEL_BITS = 8;
+	constexpr int32_t SUBPIXEL_ONE = 1 << SUBPIXEL_BITS;
+
+	// The planes of the view frustum in clip space, as Direct3D defines it (-w <= x <= w, -w <= y <= w, 0 <= z <= w)
+	constexpr int CLIP_PLANES = 6;
+
+	float PlaneDistance(const float position[4], int plane)
+	{
+		switch (plane)
+		{
+			case 0: return position[3] + position[0];
+			case 1: return position[3] - position[0];
+			case 2: return position[3] + position[1];
+			case 3: return position[3] - position[1];
+			case 4: return position[2];
+			default: return position[3] - position[2];
+		}
+	}
+
+	uint32_t OutCode(const float position[4])
+	{
+		uint32_t outCode = 0;
+		for (int plane = 0; plane < CLIP_PLANES; plane++)
+		{
+			if (PlaneDistance(position, plane) < 0.0f)
+			{
+				outCode |= 1u << plane;
+			}
+		}
+		return outCode;
+	}
+
+	inline float Saturate(float value)
+	{
+		return value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+	}
+
+	uint32_t PackColour(const float colour[4])
+	{
+		uint32_t packed = 0;
+		for (int i = 0; i < 4; i++)
+		{
+			packed |= static_cast<uint32_t>(Saturate(colour[i]) * 255.0f + 0.5f) << (8 * i);
+		}
+		return packed;
+	}
+
+	// Edges that are exactly on a pixel centre only cover it if they are a top edge (horizontal, with
+	// the rest of the triangle below) or a left edge.  Triangles are clockwise, with y going down the screen.
+	inline bool IsTopLeft(int32_t x0, int32_t y0, int32_t x1, int32_t y1)
+	{
+		return (y0 == y1 && x1 > x0) || y1 < y0;
+	}
+}
+
+SoftwareRasterizer::SoftwareRasterizer(uint32_t width, uint32_t height) : _width(0), _height(0)
+{
+	Resize(width, height);
+}
+
+void SoftwareRasterizer::Resize(uint32_t width, uint32_t height)
+{
+	if (width == _width && height == _height)
+	{
+		return;
+	}
+	_width = width;
+	_height = height;
+	_tilesAcross = (width + TILE_SIZE - 1) / TILE_SIZE;
+	_tilesDown = (height + TILE_SIZE - 1) / TILE_SIZE;
+	_colourBuffer.assign(static_cast<size_t>(width) * height, 0);
+	_depthBuffer.assign(static_cast<size_t>(width) * height, 1.0f);
+	_triangles.clear();
+	_bins.clear();
+	_bins.resize(static_cast<size_t>(_tilesAcross) * _tilesDown);
+	_tilePixelsShaded.assign(_bins.size(), 0);
+}
+
+void SoftwareRasterizer::Clear(const float colour[4], float depth)
+{
+	std::fill(_colourBuffer.begin(), _colourBuffer.end(), PackColour(colour));
+	std::fill(_depthBuffer.begin(), _depthBuffer.end(), depth);
+	_triangles.clear();
+	for (std::vector<uint32_t>& bin : _bins)
+	{
+		bin.clear();
+	}
+}
+
+void SoftwareRasterizer::DrawIndexed(const void * vertices, uint32_t vertexStride, const uint32_t * indices, uint32_t indexCount, const CBuffer& constants)
+{
+	if (indexCount < 3)
+	{
+		return;
+	}
+
+	// Run the vertex shader (VS in shader.hlsl) on every vertex the indices refer to
+	uint32_t vertexCount = *std::max_element(indices, indices + indexCount) + 1;
+	_shadedVertices.resize(vertexCount);
+	const Matrix& worldViewProjection = constants.WorldViewProjection;
+	const Matrix& world = constants.World;
+	const float lightVector[4] = { constants.DirectionalLightVector.x, constants.DirectionalLightVector.y, constants.DirectionalLightVector.z, constants.DirectionalLightVector.w };
+	const float lightColour[4] = { constants.DirectionalLightColour.x, constants.DirectionalLightColour.y, constants.DirectionalLightColour.z, constants.DirectionalLightColour.w };
+	const float ambientColour[4] = { constants.AmbientLightColour.x, constants.AmbientLightColour.y, constants.AmbientLightColour.z, constants.AmbientLightColour.w };
+	const float materialColour[4] = { constants.MaterialColour.x, constants.MaterialColour.y, constants.MaterialColour.z, constants.MaterialColour.w };
+	const char * vertexData = static_cast<const char *>(vertices);
+	for (uint32_t i = 0; i < vertexCount; i++)
+	{
+		Vertex vertex;
+		memcpy(&vertex, vertexData + static_cast<size_t>(i) * vertexStride, sizeof(vertex));
+		ShadedVertex& shaded = _shadedVertices[i];
+		float normal[4];
+		for (int j = 0; j < 4; j++)
+		{
+			shaded.Position[j] = vertex.Position.x * worldViewProjection.m[0][j] + vertex.Position.y * worldViewProjection.m[1][j] +
+								 vertex.Position.z * worldViewProjection.m[2][j] + worldViewProjection.m[3][j];
+			normal[j] = vertex.Normal.x * world.m[0][j] + vertex.Normal.y * world.m[1][j] + vertex.Normal.z * world.m[2][j];
+		}
+
+		// The shader normalizes the dot product, which turns it into its sign, so any light at all gives full diffuse lighting
+		float dot = -(normal[0] * lightVector[0] + normal[1] * lightVector[1] + normal[2] * lightVector[2] + normal[3] * lightVector[3]);
+		float diffuseLight = dot > 0.0f ? 1.0f : 0.0f;
+		for (int j = 0; j < 4; j++)
+		{
+			shaded.Colour[j] = Saturate(lightColour[j] * diffuseLight + ambientColour[j]) * materialColour[j];
+		}
+	}
+
+	for (uint32_t i = 0; i + 2 < indexCount; i += 3)
+	{
+		_statistics.TrianglesSubmitted++;
+		ClipTriangle(_shadedVertices[indices[i]], _shadedVertices[indices[i + 1]], _shadedVertices[indices[i + 2]]);
+	}
+}
+
+void SoftwareRasterizer::ClipTriangle(const ShadedVertex& vertex0, const ShadedVertex& vertex1, const ShadedVertex& vertex2)
+{
+	uint32_t outCode0 = OutCode(vertex0.Position);
+	uint32_t outCode1 = OutCode(vertex1.Position);
+	uint32_t outCode2 = OutCode(vertex2.Position);
+	if ((outCode0 | outCode1 | outCode2) == 0)
+	{
+		SetupTriangle(vertex0, vertex1, vertex2);
+		return;
+	}
+	if ((outCode0 & outCode1 & outCode2) != 0)
+	{
+		// Entirely outside one of the planes
+		return;
+	}
+
+	// Clip the triangle against each plane it crosses in turn.  Each plane can add at most one vertex.
+	uint32_t crossed = outCode0 | outCode1 | outCode2;
+	ShadedVertex polygons[2][3 + CLIP_PLANES];
+	ShadedVertex * input = polygons[0];
+	ShadedVertex * output = polygons[1];
+	input[0] = vertex0;
+	input[1] = vertex1;
+	input[2] = vertex2;
+	int inputCount = 3;
+	for (int plane = 0; plane < CLIP_PLANES && inputCount >= 3; plane++)
+	{
+		if ((crossed & (1u << plane)) == 0)
+		{
+			continue;
+		}
+		int outputCount = 0;
+		for (int i = 0; i < inputCount; i++)
+		{
+			const ShadedVertex& current = input[i];
+			const ShadedVertex& next = input[(i + 1) % inputCount];
+			float currentDistance = PlaneDistance(current.Position, plane);
+			float nextDistance = PlaneDistance(next.Position, plane);
+			if (currentDistance >= 0.0f)
+			{
+				output[outputCount++] = current;
+			}
+			if ((currentDistance >= 0.0f) != (nextDistance >= 0.0f))
+			{
+				float t = currentDistance / (currentDistance - nextDistance);
+				ShadedVertex& intersection = output[outputCount++];
+				for (int j = 0; j < 4; j++)
+				{
+					intersection.Position[j] = current.Position[j] + t * (next.Position[j] - current.Position[j]);
+					intersection.Colour[j] = current.Colour[j] + t * (next.Colour[j] - current.Colour[j]);
+				}
+			}
+		}
+		std::swap(input, output);
+		inputCount = outputCount;
+	}
+	for (int i = 1; i + 1 < inputCount; i++)
+	{
+		SetupTriangle(input[0], input[i], input[i + 1]);
+	}
+}
+
+void SoftwareRasterizer::SetupTriangle(const ShadedVertex& vertex0, const ShadedVertex& vertex1, const ShadedVertex& vertex2)
+{
+	Triangle triangle;
+	const ShadedVertex * vertices[3] = { &vertex0, &vertex1, &vertex2 };
+	for (int i = 0; i < 3; i++)
+	{
+		const float * position = vertices[i]->Position;
+		float inverseW = 1.0f / position[3];
+		float x = (position[0] * inverseW * 0.5f + 0.5f) * _width;
+		float y = (0.5f - position[1] * inverseW * 0.5f) * _height;
+		triangle.X[i] = static_cast<int32_t>(std::lround(x * SUBPIXEL_ONE));
+		triangle.Y[i] = static_cast<int32_t>(std::lround(y * SUBPIXEL_ONE));
+		triangle.Z[i] = position[2] * inverseW;
+		triangle.InverseW[i] = inverseW;
+		for (int j = 0; j < 4; j++)
+		{
+			triangle.ColourOverW[i][j] = vertices[i]->Colour[j] * inverseW;
+		}
+	}
+
+	// Twice the area of the triangle on screen.  Clockwise triangles have a positive area.
+	int64_t area = static_cast<int64_t>(triangle.X[1] - triangle.X[0]) * (triangle.Y[2] - triangle.Y[0]) -
+				   static_cast<int64_t>(triangle.X[2] - triangle.X[0]) * (triangle.Y[1] - triangle.Y[0]);
+	if (area <= 0)
+	{
+		return;
+	}
+	triangle.MinX = std::max(std::min({ triangle.X[0], triangle.X[1], triangle.X[2] }) >> SUBPIXEL_BITS, 0);
+	triangle.MinY = std::max(std::min({ triangle.Y[0], triangle.Y[1], triangle.Y[2] }) >> SUBPIXEL_BITS, 0);
+	triangle.MaxX = std::min(std::max({ triangle.X[0], triangle.X[1], triangle.X[2] }) >> SUBPIXEL_BITS, static_cast<int32_t>(_width) - 1);
+	triangle.MaxY = std::min(std::max({ triangle.Y[0], triangle.Y[1], triangle.Y[2] }) >> SUBPIXEL_BITS, static_cast<int32_t>(_height) - 1);
+	if (triangle.MinX > triangle.MaxX || triangle.MinY > triangle.MaxY)
+	{
+		return;
+	}
+	_statistics.TrianglesRasterized++;
+
+	uint32_t index = static_cast<uint32_t>(_triangles.size());
+	_triangles.push_back(triangle);
+	for (int32_t tileY = triangle.MinY / static_cast<int32_t>(TILE_SIZE); tileY <= triangle.MaxY / static_cast<int32_t>(TILE_SIZE); tileY++)
+	{
+		for (int32_t tileX = triangle.MinX / static_cast<int32_t>(TILE_SIZE); tileX <= triangle.MaxX / static_cast<int32_t>(TILE_SIZE); tileX++)
+		{
+			_bins[tileY * _tilesAcross + tileX].push_back(index);
+		}
+	}
+}
+
+void SoftwareRasterizer::Flush()
+{
+	if (_triangles.empty())
+	{
+		return;
+	}
+	for (uint32_t tile = 0; tile < _bins.size(); tile++)
+	{
+		if (_bins[tile].empty())
+		{
+			continue;
+		}
+		if (_threadPool != nullptr)
+		{
+			_threadPool->Submit([this, tile]() { RasterizeTile(tile); });
+		}
+		else
+		{
+			RasterizeTile(tile);
+		}
+	}
+	if (_threadPool != nullptr)
+	{
+		_threadPool->Wait();
+	}
+	for (uint32_t tile = 0; tile < _bins.size(); tile++)
+	{
+		_statistics.PixelsShaded += _tilePixelsShaded[tile];
+		_tilePixelsShaded[tile] = 0;
+		_bins[tile].clear();
+	}
+	_triangles.clear();
+}
+
+void SoftwareRasterizer::RasterizeTile(uint32_t tile)
+{
+	const int32_t tileMinX = static_cast<int32_t>((tile % _tilesAcross) * TILE_SIZE);
+	const int32_t tileMinY = static_cast<int32_t>((tile / _tilesAcross) * TILE_SIZE);
+	const int32_t tileMaxX = std::min(tileMinX + static_cast<int32_t>(TILE_SIZE), static_cast<int32_t>(_width)) - 1;
+	const int32_t tileMaxY = std::min(tileMinY + static_cast<int32_t>(TILE_SIZE), static_cast<int32_t>(_height)) - 1;
+	size_t pixelsShaded = 0;
+	for (uint32_t index : _bins[tile])
+	{
+		const Triangle& triangle = _triangles[index];
+		const int32_t minX = std::max(triangle.MinX, tileMinX);
+		const int32_t minY = std::max(triangle.MinY, tileMinY);
+		const int32_t maxX = std::min(triangle.MaxX, tileMaxX);
+		const int32_t maxY = std::min(triangle.MaxY, tileMaxY);
+
+		// Edge i is opposite vertex i, so its value is the (scaled) barycentric weight of that vertex.
+		// The edge functions are evaluated at the centre of the first pixel, then stepped a pixel at a time.
+		const int32_t pixelX = (minX << SUBPIXEL_BITS) + SUBPIXEL_ONE / 2;
+		const int32_t pixelY = (minY << SUBPIXEL_BITS) + SUBPIXEL_ONE / 2;
+		int64_t stepX[3];
+		int64_t stepY[3];
+		int64_t rowStart[3];
+		for (int i = 0; i < 3; i++)
+		{
+			int a = (i + 1) % 3;
+			int b = (i + 2) % 3;
+			int64_t edgeX = triangle.Y[a] - triangle.Y[b];
+			int64_t edgeY = triangle.X[b] - triangle.X[a];
+			int64_t bias = IsTopLeft(triangle.X[a], triangle.Y[a], triangle.X[b], triangle.Y[b]) ? 0 : -1;
+			rowStart[i] = edgeX * (pixelX - triangle.X[a]) + edgeY * (pixelY - triangle.Y[a]) + bias;
+			stepX[i] = edgeX * SUBPIXEL_ONE;
+			stepY[i] = edgeY * SUBPIXEL_ONE;
+		}
+		int64_t area = static_cast<int64_t>(triangle.X[1] - triangle.X[0]) * (triangle.Y[2] - triangle.Y[0]) -
+					   static_cast<int64_t>(triangle.X[2] - triangle.X[0]) * (triangle.Y[1] - triangle.Y[0]);
+		const float inverseArea = 1.0f / static_cast<float>(area);
+
+		for (int32_t y = minY; y <= maxY; y++)
+		{
+			int64_t weights[3] = { rowStart[0], rowStart[1], rowStart[2] };
+			size_t pixel = static_cast<size_t>(y) * _width + minX;
+			for (int32_t x = minX; x <= maxX; x++, pixel++)
+			{
+				if ((weights[0] | weights[1] | weights[2]) >= 0)
+				{
+					float b0 = static_cast<float>(weights[0]) * inverseArea;
+					float b1 = static_cast<float>(weights[1]) * inverseArea;
+					float b2 = static_cast<float>(weights[2]) * inverseArea;
+					float z = b0 * triangle.Z[0] + b1 * triangle.Z[1] + b2 * triangle.Z[2];
+					if (z < _depthBuffer[pixel])
+					{
+						_depthBuffer[pixel] = z;
+						float w = 1.0f / (b0 * triangle.InverseW[0] + b1 * triangle.InverseW[1] + b2 * triangle.InverseW[2]);
+						float colour[4];
+						for (int j = 0; j < 4; j++)
+						{
+							colour[j] = (b0 * triangle.ColourOverW[0][j] + b1 * triangle.ColourOverW[1][j] + b2 * triangle.ColourOverW[2][j]) * w;
+						}
+						_colourBuffer[pixel] = PackColour(colour);
+						pixelsShaded++;
+					}
+				}
+				for (int i = 0; i < 3; i++)
+				{
+					weights[i] += stepX[i];
+				}
+			}
+			for (int i = 0; i < 3; i++)
+			{
+				rowStart[i] += stepY[i];
+			}
+		}
+	}
+	_tilePixelsShaded[tile] = pixelsShaded;
+}
+
+bool SoftwareRasterizer::SaveImage(const std::wstring& fileName) const
+{
+	FILE * file = OpenFileStream(fileName, "wb");
+	if (file == nullptr)
+	{
+		return false;
+	}
+	bool written = fprintf(file, "P6\n%u %u\n255\n", _width, _height) > 0;
+	std::vector<unsigned char> row(static_cast<size_t>(_width) * 3);
+	for (uint32_t y = 0; y < _height && written; y++)
+	{
+		for (uint32_t x = 0; x < _width; x++)
+		{
+			uint32_t colour = _colourBuffer[static_cast<size_t>(y) * _width + x];
+			row[3 * x] = static_cast<unsigned char>(colour);
+			row[3 * x + 1] = static_cast<unsigned char>(colour >> 8);
+			row[3 * x + 2] = static_cast<unsigned char>(colour >> 16);
+		}
+		written = fwrite(row.data(), 1, row.size(), file) == row.size();
+	}
+	return fclose(file) == 0 && written;
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include "ShaderStructures.h"
+#include "ThreadPool.h"
+#include <string>
+#include <vector>
+
+struct RasterizerStatistics
+{
+	size_t		TrianglesSubmitted{ 0 };
+	size_t		TrianglesRasterized{ 0 };		// Left after clipping and back face culling.  Clipping can split a triangle in several.
+	size_t		PixelsShaded{ 0 };				// Pixels that passed the depth test
+};
+
+// Draws triangles on the CPU, producing the same image as the VS and PS functions in shader.hlsl
+// do on the GPU, so that scenes can be rendered and checked on machines without one.
+//
+// Drawing is done in two stages.  DrawIndexed lights and transforms the vertices, clips each triangle
+// to the view frustum, culls back faces and adds the triangle to the bin of every tile of the
+// render target that it overlaps.  Flush then rasterizes the tiles, in parallel if the rasterizer
+// has a thread pool.  Each tile draws its triangles in the order they were submitted, so the image
+// is the same however many threads are used.
+//
+// Rasterization follows the Direct3D rules: pixel centres are at half-pixel offsets, edges use
+// the top-left fill rule (with 8 bits of sub-pixel precision) and, as with the default rasterizer
+// state, triangles that are counter-clockwise on screen are culled.  Colours are interpolated
+// with perspective correction and depths are tested with less-than.
+//
+// The vertices must start with a Vertex (a position followed by a normal).
+
+class SoftwareRasterizer
+{
+public:
+	static constexpr uint32_t TILE_SIZE = 64;
+
+	SoftwareRasterizer(uint32_t width, uint32_t height);
+
+	// Tiles are rasterized on the thread pool if one is given.  nullptr rasterizes them on the calling thread.
+	inline void SetThreadPool(ThreadPool * threadPool) { _threadPool = threadPool; }
+	void Resize(uint32_t width, uint32_t height);
+
+	// Clear the colour buffer to colour (red, green, blue, alpha) and the depth buffer to depth.  Any
+	// triangles that have not been flushed are discarded.
+	void Clear(const float colour[4], float depth);
+	void DrawIndexed(const void * vertices, uint32_t vertexStride, const uint32_t * indices, uint32_t indexCount, const CBuffer& constants);
+	void Flush();
+
+	inline uint32_t GetWidth() const { return _width; }
+	inline uint32_t GetHeight() const { return _height; }
+
+	// Pixels are stored a row at a time from the top, as RGBA8 with red in the lowest byte (DXGI_FORMAT_R8G8B8A8_UNORM)
+	inline const std::vector<uint32_t>& GetColourBuffer() const { return _colourBuffer; }
+	inline const std::vector<float>& GetDepthBuffer() const { return _depthBuffer; }
+
+	inline const RasterizerStatistics& GetStatistics() const { return _statistics; }
+	inline void ResetStatistics() { _statistics = RasterizerStatistics(); }
+
+	// Write the colour buffer to a binary PPM file.  Returns false if the file could not be written.
+	bool SaveImage(const std::wstring& fileName) const;
+
+private:
+	// A vertex after the vertex shader has run.  The position is in clip space.
+	struct ShadedVertex
+	{
+		float		Position[4];
+		float		Colour[4];
+	};
+
+	// A triangle ready for rasterizing.  Positions are in pixels, in fixed point.  The colours are
+	// divided by w, so that they can be interpolated linearly across the screen.
+	struct Triangle
+	{
+		int32_t		X[3];
+		int32_t		Y[3];
+		float		Z[3];
+		float		InverseW[3];
+		float		ColourOverW[3][4];
+		int32_t		MinX, MinY, MaxX, MaxY;		// Bounds of the pixels that may be covered
+	};
+
+	uint32_t					_width;
+	uint32_t					_height;
+	uint32_t					_tilesAcross{ 0 };
+	uint32_t					_tilesDown{ 0 };
+	ThreadPool *				_threadPool{ nullptr };
+
+	std::vector<uint32_t>		_colourBuffer;
+	std::vector<float>			_depthBuffer;
+
+	std::vector<ShadedVertex>				_shadedVertices;
+	std::vector<Triangle>					_triangles;
+	std::vector<std::vector<uint32_t>>		_bins;				// The triangles overlapping each tile, in submission order
+	std::vector<size_t>						_tilePixelsShaded;
+
+	RasterizerStatistics		_statistics;
+
+	void ClipTriangle(const ShadedVertex& vertex0, const ShadedVertex& vertex1, const ShadedVertex& vertex2);
+	void SetupTriangle(const ShadedVertex& vertex0, const ShadedVertex& vertex1, const ShadedVertex& vertex2);
+	void RasterizeTile(uint32_t tile);
+};
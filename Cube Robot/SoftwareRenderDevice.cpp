@@ -0,0 +1,182 @@
+#include "SoftwareRenderDevice.h"
+#include <algorithm>
+#include <cstring>
+
+ResourceId SoftwareRenderDevice::CreateVertexBuffer(const void * data, size_t size)
+{
+	return AddResource(data, size);
+}
+
+ResourceId SoftwareRenderDevice::CreateIndexBuffer(const void * data, size_t size)
+{
+	return AddResource(data, size);
+}
+
+ResourceId SoftwareRenderDevice::CreateConstantBuffer(size_t size)
+{
+	return AddResource(nullptr, size);
+}
+
+ResourceId SoftwareRenderDevice::CreateDynamicVertexBuffer(size_t size)
+{
+	return AddResource(nullptr, size);
+}
+
+ResourceId SoftwareRenderDevice::CreateVertexShader(const void * bytecode, size_t size)
+{
+	return AddResource(nullptr, 0);
+}
+
+ResourceId SoftwareRenderDevice::CreatePixelShader(const void * bytecode, size_t size)
+{
+	return AddResource(nullptr, 0);
+}
+
+ResourceId SoftwareRenderDevice::CreateInputLayout(const VertexElement * elements, size_t elementCount, const void * vertexShaderBytecode, size_t size)
+{
+	return AddResource(nullptr, 0);
+}
+
+void SoftwareRenderDevice::ReleaseResource(ResourceId resource)
+{
+	_resources.erase(resource);
+}
+
+void SoftwareRenderDevice::Clear(const float colour[4], float depth)
+{
+	_rasterizer.Clear(colour, depth);
+}
+
+void SoftwareRenderDevice::SetViewport(float x, float y, float width, float height)
+{
+	_rasterizer.Resize(static_cast<uint32_t>(width), static_cast<uint32_t>(height));
+}
+
+void SoftwareRenderDevice::SetPrimitiveTopology(PrimitiveTopology topology)
+{
+	_topology = topology;
+}
+
+void SoftwareRenderDevice::SetInputLayout(ResourceId inputLayout)
+{
+}
+
+void SoftwareRenderDevice::SetVertexShader(ResourceId vertexShader)
+{
+}
+
+void SoftwareRenderDevice::SetPixelShader(ResourceId pixelShader)
+{
+}
+
+void SoftwareRenderDevice::SetVertexBuffer(ResourceId vertexBuffer, uint32_t stride)
+{
+	_vertexBuffer = vertexBuffer;
+	_vertexStride = stride;
+}
+
+void SoftwareRenderDevice::SetInstanceBuffer(ResourceId instanceBuffer, uint32_t stride)
+{
+	_instanceBuffer = instanceBuffer;
+	_instanceStride = stride;
+}
+
+void SoftwareRenderDevice::SetIndexBuffer(ResourceId indexBuffer)
+{
+	_indexBuffer = indexBuffer;
+}
+
+void SoftwareRenderDevice::SetConstantBuffer(uint32_t slot, ResourceId constantBuffer)
+{
+	if (slot == 0)
+	{
+		_constantBuffer = constantBuffer;
+	}
+}
+
+void SoftwareRenderDevice::UpdateConstantBuffer(ResourceId constantBuffer, const void * data, size_t size)
+{
+	WriteResource(constantBuffer, data, size);
+}
+
+void SoftwareRenderDevice::UpdateVertexBuffer(ResourceId dynamicVertexBuffer, const void * data, size_t size)
+{
+	WriteResource(dynamicVertexBuffer, data, size);
+}
+
+void SoftwareRenderDevice::DrawIndexed(uint32_t indexCount, uint32_t startIndex, int32_t baseVertex)
+{
+	Draw(indexCount, startIndex, baseVertex, GetConstants());
+}
+
+void SoftwareRenderDevice::DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex)
+{
+	const std::vector<char> * instances = FindResource(_instanceBuffer);
+	if (instances == nullptr || _instanceStride == 0)
+	{
+		return;
+	}
+	CBuffer constants = GetConstants();
+	size_t instanceSize = std::min(static_cast<size_t>(_instanceStride), sizeof(CBuffer));
+	instanceCount = std::min(instanceCount, static_cast<uint32_t>(instances->size() / _instanceStride));
+	for (uint32_t instance = 0; instance < instanceCount; instance++)
+	{
+		memcpy(&constants, instances->data() + static_cast<size_t>(instance) * _instanceStride, instanceSize);
+		Draw(indexCount, startIndex, baseVertex, constants);
+	}
+}
+
+ResourceId SoftwareRenderDevice::AddResource(const void * data, size_t size)
+{
+	std::vector<char>& contents = _resources[++_lastResource];
+	if (data != nullptr)
+	{
+		const char * bytes = static_cast<const char *>(data);
+		contents.assign(bytes, bytes + size);
+	}
+	else
+	{
+		contents.resize(size);
+	}
+	return _lastResource;
+}
+
+const std::vector<char> * SoftwareRenderDevice::FindResource(ResourceId resource) const
+{
+	auto found = _resources.find(resource);
+	return found == _resources.end() ? nullptr : &found->second;
+}
+
+void SoftwareRenderDevice::WriteResource(ResourceId resource, const void * data, size_t size)
+{
+	auto found = _resources.find(resource);
+	if (found != _resources.end())
+	{
+		memcpy(found->second.data(), data, std::min(size, found->second.size()));
+	}
+}
+
+void SoftwareRenderDevice::Draw(uint32_t indexCount, uint32_t startIndex, int32_t baseVertex, const CBuffer& constants)
+{
+	const std::vector<char> * vertices = FindResource(_vertexBuffer);
+	const std::vector<char> * indices = FindResource(_indexBuffer);
+	if (_topology != PrimitiveTopology::TriangleList || vertices == nullptr || indices == nullptr ||
+		(static_cast<size_t>(startIndex) + indexCount) * sizeof(uint32_t) > indices->size())
+	{
+		return;
+	}
+	const uint32_t * firstIndex = reinterpret_cast<const uint32_t *>(indices->data()) + startIndex;
+	const char * firstVertex = vertices->data() + static_cast<ptrdiff_t>(baseVertex) * _vertexStride;
+	_rasterizer.DrawIndexed(firstVertex, _vertexStride, firstIndex, indexCount, constants);
+}
+
+CBuffer SoftwareRenderDevice::GetConstants() const
+{
+	CBuffer constants;
+	const std::vector<char> * contents = FindResource(_constantBuffer);
+	if (contents != nullptr)
+	{
+		memcpy(&constants, contents->data(), std::min(contents->size(), sizeof(CBuffer)));
+	}
+	return constants;
+}
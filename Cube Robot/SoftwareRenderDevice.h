@@ -0,0 +1,68 @@
+#pragma once
+#include "RenderDevice.h"
+#include "SoftwareRasterizer.h"
+#include <unordered_map>
+#include <vector>
+
+// A RenderDevice that draws with a SoftwareRasterizer, so that the scene graph and render queue
+// can produce real images on machines without a GPU.
+//
+// The rasterizer only runs the shaders in shader.hlsl, so the shaders and input layouts created on
+// this device are ignored.  Draws use the constants in the buffer bound to slot 0, laid out as a
+// CBuffer.  Instanced draws take the start of each instance's constants from the instance buffer,
+// as VSInstanced does.  Only triangle lists are drawn.
+//
+// The viewport sets the size of the image.  Call Flush on the rasterizer once the frame has been
+// submitted to finish drawing it.
+
+class SoftwareRenderDevice : public RenderDevice
+{
+public:
+	SoftwareRenderDevice(uint32_t width, uint32_t height) : _rasterizer(width, height) {}
+
+	ResourceId CreateVertexBuffer(const void * data, size_t size);
+	ResourceId CreateIndexBuffer(const void * data, size_t size);
+	ResourceId CreateConstantBuffer(size_t size);
+	ResourceId CreateDynamicVertexBuffer(size_t size);
+	ResourceId CreateVertexShader(const void * bytecode, size_t size);
+	ResourceId CreatePixelShader(const void * bytecode, size_t size);
+	ResourceId CreateInputLayout(const VertexElement * elements, size_t elementCount, const void * vertexShaderBytecode, size_t size);
+	void ReleaseResource(ResourceId resource);
+
+	void Clear(const float colour[4], float depth);
+	void SetViewport(float x, float y, float width, float height);
+
+	void SetPrimitiveTopology(PrimitiveTopology topology);
+	void SetInputLayout(ResourceId inputLayout);
+	void SetVertexShader(ResourceId vertexShader);
+	void SetPixelShader(ResourceId pixelShader);
+	void SetVertexBuffer(ResourceId vertexBuffer, uint32_t stride);
+	void SetInstanceBuffer(ResourceId instanceBuffer, uint32_t stride);
+	void SetIndexBuffer(ResourceId indexBuffer);
+	void SetConstantBuffer(uint32_t slot, ResourceId constantBuffer);
+	void UpdateConstantBuffer(ResourceId constantBuffer, const void * data, size_t size);
+	void UpdateVertexBuffer(ResourceId dynamicVertexBuffer, const void * data, size_t size);
+	void DrawIndexed(uint32_t indexCount, uint32_t startIndex, int32_t baseVertex);
+	void DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex);
+
+	inline SoftwareRasterizer& GetRasterizer() { return _rasterizer; }
+
+private:
+	SoftwareRasterizer										_rasterizer;
+	std::unordered_map<ResourceId, std::vector<char>>		_resources;
+	ResourceId												_lastResource{ 0 };
+
+	PrimitiveTopology		_topology{ PrimitiveTopology::TriangleList };
+	ResourceId				_vertexBuffer{ 0 };
+	uint32_t				_vertexStride{ 0 };
+	ResourceId				_instanceBuffer{ 0 };
+	uint32_t				_instanceStride{ 0 };
+	ResourceId				_indexBuffer{ 0 };
+	ResourceId				_constantBuffer{ 0 };
+
+	ResourceId AddResource(const void * data, size_t size);
+	const std::vector<char> * FindResource(ResourceId resource) const;
+	void WriteResource(ResourceId resource, const void * data, size_t size);
+	void Draw(uint32_t indexCount, uint32_t startIndex, int32_t baseVertex, const CBuffer& constants);
+	CBuffer GetConstants() const;
+};
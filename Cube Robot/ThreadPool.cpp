@@ -0,0 +1,232 @@
+#include "ThreadPool.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <string>
+
+// The pool (if any) that the current thread belongs to and the index of its queue
+thread_local ThreadPool *	currentThreadPool = nullptr;
+thread_local unsigned int	currentQueueIndex = 0;
+
+ThreadPool::ThreadPool() : ThreadPool(std::thread::hardware_concurrency())
+{
+}
+
+ThreadPool::ThreadPool(unsigned int threadCount)
+{
+	if (threadCount == 0)
+	{
+		threadCount = 1;
+	}
+	for (unsigned int i = 0; i < threadCount; i++)
+	{
+		_queues.push_back(std::make_unique<TaskQueue>());
+	}
+	// The last queue belongs to the thread that calls Wait, so no worker is created for it
+	for (unsigned int i = 0; i < threadCount - 1; i++)
+	{
+		_workers.emplace_back(&ThreadPool::WorkerLoop, this, i);
+	}
+
+	// Otherwise, with few cores, a worker may not get to run until a later frame, and do its own
+	// setting up (such as creating its profile buffer) in the middle of it
+	std::unique_lock<std::mutex> lock(_sleepMutex);
+	_workerStarted.wait(lock, [this]() { return _startedWorkers == _workers.size(); });
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(_sleepMutex);
+		_stopping = true;
+	}
+	_workAvailable.notify_all();
+	for (std::thread& worker : _workers)
+	{
+		worker.join();
+	}
+}
+
+void ThreadPool::Submit(std::function<void()> task)
+{
+	// Tasks created by a thread in this pool go on that thread's own queue.
+	// Others are shared out between the queues.
+	unsigned int queueIndex;
+	if (currentThreadPool == this)
+	{
+		queueIndex = currentQueueIndex;
+	}
+	else
+	{
+		queueIndex = _nextQueue++ % GetThreadCount();
+	}
+
+	_pendingTasks++;
+	_queuedTasks++;
+	{
+		std::lock_guard<std::mutex> lock(_queues[queueIndex]->Mutex);
+		_queues[queueIndex]->PushBack(std::move(task));
+	}
+
+	// Taking the lock makes sure that a worker that has just found no work
+	// is either already waiting or will see the new task before it waits
+	{
+		std::lock_guard<std::mutex> lock(_sleepMutex);
+	}
+	_workAvailable.notify_one();
+}
+
+void ThreadPool::Wait()
+{
+	ThreadPool * previousPool = currentThreadPool;
+	unsigned int previousQueueIndex = currentQueueIndex;
+	currentThreadPool = this;
+	currentQueueIndex = GetThreadCount() - 1;
+
+	while (_pendingTasks > 0)
+	{
+		if (!RunOneTask(currentQueueIndex))
+		{
+			// Nothing left to take, but other threads are still running tasks, so sleep until
+			// one of them queues another task or the last of them completes
+			std::unique_lock<std::mutex> lock(_sleepMutex);
+			_workAvailable.wait(lock, [this]() { return _pendingTasks == 0 || _queuedTasks > 0; });
+		}
+	}
+
+	currentThreadPool = previousPool;
+	currentQueueIndex = previousQueueIndex;
+
+	std::exception_ptr exception;
+	{
+		std::lock_guard<std::mutex> lock(_exceptionMutex);
+		exception = _firstException;
+		_firstException = nullptr;
+	}
+	if (exception)
+	{
+		std::rethrow_exception(exception);
+	}
+}
+
+void ThreadPool::WorkerLoop(unsigned int queueIndex)
+{
+	currentThreadPool = this;
+	currentQueueIndex = queueIndex;
+	Profiler::SetThreadName("Worker " + std::to_string(queueIndex));
+	if (Profiler::IsEnabled())
+	{
+		// Create the profile buffer now rather than in whichever frame first gives this thread a task,
+		// which, since Wait runs tasks itself rather than spinning, may be long after the pool starts
+		Profiler::GetThreadBuffer();
+	}
+	{
+		std::lock_guard<std::mutex> lock(_sleepMutex);
+		_startedWorkers++;
+	}
+	_workerStarted.notify_one();
+	while (true)
+	{
+		if (RunOneTask(queueIndex))
+		{
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(_sleepMutex);
+		_workAvailable.wait(lock, [this]() { return _stopping || _queuedTasks > 0; });
+		if (_stopping)
+		{
+			return;
+		}
+	}
+}
+
+bool ThreadPool::RunOneTask(unsigned int queueIndex)
+{
+	std::function<void()> task;
+	if (!PopTask(queueIndex, task))
+	{
+		return false;
+	}
+	try
+	{
+		task();
+	}
+	catch (...)
+	{
+		// Kept for Wait to rethrow.  The task still counts as completed, or Wait would never return.
+		std::lock_guard<std::mutex> lock(_exceptionMutex);
+		if (!_firstException)
+		{
+			_firstException = std::current_exception();
+		}
+	}
+	if (--_pendingTasks == 0)
+	{
+		// Wake the thread in Wait if it is sleeping.  Taking the lock makes sure that it either
+		// has not yet checked the count or is already waiting.
+		{
+			std::lock_guard<std::mutex> lock(_sleepMutex);
+		}
+		_workAvailable.notify_all();
+	}
+	return true;
+}
+
+bool ThreadPool::PopTask(unsigned int queueIndex, std::function<void()>& task)
+{
+	unsigned int threadCount = GetThreadCount();
+	for (unsigned int i = 0; i < threadCount; i++)
+	{
+		unsigned int index = (queueIndex + i) % threadCount;
+		TaskQueue& queue = *_queues[index];
+		std::lock_guard<std::mutex> lock(queue.Mutex);
+		if (queue.Count == 0)
+		{
+			continue;
+		}
+		if (index == queueIndex)
+		{
+			// Our own queue, so take the newest task
+			queue.PopBack(task);
+		}
+		else
+		{
+			// Steal the oldest task from another thread
+			queue.PopFront(task);
+		}
+		_queuedTasks--;
+		return true;
+	}
+	return false;
+}
+
+void ThreadPool::TaskQueue::PushBack(std::function<void()>&& task)
+{
+	if (Count == Tasks.size())
+	{
+		// Unwrap the ring into a larger one
+		std::vector<std::function<void()>> tasks(std::max<size_t>(Tasks.size() * 2, 16));
+		for (size_t i = 0; i < Count; i++)
+		{
+			tasks[i] = std::move(Tasks[(First + i) % Tasks.size()]);
+		}
+		Tasks.swap(tasks);
+		First = 0;
+	}
+	Tasks[(First + Count) % Tasks.size()] = std::move(task);
+	Count++;
+}
+
+void ThreadPool::TaskQueue::PopBack(std::function<void()>& task)
+{
+	Count--;
+	task = std::move(Tasks[(First + Count) % Tasks.size()]);
+	Tasks[(First + Count) % Tasks.size()] = nullptr;
+}
+
+void ThreadPool::TaskQueue::PopFront(std::function<void()>& task)
+{
+	task = std::move(Tasks[First]);
+	Tasks[First] = nullptr;
+	First = (First + 1) % Tasks.size();
+	Count--;
+}
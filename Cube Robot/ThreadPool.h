@@ -0,0 +1,78 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A simple work-stealing thread pool.
+//
+// Each thread has its own queue of tasks.  Tasks submitted from a task running on the pool
+// go on the queue of the thread that submitted them and are taken from the back of that
+// queue (so the most recently created, and most likely cached, work is done first).  A thread
+// that runs out of work steals the oldest task from the front of another thread's queue.
+//
+// The thread that calls Wait takes part in running the tasks, so a pool created with a
+// thread count of N runs tasks on N threads in total (N - 1 worker threads plus the caller).
+//
+// Each queue is a ring of tasks that only grows, so once the queues have grown to the number of
+// tasks submitted in a frame, submitting a task does not allocate.  Tasks should capture no more
+// than a couple of pointers, which std::function holds without allocating.
+
+class ThreadPool
+{
+public:
+	// The constructor returns once every worker thread has started
+	ThreadPool();
+	ThreadPool(unsigned int threadCount);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	void Submit(std::function<void()> task);
+
+	// Run tasks until every task that has been submitted (including any tasks
+	// that those tasks submit) has completed.  The calling thread sleeps while
+	// there is nothing left for it to take but other threads are still running
+	// tasks.  If any task threw an exception, the first one is rethrown here once
+	// every task has completed.
+	void Wait();
+
+	inline unsigned int GetThreadCount() const { return static_cast<unsigned int>(_queues.size()); }
+
+private:
+	struct TaskQueue
+	{
+		std::mutex							Mutex;
+		std::vector<std::function<void()>>	Tasks;				// A ring of Count tasks, oldest first, starting at First
+		size_t								First{ 0 };
+		size_t								Count{ 0 };
+
+		void PushBack(std::function<void()>&& task);
+		void PopBack(std::function<void()>& task);
+		void PopFront(std::function<void()>& task);
+	};
+
+	std::vector<std::unique_ptr<TaskQueue>>	_queues;			// One per thread.  The last one belongs to the thread calling Wait
+	std::vector<std::thread>				_workers;
+	std::atomic<size_t>						_pendingTasks{ 0 };			// Tasks submitted but not yet completed
+	std::atomic<size_t>						_queuedTasks{ 0 };			// Tasks submitted but not yet started
+	std::atomic<unsigned int>				_nextQueue{ 0 };
+	std::atomic<bool>						_stopping{ false };
+	unsigned int							_startedWorkers{ 0 };		// Guarded by _sleepMutex
+
+	std::mutex								_sleepMutex;
+	std::condition_variable					_workAvailable;			// Signalled when a task is queued, and when the last pending task completes
+	std::condition_variable					_workerStarted;
+
+	std::mutex								_exceptionMutex;
+	std::exception_ptr						_firstException;		// The first exception thrown by a task since the last Wait
+
+	void WorkerLoop(unsigned int queueIndex);
+	bool RunOneTask(unsigned int queueIndex);
+	bool PopTask(unsigned int queueIndex, std::function<void()>& task);
+};
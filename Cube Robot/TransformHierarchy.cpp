@@ -0,0 +1,372 @@
+#include "TransformHierarchy.h"
+#include "Profiler.h"
+#include <algorithm>
+
+void TransformHierarchy::Build(SceneNode * root)
+{
+	Clear();
+	if (root == nullptr)
+	{
+		return;
+	}
+	AddSubtree(root, -1);
+
+	// Since the nodes are in depth-first order, the size of each subtree can be
+	// found by adding the size of each node to its parent, working backwards
+	size_t nodeCount = _nodes.size();
+	_subtreeSizes.assign(nodeCount, 1);
+	for (size_t i = nodeCount - 1; i > 0; i--)
+	{
+		_subtreeSizes[_parents[i]] += _subtreeSizes[i];
+	}
+	_worldTransformations.resize(nodeCount);
+	_worldChanged.assign(nodeCount, true);
+
+	// Pointers to the matrices held in each node, used by the batched matrix calculation
+	_localTransformations.resize(nodeCount);
+	_nodeWorldTransformations.resize(nodeCount);
+	for (size_t i = 0; i < nodeCount; i++)
+	{
+		_localTransformations[i] = &_nodes[i]->_thisWorldTransformation;
+		_nodeWorldTransformations[i] = &_nodes[i]->_cumulativeWorldTransformation;
+	}
+	_batch.LocalTransformations = _localTransformations.data();
+	_batch.Parents = _parents.data();
+	_batch.WorldTransformations = _worldTransformations.data();
+	_batch.NodeWorldTransformations = _nodeWorldTransformations.data();
+
+	// The local bounds of a node are fixed, so they only need to be asked for once
+	_localBounds.resize(nodeCount);
+	_localBoundsTypes.resize(nodeCount);
+	for (size_t i = 0; i < nodeCount; i++)
+	{
+		_localBoundsTypes[i] = _nodes[i]->GetLocalBounds(_localBounds[i]);
+	}
+	_worldBounds.resize(nodeCount);
+	_subtreeVisited.assign(nodeCount, true);
+	if (_interpolationEnabled)
+	{
+		_previousWorldTransformations.resize(nodeCount);
+	}
+
+	// Nothing from the previous hierarchy can be relied on, so recalculate everything
+	_updateAll = true;
+}
+
+void TransformHierarchy::Clear()
+{
+	_nodes.clear();
+	_parents.clear();
+	_subtreeSizes.clear();
+	_worldTransformations.clear();
+	_worldChanged.clear();
+	_localTransformations.clear();
+	_nodeWorldTransformations.clear();
+	_localBounds.clear();
+	_localBoundsTypes.clear();
+	_worldBounds.clear();
+	_subtreeVisited.clear();
+	_previousWorldTransformations.clear();
+	_interpolatedNodes.clear();
+	_updatedTransformCount = 0;
+	_updatesSinceBuild = 0;
+}
+
+void TransformHierarchy::AddSubtree(SceneNode * node, int parent)
+{
+	// Walk the tree depth-first using an explicit stack so that very deep
+	// hierarchies cannot overflow the call stack.  Children are pushed in
+	// reverse so that they are visited in the order they were added.
+	std::vector<std::pair<SceneNode *, int>> stack;
+	stack.emplace_back(node, parent);
+	while (!stack.empty())
+	{
+		SceneNode * current = stack.back().first;
+		int currentParent = stack.back().second;
+		stack.pop_back();
+
+		int index = static_cast<int>(_nodes.size());
+		_nodes.push_back(current);
+		_parents.push_back(currentParent);
+
+		for (size_t i = current->GetChildCount(); i > 0; i--)
+		{
+			stack.emplace_back(current->GetChild(i - 1).get(), index);
+		}
+	}
+}
+
+void TransformHierarchy::Update(const Matrix& rootTransformation)
+{
+	_updatedTransformCount = 0;
+	if (!BeginUpdate(rootTransformation))
+	{
+		return;
+	}
+	_updatedTransformCount = UpdateRange(0, _nodes.size());
+	MergeBounds();
+	_updateAll = false;
+	_updatesSinceBuild++;
+}
+
+void TransformHierarchy::Update(const Matrix& rootTransformation, ThreadPool& threadPool, size_t minimumTaskSize)
+{
+	_updatedTransformCount = 0;
+	if (!BeginUpdate(rootTransformation))
+	{
+		return;
+	}
+	_taskPool = &threadPool;
+	_minimumTaskSize = std::max<size_t>(minimumTaskSize, 1);
+	_taskUpdatedTransformCount = 0;
+	UpdateSubtreeTask(0);
+	threadPool.Wait();
+	_taskPool = nullptr;
+	_updatedTransformCount = _taskUpdatedTransformCount;
+	MergeBounds();
+	_updateAll = false;
+	_updatesSinceBuild++;
+}
+
+bool TransformHierarchy::BeginUpdate(const Matrix& rootTransformation)
+{
+	RestoreInterpolatedNodes();
+	if (_nodes.empty())
+	{
+		return false;
+	}
+
+	// If the transformation being applied to the whole hierarchy has changed, every node has moved
+	if (rootTransformation != _batch.RootTransformation)
+	{
+		_batch.RootTransformation = rootTransformation;
+		_updateAll = true;
+	}
+	return true;
+}
+
+size_t TransformHierarchy::UpdateRange(size_t first, size_t end)
+{
+	// Since parents always come before their children, a single pass is enough.
+	// Any subtree in which nothing has changed is skipped over completely.
+	size_t updatedTransformCount = 0;
+	size_t i = first;
+	while (i < end)
+	{
+		if (IsSubtreeUnchanged(i))
+		{
+			_worldChanged[i] = false;
+			_subtreeVisited[i] = false;
+			i += _subtreeSizes[i];
+			continue;
+		}
+
+		if (ParentChanged(i))
+		{
+			// The whole subtree has moved with its parent, and it is stored
+			// contiguously, so it can be calculated as a single batch.  The batch
+			// stops at the end of the range, so that a threaded update can calculate
+			// the root of a subtree before handing its children to other tasks.
+			size_t subtreeEnd = std::min(i + _subtreeSizes[i], end);
+			KeepPreviousTransformations(i, subtreeEnd);
+			ConcatenateTransforms(_batch, i, subtreeEnd);
+			for (size_t j = i; j < subtreeEnd; j++)
+			{
+				_worldChanged[j] = true;
+				_subtreeVisited[j] = true;
+				CalculateBounds(j);
+				_nodes[j]->_transformChanged = false;
+				_nodes[j]->_descendantChanged = false;
+			}
+			updatedTransformCount += subtreeEnd - i;
+			i = subtreeEnd;
+			continue;
+		}
+
+		SceneNode * node = _nodes[i];
+		bool changed = node->_transformChanged;
+		if (changed)
+		{
+			KeepPreviousTransformations(i, i + 1);
+			ConcatenateTransforms(_batch, i, i + 1);
+			CalculateBounds(i);
+			updatedTransformCount++;
+		}
+		_worldChanged[i] = changed;
+		_subtreeVisited[i] = true;
+		node->_transformChanged = false;
+		node->_descendantChanged = false;
+		i++;
+	}
+	return updatedTransformCount;
+}
+
+void TransformHierarchy::UpdateSubtreeTask(size_t subtreeRoot)
+{
+	PROFILE_ZONE("TransformHierarchy::UpdateSubtree");
+	if (IsSubtreeUnchanged(subtreeRoot))
+	{
+		_worldChanged[subtreeRoot] = false;
+		_subtreeVisited[subtreeRoot] = false;
+		return;
+	}
+
+	// Update the root of the subtree first, since all of its children depend on it
+	size_t updated = UpdateRange(subtreeRoot, subtreeRoot + 1);
+
+	// Children with large subtrees are handed to the thread pool as separate tasks.  Smaller
+	// ones are updated here, since the cost of creating a task would outweigh the benefit.
+	// Since different subtrees never share nodes, the tasks do not need to be synchronised.  A task
+	// only captures this and the child, which std::function can hold without allocating.
+	size_t end = subtreeRoot + _subtreeSizes[subtreeRoot];
+	for (size_t child = subtreeRoot + 1; child < end; child += _subtreeSizes[child])
+	{
+		if (static_cast<size_t>(_subtreeSizes[child]) >= _minimumTaskSize)
+		{
+			_taskPool->Submit([this, child]()
+							  {
+								  UpdateSubtreeTask(child);
+							  });
+		}
+		else
+		{
+			updated += UpdateRange(child, child + _subtreeSizes[child]);
+		}
+	}
+	_taskUpdatedTransformCount += updated;
+}
+
+void TransformHierarchy::SetInterpolationEnabled(bool enabled)
+{
+	RestoreInterpolatedNodes();
+	_interpolationEnabled = enabled;
+	if (enabled)
+	{
+		_previousWorldTransformations.resize(_nodes.size());
+	}
+	else
+	{
+		_previousWorldTransformations.clear();
+	}
+
+	// The transformations before the last update were not kept, so cannot be blended until after the next one
+	_updatesSinceBuild = 0;
+}
+
+void TransformHierarchy::Interpolate(float alpha)
+{
+	RestoreInterpolatedNodes();
+
+	// The results of the first update after a build are not blended, since there is nothing to blend them with
+	if (!_interpolationEnabled || _updatesSinceBuild < 2 || alpha >= 1.0f)
+	{
+		return;
+	}
+
+	// Only the nodes that moved in the last update need blending, and they are all in the subtrees that it visited
+	size_t i = 0;
+	while (i < _nodes.size())
+	{
+		if (!_subtreeVisited[i])
+		{
+			i += _subtreeSizes[i];
+			continue;
+		}
+		if (_worldChanged[i])
+		{
+			*_nodeWorldTransformations[i] = Matrix::Lerp(_previousWorldTransformations[i], _worldTransformations[i], alpha);
+			_interpolatedNodes.push_back(i);
+		}
+		i++;
+	}
+}
+
+void TransformHierarchy::RestoreInterpolatedNodes()
+{
+	for (size_t index : _interpolatedNodes)
+	{
+		*_nodeWorldTransformations[index] = _worldTransformations[index];
+	}
+	_interpolatedNodes.clear();
+}
+
+void TransformHierarchy::KeepPreviousTransformations(size_t first, size_t end)
+{
+	if (_interpolationEnabled)
+	{
+		std::copy(_worldTransformations.begin() + first, _worldTransformations.begin() + end, _previousWorldTransformations.begin() + first);
+	}
+}
+
+void TransformHierarchy::CalculateBounds(size_t index)
+{
+	// Only the bounds of the geometry drawn by the node itself are calculated here.
+	// If the node has children, these are merged in afterwards by MergeBounds.
+	if (_localBoundsTypes[index] == BoundsType::Finite)
+	{
+		_localBounds[index].Transform(_worldBounds[index], _worldTransformations[index]);
+	}
+	if (_subtreeSizes[index] == 1)
+	{
+		SceneNode * node = _nodes[index];
+		node->_worldBounds = _worldBounds[index];
+		node->_worldBoundsType = _localBoundsTypes[index];
+	}
+}
+
+void TransformHierarchy::MergeBounds()
+{
+	// Visit the nodes with children in the subtrees that were visited by the update, children
+	// before parents, so that the bounds of every child are complete before being merged into
+	// its parent.  Skipped subtrees keep the bounds calculated by an earlier update.
+	if (_nodes.empty() || _subtreeSizes[0] == 1 || !_subtreeVisited[0])
+	{
+		return;
+	}
+	_mergeStack.clear();
+	_mergeStack.emplace_back(0, false);
+	while (!_mergeStack.empty())
+	{
+		size_t index = _mergeStack.back().first;
+		size_t end = index + _subtreeSizes[index];
+		if (!_mergeStack.back().second)
+		{
+			_mergeStack.back().second = true;
+			for (size_t child = index + 1; child < end; child += _subtreeSizes[child])
+			{
+				if (_subtreeSizes[child] > 1 && _subtreeVisited[child])
+				{
+					_mergeStack.emplace_back(child, false);
+				}
+			}
+			continue;
+		}
+		_mergeStack.pop_back();
+
+		BoundsType boundsType = _localBoundsTypes[index];
+		BoundingSphere bounds = _worldBounds[index];
+		for (size_t child = index + 1; child < end && boundsType != BoundsType::Infinite; child += _subtreeSizes[child])
+		{
+			const SceneNode * childNode = _nodes[child];
+			if (childNode->_worldBoundsType == BoundsType::Infinite)
+			{
+				boundsType = BoundsType::Infinite;
+			}
+			else if (childNode->_worldBoundsType == BoundsType::Finite)
+			{
+				if (boundsType == BoundsType::Empty)
+				{
+					bounds = childNode->_worldBounds;
+					boundsType = BoundsType::Finite;
+				}
+				else
+				{
+					BoundingSphere::CreateMerged(bounds, bounds, childNode->_worldBounds);
+				}
+			}
+		}
+		SceneNode * node = _nodes[index];
+		node->_worldBounds = bounds;
+		node->_worldBoundsType = boundsType;
+	}
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include "SceneNode.h"
+#include "MatrixBatch.h"
+#include "ThreadPool.h"
+#include <atomic>
+#include <vector>
+
+// A flattened copy of the transformation hierarchy of a scene graph.
+//
+// The nodes are stored in depth-first (topological) order, so a parent always appears
+// before any of its children and the whole subtree of a node occupies a contiguous range
+// of the arrays.  This lets the world transformations be calculated in a single linear
+// pass without recursion or virtual calls.  Whenever a whole subtree has to be recalculated,
+// it is passed to ConcatenateTransforms (see MatrixBatch.h) as a single batch.
+//
+// Only the subtrees containing nodes whose transformation has changed since the last
+// update (see SceneNode::SetWorldTransform) are visited, so the cost of an update is
+// roughly proportional to the number of nodes that have actually moved.
+//
+// The update can also be split across a thread pool.  Each subtree containing at least
+// the given minimum number of nodes becomes a separate task.  Every node is calculated in
+// exactly the same way as in the single-threaded update, so the results are identical.
+//
+// The world bounds of each node are calculated along with its world transformation.  The bounds
+// of a scene graph include everything below it, so once the transformations are up to date the
+// bounds of the scene graphs that were visited are merged from the bottom up.
+//
+// If interpolation is enabled, the world transformation each node had before the last update is
+// kept, and Interpolate sets the transformation held in each node that moved to a blend between the
+// two.  Matrices are blended element by element, which is close enough to blending the rotations
+// for the small movements between two updates.  Since the hierarchy's own copy of the results is
+// used to calculate the next update, the nodes' copies can be changed without affecting it.  They
+// are put back to the results of the last update at the start of the next one.
+//
+// The hierarchy must be rebuilt (by calling Build) whenever nodes are added to or removed
+// from the scene graph.  SceneGraph takes care of this.
+
+class TransformHierarchy
+{
+public:
+	void Build(SceneNode * root);
+	void Update(const Matrix& rootTransformation);
+	void Update(const Matrix& rootTransformation, ThreadPool& threadPool, size_t minimumTaskSize);
+	void Clear();
+
+	void SetInterpolationEnabled(bool enabled);
+	void Interpolate(float alpha);
+
+	inline size_t GetNodeCount() const { return _nodes.size(); }
+	inline const std::vector<SceneNode *>& GetNodes() const { return _nodes; }
+
+	// The number of world transformations recalculated by the last call to Update
+	inline size_t GetUpdatedTransformCount() const { return _updatedTransformCount; }
+
+private:
+	std::vector<SceneNode *>	_nodes;						// Nodes in depth-first order
+	std::vector<int>			_parents;					// Index of the parent of each node (-1 for the root)
+	std::vector<int>			_subtreeSizes;				// Number of nodes in the subtree starting at each node
+	std::vector<Matrix>			_worldTransformations;		// The resulting cumulative world transformations
+	std::vector<char>			_worldChanged;				// Whether the world transformation of each node changed in the last update
+	std::vector<const Matrix *>	_localTransformations;		// The transformation set on each node with SetWorldTransform
+	std::vector<Matrix *>		_nodeWorldTransformations;	// Where the world transformation is stored in each node
+	std::vector<BoundingSphere>	_localBounds;				// Bounds of the geometry drawn by each node (see SceneNode::GetLocalBounds)
+	std::vector<BoundsType>		_localBoundsTypes;
+	std::vector<BoundingSphere>	_worldBounds;				// _localBounds transformed into world space
+	std::vector<char>			_subtreeVisited;			// Whether the last update visited each node (rather than skipping its subtree)
+	std::vector<std::pair<size_t, bool>> _mergeStack;
+	std::vector<Matrix>			_previousWorldTransformations;	// The world transformations before the last update, if interpolating
+	std::vector<size_t>			_interpolatedNodes;				// Nodes given an interpolated transformation by Interpolate
+	TransformBatch				_batch;
+
+	bool						_updateAll{ true };
+	size_t						_updatedTransformCount{ 0 };
+	bool						_interpolationEnabled{ false };
+	size_t						_updatesSinceBuild{ 0 };
+
+	// The thread pool and minimum task size of a threaded update, and the transformations updated by its tasks
+	ThreadPool *				_taskPool{ nullptr };
+	size_t						_minimumTaskSize{ 1 };
+	std::atomic<size_t>			_taskUpdatedTransformCount{ 0 };
+
+	void AddSubtree(SceneNode * node, int parent);
+	bool BeginUpdate(const Matrix& rootTransformation);
+	size_t UpdateRange(size_t first, size_t end);
+	void CalculateBounds(size_t index);
+	void MergeBounds();
+	void RestoreInterpolatedNodes();
+	void KeepPreviousTransformations(size_t first, size_t end);
+	void UpdateSubtreeTask(size_t subtreeRoot);
+
+	inline bool ParentChanged(size_t index) const
+	{
+		int parent = _parents[index];
+		return (parent < 0) ? _updateAll : (_worldChanged[parent] != 0);
+	}
+
+	// True if neither this node, anything above it or anything below it has moved
+	inline bool IsSubtreeUnchanged(size_t index) const
+	{
+		const SceneNode * node = _nodes[index];
+		return !ParentChanged(index) && !node->_transformChanged && !node->_descendantChanged;
+	}
+};
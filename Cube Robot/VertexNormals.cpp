@@ -0,0 +1,579 @@
+#include "VertexNormals.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define VERTEX_NORMALS_SSE 1
+#include <immintrin.h>
+#endif
+
+namespace
+{
+	// Triangles or vertices in each task given to the thread pool
+	constexpr size_t NORMAL_TASK_SIZE = 16384;
+
+	// Stops the lengths of zero-length edges giving infinite cosines
+	constexpr float NORMAL_MINIMUM_LENGTH_SQUARED = 1e-30f;
+
+	// The arrays used by the passes of VertexNormalGenerator::Generate
+
+	struct NormalPasses
+	{
+		Vertex *			Vertices;
+		const uint32_t *	Indices;
+		float *				PositionsX;				// The positions of the vertices, transposed for SSE
+		float *				PositionsY;
+		float *				PositionsZ;
+		float *				TriangleNormalsX;
+		float *				TriangleNormalsY;
+		float *				TriangleNormalsZ;
+		float *				CornerAngles;
+		size_t				BlockCount;				// Blocks of NORMAL_TASK_SIZE vertices that the corners are first sorted into
+		uint32_t *			RangeBlockCorners;		// For each range of corners, how many of its corners are in each block, then where they start
+		uint32_t *			BlockCornerStarts;
+		uint32_t *			BlockCorners;			// The corners, sorted by block
+		uint32_t *			VertexCornerOffsets;
+		uint32_t *			VertexCorners;
+		float *				NormalSums;				// The x, y and z sums of each vertex and a fourth float, so SSE can add a triangle to a vertex at once
+		NormalWeighting		Weighting;
+		bool				Scatter;				// Add each triangle's normal to its vertices' sums straight away
+		bool				Simd;
+	};
+
+	// Run function(first, end) over [0, count), split into tasks on the thread pool if there is one
+
+	template <typename Function>
+	void ForEachNormalRange(ThreadPool * threadPool, size_t count, const Function& function)
+	{
+		if (threadPool == nullptr || count <= NORMAL_TASK_SIZE)
+		{
+			function(0, count);
+			return;
+		}
+
+		// Each task captures only a pointer and its first index, which std::function holds without allocating
+		auto runRange = [&function, count](size_t first) { function(first, std::min(first + NORMAL_TASK_SIZE, count)); };
+		for (size_t first = 0; first < count; first += NORMAL_TASK_SIZE)
+		{
+			threadPool->Submit([&runRange, first]() { runRange(first); });
+		}
+		threadPool->Wait();
+	}
+
+	//--------------------------------------------------------------------------------------
+	// Scalar
+	//--------------------------------------------------------------------------------------
+
+	// The arc cosine, from Abramowitz and Stegun 4.4.46, which is within 2e-8 radians.  The SSE version
+	// uses the same polynomial, so that both give the same weights.
+	constexpr float ACOS_0 = 1.5707963050f;
+	constexpr float ACOS_1 = -0.2145988016f;
+	constexpr float ACOS_2 = 0.0889789874f;
+	constexpr float ACOS_3 = -0.0501743046f;
+	constexpr float ACOS_4 = 0.0308918810f;
+	constexpr float ACOS_5 = -0.0170881256f;
+	constexpr float ACOS_6 = 0.0066700901f;
+	constexpr float ACOS_7 = -0.0012624911f;
+	constexpr float ACOS_PI = 3.14159265358979f;
+
+	inline float CornerAngle(float cosine)
+	{
+		float x = std::min(std::fabs(cosine), 1.0f);
+		float polynomial = ((((((ACOS_7 * x + ACOS_6) * x + ACOS_5) * x + ACOS_4) * x + ACOS_3) * x + ACOS_2) * x + ACOS_1) * x + ACOS_0;
+		float angle = std::sqrt(1.0f - x) * polynomial;
+		return cosine < 0.0f ? ACOS_PI - angle : angle;
+	}
+
+	// Keep the normal of a triangle (and the angles at its corners, if weighted by angle) for the gather
+	// pass, or add them to the sums of its vertices now
+
+	inline void StoreTriangle(const NormalPasses& passes, size_t triangle, float normalX, float normalY, float normalZ, const float * angles)
+	{
+		if (passes.Scatter)
+		{
+			for (size_t i = 0; i < 3; i++)
+			{
+				uint32_t vertex = passes.Indices[triangle * 3 + i];
+				float weight = angles != nullptr ? angles[i] : 1.0f;
+				float * sum = passes.NormalSums + static_cast<size_t>(vertex) * 4;
+				sum[0] += normalX * weight;
+				sum[1] += normalY * weight;
+				sum[2] += normalZ * weight;
+			}
+			return;
+		}
+		passes.TriangleNormalsX[triangle] = normalX;
+		passes.TriangleNormalsY[triangle] = normalY;
+		passes.TriangleNormalsZ[triangle] = normalZ;
+		if (angles != nullptr)
+		{
+			for (size_t i = 0; i < 3; i++)
+			{
+				passes.CornerAngles[triangle * 3 + i] = angles[i];
+			}
+		}
+	}
+
+	void TriangleNormalsScalar(const NormalPasses& passes, size_t first, size_t end)
+	{
+		for (size_t triangle = first; triangle < end; triangle++)
+		{
+			const Vector3& position0 = passes.Vertices[passes.Indices[triangle * 3]].Position;
+			const Vector3& position1 = passes.Vertices[passes.Indices[triangle * 3 + 1]].Position;
+			const Vector3& position2 = passes.Vertices[passes.Indices[triangle * 3 + 2]].Position;
+			float edge1X = position1.x - position0.x;
+			float edge1Y = position1.y - position0.y;
+			float edge1Z = position1.z - position0.z;
+			float edge2X = position2.x - position0.x;
+			float edge2Y = position2.y - position0.y;
+			float edge2Z = position2.z - position0.z;
+			float normalX = edge1Y * edge2Z - edge1Z * edge2Y;
+			float normalY = edge1Z * edge2X - edge1X * edge2Z;
+			float normalZ = edge1X * edge2Y - edge1Y * edge2X;
+			if (passes.Weighting != NormalWeighting::Area)
+			{
+				float lengthSquared = normalX * normalX + normalY * normalY + normalZ * normalZ;
+				float scale = lengthSquared > 0.0f ? 1.0f / std::sqrt(lengthSquared) : 0.0f;
+				normalX *= scale;
+				normalY *= scale;
+				normalZ *= scale;
+			}
+			if (passes.Weighting != NormalWeighting::Angle)
+			{
+				StoreTriangle(passes, triangle, normalX, normalY, normalZ, nullptr);
+				continue;
+			}
+
+			// The corner at each vertex is between the two edges that meet there
+			float edge3X = edge2X - edge1X;
+			float edge3Y = edge2Y - edge1Y;
+			float edge3Z = edge2Z - edge1Z;
+			float length1 = edge1X * edge1X + edge1Y * edge1Y + edge1Z * edge1Z;
+			float length2 = edge2X * edge2X + edge2Y * edge2Y + edge2Z * edge2Z;
+			float length3 = edge3X * edge3X + edge3Y * edge3Y + edge3Z * edge3Z;
+			float dot12 = edge1X * edge2X + edge1Y * edge2Y + edge1Z * edge2Z;
+			float dot13 = edge1X * edge3X + edge1Y * edge3Y + edge1Z * edge3Z;
+			float dot23 = edge2X * edge3X + edge2Y * edge3Y + edge2Z * edge3Z;
+			float angles[3];
+			angles[0] = CornerAngle(dot12 / std::sqrt(std::max(length1 * length2, NORMAL_MINIMUM_LENGTH_SQUARED)));
+			angles[1] = CornerAngle(-dot13 / std::sqrt(std::max(length1 * length3, NORMAL_MINIMUM_LENGTH_SQUARED)));
+			angles[2] = CornerAngle(dot23 / std::sqrt(std::max(length2 * length3, NORMAL_MINIMUM_LENGTH_SQUARED)));
+			StoreTriangle(passes, triangle, normalX, normalY, normalZ, angles);
+		}
+	}
+
+	void NormaliseScalar(const NormalPasses& passes, size_t first, size_t end)
+	{
+		for (size_t vertex = first; vertex < end; vertex++)
+		{
+			const float * sum = passes.NormalSums + vertex * 4;
+			float lengthSquared = sum[0] * sum[0] + sum[1] * sum[1] + sum[2] * sum[2];
+			float scale = lengthSquared > 0.0f ? 1.0f / std::sqrt(lengthSquared) : 0.0f;
+			passes.Vertices[vertex].Normal = Vector3(sum[0] * scale, sum[1] * scale, sum[2] * scale);
+		}
+	}
+
+#if defined(VERTEX_NORMALS_SSE)
+
+	//--------------------------------------------------------------------------------------
+	// SSE.  Four triangles or vertices at a time, each in its own lane.  The positions are
+	// transposed into one array for each coordinate before the triangles are looked at, so
+	// the corners of four triangles are gathered straight into x, y and z registers.
+	//--------------------------------------------------------------------------------------
+
+	void TransposePositionsSse(const NormalPasses& passes, size_t first, size_t end)
+	{
+		for (size_t vertex = first; vertex < end; vertex++)
+		{
+			const Vector3& position = passes.Vertices[vertex].Position;
+			passes.PositionsX[vertex] = position.x;
+			passes.PositionsY[vertex] = position.y;
+			passes.PositionsZ[vertex] = position.z;
+		}
+	}
+
+	inline void GatherPositions(const NormalPasses& passes, size_t corner, __m128& x, __m128& y, __m128& z)
+	{
+		uint32_t index0 = passes.Indices[corner];
+		uint32_t index1 = passes.Indices[corner + 3];
+		uint32_t index2 = passes.Indices[corner + 6];
+		uint32_t index3 = passes.Indices[corner + 9];
+		x = _mm_setr_ps(passes.PositionsX[index0], passes.PositionsX[index1], passes.PositionsX[index2], passes.PositionsX[index3]);
+		y = _mm_setr_ps(passes.PositionsY[index0], passes.PositionsY[index1], passes.PositionsY[index2], passes.PositionsY[index3]);
+		z = _mm_setr_ps(passes.PositionsZ[index0], passes.PositionsZ[index1], passes.PositionsZ[index2], passes.PositionsZ[index3]);
+	}
+
+	inline __m128 SelectSse(__m128 mask, __m128 whenTrue, __m128 whenFalse)
+	{
+		return _mm_or_ps(_mm_and_ps(mask, whenTrue), _mm_andnot_ps(mask, whenFalse));
+	}
+
+	inline __m128 CornerAngleSse(__m128 cosine)
+	{
+		const __m128 one = _mm_set1_ps(1.0f);
+		__m128 x = _mm_min_ps(_mm_andnot_ps(_mm_set1_ps(-0.0f), cosine), one);
+		__m128 polynomial = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(ACOS_7), x), _mm_set1_ps(ACOS_6));
+		polynomial = _mm_add_ps(_mm_mul_ps(polynomial, x), _mm_set1_ps(ACOS_5));
+		polynomial = _mm_add_ps(_mm_mul_ps(polynomial, x), _mm_set1_ps(ACOS_4));
+		polynomial = _mm_add_ps(_mm_mul_ps(polynomial, x), _mm_set1_ps(ACOS_3));
+		polynomial = _mm_add_ps(_mm_mul_ps(polynomial, x), _mm_set1_ps(ACOS_2));
+		polynomial = _mm_add_ps(_mm_mul_ps(polynomial, x), _mm_set1_ps(ACOS_1));
+		polynomial = _mm_add_ps(_mm_mul_ps(polynomial, x), _mm_set1_ps(ACOS_0));
+		__m128 angle = _mm_mul_ps(_mm_sqrt_ps(_mm_sub_ps(one, x)), polynomial);
+		return SelectSse(_mm_cmplt_ps(cosine, _mm_setzero_ps()), _mm_sub_ps(_mm_set1_ps(ACOS_PI), angle), angle);
+	}
+
+	inline __m128 CosineSse(__m128 dot, __m128 lengthA, __m128 lengthB)
+	{
+		return _mm_div_ps(dot, _mm_sqrt_ps(_mm_max_ps(_mm_mul_ps(lengthA, lengthB), _mm_set1_ps(NORMAL_MINIMUM_LENGTH_SQUARED))));
+	}
+
+	inline __m128 DotSse(__m128 ax, __m128 ay, __m128 az, __m128 bx, __m128 by, __m128 bz)
+	{
+		return _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)), _mm_mul_ps(az, bz));
+	}
+
+	// 1 / length, or 0 where the length is 0
+	inline __m128 InverseLengthSse(__m128 lengthSquared)
+	{
+		__m128 nonZero = _mm_cmpgt_ps(lengthSquared, _mm_setzero_ps());
+		__m128 inverse = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(SelectSse(nonZero, lengthSquared, _mm_set1_ps(1.0f))));
+		return _mm_and_ps(nonZero, inverse);
+	}
+
+	// The SSE version of StoreTriangle, for four triangles.  Each triangle's normal is moved into a
+	// register of its own, so that it is added to each of its vertices at once.
+
+	inline void StoreTrianglesSse(const NormalPasses& passes, size_t triangle, __m128 normalX, __m128 normalY, __m128 normalZ, const float (*angles)[4])
+	{
+		if (passes.Scatter)
+		{
+			__m128 normals[4] = { normalX, normalY, normalZ, _mm_setzero_ps() };
+			_MM_TRANSPOSE4_PS(normals[0], normals[1], normals[2], normals[3]);
+			for (size_t lane = 0; lane < 4; lane++)
+			{
+				for (size_t i = 0; i < 3; i++)
+				{
+					float * sum = passes.NormalSums + static_cast<size_t>(passes.Indices[(triangle + lane) * 3 + i]) * 4;
+					__m128 normal = angles != nullptr ? _mm_mul_ps(normals[lane], _mm_set1_ps(angles[i][lane])) : normals[lane];
+					_mm_storeu_ps(sum, _mm_add_ps(_mm_loadu_ps(sum), normal));
+				}
+			}
+			return;
+		}
+		_mm_storeu_ps(passes.TriangleNormalsX + triangle, normalX);
+		_mm_storeu_ps(passes.TriangleNormalsY + triangle, normalY);
+		_mm_storeu_ps(passes.TriangleNormalsZ + triangle, normalZ);
+		if (angles != nullptr)
+		{
+			for (size_t lane = 0; lane < 4; lane++)
+			{
+				for (size_t i = 0; i < 3; i++)
+				{
+					passes.CornerAngles[(triangle + lane) * 3 + i] = angles[i][lane];
+				}
+			}
+		}
+	}
+
+	void TriangleNormalsSse(const NormalPasses& passes, size_t first, size_t end)
+	{
+		size_t triangle = first;
+		for (; triangle + 4 <= end; triangle += 4)
+		{
+			size_t corner = triangle * 3;
+			__m128 position0X, position0Y, position0Z;
+			__m128 position1X, position1Y, position1Z;
+			__m128 position2X, position2Y, position2Z;
+			GatherPositions(passes, corner, position0X, position0Y, position0Z);
+			GatherPositions(passes, corner + 1, position1X, position1Y, position1Z);
+			GatherPositions(passes, corner + 2, position2X, position2Y, position2Z);
+			__m128 edge1X = _mm_sub_ps(position1X, position0X);
+			__m128 edge1Y = _mm_sub_ps(position1Y, position0Y);
+			__m128 edge1Z = _mm_sub_ps(position1Z, position0Z);
+			__m128 edge2X = _mm_sub_ps(position2X, position0X);
+			__m128 edge2Y = _mm_sub_ps(position2Y, position0Y);
+			__m128 edge2Z = _mm_sub_ps(position2Z, position0Z);
+			__m128 normalX = _mm_sub_ps(_mm_mul_ps(edge1Y, edge2Z), _mm_mul_ps(edge1Z, edge2Y));
+			__m128 normalY = _mm_sub_ps(_mm_mul_ps(edge1Z, edge2X), _mm_mul_ps(edge1X, edge2Z));
+			__m128 normalZ = _mm_sub_ps(_mm_mul_ps(edge1X, edge2Y), _mm_mul_ps(edge1Y, edge2X));
+			if (passes.Weighting != NormalWeighting::Area)
+			{
+				__m128 scale = InverseLengthSse(DotSse(normalX, normalY, normalZ, normalX, normalY, normalZ));
+				normalX = _mm_mul_ps(normalX, scale);
+				normalY = _mm_mul_ps(normalY, scale);
+				normalZ = _mm_mul_ps(normalZ, scale);
+			}
+			if (passes.Weighting != NormalWeighting::Angle)
+			{
+				StoreTrianglesSse(passes, triangle, normalX, normalY, normalZ, nullptr);
+				continue;
+			}
+
+			__m128 edge3X = _mm_sub_ps(edge2X, edge1X);
+			__m128 edge3Y = _mm_sub_ps(edge2Y, edge1Y);
+			__m128 edge3Z = _mm_sub_ps(edge2Z, edge1Z);
+			__m128 length1 = DotSse(edge1X, edge1Y, edge1Z, edge1X, edge1Y, edge1Z);
+			__m128 length2 = DotSse(edge2X, edge2Y, edge2Z, edge2X, edge2Y, edge2Z);
+			__m128 length3 = DotSse(edge3X, edge3Y, edge3Z, edge3X, edge3Y, edge3Z);
+			__m128 negativeDot13 = _mm_sub_ps(_mm_setzero_ps(), DotSse(edge1X, edge1Y, edge1Z, edge3X, edge3Y, edge3Z));
+			alignas(16) float angles[3][4];
+			_mm_store_ps(angles[0], CornerAngleSse(CosineSse(DotSse(edge1X, edge1Y, edge1Z, edge2X, edge2Y, edge2Z), length1, length2)));
+			_mm_store_ps(angles[1], CornerAngleSse(CosineSse(negativeDot13, length1, length3)));
+			_mm_store_ps(angles[2], CornerAngleSse(CosineSse(DotSse(edge2X, edge2Y, edge2Z, edge3X, edge3Y, edge3Z), length2, length3)));
+			StoreTrianglesSse(passes, triangle, normalX, normalY, normalZ, angles);
+		}
+		TriangleNormalsScalar(passes, triangle, end);
+	}
+
+	void NormaliseSse(const NormalPasses& passes, size_t first, size_t end)
+	{
+		size_t vertex = first;
+		for (; vertex + 4 <= end; vertex += 4)
+		{
+			const float * sums = passes.NormalSums + vertex * 4;
+			__m128 x = _mm_loadu_ps(sums);
+			__m128 y = _mm_loadu_ps(sums + 4);
+			__m128 z = _mm_loadu_ps(sums + 8);
+			__m128 w = _mm_loadu_ps(sums + 12);
+			_MM_TRANSPOSE4_PS(x, y, z, w);
+			__m128 scale = InverseLengthSse(DotSse(x, y, z, x, y, z));
+			alignas(16) float normals[3][4];
+			_mm_store_ps(normals[0], _mm_mul_ps(x, scale));
+			_mm_store_ps(normals[1], _mm_mul_ps(y, scale));
+			_mm_store_ps(normals[2], _mm_mul_ps(z, scale));
+			for (size_t lane = 0; lane < 4; lane++)
+			{
+				passes.Vertices[vertex + lane].Normal = Vector3(normals[0][lane], normals[1][lane], normals[2][lane]);
+			}
+		}
+		NormaliseScalar(passes, vertex, end);
+	}
+
+#endif
+
+	//--------------------------------------------------------------------------------------
+	// The passes
+	//--------------------------------------------------------------------------------------
+
+	// The scalar calculations read the positions from the vertices, so they are only transposed for SSE
+
+	void TransposePositions(const NormalPasses& passes, size_t first, size_t end)
+	{
+#if defined(VERTEX_NORMALS_SSE)
+		if (passes.Simd)
+		{
+			TransposePositionsSse(passes, first, end);
+		}
+#endif
+	}
+
+	void CalculateTriangleNormals(const NormalPasses& passes, size_t first, size_t end)
+	{
+#if defined(VERTEX_NORMALS_SSE)
+		if (passes.Simd)
+		{
+			TriangleNormalsSse(passes, first, end);
+			return;
+		}
+#endif
+		TriangleNormalsScalar(passes, first, end);
+	}
+
+	// Normalise the sums and store them in the vertices
+
+	void FinishVertexNormals(const NormalPasses& passes, size_t first, size_t end)
+	{
+#if defined(VERTEX_NORMALS_SSE)
+		if (passes.Simd)
+		{
+			NormaliseSse(passes, first, end);
+		}
+		else
+#endif
+		{
+			NormaliseScalar(passes, first, end);
+		}
+	}
+
+	// Add up the normals of the triangles that use each vertex, in the order of the triangles, so that the
+	// sums are the same as when the triangles are scattered
+
+	void GatherVertexNormals(const NormalPasses& passes, size_t first, size_t end)
+	{
+		bool weightedByAngle = passes.Weighting == NormalWeighting::Angle;
+		for (size_t vertex = first; vertex < end; vertex++)
+		{
+			float x = 0.0f;
+			float y = 0.0f;
+			float z = 0.0f;
+			for (uint32_t i = passes.VertexCornerOffsets[vertex]; i < passes.VertexCornerOffsets[vertex + 1]; i++)
+			{
+				uint32_t corner = passes.VertexCorners[i];
+				uint32_t triangle = corner / 3;
+				float weight = weightedByAngle ? passes.CornerAngles[corner] : 1.0f;
+				x += passes.TriangleNormalsX[triangle] * weight;
+				y += passes.TriangleNormalsY[triangle] * weight;
+				z += passes.TriangleNormalsZ[triangle] * weight;
+			}
+			float * sum = passes.NormalSums + vertex * 4;
+			sum[0] = x;
+			sum[1] = y;
+			sum[2] = z;
+		}
+		FinishVertexNormals(passes, first, end);
+	}
+
+	// The corners are sorted by vertex in two steps, so that both can be split between threads without
+	// atomics.  First, the vertices are divided into blocks of NORMAL_TASK_SIZE, each range of corners
+	// counts how many of its corners go in each block, and the ranges copy their corners into the blocks.
+	// Then each block sorts its own corners by vertex.  Both steps keep the corners in the order of the
+	// triangles, so the sums are added up in the same order however the work is split.
+
+	void CountBlockCorners(const NormalPasses& passes, size_t first, size_t end)
+	{
+		uint32_t * counts = passes.RangeBlockCorners + first / NORMAL_TASK_SIZE * passes.BlockCount;
+		std::fill(counts, counts + passes.BlockCount, 0u);
+		for (size_t corner = first; corner < end; corner++)
+		{
+			counts[passes.Indices[corner] / NORMAL_TASK_SIZE]++;
+		}
+	}
+
+	void PlaceBlockCorners(const NormalPasses& passes, size_t first, size_t end)
+	{
+		uint32_t * starts = passes.RangeBlockCorners + first / NORMAL_TASK_SIZE * passes.BlockCount;
+		for (size_t corner = first; corner < end; corner++)
+		{
+			passes.BlockCorners[starts[passes.Indices[corner] / NORMAL_TASK_SIZE]++] = static_cast<uint32_t>(corner);
+		}
+	}
+
+	void SortBlockCorners(const NormalPasses& passes, size_t first, size_t end)
+	{
+		uint32_t * offsets = passes.VertexCornerOffsets;
+		const uint32_t blockStart = passes.BlockCornerStarts[first / NORMAL_TASK_SIZE];
+		const uint32_t blockEnd = passes.BlockCornerStarts[first / NORMAL_TASK_SIZE + 1];
+		std::fill(offsets + first, offsets + end, 0u);
+		for (uint32_t i = blockStart; i < blockEnd; i++)
+		{
+			offsets[passes.Indices[passes.BlockCorners[i]]]++;
+		}
+		uint32_t start = blockStart;
+		for (size_t vertex = first; vertex < end; vertex++)
+		{
+			uint32_t count = offsets[vertex];
+			offsets[vertex] = start;
+			start += count;
+		}
+
+		// Placing the corners moves each offset on to the start of the next vertex's corners, so they are
+		// moved back afterwards
+		for (uint32_t i = blockStart; i < blockEnd; i++)
+		{
+			uint32_t corner = passes.BlockCorners[i];
+			passes.VertexCorners[offsets[passes.Indices[corner]]++] = corner;
+		}
+		for (size_t vertex = end - 1; vertex > first; vertex--)
+		{
+			offsets[vertex] = offsets[vertex - 1];
+		}
+		offsets[first] = blockStart;
+	}
+}
+
+void VertexNormalGenerator::Generate(Vertex * vertices, size_t vertexCount, const uint32_t * indices, size_t indexCount,
+									 NormalWeighting weighting, ThreadPool * threadPool)
+{
+	// Any indices after the last whole triangle are ignored
+	size_t triangleCount = indexCount / 3;
+	size_t cornerCount = triangleCount * 3;
+
+	NormalPasses passes;
+	passes.Vertices = vertices;
+	passes.Indices = indices;
+	passes.Weighting = weighting;
+	passes.Scatter = threadPool == nullptr || threadPool->GetThreadCount() == 1 || triangleCount <= NORMAL_TASK_SIZE;
+	passes.Simd = IsSimdUsed();
+	if (passes.Simd)
+	{
+		_positionsX.resize(vertexCount);
+		_positionsY.resize(vertexCount);
+		_positionsZ.resize(vertexCount);
+		passes.PositionsX = _positionsX.data();
+		passes.PositionsY = _positionsY.data();
+		passes.PositionsZ = _positionsZ.data();
+	}
+	if (passes.Scatter)
+	{
+		// On one thread, each triangle is added to its vertices as soon as its normal is known
+		_normalSums.assign(vertexCount * 4, 0.0f);
+		passes.NormalSums = _normalSums.data();
+		TransposePositions(passes, 0, vertexCount);
+		CalculateTriangleNormals(passes, 0, triangleCount);
+		FinishVertexNormals(passes, 0, vertexCount);
+		return;
+	}
+
+	_triangleNormalsX.resize(triangleCount);
+	_triangleNormalsY.resize(triangleCount);
+	_triangleNormalsZ.resize(triangleCount);
+	_cornerAngles.resize(weighting == NormalWeighting::Angle ? cornerCount : 0);
+	_normalSums.resize(vertexCount * 4);
+	passes.TriangleNormalsX = _triangleNormalsX.data();
+	passes.TriangleNormalsY = _triangleNormalsY.data();
+	passes.TriangleNormalsZ = _triangleNormalsZ.data();
+	passes.CornerAngles = _cornerAngles.data();
+	passes.NormalSums = _normalSums.data();
+	ForEachNormalRange(threadPool, vertexCount, [&passes](size_t first, size_t end) { TransposePositions(passes, first, end); });
+	ForEachNormalRange(threadPool, triangleCount, [&passes](size_t first, size_t end) { CalculateTriangleNormals(passes, first, end); });
+
+	// Sort the corners by vertex
+	const size_t rangeCount = std::max<size_t>((cornerCount + NORMAL_TASK_SIZE - 1) / NORMAL_TASK_SIZE, 1);
+	passes.BlockCount = (vertexCount + NORMAL_TASK_SIZE - 1) / NORMAL_TASK_SIZE;
+	_rangeBlockCorners.resize(rangeCount * passes.BlockCount);
+	_blockCornerStarts.resize(passes.BlockCount + 1);
+	_blockCorners.resize(cornerCount);
+	_vertexCornerOffsets.resize(vertexCount + 1);
+	_vertexCorners.resize(cornerCount);
+	passes.RangeBlockCorners = _rangeBlockCorners.data();
+	passes.BlockCornerStarts = _blockCornerStarts.data();
+	passes.BlockCorners = _blockCorners.data();
+	passes.VertexCornerOffsets = _vertexCornerOffsets.data();
+	passes.VertexCorners = _vertexCorners.data();
+	ForEachNormalRange(threadPool, cornerCount, [&passes](size_t first, size_t end) { CountBlockCorners(passes, first, end); });
+
+	// Each block's corners start after those of the blocks before it, and within a block, each range's
+	// corners start after those of the ranges before it
+	uint32_t start = 0;
+	for (size_t block = 0; block < passes.BlockCount; block++)
+	{
+		_blockCornerStarts[block] = start;
+		for (size_t range = 0; range < rangeCount; range++)
+		{
+			uint32_t count = _rangeBlockCorners[range * passes.BlockCount + block];
+			_rangeBlockCorners[range * passes.BlockCount + block] = start;
+			start += count;
+		}
+	}
+	_blockCornerStarts[passes.BlockCount] = start;
+	_vertexCornerOffsets[vertexCount] = start;
+	ForEachNormalRange(threadPool, cornerCount, [&passes](size_t first, size_t end) { PlaceBlockCorners(passes, first, end); });
+	ForEachNormalRange(threadPool, vertexCount, [&passes](size_t first, size_t end) { SortBlockCorners(passes, first, end); });
+
+	ForEachNormalRange(threadPool, vertexCount, [&passes](size_t first, size_t end) { GatherVertexNormals(passes, first, end); });
+}
+
+bool VertexNormalGenerator::IsSimdUsed() const
+{
+#if defined(VERTEX_NORMALS_SSE)
+	return _simdUsed;
+#else
+	return false;
+#endif
+}
+
+void VertexNormalGenerator::SetSimdUsed(bool used)
+{
+	_simdUsed = used;
+}
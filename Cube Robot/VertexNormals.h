@@ -0,0 +1,74 @@
+#pragma once
+#include "ShaderStructures.h"
+#include "ThreadPool.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Vertex normals for indexed triangle lists.
+//
+// The normal of each vertex is the normalised, weighted sum of the normals of the triangles that use
+// it.  The positions are first copied into an array for each coordinate, so that the normals of the
+// triangles (and, for NormalWeighting::Angle, the angles at their corners) can be calculated four at a
+// time with SSE.  Each vertex's sums are kept together, so that a triangle is added to a vertex with one
+// SSE add, and the sums are normalised four at a time.
+//
+// Without a thread pool (or for a mesh too small to be worth splitting), each triangle is added to the
+// sums of its vertices as soon as its normal is known.  Otherwise the work is split into ranges that
+// are run on the pool, in three passes:
+//
+//	1.	The weighted normal of each triangle is calculated.
+//	2.	The corners of the triangles are sorted by vertex (a counting sort, giving an index in
+//		compressed sparse row form), so that each vertex can find the triangles that use it.  The
+//		corners are sorted into blocks of vertices first, then each block is sorted on its own, so
+//		both steps are split between the threads.
+//	3.	Each vertex gathers the normals of its triangles, and the sums are normalised and written into
+//		the vertices.
+//
+// Since each vertex sums its own triangles, no two threads write to the same vertex, so no atomics
+// are needed.  The triangles are always added in the order they are in the index list, so the normals
+// are exactly the same whether or not a thread pool is used, and whatever the number of threads.
+//
+// A vertex that no triangle uses, or whose triangles all have zero area, is given a zero normal.
+// The buffers used by each pass are kept by the generator, so generating the normals of another mesh
+// of the same size or smaller does not allocate.
+
+enum class NormalWeighting
+{
+	Area,				// Larger triangles count for more.  This is what adding up the cross products of the edges gives.
+	Angle,				// Each triangle counts by the angle of its corner at the vertex, so the normal does not depend on how the faces around it are split into triangles
+	Uniform				// Every triangle counts the same
+};
+
+class VertexNormalGenerator
+{
+public:
+	void Generate(Vertex * vertices, size_t vertexCount, const uint32_t * indices, size_t indexCount,
+				  NormalWeighting weighting = NormalWeighting::Area, ThreadPool * threadPool = nullptr);
+
+	inline void Generate(std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+						 NormalWeighting weighting = NormalWeighting::Area, ThreadPool * threadPool = nullptr)
+	{
+		Generate(vertices.data(), vertices.size(), indices.data(), indices.size(), weighting, threadPool);
+	}
+
+	// Whether SSE is used, or the same calculations are done one at a time
+	bool IsSimdUsed() const;
+	void SetSimdUsed(bool used);
+
+private:
+	std::vector<float>		_positionsX;				// The positions of the vertices, one array for each coordinate.  Only used with SSE.
+	std::vector<float>		_positionsY;
+	std::vector<float>		_positionsZ;
+	std::vector<float>		_triangleNormalsX;			// Weighted by area, or of unit length for the other weightings.  Only used with a thread pool.
+	std::vector<float>		_triangleNormalsY;
+	std::vector<float>		_triangleNormalsZ;
+	std::vector<float>		_cornerAngles;				// Three for each triangle, if weighted by angle and a thread pool is used
+	std::vector<uint32_t>	_rangeBlockCorners;			// Used to sort the corners by block of vertices, then by vertex
+	std::vector<uint32_t>	_blockCornerStarts;
+	std::vector<uint32_t>	_blockCorners;
+	std::vector<uint32_t>	_vertexCornerOffsets;		// Where the corners of each vertex start in _vertexCorners
+	std::vector<uint32_t>	_vertexCorners;				// The index of each corner (in the index list), sorted by vertex
+	std::vector<float>		_normalSums;				// Four for each vertex
+	bool					_simdUsed{ true };
+};
@@ -0,0 +1,281 @@
+#include "WeldingBenchmark.h"
+#include "MeshWelding.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <fstream>
+#include <limits>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+// The tolerance used for positions and normals, except where a case says otherwise
+constexpr float WELDING_BENCHMARK_TOLERANCE = 1e-5f;
+constexpr float WELDING_BENCHMARK_NORMAL_TOLERANCE = 1e-3f;
+
+// Entries in the simulated post-transform vertex cache
+constexpr size_t WELDING_BENCHMARK_CACHE_SIZE = 32;
+
+// Build a sphere of radius 1 the way ComputeSphere in the samples does: a row of segments + 1 vertices
+// for each of rings + 1 rings from pole to pole, so that the first and last vertices of each row are
+// in the same place and every vertex of the first and last rows is at a pole
+
+void BuildSampleSphere(vector<Vertex>& vertices, vector<uint32_t>& indices, uint32_t rings, uint32_t segments)
+{
+	const float pi = 3.14159265358979f;
+	vertices.clear();
+	for (uint32_t ring = 0; ring <= rings; ring++)
+	{
+		float latitude = pi * ring / rings;
+		for (uint32_t segment = 0; segment <= segments; segment++)
+		{
+			float longitude = 2.0f * pi * segment / segments;
+			Vertex vertex;
+			vertex.Position = Vector3(sinf(latitude) * cosf(longitude), cosf(latitude), sinf(latitude) * sinf(longitude));
+			vertex.Normal = vertex.Position;
+			vertices.push_back(vertex);
+		}
+	}
+	indices.clear();
+	const uint32_t rowLength = segments + 1;
+	for (uint32_t ring = 0; ring < rings; ring++)
+	{
+		for (uint32_t segment = 0; segment < segments; segment++)
+		{
+			uint32_t topLeft = ring * rowLength + segment;
+			uint32_t bottomLeft = topLeft + rowLength;
+			indices.insert(indices.end(), { topLeft, topLeft + 1, bottomLeft });
+			indices.insert(indices.end(), { topLeft + 1, bottomLeft + 1, bottomLeft });
+		}
+	}
+}
+
+// A cube with four vertices for each face, each with the normal of its face, like the one in Geometry.h
+
+void BuildFacetedCube(vector<Vertex>& vertices, vector<uint32_t>& indices)
+{
+	vertices.clear();
+	indices.clear();
+	for (int axis = 0; axis < 3; axis++)
+	{
+		for (float side : { -1.0f, 1.0f })
+		{
+			uint32_t first = static_cast<uint32_t>(vertices.size());
+			for (int corner = 0; corner < 4; corner++)
+			{
+				float coordinates[3];
+				coordinates[axis] = side;
+				coordinates[(axis + 1) % 3] = corner & 1 ? 1.0f : -1.0f;
+				coordinates[(axis + 2) % 3] = corner & 2 ? 1.0f : -1.0f;
+				float normal[3] = { 0.0f, 0.0f, 0.0f };
+				normal[axis] = side;
+				Vertex vertex;
+				vertex.Position = Vector3(coordinates[0], coordinates[1], coordinates[2]);
+				vertex.Normal = Vector3(normal[0], normal[1], normal[2]);
+				vertices.push_back(vertex);
+			}
+			indices.insert(indices.end(), { first, first + 1, first + 2, first + 2, first + 1, first + 3 });
+		}
+	}
+}
+
+// A grid of size by size squares in which every triangle has its own three vertices, each moved by up
+// to jitter in each direction, as a mesh loaded from a file without an index often is
+
+void BuildTriangleSoupGrid(vector<Vertex>& vertices, vector<uint32_t>& indices, uint32_t size, float jitter)
+{
+	mt19937 random(2468);
+	uniform_real_distribution<float> offset(-jitter, jitter);
+	vertices.clear();
+	indices.clear();
+	const uint32_t corners[6][2] = { { 0, 0 }, { 0, 1 }, { 1, 0 }, { 1, 0 }, { 0, 1 }, { 1, 1 } };
+	for (uint32_t row = 0; row < size; row++)
+	{
+		for (uint32_t column = 0; column < size; column++)
+		{
+			for (const uint32_t * corner : corners)
+			{
+				Vertex vertex;
+				vertex.Position = Vector3(static_cast<float>(column + corner[0]) / size + offset(random), 0.0f, static_cast<float>(row + corner[1]) / size + offset(random));
+				vertex.Normal = Vector3(0.0f, 1.0f, 0.0f);
+				indices.push_back(static_cast<uint32_t>(vertices.size()));
+				vertices.push_back(vertex);
+			}
+		}
+	}
+}
+
+// Two copies of a triangle a long way out, two copies of a triangle near the largest float, and two
+// copies of a triangle with a corner that is not a number, each copy with its own vertices.  Each pair
+// should share its vertices once welded, except for the corners that are not numbers.
+
+void BuildFarTriangles(vector<Vertex>& vertices, vector<uint32_t>& indices)
+{
+	const float notANumber = numeric_limits<float>::quiet_NaN();
+	const Vector3 triangles[3][3] =
+	{
+		{ Vector3(1e30f, 0.0f, 0.0f), Vector3(1e30f, 0.0f, 1.0f), Vector3(1e30f, 1.0f, 0.0f) },
+		{ Vector3(-3e38f, 0.0f, 0.0f), Vector3(-3e38f, 0.0f, 3e38f), Vector3(-3e38f, 3e38f, 0.0f) },
+		{ Vector3(notANumber, 0.0f, 0.0f), Vector3(0.0f, 5.0f, 0.0f), Vector3(0.0f, 5.0f, 1.0f) }
+	};
+	vertices.clear();
+	indices.clear();
+	for (const Vector3 * triangle : triangles)
+	{
+		for (int copy = 0; copy < 2; copy++)
+		{
+			for (int corner = 0; corner < 3; corner++)
+			{
+				Vertex vertex;
+				vertex.Position = triangle[corner];
+				vertex.Normal = Vector3(1.0f, 0.0f, 0.0f);
+				indices.push_back(static_cast<uint32_t>(vertices.size()));
+				vertices.push_back(vertex);
+			}
+		}
+	}
+}
+
+// The average number of vertices that have to be transformed for each triangle, with a first-in,
+// first-out cache of the last vertices transformed like the one in the GPU
+
+double TransformCacheMissRatio(const vector<uint32_t>& indices, size_t vertexCount)
+{
+	vector<bool> cached(vertexCount, false);
+	deque<uint32_t> cache;
+	size_t misses = 0;
+	for (uint32_t index : indices)
+	{
+		if (cached[index])
+		{
+			continue;
+		}
+		misses++;
+		cached[index] = true;
+		cache.push_back(index);
+		if (cache.size() > WELDING_BENCHMARK_CACHE_SIZE)
+		{
+			cached[cache.front()] = false;
+			cache.pop_front();
+		}
+	}
+	return indices.empty() ? 0.0 : 3.0 * misses / indices.size();
+}
+
+// Whether each triangle left after welding is in the same place as the next triangle of the original
+// mesh that did not collapse, taken in order.  Coordinates that are not numbers match anything.
+
+bool WeldedTrianglesMatch(const vector<Vertex>& originalVertices, const vector<uint32_t>& originalIndices,
+						  const vector<Vertex>& weldedVertices, const vector<uint32_t>& weldedIndices, float tolerance)
+{
+	auto samePlace = [tolerance](const Vector3& a, const Vector3& b) { return !((a - b).LengthSquared() > tolerance * tolerance); };
+	size_t welded = 0;
+	for (size_t i = 0; i + 2 < originalIndices.size(); i += 3)
+	{
+		const Vector3& original0 = originalVertices[originalIndices[i]].Position;
+		const Vector3& original1 = originalVertices[originalIndices[i + 1]].Position;
+		const Vector3& original2 = originalVertices[originalIndices[i + 2]].Position;
+		if (welded + 2 < weldedIndices.size() &&
+			samePlace(original0, weldedVertices[weldedIndices[welded]].Position) &&
+			samePlace(original1, weldedVertices[weldedIndices[welded + 1]].Position) &&
+			samePlace(original2, weldedVertices[weldedIndices[welded + 2]].Position))
+		{
+			welded += 3;
+		}
+		else if (!samePlace(original0, original1) && !samePlace(original1, original2) && !samePlace(original2, original0))
+		{
+			return false;
+		}
+	}
+	return welded == weldedIndices.size();
+}
+
+int RunWeldingBenchmarks(const std::string& resultsFileName)
+{
+	ofstream results(resultsFileName);
+	if (!results)
+	{
+		return -1;
+	}
+
+	struct WeldingCase
+	{
+		const char *	Mesh;
+		WeldAttributes	Attributes;
+		float			Tolerance;
+		size_t			ExpectedVertices;
+		size_t			ExpectedTrianglesRemoved;
+	};
+	const uint32_t smallRings = 64;
+	const uint32_t smallSegments = 128;
+	const uint32_t largeRings = 700;
+	const uint32_t largeSegments = 1400;
+	const uint32_t gridSize = 300;
+	const WeldingCase cases[] =
+	{
+		{ "sphere", WeldAttributes::PositionAndNormal, WELDING_BENCHMARK_TOLERANCE, (smallRings - 1) * smallSegments + 2, 2 * smallSegments },
+		{ "sphere", WeldAttributes::Position, WELDING_BENCHMARK_TOLERANCE, (smallRings - 1) * smallSegments + 2, 2 * smallSegments },
+		{ "large_sphere", WeldAttributes::Position, WELDING_BENCHMARK_TOLERANCE, (largeRings - 1) * largeSegments + 2, 2 * largeSegments },
+		{ "faceted_cube", WeldAttributes::PositionAndNormal, WELDING_BENCHMARK_TOLERANCE, 24, 0 },
+		{ "faceted_cube", WeldAttributes::Position, WELDING_BENCHMARK_TOLERANCE, 8, 0 },
+		{ "triangle_soup", WeldAttributes::PositionAndNormal, 0.0f, (gridSize + 1) * (gridSize + 1), 0 },
+		{ "jittered_triangle_soup", WeldAttributes::PositionAndNormal, WELDING_BENCHMARK_TOLERANCE, (gridSize + 1) * (gridSize + 1), 0 },
+		{ "far_triangles", WeldAttributes::PositionAndNormal, WELDING_BENCHMARK_TOLERANCE, 10, 0 }
+	};
+
+	bool allPassed = true;
+	MeshWelder welder;
+	vector<Vertex> originalVertices;
+	vector<uint32_t> originalIndices;
+	results << "benchmark,mesh,attributes,tolerance,vertices_before,vertices_after,expected_vertices,triangles_removed,expected_triangles_removed,"
+			<< "misses_per_triangle_before,misses_per_triangle_after,ms,vertices_per_second,triangles_match,passes" << endl;
+	for (const WeldingCase& weldingCase : cases)
+	{
+		string mesh = weldingCase.Mesh;
+		if (mesh == "sphere")
+		{
+			BuildSampleSphere(originalVertices, originalIndices, smallRings, smallSegments);
+		}
+		else if (mesh == "large_sphere")
+		{
+			BuildSampleSphere(originalVertices, originalIndices, largeRings, largeSegments);
+		}
+		else if (mesh == "faceted_cube")
+		{
+			BuildFacetedCube(originalVertices, originalIndices);
+		}
+		else if (mesh == "far_triangles")
+		{
+			BuildFarTriangles(originalVertices, originalIndices);
+		}
+		else
+		{
+			// Moved by at most a quarter of the tolerance in each direction, so the copies of a corner are within half the tolerance of each other
+			BuildTriangleSoupGrid(originalVertices, originalIndices, gridSize, weldingCase.Tolerance * 0.25f);
+		}
+
+		vector<Vertex> vertices = originalVertices;
+		vector<uint32_t> indices = originalIndices;
+		auto start = chrono::steady_clock::now();
+		WeldStatistics statistics = welder.Weld(vertices, indices, weldingCase.Tolerance, weldingCase.Attributes, WELDING_BENCHMARK_NORMAL_TOLERANCE);
+		double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+		bool trianglesMatch = WeldedTrianglesMatch(originalVertices, originalIndices, vertices, indices, max(weldingCase.Tolerance, 1e-7f));
+		bool passes = trianglesMatch &&
+					  statistics.VerticesBefore == originalVertices.size() &&
+					  statistics.VerticesAfter == vertices.size() &&
+					  statistics.VerticesAfter == weldingCase.ExpectedVertices &&
+					  statistics.TrianglesRemoved == weldingCase.ExpectedTrianglesRemoved &&
+					  indices.size() == originalIndices.size() - 3 * statistics.TrianglesRemoved;
+		allPassed = allPassed && passes;
+		results << "welding," << mesh << "," << (weldingCase.Attributes == WeldAttributes::Position ? "position" : "position_and_normal") << ","
+				<< weldingCase.Tolerance << "," << statistics.VerticesBefore << "," << statistics.VerticesAfter << "," << weldingCase.ExpectedVertices << ","
+				<< statistics.TrianglesRemoved << "," << weldingCase.ExpectedTrianglesRemoved << ","
+				<< TransformCacheMissRatio(originalIndices, originalVertices.size()) << "," << TransformCacheMissRatio(indices, vertices.size()) << ","
+				<< 1000.0 * seconds << "," << statistics.VerticesBefore / max(seconds, 1e-9) << "," << (trianglesMatch ? "yes" : "no") << ","
+				<< (passes ? "yes" : "no") << endl;
+	}
+	return allPassed ? 0 : 1;
+}
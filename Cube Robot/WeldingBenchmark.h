@@ -0,0 +1,15 @@
+#pragma once
+#include <string>
+
+// Benchmarks and checks for MeshWelder.  A sphere built the way the samples build one (with a repeated
+// column of vertices down its seam and a ring of vertices at each pole), a grid of squares whose
+// triangles each have their own vertices, moved by less than the tolerance, a cube with a normal for
+// each face, and triangles whose coordinates are too large for the cells or are not numbers are
+// welded.  The number of vertices left and triangles removed must be what each mesh should give, the
+// triangles that are left must be in the same places as before, and the cube must keep its hard edges
+// unless only positions are compared.  The time taken and the average number of vertices that miss a
+// 32-entry post-transform cache for each triangle, before and after welding, are reported.
+//
+// The results are written as comma-separated values to the file given.
+
+int RunWeldingBenchmarks(const std::string& resultsFileName);
@@ -25,16 +25,27 @@ struct VertexOut
 
 
 
-VertexOut VS(VertexIn vin)
-{
-	VertexOut vout;
-	
-	vout.OutputPosition = mul(WorldViewProjection, float4(vin.InputPosition, 1.0f));
-    //vout.outNormal = vin.Normal;
-    float4 norm = (mul(World, float4(vin.Normal, 0.0f)));
-	
+// The vertex read by VSInstanced.  The per-instance values must match the start of the constant
+// buffer, since the render queue copies them from the constants of each draw it instances.
 
+struct InstancedVertexIn
+{
+	float3 InputPosition				: POSITION;
+	float3 Normal						: NORMAL;
+	float4 WorldViewProjection0			: WORLDVIEWPROJECTION0;
+	float4 WorldViewProjection1			: WORLDVIEWPROJECTION1;
+	float4 WorldViewProjection2			: WORLDVIEWPROJECTION2;
+	float4 WorldViewProjection3			: WORLDVIEWPROJECTION3;
+	float4 World0						: WORLD0;
+	float4 World1						: WORLD1;
+	float4 World2						: WORLD2;
+	float4 World3						: WORLD3;
+	float4 InstanceMaterialColour		: MATERIAL;
+	float4 InstanceAmbientLightColour	: AMBIENT;
+};
 
+float4 CalculateLighting(float4 norm, float4 ambientLightColour, float4 materialColour)
+{
 	// Dot product of adjusted normal and vector back to the light source
     float diffuseLight = saturate(normalize(dot(norm,  - DirectionalLightVector)));
    
@@ -43,13 +54,36 @@ VertexOut VS(VertexIn vin)
     float4 lighting = (DirectionalLightColour * diffuseLight );
 
 	// Add ambient light and ensure each component is between 0 and 1
-    lighting += AmbientLightColour;
+    lighting += ambientLightColour;
 	lighting = saturate(lighting);
 
+	return lighting * materialColour;
+}
 
-	 
-    vout.Colour = lighting * MaterialColour ;
+VertexOut VS(VertexIn vin)
+{
+	VertexOut vout;
+	
+	vout.OutputPosition = mul(WorldViewProjection, float4(vin.InputPosition, 1.0f));
+    //vout.outNormal = vin.Normal;
+    float4 norm = (mul(World, float4(vin.Normal, 0.0f)));
+
+    vout.Colour = CalculateLighting(norm, AmbientLightColour, MaterialColour);
+
+	return vout;
+}
+
+VertexOut VSInstanced(InstancedVertexIn vin)
+{
+	VertexOut vout;
+
+	// The matrices arrive a row at a time, so the vertex is multiplied on the left
+	float4x4 worldViewProjection = float4x4(vin.WorldViewProjection0, vin.WorldViewProjection1, vin.WorldViewProjection2, vin.WorldViewProjection3);
+	float4x4 world = float4x4(vin.World0, vin.World1, vin.World2, vin.World3);
+	vout.OutputPosition = mul(float4(vin.InputPosition, 1.0f), worldViewProjection);
+	float4 norm = mul(float4(vin.Normal, 0.0f), world);
 
+	vout.Colour = CalculateLighting(norm, vin.InstanceAmbientLightColour, vin.InstanceMaterialColour);
 
 	return vout;
 }
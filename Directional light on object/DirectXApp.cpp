@@ -67,22 +67,6 @@ void DirectXApp::Update()
 }
 void DirectXApp::Render()
 {
-	// Setup the structure that specifies how big the index buffer should be
-	D3D11_BUFFER_DESC indexBufferDescriptor = { 0 };
-	indexBufferDescriptor.Usage = D3D11_USAGE_IMMUTABLE;
-	indexBufferDescriptor.ByteWidth = sizeof(UINT) * indices.size();
-	indexBufferDescriptor.BindFlags = D3D11_BIND_INDEX_BUFFER;
-	indexBufferDescriptor.CPUAccessFlags = 0;
-	indexBufferDescriptor.MiscFlags = 0;
-	indexBufferDescriptor.StructureByteStride = 0;
-
-	// Now set up a structure that tells DirectX where to get the data for the indices from
-	D3D11_SUBRESOURCE_DATA indexInitialisationData;
-	indexInitialisationData.pSysMem = indices.data();
-
-	// and create the index buffer
-	ThrowIfFailed(_device->CreateBuffer(&indexBufferDescriptor, &indexInitialisationData, _indexBuffer.GetAddressOf()));
-
 	const float clearColour[] = { 0.0f, 0.0f, 0.0f, 1.0f };
 	_deviceContext->ClearRenderTargetView(_renderTargetView.Get(), clearColour);
 	_deviceContext->ClearDepthStencilView(_depthStencilView.Get(), D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
@@ -1,6 +1,6 @@
 #include "DirectXApp.h"
 
-// Geometry.h contains the vertex and constant buffer structures
+// Geometry.h contains the vertex and instance data structures
 // as well as the vertices and indices for a cube
 
 #include "Geometry.h"
@@ -30,7 +30,7 @@ bool DirectXApp::Initialise()
 	BuildGeometryBuffers();
 	BuildShaders();
 	BuildVertexLayout();
-	BuildConstantBuffer();
+	BuildInstanceBuffer();
 	BuildRasteriserState();
 
 	return true;
@@ -52,22 +52,23 @@ void DirectXApp::Render()
 	_viewTransformation = XMMatrixLookAtLH(_eyePosition, _focalPointPosition, _upVector);
 	_projectionTransformation = XMMatrixPerspectiveFovLH(XM_PIDIV4, static_cast<float>(GetWindowWidth()) / GetWindowHeight(), 1.0f, 100.0f);
 
-	// Calculate the world x view x projection transformation
-	Matrix completeTransformation = _worldTransformation * _viewTransformation * _projectionTransformation;
-
-	CBuffer constantBuffer;
-	constantBuffer.WorldViewProjection = completeTransformation;
-
-	// Update the constant buffer. Note the layout of the constant buffer must match that in the shader
-	_deviceContext->VSSetConstantBuffers(0, 1, _constantBuffer.GetAddressOf());
-	_deviceContext->UpdateSubresource(_constantBuffer.Get(), 0, 0, &constantBuffer, 0, 0);
-
-	// Now render the cube
-	// Specify the distance between vertices and the starting point in the vertex buffer
-	UINT stride = sizeof(Vertex);
-	UINT offset = 0;
-	// Set the vertex buffer and index buffer we are going to use
-	_deviceContext->IASetVertexBuffers(0, 1, _vertexBuffer.GetAddressOf(), &stride, &offset);
+	// Both cubes use the same vertices and shaders, so rather than updating a constant buffer
+	// and drawing each cube in turn, the world x view x projection transformation of each cube
+	// is written to the instance buffer and both are drawn at once
+	D3D11_MAPPED_SUBRESOURCE mappedInstances;
+	ThrowIfFailed(_deviceContext->Map(_instanceBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedInstances));
+	InstanceData * instances = static_cast<InstanceData *>(mappedInstances.pData);
+	instances[0].WorldViewProjection = _worldTransformation * _viewTransformation * _projectionTransformation;
+	instances[1].WorldViewProjection = _worldTransformation2 * _viewTransformation * _projectionTransformation;
+	_deviceContext->Unmap(_instanceBuffer.Get(), 0);
+
+	// Now render the cubes
+	// Specify the distance between vertices (and between instances) and the starting point in each buffer
+	ID3D11Buffer * vertexBuffers[] = { _vertexBuffer.Get(), _instanceBuffer.Get() };
+	UINT strides[] = { sizeof(Vertex), sizeof(InstanceData) };
+	UINT offsets[] = { 0, 0 };
+	// Set the vertex buffers and index buffer we are going to use
+	_deviceContext->IASetVertexBuffers(0, ARRAYSIZE(vertexBuffers), vertexBuffers, strides, offsets);
 	_deviceContext->IASetIndexBuffer(_indexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
 
 	// Specify the layout of the polygons (it will rarely be different to this)
@@ -83,14 +84,8 @@ void DirectXApp::Render()
 	// Specify details about how the object is to be drawn
 	_deviceContext->RSSetState(_rasteriserState.Get());
 
-	// Now draw the object
-	_deviceContext->DrawIndexed(ARRAYSIZE(indices), 0, 0);
-
-	// Rendering second cube
-	Matrix completeTransformation2 = _worldTransformation2 * _viewTransformation * _projectionTransformation;
-	constantBuffer.WorldViewProjection = completeTransformation2;
-	_deviceContext->UpdateSubresource(_constantBuffer.Get(), 0, 0, &constantBuffer, 0, 0);
-	_deviceContext->DrawIndexed(ARRAYSIZE(indices), 0, 0);
+	// Now draw every instance of the cube
+	_deviceContext->DrawIndexedInstanced(ARRAYSIZE(indices), InstanceCount, 0, 0, 0);
 
 	// Update the window
 	ThrowIfFailed(_swapChain->Present(0, 0));
@@ -313,15 +308,18 @@ void DirectXApp::BuildVertexLayout()
 	ThrowIfFailed(_device->CreateInputLayout(vertexDesc, ARRAYSIZE(vertexDesc), _vertexShaderByteCode->GetBufferPointer(), _vertexShaderByteCode->GetBufferSize(), _layout.GetAddressOf()));
 }
 
-void DirectXApp::BuildConstantBuffer()
+void DirectXApp::BuildInstanceBuffer()
 {
+	// The instance data is rewritten every frame, so the buffer is dynamic and
+	// the CPU is allowed to write to it
 	D3D11_BUFFER_DESC bufferDesc;
 	ZeroMemory(&bufferDesc, sizeof(bufferDesc));
-	bufferDesc.Usage = D3D11_USAGE_DEFAULT;
-	bufferDesc.ByteWidth = sizeof(CBuffer);
-	bufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	bufferDesc.ByteWidth = sizeof(InstanceData) * InstanceCount;
+	bufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
 
-	ThrowIfFailed(_device->CreateBuffer(&bufferDesc, NULL, _constantBuffer.GetAddressOf()));
+	ThrowIfFailed(_device->CreateBuffer(&bufferDesc, NULL, _instanceBuffer.GetAddressOf()));
 }
 
 void DirectXApp::BuildRasteriserState()
@@ -34,7 +34,7 @@ private:
 	ComPtr<ID3D11VertexShader>		_vertexShader;
 	ComPtr<ID3D11PixelShader>		_pixelShader;
 	ComPtr<ID3D11InputLayout>		_layout;
-	ComPtr<ID3D11Buffer>			_constantBuffer;
+	ComPtr<ID3D11Buffer>			_instanceBuffer;
 
 	ComPtr<ID3D11RasterizerState>   _rasteriserState;
 
@@ -55,7 +55,7 @@ private:
 	void BuildGeometryBuffers();
 	void BuildShaders();
 	void BuildVertexLayout();
-	void BuildConstantBuffer();
+	void BuildInstanceBuffer();
 	void BuildRasteriserState();
 };
 
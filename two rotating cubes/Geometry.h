@@ -1,13 +1,18 @@
 #pragma once
 
 #define ShaderFileName		L"shader.hlsl"
-#define VertexShaderName	"VS"
+#define VertexShaderName	"VSInstanced"
 #define PixelShaderName		"PS" 
 
-// Format of the constant buffer. This must match the format of the
-// cbuffer structure in the shader
+// The number of cubes drawn.  They share the vertices and indices below, so they are all drawn
+// with a single instanced draw.
 
-struct CBuffer
+constexpr UINT InstanceCount = 2;
+
+// Format of the data for each instance of the cube.  This must match the per-instance
+// part of the input vertex in the shader
+
+struct InstanceData
 {
 	Matrix		WorldViewProjection; 
 };
@@ -21,11 +26,17 @@ struct Vertex
 };
 
 // The description of the vertex that is passed to CreateInputLayout.  This must
-// match the format of the vertex above and the format of the input vertex in the shader
+// match the format of the vertex and instance data above and the format of the input
+// vertex in the shader.  The vertices come from the first buffer and the rows of each
+// cube's transformation come from the second, moving on once for each instance.
 
 D3D11_INPUT_ELEMENT_DESC vertexDesc[] =
 {
 	{ "POSITION", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	{ "WORLDVIEWPROJECTION", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+	{ "WORLDVIEWPROJECTION", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 16, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+	{ "WORLDVIEWPROJECTION", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 32, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+	{ "WORLDVIEWPROJECTION", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 48, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
 };
 
 // This example uses hard-coded vertices and indices for a cube. Usually, you will load the verticesa and indices from a model file. 
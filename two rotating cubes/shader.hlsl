@@ -1,12 +1,13 @@
 
-cbuffer ConstantBuffer 
-{
-	matrix worldViewProjection; 
-};
+// The transformation of each instance arrives a row at a time with the instance data
 
 struct VertexIn
 {
-	float4 InputPosition : POSITION;
+	float4 InputPosition		: POSITION;
+	float4 WorldViewProjection0	: WORLDVIEWPROJECTION0;
+	float4 WorldViewProjection1	: WORLDVIEWPROJECTION1;
+	float4 WorldViewProjection2	: WORLDVIEWPROJECTION2;
+	float4 WorldViewProjection3	: WORLDVIEWPROJECTION3;
 };
 
 struct VertexOut
@@ -14,12 +15,14 @@ struct VertexOut
 	float4 OutputPosition : SV_POSITION;
 };
 
-VertexOut VS(VertexIn vin)
+VertexOut VSInstanced(VertexIn vin)
 {
 	VertexOut vout;
 	
-	// Transform to homogeneous clip space.
-	vout.OutputPosition = mul(worldViewProjection, vin.InputPosition);
+	// Transform to homogeneous clip space.  The matrix was built from its rows, so the
+	// vertex is multiplied on the left.
+	float4x4 worldViewProjection = float4x4(vin.WorldViewProjection0, vin.WorldViewProjection1, vin.WorldViewProjection2, vin.WorldViewProjection3);
+	vout.OutputPosition = mul(vin.InputPosition, worldViewProjection);
 	
     return vout;
 }